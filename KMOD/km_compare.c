@@ -0,0 +1,603 @@
+#include <km_compare.h>
+#include <km_debug.h>
+
+///////////////////////////////////////////////////////////
+// Locals
+///////////////////////////////////////////////////////////
+
+static LONG s_avx2Supported = -1;
+
+///////////////////////////////////////////////////////////
+// Compare utilities
+///////////////////////////////////////////////////////////
+
+static
+NTSTATUS
+KmAllocateTextPattern(
+  PPATTERN* pattern,
+  PWCHAR text,
+  DWORD32 length,
+  BOOLEAN wide,
+  BOOLEAN ignoreCase)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Compile text for a single encoding
+  *pattern = ExAllocatePoolWithTag(NonPagedPool, sizeof(PATTERN), KM_MEMORY_POOL_TAG);
+  if (*pattern)
+  {
+    status = KmCompileText(*pattern, text, length, wide, ignoreCase) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+    if (NT_SUCCESS(status) == FALSE)
+    {
+      ExFreePoolWithTag(*pattern, KM_MEMORY_POOL_TAG);
+      *pattern = NULL;
+    }
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Group utilities
+///////////////////////////////////////////////////////////
+
+static
+DWORD32
+KmGetGroupMemberRarity(
+  PSCAN_GROUP_MEMBER member,
+  DWORD32 width)
+{
+  // Zero, all bits set, small integers and unit reals are the most common values in memory
+  if (KmIsRealCompare(member->Type))
+  {
+    double real = (width == sizeof(float)) ? *(float*)member->Value : *(double*)member->Value;
+    return (real == 0.0 || real == 1.0 || real == -1.0) ? width : width * 4;
+  }
+
+  DWORD64 bits = 0;
+  RtlCopyMemory(&bits, member->Value, width);
+  DWORD64 ones = (width < sizeof(DWORD64)) ? ((1ULL << (width * 8)) - 1) : MAXULONG64;
+  if (bits == 0 || bits == ones)
+  {
+    return 0;
+  }
+  return (bits < 0x100) ? width : width * 4;
+}
+
+static __forceinline
+BOOLEAN
+KmMatchGroupMember(
+  PGROUP_COMPARE group,
+  DWORD32 index,
+  PBYTE bytes)
+{
+  DWORD32 width = group->Widths[index];
+
+  // Reals compare against their closed range, integers bitwise
+  if (KmIsRealCompare(group->Group.Members[index].Type))
+  {
+    double element = (width == sizeof(float)) ? *(float*)bytes : *(double*)bytes;
+    return element >= group->Low[index] && element <= group->High[index];
+  }
+
+  return RtlEqualMemory(bytes, group->Group.Members[index].Value, width);
+}
+
+static
+BOOLEAN
+KmVerifyGroup(
+  PGROUP_COMPARE group,
+  PBYTE bytes,
+  DWORD32 limit)
+{
+  // The anchor already matched, every other member has to be found inside the window
+  for (DWORD32 i = 0; i < group->Group.Count; i++)
+  {
+    DWORD32 width = group->Widths[i];
+    DWORD32 offset = group->Group.Members[i].Offset;
+    if (i == group->Anchor)
+    {
+      continue;
+    }
+
+    BOOLEAN found = FALSE;
+    if (offset != SCAN_GROUP_ANY_OFFSET)
+    {
+      found = (offset + width) <= limit && KmMatchGroupMember(group, i, bytes + offset);
+    }
+    else
+    {
+      for (offset = 0; (offset + width) <= limit && found == FALSE; offset += group->Alignments[i])
+      {
+        found = KmMatchGroupMember(group, i, bytes + offset);
+      }
+    }
+    if (found == FALSE)
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static
+DWORD32
+KmMatchGroup(
+  PGROUP_COMPARE group,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+
+  // Search the anchor from an aligned origin so its kernel keeps the requested alignment
+  DWORD32 anchorOffset = group->Group.Members[group->Anchor].Offset;
+  DWORD32 origin = anchorOffset - (anchorOffset % group->AnchorCompare.Alignment);
+  if (size > origin)
+  {
+    DWORD32 hitCount = KmCompareBlock(&group->AnchorCompare, bytes + origin, size - origin, offsets);
+
+    // Verify the window around every hit in place, offsets only ever shrink
+    for (DWORD32 i = 0; i < hitCount; i++)
+    {
+      DWORD32 anchor = origin + offsets[i];
+      if (anchor >= anchorOffset)
+      {
+        DWORD32 start = anchor - anchorOffset;
+        if (KmVerifyGroup(group, bytes + start, min(group->Group.Window, size - start)))
+        {
+          offsets[count++] = start;
+        }
+      }
+    }
+  }
+
+  return count;
+}
+
+static
+NTSTATUS
+KmBeginGroupCompare(
+  PSCAN_COMPARE compare,
+  DWORD32 alignment,
+  DWORD32 rounding,
+  double tolerance,
+  PBYTE value,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  // Validate group shape
+  PSCAN_GROUP request = (PSCAN_GROUP)value;
+  if (size == sizeof(SCAN_GROUP) && request->Count > 0 && request->Count <= SCAN_GROUP_MAX_MEMBERS && request->Window > 0 && request->Window <= SCAN_GROUP_MAX_WINDOW)
+  {
+    compare->Group = ExAllocatePoolWithTag(NonPagedPool, sizeof(GROUP_COMPARE), KM_MEMORY_POOL_TAG);
+    status = compare->Group ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+  }
+  if (NT_SUCCESS(status))
+  {
+    PGROUP_COMPARE group = compare->Group;
+    RtlZeroMemory(group, sizeof(GROUP_COMPARE));
+    group->Group = *request;
+    group->Anchor = MAXDWORD;
+
+    DWORD32 rarity = 0;
+    for (DWORD32 i = 0; i < group->Group.Count && NT_SUCCESS(status); i++)
+    {
+      // Members are fixed width values which fit into the window
+      PSCAN_GROUP_MEMBER member = &group->Group.Members[i];
+      group->Widths[i] = KmGetCompareWidth(member->Type);
+      group->Alignments[i] = KmGetCompareAlignment(member->Type, alignment);
+      status = (group->Widths[i] && group->Alignments[i] && group->Widths[i] <= group->Group.Window) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+      if (NT_SUCCESS(status) && member->Offset != SCAN_GROUP_ANY_OFFSET)
+      {
+        status = (member->Offset <= (group->Group.Window - group->Widths[i])) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+      }
+      if (NT_SUCCESS(status) && KmIsRealCompare(member->Type))
+      {
+        double real = (group->Widths[i] == sizeof(float)) ? *(float*)member->Value : *(double*)member->Value;
+        status = KmGetRealRange(rounding, real, tolerance, &group->Low[i], &group->High[i]) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+      }
+
+      // Anchor on the rarest member at a fixed offset
+      if (NT_SUCCESS(status) && member->Offset != SCAN_GROUP_ANY_OFFSET)
+      {
+        DWORD32 memberRarity = KmGetGroupMemberRarity(member, group->Widths[i]);
+        if (group->Anchor == MAXDWORD || memberRarity > rarity)
+        {
+          group->Anchor = i;
+          rarity = memberRarity;
+        }
+      }
+    }
+
+    // Groups without a fixed member have no start to report
+    if (NT_SUCCESS(status))
+    {
+      status = (group->Anchor != MAXDWORD) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+    }
+    if (NT_SUCCESS(status))
+    {
+      PSCAN_GROUP_MEMBER anchor = &group->Group.Members[group->Anchor];
+      status = KmBeginCompare(&group->AnchorCompare, anchor->Type, alignment, rounding, tolerance, SCAN_CASE_SENSITIVE, anchor->Value, sizeof(anchor->Value));
+    }
+    if (NT_SUCCESS(status))
+    {
+      // Every group start inside a block has to see its whole window
+      compare->Width = group->Group.Window;
+      compare->Alignment = 1;
+    }
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Predicate utilities
+///////////////////////////////////////////////////////////
+
+static
+VOID
+KmSelectAvx2Kernel(
+  PSCAN_COMPARE compare,
+  SCAN_COMPARE_ROUTINE routine)
+{
+  // Prefer AVX2 kernels if the YMM state can be preserved for this thread
+  if (KmIsAvx2Supported())
+  {
+    if (NT_SUCCESS(KeSaveExtendedProcessorState(XSTATE_MASK_AVX, &compare->State)))
+    {
+      compare->ExtendedState = TRUE;
+      compare->Routine = routine;
+    }
+  }
+}
+
+static
+NTSTATUS
+KmBeginRangeCompare(
+  PSCAN_COMPARE compare,
+  DWORD32 type,
+  DWORD32 alignment,
+  PSCAN_PREDICATE predicate)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  RtlZeroMemory(compare, sizeof(SCAN_COMPARE));
+  compare->Width = KmGetCompareWidth(type);
+  compare->Alignment = KmGetCompareAlignment(type, alignment);
+
+  if (KmIsRealCompare(type) && predicate->Type != SCAN_PREDICATE_MASK)
+  {
+    // Real ranges reuse the rounding kernels
+    double low = 0.0;
+    double high = 0.0;
+    status = KmGetRealPredicateRange(predicate, compare->Width, &low, &high) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+    if (NT_SUCCESS(status))
+    {
+      KmStoreRealRange(compare->Value, compare->Width, low, high);
+      compare->Routine = KmGetCompareKernel(type, FALSE);
+      KmSelectAvx2Kernel(compare, KmGetCompareKernel(type, TRUE));
+    }
+  }
+  else
+  {
+    // Integers and bit masks over reals compare masked signed values of the same width
+    INT64 low = 0;
+    INT64 high = 0;
+    INT64 bits = 0;
+    status = KmGetIntegerPredicateRange(predicate, compare->Width, &low, &high, &bits) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+    if (NT_SUCCESS(status))
+    {
+      RtlCopyMemory(compare->Value, &low, compare->Width);
+      RtlCopyMemory(compare->Value + compare->Width, &high, compare->Width);
+      RtlCopyMemory(compare->Value + compare->Width * 2, &bits, compare->Width);
+      compare->Routine = KmGetRangeKernel(compare->Width, FALSE);
+      KmSelectAvx2Kernel(compare, KmGetRangeKernel(compare->Width, TRUE));
+    }
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Compare API
+///////////////////////////////////////////////////////////
+
+BOOLEAN
+KmIsAvx2Supported()
+{
+  if (s_avx2Supported < 0)
+  {
+    INT32 info[4];
+    BOOLEAN supported = FALSE;
+
+    // Check OSXSAVE and AVX feature bits
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))
+    {
+      // Check AVX2 feature bit
+      __cpuidex(info, 7, 0);
+      if (info[1] & (1 << 5))
+      {
+        // Check that the kernel manages the extended YMM state
+        supported = (RtlGetEnabledExtendedFeatures(XSTATE_MASK_AVX) & XSTATE_MASK_AVX) != 0;
+      }
+    }
+
+    InterlockedExchange(&s_avx2Supported, supported);
+  }
+
+  return s_avx2Supported == TRUE;
+}
+
+NTSTATUS
+KmBeginCompare(
+  PSCAN_COMPARE compare,
+  DWORD32 type,
+  DWORD32 alignment,
+  DWORD32 rounding,
+  double tolerance,
+  DWORD32 textCase,
+  PBYTE value,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  // Patterns carry their bytes followed by their masks
+  if (type == SCAN_TYPE_BYTES)
+  {
+    RtlZeroMemory(compare, sizeof(SCAN_COMPARE));
+    if ((size % 2) == 0 && KmGetCompareAlignment(type, alignment))
+    {
+      compare->Pattern = ExAllocatePoolWithTag(NonPagedPool, sizeof(PATTERN), KM_MEMORY_POOL_TAG);
+      if (compare->Pattern)
+      {
+        status = KmCompilePattern(compare->Pattern, value, value + (size / 2), size / 2) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+        if (NT_SUCCESS(status))
+        {
+          compare->Width = compare->Pattern->Length;
+          compare->Alignment = 1;
+        }
+        else
+        {
+          ExFreePoolWithTag(compare->Pattern, KM_MEMORY_POOL_TAG);
+          compare->Pattern = NULL;
+        }
+      }
+      else
+      {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+      }
+    }
+  }
+  else if (KmIsTextCompare(type))
+  {
+    // Text arrives as UTF-16 and is compiled once per requested encoding
+    RtlZeroMemory(compare, sizeof(SCAN_COMPARE));
+    PWCHAR text = (PWCHAR)value;
+    DWORD32 length = size / sizeof(WCHAR);
+    BOOLEAN ignoreCase = textCase == SCAN_CASE_INSENSITIVE;
+    if ((size % sizeof(WCHAR)) == 0 && KmGetCompareAlignment(type, alignment))
+    {
+      if (type == SCAN_TYPE_TEXT)
+      {
+        // Text beyond the first code page has no narrow encoding and is searched wide only
+        status = KmAllocateTextPattern(&compare->WidePattern, text, length, TRUE, ignoreCase);
+        if (NT_SUCCESS(status) && NT_SUCCESS(KmAllocateTextPattern(&compare->Pattern, text, length, FALSE, ignoreCase)))
+        {
+          compare->Scratch = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD32) * KM_COMPARE_MAX_OFFSETS * 2, KM_MEMORY_POOL_TAG);
+          status = compare->Scratch ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+        }
+        else if (NT_SUCCESS(status))
+        {
+          compare->Pattern = compare->WidePattern;
+          compare->WidePattern = NULL;
+        }
+      }
+      else
+      {
+        status = KmAllocateTextPattern(&compare->Pattern, text, length, type == SCAN_TYPE_UTF16, ignoreCase);
+      }
+
+      if (NT_SUCCESS(status))
+      {
+        // The wide encoding is the longest and determines how far matches reach
+        compare->Width = compare->WidePattern ? compare->WidePattern->Length : compare->Pattern->Length;
+        compare->Alignment = 1;
+      }
+      else
+      {
+        KmEndCompare(compare);
+      }
+    }
+  }
+  else if (type == SCAN_TYPE_GROUP)
+  {
+    // Groups anchor on their rarest member and verify the others around it
+    RtlZeroMemory(compare, sizeof(SCAN_COMPARE));
+    status = KmBeginGroupCompare(compare, alignment, rounding, tolerance, value, size);
+    if (NT_SUCCESS(status) == FALSE)
+    {
+      KmEndCompare(compare);
+    }
+  }
+  else if (KmGetCompareWidth(type) && size >= KmGetCompareWidth(type) && KmGetCompareAlignment(type, alignment))
+  {
+    // Fixed width values compare by type
+    RtlZeroMemory(compare, sizeof(SCAN_COMPARE));
+    compare->Width = KmGetCompareWidth(type);
+    compare->Alignment = KmGetCompareAlignment(type, alignment);
+    compare->Routine = KmGetCompareKernel(type, FALSE);
+
+    if (KmIsRealCompare(type))
+    {
+      // Real types compare against a closed range
+      double real = (compare->Width == sizeof(float)) ? *(float*)value : *(double*)value;
+      double low = 0.0;
+      double high = 0.0;
+      status = KmGetRealRange(rounding, real, tolerance, &low, &high) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+      if (NT_SUCCESS(status))
+      {
+        KmStoreRealRange(compare->Value, compare->Width, low, high);
+      }
+    }
+    else
+    {
+      // Integer types compare bitwise
+      RtlCopyMemory(compare->Value, value, compare->Width);
+      status = STATUS_SUCCESS;
+    }
+
+    // Prefer AVX2 kernels if the YMM state can be preserved for this thread
+    if (NT_SUCCESS(status))
+    {
+      KmSelectAvx2Kernel(compare, KmGetCompareKernel(type, TRUE));
+    }
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmBeginPredicate(
+  PSCAN_COMPARE compare,
+  DWORD32 type,
+  DWORD32 alignment,
+  DWORD32 rounding,
+  double tolerance,
+  PBYTE value,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  // Predicates apply to fixed width values only
+  PSCAN_PREDICATE predicate = (PSCAN_PREDICATE)value;
+  if (size == sizeof(SCAN_PREDICATE) && KmGetCompareWidth(type) && KmGetCompareAlignment(type, alignment))
+  {
+    switch (predicate->Type)
+    {
+      case SCAN_PREDICATE_EQUAL:
+      case SCAN_PREDICATE_NOT_EQUAL:
+      {
+        // Equality keeps the exact kernels, inequality reports the aligned offsets they reject
+        status = KmBeginCompare(compare, type, alignment, rounding, tolerance, SCAN_CASE_SENSITIVE, predicate->Operand, sizeof(predicate->Operand));
+        if (NT_SUCCESS(status) && predicate->Type == SCAN_PREDICATE_NOT_EQUAL)
+        {
+          compare->Invert = TRUE;
+          compare->Scratch = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD32) * KM_COMPARE_MAX_OFFSETS, KM_MEMORY_POOL_TAG);
+          status = compare->Scratch ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+          if (NT_SUCCESS(status) == FALSE)
+          {
+            KmEndCompare(compare);
+          }
+        }
+        break;
+      }
+      case SCAN_PREDICATE_LESS:
+      case SCAN_PREDICATE_GREATER:
+      case SCAN_PREDICATE_BETWEEN:
+      case SCAN_PREDICATE_MASK:
+      {
+        // Ordered and masked predicates reduce to a closed range
+        status = KmBeginRangeCompare(compare, type, alignment, predicate);
+        if (NT_SUCCESS(status) == FALSE)
+        {
+          KmEndCompare(compare);
+        }
+        break;
+      }
+    }
+  }
+
+  return status;
+}
+
+DWORD32
+KmCompareBlock(
+  PSCAN_COMPARE compare,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  // Groups verify their members around anchor hits
+  if (compare->Group)
+  {
+    return KmMatchGroup(compare->Group, bytes, size, offsets);
+  }
+
+  // Both encodings are matched on the same block and merged in address order
+  if (compare->WidePattern)
+  {
+    PDWORD32 narrow = compare->Scratch;
+    PDWORD32 wide = compare->Scratch + KM_COMPARE_MAX_OFFSETS;
+    DWORD32 narrowCount = KmMatchPattern(compare->Pattern, bytes, size, narrow);
+    DWORD32 wideCount = KmMatchPattern(compare->WidePattern, bytes, size, wide);
+    return KmMergeOffsets(narrow, narrowCount, wide, wideCount, offsets);
+  }
+
+  // Patterns use their own matcher
+  if (compare->Pattern)
+  {
+    return KmMatchPattern(compare->Pattern, bytes, size, offsets);
+  }
+
+  // Inverted compares report the complement of the kernel hits
+  if (compare->Invert)
+  {
+    DWORD32 hitCount = compare->Routine(bytes, size, compare->Value, compare->Alignment, compare->Scratch);
+    return KmInvertOffsets(compare->Scratch, hitCount, size, compare->Width, compare->Alignment, offsets);
+  }
+
+  return compare->Routine(bytes, size, compare->Value, compare->Alignment, offsets);
+}
+
+BOOLEAN
+KmCompareElement(
+  PSCAN_COMPARE compare,
+  PBYTE bytes)
+{
+  DWORD32 offset = 0;
+
+  // Kernels fall through to their scalar tail for a single element
+  BOOLEAN match = compare->Routine(bytes, compare->Width, compare->Value, compare->Alignment, &offset) != 0;
+  return match != compare->Invert;
+}
+
+VOID
+KmEndCompare(
+  PSCAN_COMPARE compare)
+{
+  // Restore extended processor state
+  if (compare->ExtendedState)
+  {
+    KeRestoreExtendedProcessorState(&compare->State);
+    compare->ExtendedState = FALSE;
+  }
+
+  // Free compiled patterns
+  if (compare->Pattern)
+  {
+    ExFreePoolWithTag(compare->Pattern, KM_MEMORY_POOL_TAG);
+    compare->Pattern = NULL;
+  }
+  if (compare->WidePattern)
+  {
+    ExFreePoolWithTag(compare->WidePattern, KM_MEMORY_POOL_TAG);
+    compare->WidePattern = NULL;
+  }
+  if (compare->Scratch)
+  {
+    ExFreePoolWithTag(compare->Scratch, KM_MEMORY_POOL_TAG);
+    compare->Scratch = NULL;
+  }
+
+  // Release anchor compare and group
+  if (compare->Group)
+  {
+    KmEndCompare(&compare->Group->AnchorCompare);
+    ExFreePoolWithTag(compare->Group, KM_MEMORY_POOL_TAG);
+    compare->Group = NULL;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef KM_COMPARE_H
+#define KM_COMPARE_H
+
+#include <km_core.h>
+#include <km_ioctrl.h>
+#include <km_kernels.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Compare limits
+///////////////////////////////////////////////////////////
+
+// Text matched in both encodings may start past the block inside its reach
+#define KM_COMPARE_MAX_OFFSETS (KM_SCAN_BLOCK_SIZE + KM_PATTERN_MAX_LENGTH)
+
+///////////////////////////////////////////////////////////
+// Compare data types
+///////////////////////////////////////////////////////////
+
+typedef struct _GROUP_COMPARE GROUP_COMPARE, * PGROUP_COMPARE;
+
+typedef struct _SCAN_COMPARE
+{
+  SCAN_COMPARE_ROUTINE Routine;
+  DWORD32 Width;
+  DWORD32 Alignment;
+  BYTE Value[24];
+  BOOLEAN Invert;
+  PPATTERN Pattern;
+  PPATTERN WidePattern;
+  PDWORD32 Scratch;
+  PGROUP_COMPARE Group;
+  BOOLEAN ExtendedState;
+  XSTATE_SAVE State;
+} SCAN_COMPARE, * PSCAN_COMPARE;
+
+struct _GROUP_COMPARE
+{
+  SCAN_GROUP Group;
+  DWORD32 Anchor;
+  DWORD32 Widths[SCAN_GROUP_MAX_MEMBERS];
+  DWORD32 Alignments[SCAN_GROUP_MAX_MEMBERS];
+  double Low[SCAN_GROUP_MAX_MEMBERS];
+  double High[SCAN_GROUP_MAX_MEMBERS];
+  SCAN_COMPARE AnchorCompare;
+};
+
+///////////////////////////////////////////////////////////
+// Compare API
+///////////////////////////////////////////////////////////
+
+BOOLEAN
+KmIsAvx2Supported();
+
+NTSTATUS
+KmBeginCompare(
+  PSCAN_COMPARE compare,
+  DWORD32 type,
+  DWORD32 alignment,
+  DWORD32 rounding,
+  double tolerance,
+  DWORD32 textCase,
+  PBYTE value,
+  DWORD32 size);
+
+NTSTATUS
+KmBeginPredicate(
+  PSCAN_COMPARE compare,
+  DWORD32 type,
+  DWORD32 alignment,
+  DWORD32 rounding,
+  double tolerance,
+  PBYTE value,
+  DWORD32 size);
+
+DWORD32
+KmCompareBlock(
+  PSCAN_COMPARE compare,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets);
+
+BOOLEAN
+KmCompareElement(
+  PSCAN_COMPARE compare,
+  PBYTE bytes);
+
+VOID
+KmEndCompare(
+  PSCAN_COMPARE compare);
+
+#endif
\ No newline at end of file
@@ -6,5 +6,53 @@
 ///////////////////////////////////////////////////////////
 
 #define KM_MEMORY_POOL_TAG 'DOMK'
+#define KM_MEMORY_MAX_VALUES 0x1000
+
+///////////////////////////////////////////////////////////
+// Scanner
+///////////////////////////////////////////////////////////
+
+#define KM_SCAN_PAGE_SIZE 0x1000
+#define KM_SCAN_BLOCK_SIZE 0x1000
+#define KM_SCAN_WINDOW_SIZE 0x200000
+#define KM_SCAN_WINDOW_REACH 0x100
+#define KM_SCAN_WORK_SIZE 0x1000000
+#define KM_SCAN_MAX_WORKERS 32
+
+///////////////////////////////////////////////////////////
+// Pattern
+///////////////////////////////////////////////////////////
+
+#define KM_PATTERN_MAX_LENGTH 0x100
+#define KM_PATTERN_SKIP_LENGTH 8
+
+///////////////////////////////////////////////////////////
+// Signatures
+///////////////////////////////////////////////////////////
+
+#define KM_SIGNATURE_MAX_SET_SIZE 0x1000000
+
+///////////////////////////////////////////////////////////
+// Result store
+///////////////////////////////////////////////////////////
+
+#define KM_RESULT_CHUNK_MIN_ENTRIES 0x200
+#define KM_RESULT_CHUNK_MAX_ENTRIES 0x10000
+
+///////////////////////////////////////////////////////////
+// Result history
+///////////////////////////////////////////////////////////
+
+#define KM_RESULT_HISTORY_DEPTH 8
+#define KM_RESULT_HISTORY_LIMIT 0x10000000
+
+///////////////////////////////////////////////////////////
+// Snapshot store
+///////////////////////////////////////////////////////////
+
+#define KM_SNAPSHOT_COMPRESSION COMPRESSION_FORMAT_XPRESS
+#define KM_SNAPSHOT_CHUNK_PAGES 0x400
+#define KM_SNAPSHOT_HASH_BUCKETS 0x10000
+#define KM_SNAPSHOT_RESULT_LIMIT 0x100000
 
 #endif
\ No newline at end of file
@@ -0,0 +1,446 @@
+#ifndef KM_DIRTY_H
+#define KM_DIRTY_H
+
+// Dirty page sources are shared with the offline tests and benchmarks, the Linux backend only builds there
+#include <km_platform.h>
+#include <km_config.h>
+
+#if !defined(_KERNEL_MODE) && !defined(_WIN32)
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+///////////////////////////////////////////////////////////
+// Dirty page data types
+///////////////////////////////////////////////////////////
+
+typedef BOOLEAN(*DIRTY_ADVANCE_ROUTINE)(
+  PVOID context);
+
+typedef BOOLEAN(*DIRTY_QUERY_ROUTINE)(
+  PVOID context,
+  DWORD64 page);
+
+typedef struct _DIRTY_SOURCE
+{
+  DIRTY_ADVANCE_ROUTINE Advance;
+  DIRTY_QUERY_ROUTINE Query;
+  PVOID Context;
+  BOOLEAN Armed;
+  BOOLEAN Valid;
+} DIRTY_SOURCE, * PDIRTY_SOURCE;
+
+///////////////////////////////////////////////////////////
+// Dirty page utilities
+///////////////////////////////////////////////////////////
+
+static __inline
+BOOLEAN
+KmAdvanceStaticSource(
+  PVOID context)
+{
+  // Content never changes, every interval is known
+  UNREFERENCED_PARAMETER(context);
+  return TRUE;
+}
+
+static __inline
+BOOLEAN
+KmQueryStaticSource(
+  PVOID context,
+  DWORD64 page)
+{
+  UNREFERENCED_PARAMETER(context);
+  UNREFERENCED_PARAMETER(page);
+  return FALSE;
+}
+
+///////////////////////////////////////////////////////////
+// Dirty page API
+///////////////////////////////////////////////////////////
+
+static __inline
+VOID
+KmInitializeDirtySource(
+  PDIRTY_SOURCE source,
+  DIRTY_ADVANCE_ROUTINE advance,
+  DIRTY_QUERY_ROUTINE query,
+  PVOID context)
+{
+  // Sources without routines do not track writes, every page reads as dirty
+  source->Advance = advance;
+  source->Query = query;
+  source->Context = context;
+  source->Armed = FALSE;
+  source->Valid = FALSE;
+}
+
+static __inline
+VOID
+KmAdvanceDirtySource(
+  PDIRTY_SOURCE source)
+{
+  // Close the running interval and open the next one, before the pass reads its first page
+  BOOLEAN tracked = source->Advance && source->Advance(source->Context);
+
+  // The closed interval only tells anything if it started before the previous pass read its values
+  source->Valid = source->Armed && tracked;
+  source->Armed = tracked;
+}
+
+static __inline
+VOID
+KmInvalidateDirtySource(
+  PDIRTY_SOURCE source)
+{
+  // Stored values predate the running interval, the next pass reads every page
+  source->Armed = FALSE;
+  source->Valid = FALSE;
+}
+
+static __inline
+BOOLEAN
+KmIsRangeDirty(
+  PDIRTY_SOURCE source,
+  DWORD64 base,
+  DWORD64 size)
+{
+  if (source->Valid == FALSE)
+  {
+    return TRUE;
+  }
+
+  // Values straddling into the next page need that page to be clean as well
+  for (DWORD64 page = base & ~(DWORD64)(KM_SCAN_PAGE_SIZE - 1); page < (base + size); page += KM_SCAN_PAGE_SIZE)
+  {
+    if (source->Query(source->Context, page))
+    {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+#if !defined(_KERNEL_MODE) && !defined(_WIN32)
+
+///////////////////////////////////////////////////////////
+// Soft dirty data types
+///////////////////////////////////////////////////////////
+
+#define KM_SOFT_DIRTY_BIT 55
+#define KM_SOFT_DIRTY_BATCH 0x200
+
+typedef struct _SOFT_DIRTY_RANGE
+{
+  DWORD64 Base;
+  DWORD64 PageCount;
+  PBYTE Bits;
+} SOFT_DIRTY_RANGE, * PSOFT_DIRTY_RANGE;
+
+typedef struct _SOFT_DIRTY
+{
+  int Pid;
+  int Pagemap;
+  int ClearRefs;
+  PSOFT_DIRTY_RANGE Ranges;
+  DWORD32 RangeCount;
+  DWORD32 RangeCapacity;
+} SOFT_DIRTY, * PSOFT_DIRTY;
+
+///////////////////////////////////////////////////////////
+// Soft dirty utilities
+///////////////////////////////////////////////////////////
+
+static __inline
+BOOLEAN
+KmClearSoftDirty(
+  int clearRefs)
+{
+  // Writing 4 clears the soft dirty bits of every page and write protects them again
+  return pwrite(clearRefs, "4", 1, 0) == 1;
+}
+
+static __inline
+BOOLEAN
+KmIsSoftDirtySupported()
+{
+  BOOLEAN supported = FALSE;
+
+  // Kernels without soft dirty tracking never set the bit, probe one private page of this process
+  PBYTE page = mmap(NULL, KM_SCAN_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  int clearRefs = open("/proc/self/clear_refs", O_WRONLY);
+  int pagemap = open("/proc/self/pagemap", O_RDONLY);
+  if (page != MAP_FAILED && clearRefs >= 0 && pagemap >= 0 && sysconf(_SC_PAGESIZE) == KM_SCAN_PAGE_SIZE)
+  {
+    page[0] = 1;
+    if (KmClearSoftDirty(clearRefs))
+    {
+      DWORD64 entry = 0;
+      *(volatile BYTE*)page = 2;
+      if (pread(pagemap, &entry, sizeof(entry), (off_t)((DWORD64)page / KM_SCAN_PAGE_SIZE * sizeof(entry))) == sizeof(entry))
+      {
+        supported = ((entry >> KM_SOFT_DIRTY_BIT) & 1) != 0;
+      }
+    }
+  }
+
+  if (pagemap >= 0)
+  {
+    close(pagemap);
+  }
+  if (clearRefs >= 0)
+  {
+    close(clearRefs);
+  }
+  if (page != MAP_FAILED)
+  {
+    munmap(page, KM_SCAN_PAGE_SIZE);
+  }
+
+  return supported;
+}
+
+static __inline
+char
+KmQueryProcessState(
+  int pid)
+{
+  char state = 0;
+
+  // Third field of the stat line, the command before it is parenthesized and may hold spaces
+  char path[64];
+  char line[512];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  FILE* file = fopen(path, "r");
+  if (file)
+  {
+    if (fgets(line, sizeof(line), file))
+    {
+      char* end = strrchr(line, ')');
+      state = (end && end[1] == ' ') ? end[2] : 0;
+    }
+    fclose(file);
+  }
+
+  return state;
+}
+
+static __inline
+BOOLEAN
+KmStopSoftDirtyTarget(
+  PSOFT_DIRTY dirty)
+{
+  // The calling process does not write while it advances, other processes are stopped
+  if (dirty->Pid == getpid() || KmQueryProcessState(dirty->Pid) == 'T')
+  {
+    return FALSE;
+  }
+
+  kill(dirty->Pid, SIGSTOP);
+  for (DWORD32 i = 0; i < 1000 && KmQueryProcessState(dirty->Pid) != 'T'; i++)
+  {
+    struct timespec delay = { 0, 1000000 };
+    nanosleep(&delay, NULL);
+  }
+
+  return TRUE;
+}
+
+static __inline
+VOID
+KmFreeSoftDirtyRanges(
+  PSOFT_DIRTY dirty)
+{
+  for (DWORD32 i = 0; i < dirty->RangeCount; i++)
+  {
+    free(dirty->Ranges[i].Bits);
+  }
+  dirty->RangeCount = 0;
+}
+
+static __inline
+BOOLEAN
+KmReadSoftDirtyRange(
+  PSOFT_DIRTY dirty,
+  DWORD64 base,
+  DWORD64 end)
+{
+  // Grow range table
+  if (dirty->RangeCount == dirty->RangeCapacity)
+  {
+    DWORD32 capacity = dirty->RangeCapacity ? dirty->RangeCapacity * 2 : 0x100;
+    PSOFT_DIRTY_RANGE ranges = realloc(dirty->Ranges, sizeof(SOFT_DIRTY_RANGE) * capacity);
+    if (ranges == NULL)
+    {
+      return FALSE;
+    }
+    dirty->Ranges = ranges;
+    dirty->RangeCapacity = capacity;
+  }
+
+  PSOFT_DIRTY_RANGE range = &dirty->Ranges[dirty->RangeCount];
+  range->Base = base;
+  range->PageCount = (end - base) / KM_SCAN_PAGE_SIZE;
+  range->Bits = calloc((SIZE_T)((range->PageCount + 7) / 8), 1);
+  if (range->Bits == NULL)
+  {
+    return FALSE;
+  }
+  dirty->RangeCount++;
+
+  // One pagemap entry per page, ranges which can not be read stay dirty as a whole
+  DWORD64 entries[KM_SOFT_DIRTY_BATCH];
+  for (DWORD64 first = 0; first < range->PageCount; first += KM_SOFT_DIRTY_BATCH)
+  {
+    DWORD64 count = ((range->PageCount - first) < KM_SOFT_DIRTY_BATCH) ? (range->PageCount - first) : KM_SOFT_DIRTY_BATCH;
+    ssize_t read = pread(dirty->Pagemap, entries, (size_t)count * sizeof(DWORD64), (off_t)((base / KM_SCAN_PAGE_SIZE + first) * sizeof(DWORD64)));
+    for (DWORD64 i = 0; i < count; i++)
+    {
+      if ((i + 1) * sizeof(DWORD64) > (DWORD64)((read > 0) ? read : 0) || ((entries[i] >> KM_SOFT_DIRTY_BIT) & 1))
+      {
+        range->Bits[(first + i) >> 3] |= (BYTE)(1 << ((first + i) & 7));
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+static __inline
+BOOLEAN
+KmSnapshotSoftDirty(
+  PSOFT_DIRTY dirty)
+{
+  BOOLEAN success = FALSE;
+
+  // Private writable mappings in address order, shared ones can be written through other processes and stay dirty
+  char path[64];
+  char line[512];
+  snprintf(path, sizeof(path), "/proc/%d/maps", dirty->Pid);
+  FILE* file = fopen(path, "r");
+  if (file)
+  {
+    success = TRUE;
+    KmFreeSoftDirtyRanges(dirty);
+    while (success && fgets(line, sizeof(line), file))
+    {
+      unsigned long long base;
+      unsigned long long end;
+      char permissions[8];
+      if (sscanf(line, "%llx-%llx %7s", &base, &end, permissions) == 3 && permissions[1] == 'w' && permissions[3] == 'p')
+      {
+        success = KmReadSoftDirtyRange(dirty, base, end);
+      }
+    }
+    fclose(file);
+  }
+
+  return success;
+}
+
+static
+BOOLEAN
+KmAdvanceSoftDirty(
+  PVOID context)
+{
+  PSOFT_DIRTY dirty = (PSOFT_DIRTY)context;
+
+  // Bits are read and cleared in one step, a write in between would be lost to both intervals
+  BOOLEAN stopped = KmStopSoftDirtyTarget(dirty);
+  BOOLEAN success = KmSnapshotSoftDirty(dirty) && KmClearSoftDirty(dirty->ClearRefs);
+  if (stopped)
+  {
+    kill(dirty->Pid, SIGCONT);
+  }
+
+  return success;
+}
+
+static
+BOOLEAN
+KmQuerySoftDirty(
+  PVOID context,
+  DWORD64 page)
+{
+  PSOFT_DIRTY dirty = (PSOFT_DIRTY)context;
+
+  // Ranges are sorted, pages outside of any tracked range are dirty
+  DWORD32 low = 0;
+  DWORD32 high = dirty->RangeCount;
+  while (low < high)
+  {
+    DWORD32 middle = (low + high) / 2;
+    PSOFT_DIRTY_RANGE range = &dirty->Ranges[middle];
+    if (page < range->Base)
+    {
+      high = middle;
+    }
+    else if (page >= range->Base + range->PageCount * KM_SCAN_PAGE_SIZE)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      DWORD64 index = (page - range->Base) / KM_SCAN_PAGE_SIZE;
+      return (range->Bits[index >> 3] & (1 << (index & 7))) != 0;
+    }
+  }
+
+  return TRUE;
+}
+
+///////////////////////////////////////////////////////////
+// Soft dirty API
+///////////////////////////////////////////////////////////
+
+static __inline
+BOOLEAN
+KmOpenSoftDirtySource(
+  PDIRTY_SOURCE source,
+  PSOFT_DIRTY dirty,
+  int pid)
+{
+  char path[64];
+  memset(dirty, 0, sizeof(SOFT_DIRTY));
+  dirty->Pid = pid;
+  snprintf(path, sizeof(path), "/proc/%d/pagemap", pid);
+  dirty->Pagemap = open(path, O_RDONLY);
+  snprintf(path, sizeof(path), "/proc/%d/clear_refs", pid);
+  dirty->ClearRefs = open(path, O_WRONLY);
+
+  // Without kernel support or access the source stays untracked and every page reads as dirty
+  BOOLEAN tracked = dirty->Pagemap >= 0 && dirty->ClearRefs >= 0 && KmIsSoftDirtySupported();
+  KmInitializeDirtySource(source, tracked ? KmAdvanceSoftDirty : NULL, tracked ? KmQuerySoftDirty : NULL, dirty);
+
+  return tracked;
+}
+
+static __inline
+VOID
+KmCloseSoftDirtySource(
+  PDIRTY_SOURCE source,
+  PSOFT_DIRTY dirty)
+{
+  KmFreeSoftDirtyRanges(dirty);
+  free(dirty->Ranges);
+  if (dirty->Pagemap >= 0)
+  {
+    close(dirty->Pagemap);
+  }
+  if (dirty->ClearRefs >= 0)
+  {
+    close(dirty->ClearRefs);
+  }
+  memset(dirty, 0, sizeof(SOFT_DIRTY));
+  KmInitializeDirtySource(source, NULL, NULL, NULL);
+}
+
+#endif
+
+#endif
\ No newline at end of file
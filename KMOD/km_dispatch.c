@@ -27,7 +27,12 @@ KmOnIrpCreate(
   PIRP irp)
 {
   UNREFERENCED_PARAMETER(device);
-  irp->IoStatus.Status = STATUS_SUCCESS;
+  PIO_STACK_LOCATION stack = IoGetCurrentIrpStackLocation(irp);
+
+  // Every handle owns its own scan session
+  PSCAN_SESSION session = NULL;
+  irp->IoStatus.Status = KmCreateScanSession(&session);
+  stack->FileObject->FsContext = session;
   irp->IoStatus.Information = 0;
   IoCompleteRequest(irp, IO_NO_INCREMENT);
   return irp->IoStatus.Status;
@@ -40,6 +45,7 @@ KmOnIrpCtrl(
 {
   UNREFERENCED_PARAMETER(device);
   PIO_STACK_LOCATION stack = IoGetCurrentIrpStackLocation(irp);
+  PSCAN_SESSION session = (PSCAN_SESSION)stack->FileObject->FsContext;
   switch (stack->Parameters.DeviceIoControl.IoControlCode)
   {
     // Update API
@@ -99,13 +105,96 @@ KmOnIrpCtrl(
     }
     case IOCTRL_READ_SCAN_RESULTS:
     {
-      DWORD32 count = *(PDWORD32)irp->AssociatedIrp.SystemBuffer;
       PDWORD64 scans = (PDWORD64)irp->AssociatedIrp.SystemBuffer;
-      irp->IoStatus.Status = KmReadScanList(count, scans);
+      DWORD32 count = 0;
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(READ_SCAN_RESULTS))
+      {
+        READ_SCAN_RESULTS request = *(PREAD_SCAN_RESULTS)irp->AssociatedIrp.SystemBuffer;
+        if (request.Count <= (stack->Parameters.DeviceIoControl.OutputBufferLength / sizeof(DWORD64)))
+        {
+          count = request.Count;
+          irp->IoStatus.Status = KmReadScanList(session, request.Offset, request.Count, scans);
+        }
+        else
+        {
+          irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+        }
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
       irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? (sizeof(DWORD64) * count) : 0;
       KD_LOG("[IOCTRL_READ_SCAN_RESULTS] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
       break;
     }
+    case IOCTRL_READ_SCAN_VALUES:
+    {
+      PBYTE values = (PBYTE)irp->AssociatedIrp.SystemBuffer;
+      DWORD32 written = 0;
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(READ_SCAN_RESULTS))
+      {
+        READ_SCAN_RESULTS request = *(PREAD_SCAN_RESULTS)irp->AssociatedIrp.SystemBuffer;
+        irp->IoStatus.Status = KmReadScanValues(session, request.Offset, request.Count, values, stack->Parameters.DeviceIoControl.OutputBufferLength, &written);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? written : 0;
+      KD_LOG("[IOCTRL_READ_SCAN_VALUES] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_READ_PROCESS_VALUES:
+    {
+      PDWORD64 bases = (PDWORD64)((PBYTE)irp->AssociatedIrp.SystemBuffer + sizeof(READ_PROCESS_VALUES));
+      PBYTE values = (PBYTE)irp->AssociatedIrp.SystemBuffer;
+      SIZE_T written = 0;
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(READ_PROCESS_VALUES))
+      {
+        READ_PROCESS_VALUES request = *(PREAD_PROCESS_VALUES)irp->AssociatedIrp.SystemBuffer;
+        if (stack->Parameters.DeviceIoControl.InputBufferLength >= (sizeof(READ_PROCESS_VALUES) + sizeof(DWORD64) * (SIZE_T)request.Count) && stack->Parameters.DeviceIoControl.OutputBufferLength >= ((SIZE_T)request.Count * request.Width))
+        {
+          irp->IoStatus.Status = KmReadProcessValues(&request, bases, values);
+          written = (SIZE_T)request.Count * request.Width;
+        }
+        else
+        {
+          irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+        }
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? written : 0;
+      KD_LOG("[IOCTRL_READ_PROCESS_VALUES] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_READ_SIGNATURES:
+    {
+      PSIGNATURE_MATCH matches = (PSIGNATURE_MATCH)irp->AssociatedIrp.SystemBuffer;
+      DWORD32 count = 0;
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(READ_SCAN_RESULTS))
+      {
+        READ_SCAN_RESULTS request = *(PREAD_SCAN_RESULTS)irp->AssociatedIrp.SystemBuffer;
+        if (request.Count <= (stack->Parameters.DeviceIoControl.OutputBufferLength / sizeof(SIGNATURE_MATCH)))
+        {
+          irp->IoStatus.Status = KmReadSignatureMatches(session, request.Offset, request.Count, matches, &count);
+        }
+        else
+        {
+          irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+        }
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? (sizeof(SIGNATURE_MATCH) * count) : 0;
+      KD_LOG("[IOCTRL_READ_SIGNATURES] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
     // Write API
     case IOCTRL_WRITE_PROCESS_MEMORY:
     {
@@ -127,20 +216,155 @@ KmOnIrpCtrl(
     case IOCTRL_SCAN_PROCESS_FIRST:
     {
       SCAN_PROCESS_FIRST request = *(PSCAN_PROCESS_FIRST)irp->AssociatedIrp.SystemBuffer;
-      PDWORD32 count = (PDWORD32)irp->AssociatedIrp.SystemBuffer;
-      irp->IoStatus.Status = KmScanProcessFirst(&request, count);
-      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? sizeof(DWORD32) : 0;
+      irp->IoStatus.Status = KmStartScanFirst(session, &request);
+      irp->IoStatus.Information = 0;
       KD_LOG("[IOCTRL_SCAN_PROCESS_FIRST] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
       break;
     }
     case IOCTRL_SCAN_PROCESS_NEXT:
     {
       SCAN_PROCESS_NEXT request = *(PSCAN_PROCESS_NEXT)irp->AssociatedIrp.SystemBuffer;
-      irp->IoStatus.Status = KmScanProcessNext(&request);
-      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? 0 : 0;
+      irp->IoStatus.Status = KmStartScanNext(session, &request);
+      irp->IoStatus.Information = 0;
       KD_LOG("[IOCTRL_SCAN_PROCESS_NEXT] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
       break;
     }
+    case IOCTRL_SCAN_POINTERS:
+    {
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(SCAN_POINTERS))
+      {
+        SCAN_POINTERS request = *(PSCAN_POINTERS)irp->AssociatedIrp.SystemBuffer;
+        irp->IoStatus.Status = KmStartScanPointers(session, &request);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = 0;
+      KD_LOG("[IOCTRL_SCAN_POINTERS] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_SIGNATURES:
+    {
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(SCAN_SIGNATURES))
+      {
+        SCAN_SIGNATURES request = *(PSCAN_SIGNATURES)irp->AssociatedIrp.SystemBuffer;
+        irp->IoStatus.Status = KmStartScanSignatures(session, &request);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = 0;
+      KD_LOG("[IOCTRL_SCAN_SIGNATURES] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_PROGRESS:
+    {
+      PSCAN_PROGRESS progress = (PSCAN_PROGRESS)irp->AssociatedIrp.SystemBuffer;
+      if (stack->Parameters.DeviceIoControl.OutputBufferLength >= sizeof(SCAN_PROGRESS))
+      {
+        irp->IoStatus.Status = KmQueryScanProgress(session, progress);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? sizeof(SCAN_PROGRESS) : 0;
+      break;
+    }
+    case IOCTRL_SCAN_CANCEL:
+    {
+      irp->IoStatus.Status = KmCancelScan(session);
+      irp->IoStatus.Information = 0;
+      KD_LOG("[IOCTRL_SCAN_CANCEL] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_UNDO:
+    {
+      PSCAN_SUMMARY summary = (PSCAN_SUMMARY)irp->AssociatedIrp.SystemBuffer;
+      if (stack->Parameters.DeviceIoControl.OutputBufferLength >= sizeof(SCAN_SUMMARY))
+      {
+        irp->IoStatus.Status = KmUndoScan(session, summary);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? sizeof(SCAN_SUMMARY) : 0;
+      KD_LOG("[IOCTRL_SCAN_UNDO] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_REDO:
+    {
+      PSCAN_SUMMARY summary = (PSCAN_SUMMARY)irp->AssociatedIrp.SystemBuffer;
+      if (stack->Parameters.DeviceIoControl.OutputBufferLength >= sizeof(SCAN_SUMMARY))
+      {
+        irp->IoStatus.Status = KmRedoScan(session, summary);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? sizeof(SCAN_SUMMARY) : 0;
+      KD_LOG("[IOCTRL_SCAN_REDO] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_IMPORT:
+    {
+      PDWORD64 bases = (PDWORD64)((PBYTE)irp->AssociatedIrp.SystemBuffer + sizeof(SCAN_IMPORT));
+      PSCAN_SUMMARY summary = (PSCAN_SUMMARY)irp->AssociatedIrp.SystemBuffer;
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(SCAN_IMPORT))
+      {
+        SCAN_IMPORT request = *(PSCAN_IMPORT)irp->AssociatedIrp.SystemBuffer;
+        if (stack->Parameters.DeviceIoControl.InputBufferLength >= (sizeof(SCAN_IMPORT) + sizeof(DWORD64) * (SIZE_T)request.Count + (SIZE_T)request.ValueSize * request.Count) && stack->Parameters.DeviceIoControl.OutputBufferLength >= sizeof(SCAN_SUMMARY))
+        {
+          PBYTE values = (PBYTE)(bases + request.Count);
+          irp->IoStatus.Status = KmImportScanResults(session, &request, bases, values, summary);
+        }
+        else
+        {
+          irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+        }
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = NT_SUCCESS(irp->IoStatus.Status) ? sizeof(SCAN_SUMMARY) : 0;
+      KD_LOG("[IOCTRL_SCAN_IMPORT] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_CAPTURE:
+    {
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(SCAN_CAPTURE))
+      {
+        SCAN_CAPTURE request = *(PSCAN_CAPTURE)irp->AssociatedIrp.SystemBuffer;
+        irp->IoStatus.Status = KmStartScanCapture(session, &request);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = 0;
+      KD_LOG("[IOCTRL_SCAN_CAPTURE] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
+    case IOCTRL_SCAN_SOURCE:
+    {
+      if (stack->Parameters.DeviceIoControl.InputBufferLength >= sizeof(SCAN_SOURCE))
+      {
+        SCAN_SOURCE request = *(PSCAN_SOURCE)irp->AssociatedIrp.SystemBuffer;
+        irp->IoStatus.Status = KmSetScanSource(session, &request);
+      }
+      else
+      {
+        irp->IoStatus.Status = STATUS_BUFFER_TOO_SMALL;
+      }
+      irp->IoStatus.Information = 0;
+      KD_LOG("[IOCTRL_SCAN_SOURCE] status:%X written:%llu\n", irp->IoStatus.Status, irp->IoStatus.Information);
+      break;
+    }
   }
   IoCompleteRequest(irp, IO_NO_INCREMENT);
   return irp->IoStatus.Status;
@@ -152,6 +376,15 @@ KmOnIrpClose(
   PIRP irp)
 {
   UNREFERENCED_PARAMETER(device);
+  PIO_STACK_LOCATION stack = IoGetCurrentIrpStackLocation(irp);
+
+  // Free scan session once the last reference to the handle is gone
+  PSCAN_SESSION session = (PSCAN_SESSION)stack->FileObject->FsContext;
+  if (session)
+  {
+    KmFreeScanSession(session);
+    stack->FileObject->FsContext = NULL;
+  }
   irp->IoStatus.Status = STATUS_SUCCESS;
   irp->IoStatus.Information = 0;
   IoCompleteRequest(irp, IO_NO_INCREMENT);
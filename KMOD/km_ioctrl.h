@@ -15,12 +15,70 @@
 #define IOCTRL_READ_PROCESS_MEMORY   CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0202, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_READ_KERNEL_MEMORY    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0203, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_READ_SCAN_RESULTS     CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0204, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_READ_SCAN_VALUES      CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0205, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_READ_PROCESS_VALUES   CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0206, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_READ_SIGNATURES       CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0207, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 
 #define IOCTRL_WRITE_PROCESS_MEMORY  CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0300, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_WRITE_KERNEL_MEMORY   CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0301, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 
 #define IOCTRL_SCAN_PROCESS_FIRST    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0400, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_SCAN_PROCESS_NEXT     CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0401, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_SIGNATURES       CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0402, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_PROGRESS         CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0403, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_CANCEL           CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0404, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_UNDO             CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0405, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_REDO             CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0406, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_POINTERS         CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0407, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_IMPORT           CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0408, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_CAPTURE          CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0409, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_SOURCE           CTL_CODE(FILE_DEVICE_UNKNOWN, 0x040A, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+
+///////////////////////////////////////////////////////////
+// Signature set format
+///////////////////////////////////////////////////////////
+
+// Sets are a header followed by signatures, key offsets, anchors and pattern bytes
+#define SIGNATURE_SET_MAGIC   0x4749534B
+#define SIGNATURE_SET_VERSION 1
+#define SIGNATURE_SET_KEYS    0x10000
+
+///////////////////////////////////////////////////////////
+// Group scan format
+///////////////////////////////////////////////////////////
+
+// Groups are matched relative to their start, members without offset may be anywhere inside the window
+#define SCAN_GROUP_MAX_MEMBERS 8
+#define SCAN_GROUP_MAX_WINDOW  0x100
+#define SCAN_GROUP_ANY_OFFSET  0xFFFFFFFF
+
+///////////////////////////////////////////////////////////
+// Region filter format
+///////////////////////////////////////////////////////////
+
+// Regions have to carry every requested flag, a cleared filter scans all readable regions
+#define SCAN_REGION_WRITABLE   0x1
+#define SCAN_REGION_EXECUTABLE 0x2
+#define SCAN_REGION_PRIVATE    0x4
+#define SCAN_REGION_IMAGE      0x8
+#define SCAN_REGION_MAPPED     0x10
+
+///////////////////////////////////////////////////////////
+// Result import format
+///////////////////////////////////////////////////////////
+
+// Imports are streamed in batches, addresses follow the request and values follow the addresses
+#define SCAN_IMPORT_BEGIN 0x1
+#define SCAN_IMPORT_END   0x2
+
+///////////////////////////////////////////////////////////
+// Memory capture format
+///////////////////////////////////////////////////////////
+
+// Captures are a page sized header followed by the page data of every region and a trailing region table
+#define MEMORY_CAPTURE_MAGIC    0x50414D4B
+#define MEMORY_CAPTURE_VERSION  1
+#define MEMORY_CAPTURE_MAX_PATH 260
 
 ///////////////////////////////////////////////////////////
 // I/O request data types
@@ -32,8 +90,70 @@ typedef enum _SCAN_TYPE
   SCAN_TYPE_BYTE16,
   SCAN_TYPE_BYTE32,
   SCAN_TYPE_BYTE64,
+  SCAN_TYPE_FLOAT32,
+  SCAN_TYPE_FLOAT64,
+  SCAN_TYPE_BYTES,
+  SCAN_TYPE_ASCII,
+  SCAN_TYPE_UTF16,
+  SCAN_TYPE_TEXT,
+  SCAN_TYPE_GROUP,
 } SCAN_TYPE, * PSCAN_TYPE;
 
+typedef enum _SCAN_FILTER
+{
+  SCAN_FILTER_EXACT,
+  SCAN_FILTER_CHANGED,
+  SCAN_FILTER_UNCHANGED,
+  SCAN_FILTER_INCREASED,
+  SCAN_FILTER_DECREASED,
+  SCAN_FILTER_INCREASED_BY,
+  SCAN_FILTER_DECREASED_BY,
+  SCAN_FILTER_UNKNOWN,
+  SCAN_FILTER_PREDICATE,
+} SCAN_FILTER, * PSCAN_FILTER;
+
+typedef enum _SCAN_ALIGNMENT
+{
+  SCAN_ALIGNMENT_NATURAL = 0,
+  SCAN_ALIGNMENT_BYTE8 = 1,
+  SCAN_ALIGNMENT_BYTE16 = 2,
+  SCAN_ALIGNMENT_BYTE32 = 4,
+  SCAN_ALIGNMENT_BYTE64 = 8,
+} SCAN_ALIGNMENT, * PSCAN_ALIGNMENT;
+
+typedef enum _SCAN_STATE
+{
+  SCAN_STATE_IDLE,
+  SCAN_STATE_RUNNING,
+  SCAN_STATE_DONE,
+  SCAN_STATE_CANCELLED,
+  SCAN_STATE_FAILED,
+} SCAN_STATE, * PSCAN_STATE;
+
+typedef enum _SCAN_ROUNDING
+{
+  SCAN_ROUNDING_EXACT,
+  SCAN_ROUNDING_ROUNDED,
+  SCAN_ROUNDING_TRUNCATED,
+  SCAN_ROUNDING_EPSILON,
+} SCAN_ROUNDING, * PSCAN_ROUNDING;
+
+typedef enum _SCAN_CASE
+{
+  SCAN_CASE_SENSITIVE,
+  SCAN_CASE_INSENSITIVE,
+} SCAN_CASE, * PSCAN_CASE;
+
+typedef enum _SCAN_PREDICATE_TYPE
+{
+  SCAN_PREDICATE_EQUAL,
+  SCAN_PREDICATE_NOT_EQUAL,
+  SCAN_PREDICATE_LESS,
+  SCAN_PREDICATE_GREATER,
+  SCAN_PREDICATE_BETWEEN,
+  SCAN_PREDICATE_MASK,
+} SCAN_PREDICATE_TYPE, * PSCAN_PREDICATE_TYPE;
+
 typedef struct _READ_PROCESS_MEMORY
 {
   DWORD32 Pid;
@@ -45,6 +165,17 @@ typedef struct _READ_KERNEL_MEMORY
   DWORD64 Base;
   DWORD32 Size;
 } READ_KERNEL_MEMORY, * PREAD_KERNEL_MEMORY;
+typedef struct _READ_SCAN_RESULTS
+{
+  DWORD64 Offset;
+  DWORD32 Count;
+} READ_SCAN_RESULTS, * PREAD_SCAN_RESULTS;
+typedef struct _READ_PROCESS_VALUES
+{
+  DWORD32 Pid;
+  DWORD32 Count;
+  DWORD32 Width;
+} READ_PROCESS_VALUES, * PREAD_PROCESS_VALUES;
 
 typedef struct _WRITE_PROCESS_MEMORY
 {
@@ -60,6 +191,14 @@ typedef struct _WRITE_KERNEL_MEMORY
   PVOID Buffer;
 } WRITE_KERNEL_MEMORY, * PWRITE_KERNEL_MEMORY;
 
+typedef struct _SCAN_REGION_FILTER
+{
+  DWORD32 Flags;
+  DWORD64 Start;
+  DWORD64 End;
+  DWORD64 Module;
+} SCAN_REGION_FILTER, * PSCAN_REGION_FILTER;
+
 typedef struct _SCAN_PROCESS_FIRST
 {
   DWORD32 Pid;
@@ -67,11 +206,111 @@ typedef struct _SCAN_PROCESS_FIRST
   DWORD32 Size;
   PVOID Buffer;
   DWORD32 Type;
+  DWORD32 Filter;
+  DWORD32 Alignment;
+  DWORD32 Rounding;
+  double Tolerance;
+  DWORD32 Case;
+  SCAN_REGION_FILTER Regions;
 } SCAN_PROCESS_FIRST, * PSCAN_PROCESS_FIRST;
 typedef struct _SCAN_PROCESS_NEXT
 {
   DWORD32 Pid;
+  DWORD32 Size;
+  PVOID Buffer;
+  DWORD32 Filter;
+  DWORD32 Rounding;
+  double Tolerance;
 } SCAN_PROCESS_NEXT, * PSCAN_PROCESS_NEXT;
+typedef struct _SCAN_SIGNATURES
+{
+  DWORD32 Pid;
+  DWORD64 Base;
+  DWORD64 Size;
+  DWORD32 Limit;
+  DWORD32 SetSize;
+  PVOID Set;
+} SCAN_SIGNATURES, * PSCAN_SIGNATURES;
+typedef struct _SCAN_POINTERS
+{
+  DWORD32 Pid;
+  DWORD64 Base;
+  DWORD64 Size;
+} SCAN_POINTERS, * PSCAN_POINTERS;
+typedef struct _SCAN_IMPORT
+{
+  DWORD32 Type;
+  DWORD32 ValueSize;
+  DWORD32 Count;
+  DWORD32 Flags;
+} SCAN_IMPORT, * PSCAN_IMPORT;
+typedef struct _SCAN_CAPTURE
+{
+  DWORD32 Pid;
+  SCAN_REGION_FILTER Regions;
+  WCHAR Path[MEMORY_CAPTURE_MAX_PATH];
+} SCAN_CAPTURE, * PSCAN_CAPTURE;
+typedef struct _SCAN_SOURCE
+{
+  WCHAR Path[MEMORY_CAPTURE_MAX_PATH];
+} SCAN_SOURCE, * PSCAN_SOURCE;
+
+typedef struct _SCAN_GROUP_MEMBER
+{
+  DWORD32 Type;
+  DWORD32 Offset;
+  BYTE Value[8];
+} SCAN_GROUP_MEMBER, * PSCAN_GROUP_MEMBER;
+
+typedef struct _SCAN_GROUP
+{
+  DWORD32 Window;
+  DWORD32 Count;
+  SCAN_GROUP_MEMBER Members[SCAN_GROUP_MAX_MEMBERS];
+} SCAN_GROUP, * PSCAN_GROUP;
+
+typedef struct _SCAN_PREDICATE
+{
+  DWORD32 Type;
+  BYTE Operand[8];
+  BYTE Limit[8];
+} SCAN_PREDICATE, * PSCAN_PREDICATE;
+
+typedef struct _SIGNATURE
+{
+  DWORD32 Offset;
+  DWORD32 Length;
+  DWORD32 Anchor;
+} SIGNATURE, * PSIGNATURE;
+typedef struct _SIGNATURE_SET
+{
+  DWORD32 Magic;
+  DWORD32 Version;
+  DWORD32 Size;
+  DWORD32 SignatureCount;
+  DWORD32 AnchorCount;
+  DWORD32 PatternSize;
+  DWORD64 SourceHash;
+} SIGNATURE_SET, * PSIGNATURE_SET;
+
+typedef struct _MEMORY_CAPTURE_REGION
+{
+  DWORD64 Base;
+  DWORD64 AllocationBase;
+  DWORD64 Size;
+  DWORD64 Offset;
+  DWORD32 Protect;
+  DWORD32 Type;
+} MEMORY_CAPTURE_REGION, * PMEMORY_CAPTURE_REGION;
+typedef struct _MEMORY_CAPTURE
+{
+  DWORD32 Magic;
+  DWORD32 Version;
+  DWORD32 Pid;
+  DWORD32 RegionCount;
+  DWORD64 Bytes;
+  DWORD64 RegionOffset;
+} MEMORY_CAPTURE, * PMEMORY_CAPTURE;
 
 ///////////////////////////////////////////////////////////
 // I/O response data types
@@ -89,5 +328,27 @@ typedef struct _KERNEL_IMAGE
   DWORD32 Size;
   CHAR Name[260];
 } KERNEL_IMAGE, * PKERNEL_IMAGE;
+typedef struct _SCAN_SUMMARY
+{
+  DWORD64 Results;
+  DWORD64 Candidates;
+  DWORD64 Bytes;
+  DWORD32 ValueSize;
+} SCAN_SUMMARY, * PSCAN_SUMMARY;
+typedef struct _SCAN_PROGRESS
+{
+  DWORD32 State;
+  LONG Status;
+  DWORD64 Bytes;
+  DWORD64 Regions;
+  DWORD64 RegionCount;
+  DWORD64 Hits;
+  SCAN_SUMMARY Summary;
+} SCAN_PROGRESS, * PSCAN_PROGRESS;
+typedef struct _SIGNATURE_MATCH
+{
+  DWORD32 Signature;
+  DWORD64 Address;
+} SIGNATURE_MATCH, * PSIGNATURE_MATCH;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,1244 @@
+#ifndef KM_KERNELS_H
+#define KM_KERNELS_H
+
+// Compare and pattern kernels are shared with the client and offline tools, none of them allocates or touches processor state
+#include <km_platform.h>
+#include <km_config.h>
+#if defined(_KERNEL_MODE)
+#include <km_ioctrl.h>
+#else
+#include <kc_ioctrl.h>
+#endif
+
+///////////////////////////////////////////////////////////
+// Kernel data types
+///////////////////////////////////////////////////////////
+
+typedef DWORD32(*SCAN_COMPARE_ROUTINE)(
+  PBYTE bytes,
+  DWORD32 size,
+  PBYTE value,
+  DWORD32 alignment,
+  PDWORD32 offsets);
+
+typedef struct _PATTERN
+{
+  DWORD32 Length;
+  DWORD32 Anchor;
+  DWORD32 RunOffset;
+  DWORD32 RunLength;
+  BYTE Bytes[KM_PATTERN_MAX_LENGTH];
+  BYTE Masks[KM_PATTERN_MAX_LENGTH];
+  DWORD32 Skip[256];
+} PATTERN, * PPATTERN;
+
+typedef struct _SCAN_SPAN
+{
+  DWORD64 Base;
+  DWORD32 Size;
+  DWORD32 Reach;
+} SCAN_SPAN, * PSCAN_SPAN;
+
+typedef BOOLEAN(*SCAN_MAP_ROUTINE)(
+  PVOID context,
+  DWORD64 base,
+  DWORD32 size,
+  PBYTE* mapped);
+
+typedef VOID(*SCAN_UNMAP_ROUTINE)(
+  PVOID context);
+
+typedef BOOLEAN(*SCAN_STEP_ROUTINE)(
+  PVOID context,
+  DWORD32 size);
+
+typedef VOID(*SCAN_WINDOW_ROUTINE)(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned);
+
+typedef struct _SCAN_WALK
+{
+  SCAN_MAP_ROUTINE Map;
+  SCAN_UNMAP_ROUTINE Unmap;
+  SCAN_STEP_ROUTINE Step;
+  PVOID Context;
+} SCAN_WALK, * PSCAN_WALK;
+
+///////////////////////////////////////////////////////////
+// Compare utilities
+///////////////////////////////////////////////////////////
+
+static __forceinline
+DWORD32
+KmDrainMask(
+  DWORD32 mask,
+  DWORD32 offset,
+  PDWORD32 offsets,
+  DWORD32 count)
+{
+  unsigned long index;
+
+  // Convert every set bit into a block relative offset
+  while (_BitScanForward(&index, mask))
+  {
+    offsets[count++] = offset + index;
+    mask &= mask - 1;
+  }
+
+  return count;
+}
+
+static __forceinline
+DWORD32
+KmAlignmentMask(
+  DWORD32 alignment)
+{
+  // Keep only mask bits of aligned start offsets
+  switch (alignment)
+  {
+    case 2: return 0x55555555;
+    case 4: return 0x11111111;
+    case 8: return 0x01010101;
+    default: return 0xFFFFFFFF;
+  }
+}
+
+static __inline
+DWORD32
+KmCompareTail(
+  PBYTE bytes,
+  DWORD32 offset,
+  DWORD32 size,
+  PBYTE value,
+  DWORD32 width,
+  DWORD32 alignment,
+  PDWORD32 offsets,
+  DWORD32 count)
+{
+  // Compare remaining elements which do not fill an entire vector
+  for (; (offset + width) <= size; offset += alignment)
+  {
+    if (RtlEqualMemory(bytes + offset, value, width))
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+static __inline
+INT64
+KmLoadCompareValue(
+  PBYTE bytes,
+  DWORD32 width)
+{
+  switch (width)
+  {
+    case sizeof(INT8): return *(PINT8)bytes;
+    case sizeof(INT16): return *(PINT16)bytes;
+    case sizeof(INT32): return *(PINT32)bytes;
+    default: return *(PINT64)bytes;
+  }
+}
+
+static __inline
+DWORD32
+KmCompareRangeTail(
+  PBYTE bytes,
+  DWORD32 offset,
+  DWORD32 size,
+  PBYTE value,
+  DWORD32 width,
+  DWORD32 alignment,
+  PDWORD32 offsets,
+  DWORD32 count)
+{
+  // Compare remaining masked elements against the signed closed range
+  INT64 low = KmLoadCompareValue(value, width);
+  INT64 high = KmLoadCompareValue(value + width, width);
+  INT64 bits = KmLoadCompareValue(value + width * 2, width);
+  for (; (offset + width) <= size; offset += alignment)
+  {
+    INT64 element = KmLoadCompareValue(bytes + offset, width) & bits;
+    if (element >= low && element <= high)
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+static __inline
+DWORD32
+KmInvertOffsets(
+  PDWORD32 hits,
+  DWORD32 hitCount,
+  DWORD32 size,
+  DWORD32 width,
+  DWORD32 alignment,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+  DWORD32 i = 0;
+
+  // Report every aligned start offset the kernel rejected, hits are ascending
+  for (DWORD32 offset = 0; (offset + width) <= size; offset += alignment)
+  {
+    if (i < hitCount && hits[i] == offset)
+    {
+      i++;
+    }
+    else
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+static __inline
+DWORD32
+KmMergeOffsets(
+  PDWORD32 left,
+  DWORD32 leftCount,
+  PDWORD32 right,
+  DWORD32 rightCount,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+  DWORD32 i = 0;
+  DWORD32 j = 0;
+
+  // Merge ascending offsets, starts matching in both encodings are reported once
+  while (i < leftCount || j < rightCount)
+  {
+    if (j == rightCount || (i < leftCount && left[i] < right[j]))
+    {
+      offsets[count++] = left[i++];
+    }
+    else
+    {
+      i += (i < leftCount && left[i] == right[j]) ? 1 : 0;
+      offsets[count++] = right[j++];
+    }
+  }
+
+  return count;
+}
+
+///////////////////////////////////////////////////////////
+// Span utilities
+///////////////////////////////////////////////////////////
+
+static __forceinline
+SCAN_SPAN
+KmGetScanSpan(
+  DWORD64 base,
+  DWORD64 end,
+  DWORD64 limit,
+  DWORD32 size,
+  DWORD32 reach)
+{
+  SCAN_SPAN span;
+
+  // Spans own up to size bytes and read up to reach bytes past them so values crossing into the next span are compared once
+  span.Base = base;
+  span.Size = (DWORD32)(((end - base) < size) ? (end - base) : size);
+  span.Reach = (DWORD32)(((limit - base - span.Size) < reach) ? (limit - base - span.Size) : reach);
+
+  return span;
+}
+
+static __forceinline
+DWORD32
+KmTrimOffsets(
+  PDWORD32 offsets,
+  DWORD32 count,
+  DWORD32 size)
+{
+  // Starts inside the reach belong to the following span, offsets are ascending
+  while (count > 0 && offsets[count - 1] >= size)
+  {
+    count--;
+  }
+
+  return count;
+}
+
+static __inline
+VOID
+KmWalkScanWindows(
+  PSCAN_WALK walk,
+  DWORD64 regionBase,
+  DWORD64 regionSize,
+  DWORD64 regionLimit,
+  DWORD32 reach,
+  SCAN_WINDOW_ROUTINE routine,
+  PVOID context)
+{
+  // Slide a bounded window over the region, the step routine sees every window and may stop the walk
+  DWORD64 regionEnd = regionBase + regionSize;
+  for (DWORD64 base = regionBase; base < regionEnd; base += KM_SCAN_WINDOW_SIZE)
+  {
+    // Windows also map the reach of values starting in their last bytes
+    SCAN_SPAN span = KmGetScanSpan(base, regionEnd, regionLimit, KM_SCAN_WINDOW_SIZE, reach);
+    PBYTE mapped = NULL;
+    if (walk->Map(walk->Context, span.Base, span.Size + span.Reach, &mapped))
+    {
+      routine(context, span.Base, mapped, span.Size + span.Reach, span.Size);
+      if (walk->Unmap)
+      {
+        walk->Unmap(walk->Context);
+      }
+    }
+    else
+    {
+      // Retry page wise so a single bad page does not discard the whole window
+      for (DWORD64 pageBase = span.Base; pageBase < (span.Base + span.Size); pageBase += KM_SCAN_PAGE_SIZE)
+      {
+        SCAN_SPAN page = KmGetScanSpan(pageBase, span.Base + span.Size, regionLimit, KM_SCAN_PAGE_SIZE, reach);
+        BOOLEAN success = walk->Map(walk->Context, page.Base, page.Size + page.Reach, &mapped);
+        if (success == FALSE && page.Reach)
+        {
+          // Values crossing into an unreadable page can not match
+          page.Reach = 0;
+          success = walk->Map(walk->Context, page.Base, page.Size, &mapped);
+        }
+        if (success)
+        {
+          routine(context, page.Base, mapped, page.Size + page.Reach, page.Size);
+          if (walk->Unmap)
+          {
+            walk->Unmap(walk->Context);
+          }
+        }
+      }
+    }
+
+    // Window is done
+    if (walk->Step && walk->Step(walk->Context, span.Size) == FALSE)
+    {
+      break;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////
+// Real utilities
+///////////////////////////////////////////////////////////
+
+static __inline
+double
+KmInfiniteReal()
+{
+  INT64 bits = 0x7FF0000000000000;
+  double value;
+  RtlCopyMemory(&value, &bits, sizeof(bits));
+  return value;
+}
+
+static __inline
+double
+KmNextUpReal(
+  double value)
+{
+  INT64 bits;
+  RtlCopyMemory(&bits, &value, sizeof(bits));
+
+  // NaN and positive infinity have no successor
+  if (value != value || bits == 0x7FF0000000000000)
+  {
+    return value;
+  }
+
+  // Both zeros step to the smallest denormal
+  if (value == 0.0)
+  {
+    bits = 1;
+  }
+  else
+  {
+    bits += (bits > 0) ? 1 : -1;
+  }
+
+  RtlCopyMemory(&value, &bits, sizeof(bits));
+  return value;
+}
+
+static __inline
+double
+KmNextDownReal(
+  double value)
+{
+  return -KmNextUpReal(-value);
+}
+
+static __inline
+float
+KmNextUpFloat(
+  float value)
+{
+  INT32 bits;
+  RtlCopyMemory(&bits, &value, sizeof(bits));
+
+  // NaN and positive infinity have no successor
+  if (value != value || bits == 0x7F800000)
+  {
+    return value;
+  }
+
+  // Both zeros step to the smallest denormal
+  if (value == 0.0f)
+  {
+    bits = 1;
+  }
+  else
+  {
+    bits += (bits > 0) ? 1 : -1;
+  }
+
+  RtlCopyMemory(&value, &bits, sizeof(bits));
+  return value;
+}
+
+static __inline
+float
+KmNextDownFloat(
+  float value)
+{
+  return -KmNextUpFloat(-value);
+}
+
+static __inline
+double
+KmTruncateReal(
+  double value)
+{
+  // Values beyond 2^52 carry no fraction
+  return (value > -4503599627370496.0 && value < 4503599627370496.0) ? (double)(INT64)value : value;
+}
+
+static __inline
+double
+KmRoundReal(
+  double value)
+{
+  // Round half away from zero
+  double truncated = KmTruncateReal(value);
+  if ((value - truncated) >= 0.5)
+  {
+    truncated += 1.0;
+  }
+  else if ((value - truncated) <= -0.5)
+  {
+    truncated -= 1.0;
+  }
+  return truncated;
+}
+
+static __inline
+VOID
+KmStoreRealRange(
+  PBYTE value,
+  DWORD32 width,
+  double low,
+  double high)
+{
+  if (width == sizeof(float))
+  {
+    // Narrow bounds without widening the range
+    float lowFloat = (float)low;
+    float highFloat = (float)high;
+    if ((double)lowFloat < low)
+    {
+      lowFloat = KmNextUpFloat(lowFloat);
+    }
+    if ((double)highFloat > high)
+    {
+      highFloat = KmNextDownFloat(highFloat);
+    }
+    RtlCopyMemory(value, &lowFloat, sizeof(float));
+    RtlCopyMemory(value + sizeof(float), &highFloat, sizeof(float));
+  }
+  else
+  {
+    RtlCopyMemory(value, &low, sizeof(double));
+    RtlCopyMemory(value + sizeof(double), &high, sizeof(double));
+  }
+}
+
+static __inline
+DWORD32
+KmCompareRealTail(
+  PBYTE bytes,
+  DWORD32 offset,
+  DWORD32 size,
+  PBYTE value,
+  DWORD32 width,
+  DWORD32 alignment,
+  PDWORD32 offsets,
+  DWORD32 count)
+{
+  // Compare remaining elements against the closed range, NaN never matches
+  for (; (offset + width) <= size; offset += alignment)
+  {
+    BOOLEAN match = FALSE;
+    if (width == sizeof(float))
+    {
+      float element = *(float*)(bytes + offset);
+      match = element >= *(float*)value && element <= *(float*)(value + sizeof(float));
+    }
+    else
+    {
+      double element = *(double*)(bytes + offset);
+      match = element >= *(double*)value && element <= *(double*)(value + sizeof(double));
+    }
+    if (match)
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+///////////////////////////////////////////////////////////
+// Kernel templates
+///////////////////////////////////////////////////////////
+
+// Shifted loads cover every aligned start offset within a vector, the lane mask keeps one bit per element
+#define KM_COMPARE_KERNEL(name, target, vector, width, lanes, load, setup, match, tail)          \
+static target                                                                                    \
+DWORD32                                                                                          \
+name(                                                                                            \
+  PBYTE bytes,                                                                                   \
+  DWORD32 size,                                                                                  \
+  PBYTE value,                                                                                   \
+  DWORD32 alignment,                                                                             \
+  PDWORD32 offsets)                                                                              \
+{                                                                                                \
+  DWORD32 count = 0;                                                                             \
+  DWORD32 offset = 0;                                                                            \
+  DWORD32 reach = (DWORD32)(width) - ((alignment < (width)) ? alignment : (DWORD32)(width));     \
+  DWORD32 alignmentMask = KmAlignmentMask(alignment);                                            \
+  setup;                                                                                         \
+  for (; (offset + sizeof(vector) + reach) <= size; offset += sizeof(vector))                    \
+  {                                                                                              \
+    DWORD32 mask = 0;                                                                            \
+    for (DWORD32 shift = 0; shift <= reach; shift += alignment)                                  \
+    {                                                                                            \
+      vector block = load(bytes + offset + shift);                                               \
+      mask |= ((DWORD32)(match) & (lanes)) << shift;                                             \
+    }                                                                                            \
+    count = KmDrainMask(mask & alignmentMask, offset, offsets, count);                           \
+  }                                                                                              \
+  return tail(bytes, offset, size, value, (DWORD32)(width), alignment, offsets, count);          \
+}
+
+// Integers compare bitwise against the value
+#define KM_EQUAL_KERNEL(name, target, vector, type, lanes, load, set, equal, movemask)           \
+KM_COMPARE_KERNEL(name, target, vector, sizeof(type), lanes, load,                               \
+  vector needle = set(*(type*)value),                                                            \
+  movemask(equal(block, needle)),                                                                \
+  KmCompareTail)
+
+// Reals compare against the closed range which follows the value
+#define KM_REAL_KERNEL(name, target, vector, type, lanes, load, set, inside, movemask)           \
+KM_COMPARE_KERNEL(name, target, vector, sizeof(type), lanes, load,                               \
+  vector low = set(*(type*)value);                                                               \
+  vector high = set(*(type*)(value + sizeof(type))),                                             \
+  movemask(inside(block, low, high)),                                                            \
+  KmCompareRealTail)
+
+// Masked integers compare against the signed closed range, the lanes outside of it are inverted
+#define KM_RANGE_KERNEL(name, target, vector, type, lanes, load, set, intersect, unite, greater, movemask) \
+KM_COMPARE_KERNEL(name, target, vector, sizeof(type), lanes, load,                               \
+  vector low = set(*(type*)value);                                                               \
+  vector high = set(*(type*)(value + sizeof(type)));                                             \
+  vector bits = set(*(type*)(value + sizeof(type) * 2)),                                         \
+  ~(DWORD32)movemask(unite(greater(low, intersect(block, bits)), greater(intersect(block, bits), high))), \
+  KmCompareRangeTail)
+
+///////////////////////////////////////////////////////////
+// SSE2 kernels
+///////////////////////////////////////////////////////////
+
+#define KM_TARGET_SSE2
+#define KM_LOAD_SSE2(bytes) _mm_loadu_si128((__m128i*)(bytes))
+#define KM_LOAD_FLOAT32_SSE2(bytes) _mm_loadu_ps((float*)(bytes))
+#define KM_LOAD_FLOAT64_SSE2(bytes) _mm_loadu_pd((double*)(bytes))
+
+static __forceinline
+__m128i
+KmCompareEqual64Sse2(
+  __m128i left,
+  __m128i right)
+{
+  // SSE2 has no 64 bit compare, both halves have to be equal
+  __m128i equal = _mm_cmpeq_epi32(left, right);
+  return _mm_and_si128(equal, _mm_shuffle_epi32(equal, _MM_SHUFFLE(2, 3, 0, 1)));
+}
+
+static __forceinline
+__m128i
+KmCompareGreater64Sse2(
+  __m128i left,
+  __m128i right)
+{
+  // SSE2 has no 64 bit compare, signed high halves decide unless equal, then unsigned low halves
+  __m128i bias = _mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000);
+  __m128i greater = _mm_cmpgt_epi32(_mm_xor_si128(left, bias), _mm_xor_si128(right, bias));
+  __m128i equal = _mm_cmpeq_epi32(left, right);
+  __m128i greaterLow = _mm_shuffle_epi32(greater, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128i greaterHigh = _mm_shuffle_epi32(greater, _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i equalHigh = _mm_shuffle_epi32(equal, _MM_SHUFFLE(3, 3, 1, 1));
+  return _mm_or_si128(greaterHigh, _mm_and_si128(equalHigh, greaterLow));
+}
+
+static __forceinline
+__m128i
+KmCompareInside32Sse2(
+  __m128 block,
+  __m128 low,
+  __m128 high)
+{
+  // Ordered compares, NaN is outside of every range
+  return _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(block, low), _mm_cmple_ps(block, high)));
+}
+
+static __forceinline
+__m128i
+KmCompareInside64Sse2(
+  __m128d block,
+  __m128d low,
+  __m128d high)
+{
+  // Ordered compares, NaN is outside of every range
+  return _mm_castpd_si128(_mm_and_pd(_mm_cmpge_pd(block, low), _mm_cmple_pd(block, high)));
+}
+
+KM_EQUAL_KERNEL(KmCompareByte8Sse2, KM_TARGET_SSE2, __m128i, INT8, 0xFFFF, KM_LOAD_SSE2, _mm_set1_epi8, _mm_cmpeq_epi8, _mm_movemask_epi8)
+KM_EQUAL_KERNEL(KmCompareByte16Sse2, KM_TARGET_SSE2, __m128i, INT16, 0x5555, KM_LOAD_SSE2, _mm_set1_epi16, _mm_cmpeq_epi16, _mm_movemask_epi8)
+KM_EQUAL_KERNEL(KmCompareByte32Sse2, KM_TARGET_SSE2, __m128i, INT32, 0x1111, KM_LOAD_SSE2, _mm_set1_epi32, _mm_cmpeq_epi32, _mm_movemask_epi8)
+KM_EQUAL_KERNEL(KmCompareByte64Sse2, KM_TARGET_SSE2, __m128i, INT64, 0x0101, KM_LOAD_SSE2, _mm_set1_epi64x, KmCompareEqual64Sse2, _mm_movemask_epi8)
+KM_REAL_KERNEL(KmCompareFloat32Sse2, KM_TARGET_SSE2, __m128, float, 0x1111, KM_LOAD_FLOAT32_SSE2, _mm_set1_ps, KmCompareInside32Sse2, _mm_movemask_epi8)
+KM_REAL_KERNEL(KmCompareFloat64Sse2, KM_TARGET_SSE2, __m128d, double, 0x0101, KM_LOAD_FLOAT64_SSE2, _mm_set1_pd, KmCompareInside64Sse2, _mm_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange8Sse2, KM_TARGET_SSE2, __m128i, INT8, 0xFFFF, KM_LOAD_SSE2, _mm_set1_epi8, _mm_and_si128, _mm_or_si128, _mm_cmpgt_epi8, _mm_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange16Sse2, KM_TARGET_SSE2, __m128i, INT16, 0x5555, KM_LOAD_SSE2, _mm_set1_epi16, _mm_and_si128, _mm_or_si128, _mm_cmpgt_epi16, _mm_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange32Sse2, KM_TARGET_SSE2, __m128i, INT32, 0x1111, KM_LOAD_SSE2, _mm_set1_epi32, _mm_and_si128, _mm_or_si128, _mm_cmpgt_epi32, _mm_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange64Sse2, KM_TARGET_SSE2, __m128i, INT64, 0x0101, KM_LOAD_SSE2, _mm_set1_epi64x, _mm_and_si128, _mm_or_si128, KmCompareGreater64Sse2, _mm_movemask_epi8)
+
+///////////////////////////////////////////////////////////
+// AVX2 kernels
+///////////////////////////////////////////////////////////
+
+#define KM_LOAD_AVX2(bytes) _mm256_loadu_si256((__m256i*)(bytes))
+#define KM_LOAD_FLOAT32_AVX2(bytes) _mm256_loadu_ps((float*)(bytes))
+#define KM_LOAD_FLOAT64_AVX2(bytes) _mm256_loadu_pd((double*)(bytes))
+
+static __forceinline KM_TARGET_AVX2
+__m256i
+KmCompareInside32Avx2(
+  __m256 block,
+  __m256 low,
+  __m256 high)
+{
+  // Ordered compares, NaN is outside of every range
+  return _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(block, low, _CMP_GE_OQ), _mm256_cmp_ps(block, high, _CMP_LE_OQ)));
+}
+
+static __forceinline KM_TARGET_AVX2
+__m256i
+KmCompareInside64Avx2(
+  __m256d block,
+  __m256d low,
+  __m256d high)
+{
+  // Ordered compares, NaN is outside of every range
+  return _mm256_castpd_si256(_mm256_and_pd(_mm256_cmp_pd(block, low, _CMP_GE_OQ), _mm256_cmp_pd(block, high, _CMP_LE_OQ)));
+}
+
+KM_EQUAL_KERNEL(KmCompareByte8Avx2, KM_TARGET_AVX2, __m256i, INT8, 0xFFFFFFFF, KM_LOAD_AVX2, _mm256_set1_epi8, _mm256_cmpeq_epi8, _mm256_movemask_epi8)
+KM_EQUAL_KERNEL(KmCompareByte16Avx2, KM_TARGET_AVX2, __m256i, INT16, 0x55555555, KM_LOAD_AVX2, _mm256_set1_epi16, _mm256_cmpeq_epi16, _mm256_movemask_epi8)
+KM_EQUAL_KERNEL(KmCompareByte32Avx2, KM_TARGET_AVX2, __m256i, INT32, 0x11111111, KM_LOAD_AVX2, _mm256_set1_epi32, _mm256_cmpeq_epi32, _mm256_movemask_epi8)
+KM_EQUAL_KERNEL(KmCompareByte64Avx2, KM_TARGET_AVX2, __m256i, INT64, 0x01010101, KM_LOAD_AVX2, _mm256_set1_epi64x, _mm256_cmpeq_epi64, _mm256_movemask_epi8)
+KM_REAL_KERNEL(KmCompareFloat32Avx2, KM_TARGET_AVX2, __m256, float, 0x11111111, KM_LOAD_FLOAT32_AVX2, _mm256_set1_ps, KmCompareInside32Avx2, _mm256_movemask_epi8)
+KM_REAL_KERNEL(KmCompareFloat64Avx2, KM_TARGET_AVX2, __m256d, double, 0x01010101, KM_LOAD_FLOAT64_AVX2, _mm256_set1_pd, KmCompareInside64Avx2, _mm256_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange8Avx2, KM_TARGET_AVX2, __m256i, INT8, 0xFFFFFFFF, KM_LOAD_AVX2, _mm256_set1_epi8, _mm256_and_si256, _mm256_or_si256, _mm256_cmpgt_epi8, _mm256_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange16Avx2, KM_TARGET_AVX2, __m256i, INT16, 0x55555555, KM_LOAD_AVX2, _mm256_set1_epi16, _mm256_and_si256, _mm256_or_si256, _mm256_cmpgt_epi16, _mm256_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange32Avx2, KM_TARGET_AVX2, __m256i, INT32, 0x11111111, KM_LOAD_AVX2, _mm256_set1_epi32, _mm256_and_si256, _mm256_or_si256, _mm256_cmpgt_epi32, _mm256_movemask_epi8)
+KM_RANGE_KERNEL(KmCompareRange64Avx2, KM_TARGET_AVX2, __m256i, INT64, 0x01010101, KM_LOAD_AVX2, _mm256_set1_epi64x, _mm256_and_si256, _mm256_or_si256, _mm256_cmpgt_epi64, _mm256_movemask_epi8)
+
+///////////////////////////////////////////////////////////
+// Kernel selection
+///////////////////////////////////////////////////////////
+
+static __inline
+DWORD32
+KmGetCompareWidth(
+  DWORD32 type)
+{
+  static const DWORD32 widths[] = { sizeof(INT8), sizeof(INT16), sizeof(INT32), sizeof(INT64), sizeof(float), sizeof(double) };
+  return (type < ARRAYSIZE(widths)) ? widths[type] : 0;
+}
+
+static __inline
+SCAN_COMPARE_ROUTINE
+KmGetCompareKernel(
+  DWORD32 type,
+  BOOLEAN avx2)
+{
+  // Fixed width types in scan type order
+  static const SCAN_COMPARE_ROUTINE sse2Kernels[] = { KmCompareByte8Sse2, KmCompareByte16Sse2, KmCompareByte32Sse2, KmCompareByte64Sse2, KmCompareFloat32Sse2, KmCompareFloat64Sse2 };
+  static const SCAN_COMPARE_ROUTINE avx2Kernels[] = { KmCompareByte8Avx2, KmCompareByte16Avx2, KmCompareByte32Avx2, KmCompareByte64Avx2, KmCompareFloat32Avx2, KmCompareFloat64Avx2 };
+  if (type >= ARRAYSIZE(sse2Kernels))
+  {
+    return NULL;
+  }
+  return avx2 ? avx2Kernels[type] : sse2Kernels[type];
+}
+
+static __inline
+SCAN_COMPARE_ROUTINE
+KmGetRangeKernel(
+  DWORD32 width,
+  BOOLEAN avx2)
+{
+  // Masked signed ranges by integer width
+  static const SCAN_COMPARE_ROUTINE sse2Kernels[] = { KmCompareRange8Sse2, KmCompareRange16Sse2, KmCompareRange32Sse2, KmCompareRange64Sse2 };
+  static const SCAN_COMPARE_ROUTINE avx2Kernels[] = { KmCompareRange8Avx2, KmCompareRange16Avx2, KmCompareRange32Avx2, KmCompareRange64Avx2 };
+  unsigned long index;
+  if (_BitScanForward(&index, width) == 0 || index >= ARRAYSIZE(sse2Kernels) || (width & (width - 1)))
+  {
+    return NULL;
+  }
+  return avx2 ? avx2Kernels[index] : sse2Kernels[index];
+}
+
+///////////////////////////////////////////////////////////
+// Type utilities
+///////////////////////////////////////////////////////////
+
+static __inline
+BOOLEAN
+KmIsRealCompare(
+  DWORD32 type)
+{
+  return type == SCAN_TYPE_FLOAT32 || type == SCAN_TYPE_FLOAT64;
+}
+
+static __inline
+BOOLEAN
+KmIsTextCompare(
+  DWORD32 type)
+{
+  return type == SCAN_TYPE_ASCII || type == SCAN_TYPE_UTF16 || type == SCAN_TYPE_TEXT;
+}
+
+static __inline
+DWORD32
+KmGetCompareAlignment(
+  DWORD32 type,
+  DWORD32 alignment)
+{
+  // Patterns and text match at every byte
+  if (type == SCAN_TYPE_BYTES || KmIsTextCompare(type))
+  {
+    return (alignment == SCAN_ALIGNMENT_NATURAL || alignment == SCAN_ALIGNMENT_BYTE8) ? 1 : 0;
+  }
+
+  // Natural alignment follows the value width
+  if (alignment == SCAN_ALIGNMENT_NATURAL)
+  {
+    return KmGetCompareWidth(type);
+  }
+
+  // Explicit alignment has to be a power of two up to eight bytes
+  switch (alignment)
+  {
+    case 1: case 2: case 4: case 8: return alignment;
+    default: return 0;
+  }
+}
+
+static __inline
+BOOLEAN
+KmGetRealRange(
+  DWORD32 rounding,
+  double value,
+  double tolerance,
+  double* low,
+  double* high)
+{
+  BOOLEAN valid = FALSE;
+
+  // NaN never matches, values beyond 2^52 and infinities have no fraction to round
+  if (value == value)
+  {
+    BOOLEAN integral = value <= -4503599627370496.0 || value >= 4503599627370496.0;
+    switch (rounding)
+    {
+      case SCAN_ROUNDING_EXACT:
+      {
+        *low = value;
+        *high = value;
+        valid = TRUE;
+        break;
+      }
+      case SCAN_ROUNDING_ROUNDED:
+      {
+        // Every value which rounds half away from zero onto the same integer
+        double rounded = integral ? value : KmRoundReal(value);
+        *low = integral ? value : rounded - 0.5;
+        *high = integral ? value : rounded + 0.5;
+        if (integral == FALSE && *low < 0.0)
+        {
+          *low = KmNextUpReal(*low);
+        }
+        if (integral == FALSE && *high > 0.0)
+        {
+          *high = KmNextDownReal(*high);
+        }
+        valid = TRUE;
+        break;
+      }
+      case SCAN_ROUNDING_TRUNCATED:
+      {
+        // Every value which truncates towards zero onto the same integer
+        double truncated = KmTruncateReal(value);
+        *low = (integral || truncated > 0.0) ? truncated : KmNextUpReal(truncated - 1.0);
+        *high = (integral || truncated < 0.0) ? truncated : KmNextDownReal(truncated + 1.0);
+        valid = TRUE;
+        break;
+      }
+      case SCAN_ROUNDING_EPSILON:
+      {
+        // Tolerance has to be a non-negative number
+        if (tolerance >= 0.0)
+        {
+          *low = value - tolerance;
+          *high = value + tolerance;
+          valid = TRUE;
+        }
+        break;
+      }
+    }
+  }
+
+  return valid;
+}
+
+static __inline
+BOOLEAN
+KmGetIntegerPredicateRange(
+  PSCAN_PREDICATE predicate,
+  DWORD32 width,
+  INT64* low,
+  INT64* high,
+  INT64* bits)
+{
+  BOOLEAN valid = FALSE;
+
+  // Operands are sign extended like the scanned elements
+  INT64 minimum = (width < sizeof(INT64)) ? -(1LL << (width * 8 - 1)) : MINLONG64;
+  INT64 maximum = ~minimum;
+  INT64 operand = KmLoadCompareValue(predicate->Operand, width);
+  INT64 limit = KmLoadCompareValue(predicate->Limit, width);
+  *bits = -1;
+  switch (predicate->Type)
+  {
+    case SCAN_PREDICATE_LESS:
+    {
+      *low = minimum;
+      *high = operand - 1;
+      valid = operand > minimum;
+      break;
+    }
+    case SCAN_PREDICATE_GREATER:
+    {
+      *low = operand + 1;
+      *high = maximum;
+      valid = operand < maximum;
+      break;
+    }
+    case SCAN_PREDICATE_BETWEEN:
+    {
+      *low = operand;
+      *high = limit;
+      valid = operand <= limit;
+      break;
+    }
+    case SCAN_PREDICATE_MASK:
+    {
+      // Bits selected by the limit have to equal those of the operand
+      *bits = limit;
+      *low = operand & limit;
+      *high = operand & limit;
+      valid = TRUE;
+      break;
+    }
+  }
+
+  return valid;
+}
+
+static __inline
+BOOLEAN
+KmGetRealPredicateRange(
+  PSCAN_PREDICATE predicate,
+  DWORD32 width,
+  double* low,
+  double* high)
+{
+  BOOLEAN valid = FALSE;
+
+  // Bounds are exact, NaN operands match nothing
+  double infinity = KmInfiniteReal();
+  double operand = (width == sizeof(float)) ? *(float*)predicate->Operand : *(double*)predicate->Operand;
+  double limit = (width == sizeof(float)) ? *(float*)predicate->Limit : *(double*)predicate->Limit;
+  switch (predicate->Type)
+  {
+    case SCAN_PREDICATE_LESS:
+    {
+      *low = -infinity;
+      *high = KmNextDownReal(operand);
+      valid = operand > -infinity;
+      break;
+    }
+    case SCAN_PREDICATE_GREATER:
+    {
+      *low = KmNextUpReal(operand);
+      *high = infinity;
+      valid = operand < infinity;
+      break;
+    }
+    case SCAN_PREDICATE_BETWEEN:
+    {
+      *low = operand;
+      *high = limit;
+      valid = operand <= limit;
+      break;
+    }
+  }
+
+  return valid;
+}
+
+///////////////////////////////////////////////////////////
+// Pattern utilities
+///////////////////////////////////////////////////////////
+
+static __inline
+DWORD32
+KmGetByteFrequency(
+  BYTE value)
+{
+  // Rough frequency of bytes in x64 code and data, higher is more common
+  switch (value)
+  {
+    case 0x00: return 16;
+    case 0xFF: return 12;
+    case 0xCC: return 10;
+    case 0x48: return 9;
+    case 0x8B: return 8;
+    case 0x89: return 7;
+    case 0x01: case 0x0F: case 0x24: case 0x44: case 0x4C: return 6;
+    case 0x83: case 0x85: case 0x8D: case 0xE8: case 0x90: return 5;
+    case 0x02: case 0x03: case 0x04: case 0x08: case 0x10: case 0x20: case 0x40: case 0x80: return 4;
+    case 0x41: case 0x45: case 0x49: case 0x4D: case 0x74: case 0x75: case 0xC0: case 0xC3: return 3;
+  }
+  return (value < 0x20 || value >= 0xF0) ? 2 : 1;
+}
+
+static __inline
+BOOLEAN
+KmIsAsciiLetter(
+  WCHAR value)
+{
+  return (value >= 'a' && value <= 'z') || (value >= 'A' && value <= 'Z');
+}
+
+static __forceinline
+BOOLEAN
+KmVerifyPattern(
+  PPATTERN pattern,
+  PBYTE bytes)
+{
+  DWORD32 i = 0;
+
+  // Masked compare of whole vectors
+  for (; (i + sizeof(__m128i)) <= pattern->Length; i += sizeof(__m128i))
+  {
+    __m128i block = _mm_loadu_si128((__m128i*)(bytes + i));
+    __m128i expected = _mm_loadu_si128((__m128i*)(pattern->Bytes + i));
+    __m128i mask = _mm_loadu_si128((__m128i*)(pattern->Masks + i));
+    __m128i difference = _mm_and_si128(_mm_xor_si128(block, expected), mask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(difference, _mm_setzero_si128())) != 0xFFFF)
+    {
+      return FALSE;
+    }
+  }
+
+  // Masked compare of remaining bytes
+  for (; i < pattern->Length; i++)
+  {
+    if ((bytes[i] ^ pattern->Bytes[i]) & pattern->Masks[i])
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static __inline
+DWORD32
+KmMatchPatternSkip(
+  PPATTERN pattern,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+  PBYTE run = pattern->Bytes + pattern->RunOffset;
+  DWORD32 runLength = pattern->RunLength;
+
+  // Slide over the longest fixed run, shifts are driven by its last byte
+  for (DWORD32 start = 0; (start + pattern->Length) <= size;)
+  {
+    PBYTE window = bytes + start + pattern->RunOffset;
+    BYTE last = window[runLength - 1];
+    if (last == run[runLength - 1] && RtlEqualMemory(window, run, runLength - 1) && KmVerifyPattern(pattern, bytes + start))
+    {
+      offsets[count++] = start;
+    }
+    start += pattern->Skip[last];
+  }
+
+  return count;
+}
+
+static __inline
+DWORD32
+KmMatchPatternAnchor(
+  PPATTERN pattern,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+  DWORD32 start = 0;
+  DWORD32 starts = size - pattern->Length + 1;
+  BYTE anchor = pattern->Bytes[pattern->Anchor];
+  BYTE anchorMask = pattern->Masks[pattern->Anchor];
+
+  // Search the rarest fixed byte vector wise and verify its candidates, case folded letters are masked in place
+  __m128i needle = _mm_set1_epi8((CHAR)anchor);
+  __m128i needleMask = _mm_set1_epi8((CHAR)anchorMask);
+  for (; (start + sizeof(__m128i)) <= starts; start += sizeof(__m128i))
+  {
+    __m128i block = _mm_and_si128(_mm_loadu_si128((__m128i*)(bytes + start + pattern->Anchor)), needleMask);
+    DWORD32 mask = (DWORD32)_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle));
+
+    unsigned long index;
+    while (_BitScanForward(&index, mask))
+    {
+      if (KmVerifyPattern(pattern, bytes + start + index))
+      {
+        offsets[count++] = start + index;
+      }
+      mask &= mask - 1;
+    }
+  }
+
+  // Verify remaining start offsets
+  for (; start < starts; start++)
+  {
+    if ((bytes[start + pattern->Anchor] & anchorMask) == anchor && KmVerifyPattern(pattern, bytes + start))
+    {
+      offsets[count++] = start;
+    }
+  }
+
+  return count;
+}
+
+static __inline
+DWORD32
+KmMatchPatternScalar(
+  PPATTERN pattern,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+
+  // Patterns without fixed bytes have to be verified at every offset
+  for (DWORD32 start = 0; (start + pattern->Length) <= size; start++)
+  {
+    if (KmVerifyPattern(pattern, bytes + start))
+    {
+      offsets[count++] = start;
+    }
+  }
+
+  return count;
+}
+
+///////////////////////////////////////////////////////////
+// Pattern kernels
+///////////////////////////////////////////////////////////
+
+static __inline
+BOOLEAN
+KmCompilePattern(
+  PPATTERN pattern,
+  PBYTE bytes,
+  PBYTE masks,
+  DWORD32 length)
+{
+  BOOLEAN fixed = FALSE;
+
+  if (length > 0 && length <= KM_PATTERN_MAX_LENGTH)
+  {
+    RtlZeroMemory(pattern, sizeof(PATTERN));
+    pattern->Length = length;
+    pattern->Anchor = MAXDWORD;
+
+    DWORD32 runOffset = 0;
+    DWORD32 runLength = 0;
+    for (DWORD32 i = 0; i < length; i++)
+    {
+      // Normalize wildcard bits
+      pattern->Masks[i] = masks[i];
+      pattern->Bytes[i] = bytes[i] & masks[i];
+      fixed |= masks[i] != 0;
+
+      // Pick the rarest fixed or case folded byte as anchor
+      if ((BYTE)(masks[i] | 0x20) == 0xFF)
+      {
+        if (pattern->Anchor == MAXDWORD || KmGetByteFrequency(pattern->Bytes[i]) < KmGetByteFrequency(pattern->Bytes[pattern->Anchor]))
+        {
+          pattern->Anchor = i;
+        }
+      }
+
+      if (masks[i] == 0xFF)
+      {
+        // Track the longest fully fixed run
+        runOffset = (runLength == 0) ? i : runOffset;
+        runLength++;
+        if (runLength > pattern->RunLength)
+        {
+          pattern->RunOffset = runOffset;
+          pattern->RunLength = runLength;
+        }
+      }
+      else
+      {
+        runLength = 0;
+      }
+    }
+
+    // Build skip table for long fixed runs
+    if (pattern->RunLength >= KM_PATTERN_SKIP_LENGTH)
+    {
+      for (DWORD32 i = 0; i < 256; i++)
+      {
+        pattern->Skip[i] = pattern->RunLength;
+      }
+      for (DWORD32 i = 0; i < (pattern->RunLength - 1); i++)
+      {
+        pattern->Skip[pattern->Bytes[pattern->RunOffset + i]] = pattern->RunLength - 1 - i;
+      }
+    }
+  }
+
+  // Patterns consisting of wildcards only would match everything
+  return fixed;
+}
+
+static __inline
+BOOLEAN
+KmCompileText(
+  PPATTERN pattern,
+  PWCHAR text,
+  DWORD32 length,
+  BOOLEAN wide,
+  BOOLEAN ignoreCase)
+{
+  BOOLEAN valid = FALSE;
+
+  DWORD32 width = wide ? sizeof(WCHAR) : sizeof(CHAR);
+  if (length > 0 && length <= (KM_PATTERN_MAX_LENGTH / width))
+  {
+    BYTE bytes[KM_PATTERN_MAX_LENGTH];
+    BYTE masks[KM_PATTERN_MAX_LENGTH];
+
+    valid = TRUE;
+    for (DWORD32 i = 0; i < length && valid; i++)
+    {
+      // ASCII letters differ in a single bit between cases, clearing it from the mask folds them during the compare
+      BYTE mask = (ignoreCase && KmIsAsciiLetter(text[i])) ? 0xDF : 0xFF;
+      if (wide)
+      {
+        bytes[i * 2] = (BYTE)text[i];
+        bytes[i * 2 + 1] = (BYTE)(text[i] >> 8);
+        masks[i * 2] = mask;
+        masks[i * 2 + 1] = 0xFF;
+      }
+      else
+      {
+        // Narrow text only covers the first code page
+        bytes[i] = (BYTE)text[i];
+        masks[i] = mask;
+        valid = text[i] <= 0xFF;
+      }
+    }
+
+    if (valid)
+    {
+      valid = KmCompilePattern(pattern, bytes, masks, length * width);
+    }
+  }
+
+  return valid;
+}
+
+static __inline
+DWORD32
+KmMatchPattern(
+  PPATTERN pattern,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+
+  if (size >= pattern->Length)
+  {
+    // Select strategy by the shape of the pattern
+    if (pattern->RunLength >= KM_PATTERN_SKIP_LENGTH)
+    {
+      count = KmMatchPatternSkip(pattern, bytes, size, offsets);
+    }
+    else if (pattern->Anchor != MAXDWORD)
+    {
+      count = KmMatchPatternAnchor(pattern, bytes, size, offsets);
+    }
+    else
+    {
+      count = KmMatchPatternScalar(pattern, bytes, size, offsets);
+    }
+  }
+
+  return count;
+}
+
+#endif
\ No newline at end of file
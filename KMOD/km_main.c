@@ -34,7 +34,6 @@ DriverUnload(
   // Free lists
   status = KmResetKernelImageList();
   status = KmResetProcessImageList();
-  status = KmResetScanList();
 
   // Check driver unload successfully
   if (NT_SUCCESS(status))
@@ -78,7 +77,6 @@ DriverEntry(
   // Initialize lists
   status = KmInitializeProcessImageList();
   status = KmInitializeKernelImageList();
-  status = KmInitializeScanList();
 
   // Check driver load successfully
   if (NT_SUCCESS(status))
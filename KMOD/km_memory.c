@@ -110,6 +110,137 @@ KmWriteMemorySafe(
   return status;
 }
 
+NTSTATUS
+KmReadUserBuffer(
+  PVOID dst,
+  PVOID src,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  __try
+  {
+    // Buffers referenced by requests have to lie in user space
+    ProbeForRead(src, size, 1);
+
+    // Copy memory
+    RtlCopyMemory(dst, src, size);
+  }
+  __except (EXCEPTION_EXECUTE_HANDLER)
+  {
+    status = STATUS_INVALID_USER_BUFFER;
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmInitializeMemoryWindow(
+  PMEMORY_WINDOW window,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Allocate MDL large enough to describe an unaligned window of the supplied size
+  window->Size = size;
+  window->Mapped = NULL;
+  window->Mdl = ExAllocatePoolWithTag(NonPagedPool, MmSizeOfMdl((PVOID)(PAGE_SIZE - 1), size), KM_MEMORY_POOL_TAG);
+  if (window->Mdl)
+  {
+    status = STATUS_SUCCESS;
+  }
+
+  return status;
+}
+
+VOID
+KmFreeMemoryWindow(
+  PMEMORY_WINDOW window)
+{
+  // Release mapping if still present
+  KmUnmapMemoryWindow(window);
+
+  // Free MDL
+  if (window->Mdl)
+  {
+    ExFreePoolWithTag(window->Mdl, KM_MEMORY_POOL_TAG);
+    window->Mdl = NULL;
+  }
+}
+
+NTSTATUS
+KmMapMemoryWindow(
+  PMEMORY_WINDOW window,
+  PVOID base,
+  DWORD32 size,
+  PBYTE* mapped)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  if (size <= window->Size)
+  {
+    // Describe supplied range with the reusable MDL
+    MmInitializeMdl(window->Mdl, base, size);
+
+    __try
+    {
+      // Try lock pages
+      MmProbeAndLockPages(window->Mdl, KernelMode, IoReadAccess);
+      status = STATUS_SUCCESS;
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      status = STATUS_INVALID_USER_BUFFER;
+    }
+
+    if (NT_SUCCESS(status))
+    {
+      // Remap to system space address
+      window->Mapped = MmMapLockedPagesSpecifyCache(window->Mdl, KernelMode, MmCached, NULL, FALSE, HighPagePriority);
+      if (window->Mapped)
+      {
+        // Set page protection
+        status = MmProtectMdlSystemAddress(window->Mdl, PAGE_READONLY);
+      }
+      else
+      {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+      }
+
+      // Undo partial mapping
+      if (NT_SUCCESS(status))
+      {
+        *mapped = window->Mapped;
+      }
+      else if (window->Mapped)
+      {
+        KmUnmapMemoryWindow(window);
+      }
+      else
+      {
+        MmUnlockPages(window->Mdl);
+      }
+    }
+  }
+
+  return status;
+}
+
+VOID
+KmUnmapMemoryWindow(
+  PMEMORY_WINDOW window)
+{
+  if (window->Mapped)
+  {
+    // Unmap locked pages
+    MmUnmapLockedPages(window->Mapped, window->Mdl);
+    window->Mapped = NULL;
+
+    // Unlock MDL
+    MmUnlockPages(window->Mdl);
+  }
+}
+
 PVOID
 KmConvertToSystemAddressSafe(
   PVOID base)
@@ -181,6 +312,94 @@ KmReadProcessMemory(
   return status;
 }
 
+NTSTATUS
+KmReadProcessValues(
+  PREAD_PROCESS_VALUES request,
+  PDWORD64 bases,
+  PBYTE values)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  if (request->Count <= KM_MEMORY_MAX_VALUES && request->Width > 0 && request->Width <= PAGE_SIZE)
+  {
+    // Addresses share the system buffer with the values, keep a copy
+    PDWORD64 addresses = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD64) * max(request->Count, 1), KM_MEMORY_POOL_TAG);
+    MEMORY_WINDOW window;
+    status = KmInitializeMemoryWindow(&window, KM_SCAN_WINDOW_SIZE);
+    if (addresses && NT_SUCCESS(status))
+    {
+      RtlCopyMemory(addresses, bases, sizeof(DWORD64) * request->Count);
+      RtlZeroMemory(values, (SIZE_T)request->Count * request->Width);
+
+      // Search process by process id
+      PEPROCESS process;
+      status = PsLookupProcessByProcessId((HANDLE)request->Pid, &process);
+      if (NT_SUCCESS(status))
+      {
+        // Attach to process
+        KAPC_STATE apc;
+        KeStackAttachProcess(process, &apc);
+
+        __try
+        {
+          for (DWORD32 i = 0; i < request->Count;)
+          {
+            // Coalesce following values sharing pages with the current run into one mapping
+            DWORD64 start = addresses[i] & ~(DWORD64)(PAGE_SIZE - 1);
+            DWORD64 end = (addresses[i] + request->Width + PAGE_SIZE - 1) & ~(DWORD64)(PAGE_SIZE - 1);
+            DWORD32 j = i + 1;
+            for (; j < request->Count && addresses[j] >= start && addresses[j] < end; j++)
+            {
+              DWORD64 valueEnd = (addresses[j] + request->Width + PAGE_SIZE - 1) & ~(DWORD64)(PAGE_SIZE - 1);
+              if ((valueEnd - start) > window.Size)
+              {
+                break;
+              }
+              end = max(end, valueEnd);
+            }
+
+            // Unreadable runs are left zeroed
+            PBYTE mapped;
+            if (NT_SUCCESS(KmMapMemoryWindow(&window, (PVOID)start, (DWORD32)(end - start), &mapped)))
+            {
+              for (DWORD32 k = i; k < j; k++)
+              {
+                RtlCopyMemory(values + (SIZE_T)k * request->Width, mapped + (addresses[k] - start), request->Width);
+              }
+              KmUnmapMemoryWindow(&window);
+            }
+            i = j;
+          }
+        }
+        __except (EXCEPTION_EXECUTE_HANDLER)
+        {
+          KD_LOG("Something went wrong\n");
+          status = STATUS_UNHANDLED_EXCEPTION;
+        }
+
+        // Detach from process
+        KeUnstackDetachProcess(&apc);
+
+        // Dereference process handle
+        ObDereferenceObject(process);
+      }
+    }
+    else
+    {
+      status = STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    // Free addresses and mapping window
+    if (addresses)
+    {
+      ExFreePoolWithTag(addresses, KM_MEMORY_POOL_TAG);
+    }
+    KmFreeMemoryWindow(&window);
+  }
+
+  return status;
+}
+
 NTSTATUS
 KmReadKernelMemory(
   PREAD_KERNEL_MEMORY request,
@@ -4,6 +4,17 @@
 #include <km_core.h>
 #include <km_ioctrl.h>
 
+///////////////////////////////////////////////////////////
+// Memory data types
+///////////////////////////////////////////////////////////
+
+typedef struct _MEMORY_WINDOW
+{
+  PMDL Mdl;
+  DWORD32 Size;
+  PVOID Mapped;
+} MEMORY_WINDOW, * PMEMORY_WINDOW;
+
 ///////////////////////////////////////////////////////////
 // Memory utilities
 ///////////////////////////////////////////////////////////
@@ -20,6 +31,32 @@ KmWriteMemorySafe(
   PVOID src,
   DWORD32 size);
 
+NTSTATUS
+KmReadUserBuffer(
+  PVOID dst,
+  PVOID src,
+  DWORD32 size);
+
+NTSTATUS
+KmInitializeMemoryWindow(
+  PMEMORY_WINDOW window,
+  DWORD32 size);
+
+VOID
+KmFreeMemoryWindow(
+  PMEMORY_WINDOW window);
+
+NTSTATUS
+KmMapMemoryWindow(
+  PMEMORY_WINDOW window,
+  PVOID base,
+  DWORD32 size,
+  PBYTE* mapped);
+
+VOID
+KmUnmapMemoryWindow(
+  PMEMORY_WINDOW window);
+
 PVOID
 KmConvertToSystemAddressSafe(
   PVOID base);
@@ -37,6 +74,12 @@ KmReadProcessMemory(
   PREAD_PROCESS_MEMORY request,
   PBYTE bytes);
 
+NTSTATUS
+KmReadProcessValues(
+  PREAD_PROCESS_VALUES request,
+  PDWORD64 bases,
+  PBYTE values);
+
 NTSTATUS
 KmReadKernelMemory(
   PREAD_KERNEL_MEMORY request,
@@ -0,0 +1,81 @@
+#ifndef KM_PARTITION_H
+#define KM_PARTITION_H
+
+// Work partitioning is shared with the offline tests and benchmarks, results stay with the caller
+#include <km_platform.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Partition data types
+///////////////////////////////////////////////////////////
+
+typedef struct _SCAN_PARTITION
+{
+  DWORD64 Base;
+  DWORD64 Size;
+  DWORD64 Limit;
+} SCAN_PARTITION, * PSCAN_PARTITION;
+
+typedef VOID(*SCAN_SPLICE_ROUTINE)(
+  PVOID context,
+  DWORD32 index);
+
+///////////////////////////////////////////////////////////
+// Partition utilities
+///////////////////////////////////////////////////////////
+
+static __inline
+DWORD32
+KmCountPartitions(
+  DWORD64 size)
+{
+  // Split large regions so workers stay balanced
+  return (DWORD32)((size + KM_SCAN_WORK_SIZE - 1) / KM_SCAN_WORK_SIZE);
+}
+
+static __inline
+SCAN_PARTITION
+KmGetPartition(
+  DWORD64 base,
+  DWORD64 size,
+  DWORD32 index)
+{
+  SCAN_PARTITION partition;
+
+  // Items own a slice of the region
+  DWORD64 offset = (DWORD64)index * KM_SCAN_WORK_SIZE;
+  partition.Base = base + offset;
+  partition.Size = ((size - offset) < KM_SCAN_WORK_SIZE) ? (size - offset) : KM_SCAN_WORK_SIZE;
+
+  // Values crossing into the next item are read by the item they start in
+  partition.Limit = base + size;
+
+  return partition;
+}
+
+static __inline
+DWORD32
+KmClaimPartition(
+  volatile LONG* next,
+  DWORD32 count)
+{
+  // Hand out items in address order, count is returned once every item is taken
+  LONG index = InterlockedIncrement(next) - 1;
+  return ((DWORD32)index < count) ? (DWORD32)index : count;
+}
+
+static __inline
+VOID
+KmSplicePartitions(
+  DWORD32 count,
+  SCAN_SPLICE_ROUTINE routine,
+  PVOID context)
+{
+  // Workers finish items in any order, private results are spliced in address order
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    routine(context, i);
+  }
+}
+
+#endif
\ No newline at end of file
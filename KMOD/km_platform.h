@@ -0,0 +1,87 @@
+#ifndef KM_PLATFORM_H
+#define KM_PLATFORM_H
+
+// Kernels shared with the client and offline tools only depend on fixed width types and compiler intrinsics
+#if defined(_KERNEL_MODE)
+#include <km_core.h>
+#include <intrin.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+#endif
+
+///////////////////////////////////////////////////////////
+// Compiler support
+///////////////////////////////////////////////////////////
+
+// Other compilers only emit AVX2 instructions for functions which ask for them
+#if defined(_MSC_VER)
+#define KM_TARGET_AVX2
+#else
+#define KM_TARGET_AVX2 __attribute__((target("avx2")))
+#ifndef __forceinline
+#define __forceinline __inline __attribute__((always_inline))
+#endif
+#endif
+
+#if !defined(_KERNEL_MODE) && !defined(_WIN32)
+
+///////////////////////////////////////////////////////////
+// Windows data types
+///////////////////////////////////////////////////////////
+
+typedef uint8_t BYTE, * PBYTE;
+typedef char CHAR, * PCHAR;
+typedef uint16_t WCHAR, * PWCHAR;
+typedef uint16_t USHORT, * PUSHORT;
+typedef int32_t LONG, * PLONG;
+typedef uint32_t DWORD32, * PDWORD32;
+typedef uint64_t DWORD64, * PDWORD64;
+typedef int8_t INT8, * PINT8;
+typedef int16_t INT16, * PINT16;
+typedef int32_t INT32, * PINT32;
+typedef int64_t INT64, * PINT64;
+typedef size_t SIZE_T, * PSIZE_T;
+typedef uint8_t BOOLEAN, * PBOOLEAN;
+typedef void VOID, * PVOID;
+
+#define TRUE 1
+#define FALSE 0
+
+#define MAXDWORD 0xFFFFFFFF
+#define MAXULONG64 0xFFFFFFFFFFFFFFFFULL
+#define MINLONG64 (-0x7FFFFFFFFFFFFFFFLL - 1)
+
+#define ARRAYSIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define UNREFERENCED_PARAMETER(parameter) ((void)(parameter))
+
+///////////////////////////////////////////////////////////
+// Windows runtime
+///////////////////////////////////////////////////////////
+
+#define RtlEqualMemory(destination, source, length) (memcmp((destination), (source), (length)) == 0)
+#define RtlCopyMemory(destination, source, length) memcpy((destination), (source), (length))
+#define RtlZeroMemory(destination, length) memset((destination), 0, (length))
+#define InterlockedIncrement(value) __atomic_add_fetch((value), 1, __ATOMIC_SEQ_CST)
+
+static __forceinline
+unsigned char
+_BitScanForward(
+  unsigned long* index,
+  unsigned long mask)
+{
+  if (mask == 0)
+  {
+    return 0;
+  }
+  *index = (unsigned long)__builtin_ctzl(mask);
+  return 1;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <km_pointer.h>
+#include <km_debug.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Pointer utilities
+///////////////////////////////////////////////////////////
+
+static
+NTSTATUS
+KmGrowPointerRanges(
+  PPOINTER_RANGES ranges)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Double range capacity
+  DWORD32 capacity = ranges->Capacity ? ranges->Capacity * 2 : 0x400;
+  PPOINTER_RANGE items = ExAllocatePoolWithTag(PagedPool, sizeof(POINTER_RANGE) * capacity, KM_MEMORY_POOL_TAG);
+  if (items)
+  {
+    if (ranges->Items)
+    {
+      RtlCopyMemory(items, ranges->Items, sizeof(POINTER_RANGE) * ranges->Count);
+      ExFreePoolWithTag(ranges->Items, KM_MEMORY_POOL_TAG);
+    }
+
+    ranges->Items = items;
+    ranges->Capacity = capacity;
+
+    status = STATUS_SUCCESS;
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Pointer API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializePointerRanges(
+  PPOINTER_RANGES ranges)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Reset ranges
+  ranges->Items = NULL;
+  ranges->Count = 0;
+  ranges->Capacity = 0;
+  ranges->Low = MAXULONG64;
+  ranges->High = 0;
+
+  return status;
+}
+
+VOID
+KmFreePointerRanges(
+  PPOINTER_RANGES ranges)
+{
+  // Free ranges
+  if (ranges->Items)
+  {
+    ExFreePoolWithTag(ranges->Items, KM_MEMORY_POOL_TAG);
+  }
+
+  // Reset ranges
+  ranges->Items = NULL;
+  ranges->Count = 0;
+  ranges->Capacity = 0;
+}
+
+NTSTATUS
+KmAppendPointerRange(
+  PPOINTER_RANGES ranges,
+  DWORD64 base,
+  DWORD64 size)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Regions arrive in address order, adjacent ones are merged
+  if (ranges->Count > 0 && ranges->Items[ranges->Count - 1].End == base)
+  {
+    ranges->Items[ranges->Count - 1].End = base + size;
+  }
+  else
+  {
+    if (ranges->Count == ranges->Capacity)
+    {
+      status = KmGrowPointerRanges(ranges);
+    }
+
+    if (NT_SUCCESS(status))
+    {
+      ranges->Items[ranges->Count].Base = base;
+      ranges->Items[ranges->Count].End = base + size;
+      ranges->Count++;
+    }
+  }
+
+  // Bounds reject most non pointer values without a search
+  if (NT_SUCCESS(status))
+  {
+    ranges->Low = min(ranges->Low, base);
+    ranges->High = max(ranges->High, base + size);
+  }
+
+  return status;
+}
+
+BOOLEAN
+KmIsPointerTarget(
+  PPOINTER_RANGES ranges,
+  DWORD64 value)
+{
+  // Binary search the last range starting at or below the value
+  DWORD32 low = 0;
+  DWORD32 high = ranges->Count;
+  while (low < high)
+  {
+    DWORD32 middle = low + (high - low) / 2;
+    if (ranges->Items[middle].Base <= value)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low > 0 && value < ranges->Items[low - 1].End;
+}
+
+DWORD32
+KmFindPointers(
+  PPOINTER_RANGES ranges,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+
+  // Only naturally aligned values are considered
+  for (DWORD32 offset = 0; (offset + sizeof(DWORD64)) <= size; offset += sizeof(DWORD64))
+  {
+    DWORD64 value = *(PDWORD64)(bytes + offset);
+    if (value >= ranges->Low && value < ranges->High && KmIsPointerTarget(ranges, value))
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
\ No newline at end of file
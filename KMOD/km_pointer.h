@@ -0,0 +1,55 @@
+#ifndef KM_POINTER_H
+#define KM_POINTER_H
+
+#include <km_core.h>
+
+///////////////////////////////////////////////////////////
+// Pointer data types
+///////////////////////////////////////////////////////////
+
+typedef struct _POINTER_RANGE
+{
+  DWORD64 Base;
+  DWORD64 End;
+} POINTER_RANGE, * PPOINTER_RANGE;
+
+typedef struct _POINTER_RANGES
+{
+  PPOINTER_RANGE Items;
+  DWORD32 Count;
+  DWORD32 Capacity;
+  DWORD64 Low;
+  DWORD64 High;
+} POINTER_RANGES, * PPOINTER_RANGES;
+
+///////////////////////////////////////////////////////////
+// Pointer API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializePointerRanges(
+  PPOINTER_RANGES ranges);
+
+VOID
+KmFreePointerRanges(
+  PPOINTER_RANGES ranges);
+
+NTSTATUS
+KmAppendPointerRange(
+  PPOINTER_RANGES ranges,
+  DWORD64 base,
+  DWORD64 size);
+
+BOOLEAN
+KmIsPointerTarget(
+  PPOINTER_RANGES ranges,
+  DWORD64 value);
+
+DWORD32
+KmFindPointers(
+  PPOINTER_RANGES ranges,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets);
+
+#endif
\ No newline at end of file
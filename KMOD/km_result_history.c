@@ -0,0 +1,194 @@
+#include <km_result_history.h>
+#include <km_debug.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Result history utilities
+///////////////////////////////////////////////////////////
+
+static
+VOID
+KmFreeResultGeneration(
+  PRESULT_HISTORY history,
+  PRESULT_GENERATION generation)
+{
+  // Shared slabs survive as long as a newer generation references them
+  RemoveEntryList(&generation->List);
+  KmResetResultStore(&generation->Store);
+  ExFreePoolWithTag(generation, KM_MEMORY_POOL_TAG);
+  history->Count--;
+}
+
+static
+VOID
+KmMeasureResultHistory(
+  PRESULT_HISTORY history)
+{
+  // Count every header but each slab only once
+  history->Epoch++;
+  history->Bytes = 0;
+  PLIST_ENTRY generationEntry = history->Generations.Flink;
+  while (generationEntry != &history->Generations)
+  {
+    PRESULT_GENERATION generation = CONTAINING_RECORD(generationEntry, RESULT_GENERATION, List);
+    PLIST_ENTRY listEntry = generation->Store.Chunks.Flink;
+    while (listEntry != &generation->Store.Chunks)
+    {
+      PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+      history->Bytes += sizeof(RESULT_CHUNK);
+      if (chunk->Slab->Epoch != history->Epoch)
+      {
+        chunk->Slab->Epoch = history->Epoch;
+        history->Bytes += chunk->Slab->Size;
+      }
+      listEntry = listEntry->Flink;
+    }
+    generationEntry = generationEntry->Flink;
+  }
+}
+
+///////////////////////////////////////////////////////////
+// Result history API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeResultHistory(
+  PRESULT_HISTORY history)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Reset generation list
+  InitializeListHead(&history->Generations);
+  history->Current = NULL;
+  history->Count = 0;
+  history->Epoch = 0;
+  history->Bytes = 0;
+
+  // Sessions without results read from an empty store
+  status = KmInitializeResultStore(&history->Empty, 0);
+
+  return status;
+}
+
+NTSTATUS
+KmResetResultHistory(
+  PRESULT_HISTORY history)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Free every generation, slabs go with their last reference
+  while (IsListEmpty(&history->Generations) == FALSE)
+  {
+    KmFreeResultGeneration(history, CONTAINING_RECORD(history->Generations.Blink, RESULT_GENERATION, List));
+  }
+
+  // Reset statistics
+  history->Current = NULL;
+  history->Bytes = 0;
+
+  return status;
+}
+
+PRESULT_STORE
+KmGetCurrentResults(
+  PRESULT_HISTORY history)
+{
+  return history->Current ? &history->Current->Store : &history->Empty;
+}
+
+NTSTATUS
+KmBeginResultGeneration(
+  PRESULT_HISTORY history,
+  DWORD32 valueSize,
+  PRESULT_STORE* store)
+{
+  UNREFERENCED_PARAMETER(history);
+
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Generations are detached until committed
+  PRESULT_GENERATION generation = ExAllocatePoolWithTag(NonPagedPool, sizeof(RESULT_GENERATION), KM_MEMORY_POOL_TAG);
+  if (generation)
+  {
+    InitializeListHead(&generation->List);
+    status = KmInitializeResultStore(&generation->Store, valueSize);
+    *store = &generation->Store;
+  }
+
+  return status;
+}
+
+VOID
+KmCommitResultGeneration(
+  PRESULT_HISTORY history,
+  PRESULT_STORE store)
+{
+  PRESULT_GENERATION generation = CONTAINING_RECORD(store, RESULT_GENERATION, Store);
+
+  // Generations after the current one can not be redone anymore
+  while (history->Current && history->Generations.Blink != &history->Current->List)
+  {
+    KmFreeResultGeneration(history, CONTAINING_RECORD(history->Generations.Blink, RESULT_GENERATION, List));
+  }
+
+  // Append generation and make it current
+  InsertTailList(&history->Generations, &generation->List);
+  history->Current = generation;
+  history->Count++;
+
+  // Evict oldest generations beyond depth or memory limit
+  while (history->Count > KM_RESULT_HISTORY_DEPTH)
+  {
+    KmFreeResultGeneration(history, CONTAINING_RECORD(history->Generations.Flink, RESULT_GENERATION, List));
+  }
+  KmMeasureResultHistory(history);
+  while (history->Count > 1 && history->Bytes > KM_RESULT_HISTORY_LIMIT)
+  {
+    KmFreeResultGeneration(history, CONTAINING_RECORD(history->Generations.Flink, RESULT_GENERATION, List));
+    KmMeasureResultHistory(history);
+  }
+}
+
+VOID
+KmDiscardResultGeneration(
+  PRESULT_HISTORY history,
+  PRESULT_STORE store)
+{
+  UNREFERENCED_PARAMETER(history);
+
+  // Free detached generation
+  KmResetResultStore(store);
+  ExFreePoolWithTag(CONTAINING_RECORD(store, RESULT_GENERATION, Store), KM_MEMORY_POOL_TAG);
+}
+
+NTSTATUS
+KmUndoResultGeneration(
+  PRESULT_HISTORY history)
+{
+  NTSTATUS status = STATUS_NOT_FOUND;
+
+  // Step back to the previous generation
+  if (history->Current && history->Current->List.Blink != &history->Generations)
+  {
+    history->Current = CONTAINING_RECORD(history->Current->List.Blink, RESULT_GENERATION, List);
+    status = STATUS_SUCCESS;
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmRedoResultGeneration(
+  PRESULT_HISTORY history)
+{
+  NTSTATUS status = STATUS_NOT_FOUND;
+
+  // Step forward to the next generation
+  if (history->Current && history->Current->List.Flink != &history->Generations)
+  {
+    history->Current = CONTAINING_RECORD(history->Current->List.Flink, RESULT_GENERATION, List);
+    status = STATUS_SUCCESS;
+  }
+
+  return status;
+}
\ No newline at end of file
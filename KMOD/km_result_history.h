@@ -0,0 +1,67 @@
+#ifndef KM_RESULT_HISTORY_H
+#define KM_RESULT_HISTORY_H
+
+#include <km_core.h>
+#include <km_result_store.h>
+
+///////////////////////////////////////////////////////////
+// Result history data types
+///////////////////////////////////////////////////////////
+
+typedef struct _RESULT_GENERATION
+{
+  LIST_ENTRY List;
+  RESULT_STORE Store;
+} RESULT_GENERATION, * PRESULT_GENERATION;
+
+typedef struct _RESULT_HISTORY
+{
+  LIST_ENTRY Generations;
+  PRESULT_GENERATION Current;
+  RESULT_STORE Empty;
+  DWORD32 Count;
+  DWORD32 Epoch;
+  DWORD64 Bytes;
+} RESULT_HISTORY, * PRESULT_HISTORY;
+
+///////////////////////////////////////////////////////////
+// Result history API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeResultHistory(
+  PRESULT_HISTORY history);
+
+NTSTATUS
+KmResetResultHistory(
+  PRESULT_HISTORY history);
+
+PRESULT_STORE
+KmGetCurrentResults(
+  PRESULT_HISTORY history);
+
+NTSTATUS
+KmBeginResultGeneration(
+  PRESULT_HISTORY history,
+  DWORD32 valueSize,
+  PRESULT_STORE* store);
+
+VOID
+KmCommitResultGeneration(
+  PRESULT_HISTORY history,
+  PRESULT_STORE store);
+
+VOID
+KmDiscardResultGeneration(
+  PRESULT_HISTORY history,
+  PRESULT_STORE store);
+
+NTSTATUS
+KmUndoResultGeneration(
+  PRESULT_HISTORY history);
+
+NTSTATUS
+KmRedoResultGeneration(
+  PRESULT_HISTORY history);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,790 @@
+#include <km_result_store.h>
+#include <km_debug.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Result store data types
+///////////////////////////////////////////////////////////
+
+typedef struct _RESULT_SORT
+{
+  PDWORD64 Keys[2];
+  PDWORD32 Indices[2];
+  PBYTE Values;
+  DWORD32 ValueSize;
+} RESULT_SORT, * PRESULT_SORT;
+
+typedef struct _RESULT_CURSOR
+{
+  DWORD64 Key;
+  PRESULT_CHUNK Chunk;
+  DWORD32 Index;
+  DWORD32 Order;
+} RESULT_CURSOR, * PRESULT_CURSOR;
+
+///////////////////////////////////////////////////////////
+// Result store utilities
+///////////////////////////////////////////////////////////
+
+static
+PRESULT_CHUNK
+KmAllocateResultChunk(
+  PRESULT_STORE store)
+{
+  // Grow chunk capacity geometrically so small result sets stay small
+  DWORD32 capacity = KM_RESULT_CHUNK_MIN_ENTRIES;
+  if (IsListEmpty(&store->Chunks) == FALSE)
+  {
+    PRESULT_CHUNK tail = CONTAINING_RECORD(store->Chunks.Blink, RESULT_CHUNK, List);
+    capacity = min(tail->Capacity * 2, KM_RESULT_CHUNK_MAX_ENTRIES);
+  }
+
+  // Headers are private, address and value slabs may be shared between generations
+  SIZE_T size = FIELD_OFFSET(RESULT_SLAB, Data) + (SIZE_T)capacity * (sizeof(DWORD64) + store->ValueSize);
+  PRESULT_CHUNK chunk = ExAllocatePoolWithTag(PagedPool, sizeof(RESULT_CHUNK), KM_MEMORY_POOL_TAG);
+  PRESULT_SLAB slab = ExAllocatePoolWithTag(PagedPool, size, KM_MEMORY_POOL_TAG);
+  if (chunk && slab)
+  {
+    slab->References = 1;
+    slab->Epoch = 0;
+    slab->Size = size;
+    chunk->Count = 0;
+    chunk->Capacity = capacity;
+    chunk->Bases = (PDWORD64)slab->Data;
+    chunk->Values = store->ValueSize ? (PBYTE)(chunk->Bases + capacity) : NULL;
+    chunk->Slab = slab;
+    InsertTailList(&store->Chunks, &chunk->List);
+
+    // Update statistics
+    store->ChunkCount++;
+    store->Bytes += sizeof(RESULT_CHUNK) + size;
+  }
+  else
+  {
+    if (chunk)
+    {
+      ExFreePoolWithTag(chunk, KM_MEMORY_POOL_TAG);
+      chunk = NULL;
+    }
+    if (slab)
+    {
+      ExFreePoolWithTag(slab, KM_MEMORY_POOL_TAG);
+    }
+  }
+
+  return chunk;
+}
+
+static
+VOID
+KmFreeResultChunk(
+  PRESULT_CHUNK chunk)
+{
+  // Slabs are freed with their last reference
+  if (--chunk->Slab->References == 0)
+  {
+    ExFreePoolWithTag(chunk->Slab, KM_MEMORY_POOL_TAG);
+  }
+  ExFreePoolWithTag(chunk, KM_MEMORY_POOL_TAG);
+}
+
+static
+BOOLEAN
+KmIsResultChunkWritable(
+  PRESULT_CHUNK chunk)
+{
+  // Shared slabs are immutable
+  return chunk->Count < chunk->Capacity && chunk->Slab->References == 1;
+}
+
+static
+PRESULT_CHUNK
+KmShareResultChunk(
+  PRESULT_STORE store,
+  PRESULT_CHUNK source)
+{
+  // Reference the slab of the source chunk from a private header
+  PRESULT_CHUNK chunk = ExAllocatePoolWithTag(PagedPool, sizeof(RESULT_CHUNK), KM_MEMORY_POOL_TAG);
+  if (chunk)
+  {
+    *chunk = *source;
+    chunk->Slab->References++;
+    InsertTailList(&store->Chunks, &chunk->List);
+
+    // Update statistics
+    store->Count += chunk->Count;
+    store->ChunkCount++;
+    store->Bytes += sizeof(RESULT_CHUNK) + chunk->Slab->Size;
+  }
+
+  return chunk;
+}
+
+static
+VOID
+KmFinishDerivedChunk(
+  PRESULT_WRITER writer)
+{
+  PRESULT_CHUNK source = writer->Source;
+
+  // Untouched chunks are shared, a prefix of survivors is copied
+  if (source && writer->Identical && writer->Index > 0 && NT_SUCCESS(writer->Status))
+  {
+    if (writer->Index == source->Count)
+    {
+      writer->Status = KmShareResultChunk(writer->Store, source) ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+    }
+    else
+    {
+      for (DWORD32 i = 0; i < writer->Index && NT_SUCCESS(writer->Status); i++)
+      {
+        writer->Status = KmAppendResult(writer->Store, source->Bases[i], source->Values + (SIZE_T)i * writer->Store->ValueSize);
+      }
+    }
+  }
+
+  writer->Source = NULL;
+  writer->Index = 0;
+  writer->Identical = FALSE;
+}
+
+///////////////////////////////////////////////////////////
+// Result sort utilities
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+KmIsResultChunkSorted(
+  PRESULT_CHUNK chunk)
+{
+  // Addresses have to be strictly increasing
+  for (DWORD32 i = 1; i < chunk->Count; i++)
+  {
+    if (chunk->Bases[i] <= chunk->Bases[i - 1])
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static
+BOOLEAN
+KmIsResultStoreSorted(
+  PRESULT_STORE store,
+  PDWORD32 capacity)
+{
+  BOOLEAN sorted = TRUE;
+
+  // Chunks have to be sorted and follow each other, the largest one sizes the scratch
+  PRESULT_CHUNK previous = NULL;
+  *capacity = 0;
+  for (PLIST_ENTRY listEntry = store->Chunks.Flink; listEntry != &store->Chunks; listEntry = listEntry->Flink)
+  {
+    PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+    if (chunk->Count)
+    {
+      *capacity = max(*capacity, chunk->Count);
+      sorted &= KmIsResultChunkSorted(chunk);
+      if (previous)
+      {
+        sorted &= previous->Bases[previous->Count - 1] < chunk->Bases[0];
+      }
+      previous = chunk;
+    }
+  }
+
+  return sorted;
+}
+
+static
+BOOLEAN
+KmPrivatizeResultChunk(
+  PRESULT_CHUNK chunk)
+{
+  // Shared slabs are copied before they get reordered
+  if (chunk->Slab->References > 1)
+  {
+    PRESULT_SLAB slab = ExAllocatePoolWithTag(PagedPool, chunk->Slab->Size, KM_MEMORY_POOL_TAG);
+    if (slab == NULL)
+    {
+      return FALSE;
+    }
+    RtlCopyMemory(slab, chunk->Slab, chunk->Slab->Size);
+    slab->References = 1;
+    chunk->Slab->References--;
+    chunk->Values = chunk->Values ? ((PBYTE)slab + ((PBYTE)chunk->Values - (PBYTE)chunk->Slab)) : NULL;
+    chunk->Bases = (PDWORD64)slab->Data;
+    chunk->Slab = slab;
+  }
+
+  return TRUE;
+}
+
+static
+VOID
+KmRadixSortResultChunk(
+  PRESULT_SORT sort,
+  PRESULT_CHUNK chunk)
+{
+  DWORD32 count = chunk->Count;
+  PDWORD64 keys = sort->Keys[0];
+  PDWORD64 sortedKeys = sort->Keys[1];
+  PDWORD32 indices = sort->Indices[0];
+  PDWORD32 sortedIndices = sort->Indices[1];
+
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    keys[i] = chunk->Bases[i];
+    indices[i] = i;
+  }
+
+  // Stable LSD passes over key bytes, bytes shared by all keys are skipped
+  DWORD32 offsets[256];
+  for (DWORD32 shift = 0; shift < 64; shift += 8)
+  {
+    RtlZeroMemory(offsets, sizeof(offsets));
+    for (DWORD32 i = 0; i < count; i++)
+    {
+      offsets[(keys[i] >> shift) & 0xFF]++;
+    }
+    if (offsets[(keys[0] >> shift) & 0xFF] == count)
+    {
+      continue;
+    }
+
+    // Turn counts into bucket offsets
+    DWORD32 offset = 0;
+    for (DWORD32 digit = 0; digit < 256; digit++)
+    {
+      DWORD32 bucket = offsets[digit];
+      offsets[digit] = offset;
+      offset += bucket;
+    }
+
+    // Scatter keys with their original positions
+    for (DWORD32 i = 0; i < count; i++)
+    {
+      DWORD32 position = offsets[(keys[i] >> shift) & 0xFF]++;
+      sortedKeys[position] = keys[i];
+      sortedIndices[position] = indices[i];
+    }
+
+    PDWORD64 swapKeys = keys;
+    keys = sortedKeys;
+    sortedKeys = swapKeys;
+    PDWORD32 swapIndices = indices;
+    indices = sortedIndices;
+    sortedIndices = swapIndices;
+  }
+
+  // Gather addresses and values in key order
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    sortedKeys[i] = chunk->Bases[indices[i]];
+  }
+  RtlCopyMemory(chunk->Bases, sortedKeys, sizeof(DWORD64) * count);
+  if (sort->ValueSize)
+  {
+    for (DWORD32 i = 0; i < count; i++)
+    {
+      RtlCopyMemory(sort->Values + (SIZE_T)i * sort->ValueSize, chunk->Values + (SIZE_T)indices[i] * sort->ValueSize, sort->ValueSize);
+    }
+    RtlCopyMemory(chunk->Values, sort->Values, (SIZE_T)count * sort->ValueSize);
+  }
+}
+
+static
+DWORD32
+KmDeduplicateResultChunk(
+  PRESULT_CHUNK chunk,
+  DWORD32 valueSize)
+{
+  DWORD32 count = min(chunk->Count, 1);
+
+  // Keep the first result of every address
+  for (DWORD32 i = 1; i < chunk->Count; i++)
+  {
+    if (chunk->Bases[i] != chunk->Bases[count - 1])
+    {
+      chunk->Bases[count] = chunk->Bases[i];
+      if (valueSize)
+      {
+        RtlMoveMemory(chunk->Values + (SIZE_T)count * valueSize, chunk->Values + (SIZE_T)i * valueSize, valueSize);
+      }
+      count++;
+    }
+  }
+
+  DWORD32 removed = chunk->Count - count;
+  chunk->Count = count;
+  return removed;
+}
+
+static
+BOOLEAN
+KmIsResultCursorBefore(
+  PRESULT_CURSOR cursor,
+  PRESULT_CURSOR other)
+{
+  // Ties are broken by chunk order so merging stays stable
+  return cursor->Key < other->Key || (cursor->Key == other->Key && cursor->Order < other->Order);
+}
+
+static
+VOID
+KmSiftResultCursor(
+  PRESULT_CURSOR heap,
+  DWORD32 count,
+  DWORD32 index)
+{
+  // Move cursor down until both children follow it
+  while (TRUE)
+  {
+    DWORD32 first = index;
+    DWORD32 left = index * 2 + 1;
+    DWORD32 right = left + 1;
+    if (left < count && KmIsResultCursorBefore(&heap[left], &heap[first]))
+    {
+      first = left;
+    }
+    if (right < count && KmIsResultCursorBefore(&heap[right], &heap[first]))
+    {
+      first = right;
+    }
+    if (first == index)
+    {
+      break;
+    }
+    RESULT_CURSOR cursor = heap[index];
+    heap[index] = heap[first];
+    heap[first] = cursor;
+    index = first;
+  }
+}
+
+static
+NTSTATUS
+KmMergeResultChunks(
+  PRESULT_STORE store)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // One cursor per sorted chunk
+  PRESULT_CURSOR heap = ExAllocatePoolWithTag(PagedPool, sizeof(RESULT_CURSOR) * max(store->ChunkCount, 1), KM_MEMORY_POOL_TAG);
+  if (heap)
+  {
+    DWORD32 count = 0;
+    for (PLIST_ENTRY listEntry = store->Chunks.Flink; listEntry != &store->Chunks; listEntry = listEntry->Flink)
+    {
+      PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+      if (chunk->Count)
+      {
+        heap[count].Key = chunk->Bases[0];
+        heap[count].Chunk = chunk;
+        heap[count].Index = 0;
+        heap[count].Order = count;
+        count++;
+      }
+    }
+    for (DWORD32 i = count / 2; i-- > 0;)
+    {
+      KmSiftResultCursor(heap, count, i);
+    }
+
+    // Drained chunks are freed right away so the merge needs little more than one chunk per cursor
+    RESULT_STORE merged;
+    KmInitializeResultStore(&merged, store->ValueSize);
+    DWORD64 last = 0;
+    status = STATUS_SUCCESS;
+    while (count > 0 && NT_SUCCESS(status))
+    {
+      PRESULT_CHUNK chunk = heap[0].Chunk;
+      DWORD32 index = heap[0].Index++;
+      if (merged.Count == 0 || chunk->Bases[index] != last)
+      {
+        status = KmAppendResult(&merged, chunk->Bases[index], chunk->Values + (SIZE_T)index * store->ValueSize);
+        last = chunk->Bases[index];
+      }
+      if (heap[0].Index == chunk->Count)
+      {
+        RemoveEntryList(&chunk->List);
+        KmFreeResultChunk(chunk);
+        heap[0] = heap[--count];
+      }
+      else
+      {
+        heap[0].Key = chunk->Bases[heap[0].Index];
+      }
+      KmSiftResultCursor(heap, count, 0);
+    }
+
+    // Replace remaining chunks with the merged ones
+    KmResetResultStore(store);
+    if (NT_SUCCESS(status))
+    {
+      KmSpliceResultStore(store, &merged);
+    }
+    else
+    {
+      KmResetResultStore(&merged);
+    }
+
+    ExFreePoolWithTag(heap, KM_MEMORY_POOL_TAG);
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Result store API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeResultStore(
+  PRESULT_STORE store,
+  DWORD32 valueSize)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Reset chunk list
+  InitializeListHead(&store->Chunks);
+
+  // Reset statistics
+  store->Count = 0;
+  store->Bytes = 0;
+  store->ChunkCount = 0;
+  store->ValueSize = valueSize;
+
+  // Reset read cursor
+  store->Cursor = NULL;
+  store->CursorOffset = 0;
+
+  return status;
+}
+
+NTSTATUS
+KmResetResultStore(
+  PRESULT_STORE store)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Free chunks
+  while (IsListEmpty(&store->Chunks) == FALSE)
+  {
+    PLIST_ENTRY listEntry = RemoveHeadList(&store->Chunks);
+    KmFreeResultChunk(CONTAINING_RECORD(listEntry, RESULT_CHUNK, List));
+  }
+
+  // Reset chunk list
+  InitializeListHead(&store->Chunks);
+
+  // Reset statistics
+  store->Count = 0;
+  store->Bytes = 0;
+  store->ChunkCount = 0;
+
+  // Reset read cursor
+  store->Cursor = NULL;
+  store->CursorOffset = 0;
+
+  return status;
+}
+
+NTSTATUS
+KmAppendResults(
+  PRESULT_STORE store,
+  DWORD64 base,
+  PBYTE bytes,
+  PDWORD32 offsets,
+  DWORD32 count)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Start at the tail chunk
+  PRESULT_CHUNK chunk = NULL;
+  if (IsListEmpty(&store->Chunks) == FALSE)
+  {
+    chunk = CONTAINING_RECORD(store->Chunks.Blink, RESULT_CHUNK, List);
+  }
+
+  DWORD32 i = 0;
+  while (i < count)
+  {
+    // Allocate new chunk once the tail is full or shared
+    if (chunk == NULL || KmIsResultChunkWritable(chunk) == FALSE)
+    {
+      chunk = KmAllocateResultChunk(store);
+      if (chunk == NULL)
+      {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+        break;
+      }
+    }
+
+    // Fill as much of the chunk as possible
+    DWORD32 batch = min(count - i, chunk->Capacity - chunk->Count);
+    for (DWORD32 j = 0; j < batch; j++, i++)
+    {
+      chunk->Bases[chunk->Count] = base + offsets[i];
+      if (store->ValueSize)
+      {
+        RtlCopyMemory(chunk->Values + (SIZE_T)chunk->Count * store->ValueSize, bytes + offsets[i], store->ValueSize);
+      }
+      chunk->Count++;
+    }
+
+    // Update result count
+    store->Count += batch;
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmAppendResult(
+  PRESULT_STORE store,
+  DWORD64 base,
+  PBYTE value)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Start at the tail chunk, allocate a new one once it is full or shared
+  PRESULT_CHUNK chunk = NULL;
+  if (IsListEmpty(&store->Chunks) == FALSE)
+  {
+    chunk = CONTAINING_RECORD(store->Chunks.Blink, RESULT_CHUNK, List);
+  }
+  if (chunk == NULL || KmIsResultChunkWritable(chunk) == FALSE)
+  {
+    chunk = KmAllocateResultChunk(store);
+  }
+
+  if (chunk)
+  {
+    // Store single result with an arbitrary value
+    chunk->Bases[chunk->Count] = base;
+    if (store->ValueSize)
+    {
+      RtlCopyMemory(chunk->Values + (SIZE_T)chunk->Count * store->ValueSize, value, store->ValueSize);
+    }
+    chunk->Count++;
+    store->Count++;
+  }
+  else
+  {
+    status = STATUS_INSUFFICIENT_RESOURCES;
+  }
+
+  return status;
+}
+
+VOID
+KmSpliceResultStore(
+  PRESULT_STORE store,
+  PRESULT_STORE source)
+{
+  // Move chunks behind the existing ones, order is preserved
+  while (IsListEmpty(&source->Chunks) == FALSE)
+  {
+    PLIST_ENTRY listEntry = RemoveHeadList(&source->Chunks);
+    InsertTailList(&store->Chunks, listEntry);
+  }
+
+  // Transfer statistics
+  store->Count += source->Count;
+  store->Bytes += source->Bytes;
+  store->ChunkCount += source->ChunkCount;
+  source->Count = 0;
+  source->Bytes = 0;
+  source->ChunkCount = 0;
+  source->Cursor = NULL;
+  source->CursorOffset = 0;
+}
+
+NTSTATUS
+KmSortResultStore(
+  PRESULT_STORE store)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Results of address ordered work items are left untouched
+  DWORD32 capacity;
+  if (KmIsResultStoreSorted(store, &capacity) == FALSE)
+  {
+    // Scratch is sized for the largest chunk and reused for all of them
+    RESULT_SORT sort;
+    SIZE_T size = (SIZE_T)capacity * (2 * sizeof(DWORD64) + 2 * sizeof(DWORD32) + store->ValueSize);
+    PBYTE scratch = ExAllocatePoolWithTag(PagedPool, size, KM_MEMORY_POOL_TAG);
+    if (scratch)
+    {
+      sort.Keys[0] = (PDWORD64)scratch;
+      sort.Keys[1] = sort.Keys[0] + capacity;
+      sort.Indices[0] = (PDWORD32)(sort.Keys[1] + capacity);
+      sort.Indices[1] = sort.Indices[0] + capacity;
+      sort.Values = (PBYTE)(sort.Indices[1] + capacity);
+      sort.ValueSize = store->ValueSize;
+
+      // Sort and deduplicate chunks in place
+      for (PLIST_ENTRY listEntry = store->Chunks.Flink; listEntry != &store->Chunks && NT_SUCCESS(status); listEntry = listEntry->Flink)
+      {
+        PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+        if (KmIsResultChunkSorted(chunk) == FALSE)
+        {
+          status = KmPrivatizeResultChunk(chunk) ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+          if (NT_SUCCESS(status))
+          {
+            KmRadixSortResultChunk(&sort, chunk);
+            store->Count -= KmDeduplicateResultChunk(chunk, store->ValueSize);
+          }
+        }
+      }
+
+      // Interleaved chunks are merged into fresh ones
+      if (NT_SUCCESS(status) && KmIsResultStoreSorted(store, &capacity) == FALSE)
+      {
+        status = KmMergeResultChunks(store);
+      }
+
+      ExFreePoolWithTag(scratch, KM_MEMORY_POOL_TAG);
+    }
+    else
+    {
+      status = STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    // Reordering invalidates the read cursor
+    store->Cursor = NULL;
+    store->CursorOffset = 0;
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmReadResultStore(
+  PRESULT_STORE store,
+  DWORD64 offset,
+  DWORD32 count,
+  PDWORD64 bases,
+  PBYTE values)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  // Validate requested range before writing anything
+  if (offset <= store->Count && count <= (store->Count - offset))
+  {
+    // Resume at the cursor for forward reads, otherwise start at the head
+    PLIST_ENTRY listEntry = store->Chunks.Flink;
+    DWORD64 chunkOffset = 0;
+    if (store->Cursor && offset >= store->CursorOffset)
+    {
+      listEntry = &store->Cursor->List;
+      chunkOffset = store->CursorOffset;
+    }
+
+    // Copy addresses and values chunk wise, either one may be omitted
+    DWORD32 copied = 0;
+    while (listEntry != &store->Chunks && copied < count)
+    {
+      PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+      if (offset >= (chunkOffset + chunk->Count))
+      {
+        // Skip chunks before the requested offset
+        chunkOffset += chunk->Count;
+        listEntry = listEntry->Flink;
+        continue;
+      }
+
+      // Remember the chunk so the next page starts right here
+      store->Cursor = chunk;
+      store->CursorOffset = chunkOffset;
+
+      DWORD32 index = (DWORD32)(offset - chunkOffset);
+      DWORD32 batch = min(chunk->Count - index, count - copied);
+      if (bases)
+      {
+        RtlCopyMemory(bases + copied, chunk->Bases + index, sizeof(DWORD64) * batch);
+      }
+      if (values && store->ValueSize)
+      {
+        RtlCopyMemory(values + (SIZE_T)copied * store->ValueSize, chunk->Values + (SIZE_T)index * store->ValueSize, (SIZE_T)store->ValueSize * batch);
+      }
+      copied += batch;
+      offset += batch;
+    }
+
+    status = STATUS_SUCCESS;
+  }
+
+  return status;
+}
+
+VOID
+KmBeginDerivation(
+  PRESULT_STORE store,
+  PRESULT_WRITER writer)
+{
+  // Survivors are written into a new store, the source stays intact
+  writer->Store = store;
+  writer->Source = NULL;
+  writer->Index = 0;
+  writer->Identical = FALSE;
+  writer->Status = STATUS_SUCCESS;
+}
+
+VOID
+KmDeriveChunk(
+  PRESULT_WRITER writer,
+  PRESULT_CHUNK chunk)
+{
+  KmFinishDerivedChunk(writer);
+
+  // Copies are deferred as long as survivors match the source one to one
+  writer->Source = chunk;
+  writer->Identical = TRUE;
+}
+
+VOID
+KmDeriveResult(
+  PRESULT_WRITER writer,
+  DWORD64 base,
+  PBYTE value)
+{
+  PRESULT_STORE store = writer->Store;
+  PRESULT_CHUNK source = writer->Source;
+
+  if (writer->Identical)
+  {
+    SIZE_T offset = (SIZE_T)writer->Index * store->ValueSize;
+    if (writer->Index < source->Count && source->Bases[writer->Index] == base && (store->ValueSize == 0 || RtlEqualMemory(source->Values + offset, value, store->ValueSize)))
+    {
+      writer->Index++;
+    }
+    else
+    {
+      // Result diverged, copy the identical prefix before appending
+      for (DWORD32 i = 0; i < writer->Index && NT_SUCCESS(writer->Status); i++)
+      {
+        writer->Status = KmAppendResult(store, source->Bases[i], source->Values + (SIZE_T)i * store->ValueSize);
+      }
+      writer->Identical = FALSE;
+      writer->Index = 0;
+    }
+  }
+
+  if (writer->Identical == FALSE && NT_SUCCESS(writer->Status))
+  {
+    writer->Status = KmAppendResult(store, base, value);
+  }
+}
+
+NTSTATUS
+KmEndDerivation(
+  PRESULT_WRITER writer)
+{
+  KmFinishDerivedChunk(writer);
+
+  return writer->Status;
+}
\ No newline at end of file
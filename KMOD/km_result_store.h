@@ -0,0 +1,112 @@
+#ifndef KM_RESULT_STORE_H
+#define KM_RESULT_STORE_H
+
+#include <km_core.h>
+
+///////////////////////////////////////////////////////////
+// Result store data types
+///////////////////////////////////////////////////////////
+
+typedef struct _RESULT_SLAB
+{
+  LONG References;
+  DWORD32 Epoch;
+  SIZE_T Size;
+  BYTE Data[1];
+} RESULT_SLAB, * PRESULT_SLAB;
+
+typedef struct _RESULT_CHUNK
+{
+  LIST_ENTRY List;
+  DWORD32 Count;
+  DWORD32 Capacity;
+  PDWORD64 Bases;
+  PBYTE Values;
+  PRESULT_SLAB Slab;
+} RESULT_CHUNK, * PRESULT_CHUNK;
+
+typedef struct _RESULT_STORE
+{
+  LIST_ENTRY Chunks;
+  DWORD64 Count;
+  DWORD64 Bytes;
+  DWORD32 ChunkCount;
+  DWORD32 ValueSize;
+  PRESULT_CHUNK Cursor;
+  DWORD64 CursorOffset;
+} RESULT_STORE, * PRESULT_STORE;
+
+typedef struct _RESULT_WRITER
+{
+  PRESULT_STORE Store;
+  PRESULT_CHUNK Source;
+  DWORD32 Index;
+  BOOLEAN Identical;
+  NTSTATUS Status;
+} RESULT_WRITER, * PRESULT_WRITER;
+
+///////////////////////////////////////////////////////////
+// Result store API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeResultStore(
+  PRESULT_STORE store,
+  DWORD32 valueSize);
+
+NTSTATUS
+KmResetResultStore(
+  PRESULT_STORE store);
+
+NTSTATUS
+KmAppendResults(
+  PRESULT_STORE store,
+  DWORD64 base,
+  PBYTE bytes,
+  PDWORD32 offsets,
+  DWORD32 count);
+
+NTSTATUS
+KmAppendResult(
+  PRESULT_STORE store,
+  DWORD64 base,
+  PBYTE value);
+
+VOID
+KmSpliceResultStore(
+  PRESULT_STORE store,
+  PRESULT_STORE source);
+
+NTSTATUS
+KmSortResultStore(
+  PRESULT_STORE store);
+
+NTSTATUS
+KmReadResultStore(
+  PRESULT_STORE store,
+  DWORD64 offset,
+  DWORD32 count,
+  PDWORD64 bases,
+  PBYTE values);
+
+VOID
+KmBeginDerivation(
+  PRESULT_STORE store,
+  PRESULT_WRITER writer);
+
+VOID
+KmDeriveChunk(
+  PRESULT_WRITER writer,
+  PRESULT_CHUNK chunk);
+
+VOID
+KmDeriveResult(
+  PRESULT_WRITER writer,
+  DWORD64 base,
+  PBYTE value);
+
+NTSTATUS
+KmEndDerivation(
+  PRESULT_WRITER writer);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include <km_scan_work.h>
+#include <km_debug.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Scan work data types
+///////////////////////////////////////////////////////////
+
+typedef struct _SCAN_WORKER_START
+{
+  SCAN_WORKER_ROUTINE Routine;
+  PVOID Context;
+} SCAN_WORKER_START, * PSCAN_WORKER_START;
+
+typedef struct _SCAN_WORK_MERGE
+{
+  PSCAN_WORK_LIST List;
+  PRESULT_STORE Store;
+} SCAN_WORK_MERGE, * PSCAN_WORK_MERGE;
+
+///////////////////////////////////////////////////////////
+// Scan work utilities
+///////////////////////////////////////////////////////////
+
+static
+NTSTATUS
+KmGrowScanWork(
+  PSCAN_WORK_LIST list)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Double item capacity
+  DWORD32 capacity = list->Capacity ? list->Capacity * 2 : 0x100;
+  PSCAN_WORK items = ExAllocatePoolWithTag(PagedPool, sizeof(SCAN_WORK) * capacity, KM_MEMORY_POOL_TAG);
+  if (items)
+  {
+    if (list->Items)
+    {
+      RtlCopyMemory(items, list->Items, sizeof(SCAN_WORK) * list->Count);
+      ExFreePoolWithTag(list->Items, KM_MEMORY_POOL_TAG);
+    }
+
+    // Result stores are still empty while partitioning, re-anchor their list heads
+    for (DWORD32 i = 0; i < list->Count; i++)
+    {
+      KmInitializeResultStore(&items[i].Results, list->ValueSize);
+    }
+
+    list->Items = items;
+    list->Capacity = capacity;
+
+    status = STATUS_SUCCESS;
+  }
+
+  return status;
+}
+
+static
+VOID
+KmSpliceScanWork(
+  PVOID context,
+  DWORD32 index)
+{
+  PSCAN_WORK_MERGE merge = (PSCAN_WORK_MERGE)context;
+  KmSpliceResultStore(merge->Store, &merge->List->Items[index].Results);
+}
+
+static
+VOID
+KmStartScanWorker(
+  PVOID context)
+{
+  PSCAN_WORKER_START start = (PSCAN_WORKER_START)context;
+
+  // Run worker to completion
+  start->Routine(start->Context);
+
+  PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
+///////////////////////////////////////////////////////////
+// Scan work API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeScanWork(
+  PSCAN_WORK_LIST list,
+  DWORD32 valueSize)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Reset items
+  list->Items = NULL;
+  list->Count = 0;
+  list->Capacity = 0;
+  list->ValueSize = valueSize;
+  list->Next = 0;
+
+  return status;
+}
+
+VOID
+KmFreeScanWork(
+  PSCAN_WORK_LIST list)
+{
+  if (list->Items)
+  {
+    // Free results which were not merged
+    for (DWORD32 i = 0; i < list->Count; i++)
+    {
+      KmResetResultStore(&list->Items[i].Results);
+    }
+
+    // Free items
+    ExFreePoolWithTag(list->Items, KM_MEMORY_POOL_TAG);
+  }
+
+  // Reset items
+  list->Items = NULL;
+  list->Count = 0;
+  list->Capacity = 0;
+  list->Next = 0;
+}
+
+NTSTATUS
+KmAppendScanWork(
+  PSCAN_WORK_LIST list,
+  DWORD64 base,
+  DWORD64 size)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Append one item per partition of the region
+  DWORD32 count = KmCountPartitions(size);
+  for (DWORD32 i = 0; i < count && NT_SUCCESS(status); i++)
+  {
+    if (list->Count == list->Capacity)
+    {
+      status = KmGrowScanWork(list);
+    }
+
+    if (NT_SUCCESS(status))
+    {
+      PSCAN_WORK work = &list->Items[list->Count++];
+      SCAN_PARTITION partition = KmGetPartition(base, size, i);
+      work->Base = partition.Base;
+      work->Size = partition.Size;
+      work->Limit = partition.Limit;
+      KmInitializeResultStore(&work->Results, list->ValueSize);
+    }
+  }
+
+  return status;
+}
+
+PSCAN_WORK
+KmNextScanWork(
+  PSCAN_WORK_LIST list)
+{
+  PSCAN_WORK work = NULL;
+
+  // Hand out items in address order
+  DWORD32 index = KmClaimPartition(&list->Next, list->Count);
+  if (index < list->Count)
+  {
+    work = &list->Items[index];
+  }
+
+  return work;
+}
+
+VOID
+KmMergeScanWork(
+  PSCAN_WORK_LIST list,
+  PRESULT_STORE store)
+{
+  SCAN_WORK_MERGE merge;
+  merge.List = list;
+  merge.Store = store;
+
+  // Splice private results in address order
+  KmSplicePartitions(list->Count, KmSpliceScanWork, &merge);
+}
+
+DWORD32
+KmRunScanWorkers(
+  SCAN_WORKER_ROUTINE routine,
+  PVOID context)
+{
+  PETHREAD threads[KM_SCAN_MAX_WORKERS];
+  DWORD32 threadCount = 0;
+
+  // Worker handles must not land in the handle table of whichever process issued the scan
+  OBJECT_ATTRIBUTES attributes;
+  InitializeObjectAttributes(&attributes, NULL, OBJ_KERNEL_HANDLE, NULL, NULL);
+
+  // Start one worker per active processor
+  SCAN_WORKER_START start;
+  start.Routine = routine;
+  start.Context = context;
+  DWORD32 workerCount = min(KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS), KM_SCAN_MAX_WORKERS);
+  for (DWORD32 i = 0; i < workerCount; i++)
+  {
+    HANDLE thread;
+    if (NT_SUCCESS(PsCreateSystemThread(&thread, THREAD_ALL_ACCESS, &attributes, NULL, NULL, KmStartScanWorker, &start)))
+    {
+      if (NT_SUCCESS(ObReferenceObjectByHandle(thread, SYNCHRONIZE, *PsThreadType, KernelMode, (PVOID*)&threads[threadCount], NULL)))
+      {
+        threadCount++;
+      }
+      else
+      {
+        // Workers use the start block on this stack, wait through the handle instead
+        ZwWaitForSingleObject(thread, FALSE, NULL);
+      }
+      ZwClose(thread);
+    }
+  }
+
+  // Fall back to the calling thread if no worker could be started
+  if (threadCount == 0)
+  {
+    routine(context);
+  }
+
+  // Wait for workers to drain the work list
+  for (DWORD32 i = 0; i < threadCount; i++)
+  {
+    KeWaitForSingleObject(threads[i], Executive, KernelMode, FALSE, NULL);
+    ObDereferenceObject(threads[i]);
+  }
+
+  return max(threadCount, 1);
+}
\ No newline at end of file
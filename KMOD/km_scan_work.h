@@ -0,0 +1,65 @@
+#ifndef KM_SCAN_WORK_H
+#define KM_SCAN_WORK_H
+
+#include <km_core.h>
+#include <km_result_store.h>
+#include <km_partition.h>
+
+///////////////////////////////////////////////////////////
+// Scan work data types
+///////////////////////////////////////////////////////////
+
+typedef struct _SCAN_WORK
+{
+  DWORD64 Base;
+  DWORD64 Size;
+  DWORD64 Limit;
+  RESULT_STORE Results;
+} SCAN_WORK, * PSCAN_WORK;
+
+typedef struct _SCAN_WORK_LIST
+{
+  PSCAN_WORK Items;
+  DWORD32 Count;
+  DWORD32 Capacity;
+  DWORD32 ValueSize;
+  volatile LONG Next;
+} SCAN_WORK_LIST, * PSCAN_WORK_LIST;
+
+typedef VOID(*SCAN_WORKER_ROUTINE)(
+  PVOID context);
+
+///////////////////////////////////////////////////////////
+// Scan work API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeScanWork(
+  PSCAN_WORK_LIST list,
+  DWORD32 valueSize);
+
+VOID
+KmFreeScanWork(
+  PSCAN_WORK_LIST list);
+
+NTSTATUS
+KmAppendScanWork(
+  PSCAN_WORK_LIST list,
+  DWORD64 base,
+  DWORD64 size);
+
+PSCAN_WORK
+KmNextScanWork(
+  PSCAN_WORK_LIST list);
+
+VOID
+KmMergeScanWork(
+  PSCAN_WORK_LIST list,
+  PRESULT_STORE store);
+
+DWORD32
+KmRunScanWorkers(
+  SCAN_WORKER_ROUTINE routine,
+  PVOID context);
+
+#endif
\ No newline at end of file
@@ -1,276 +1,2504 @@
 #include <km_scanner.h>
 #include <km_debug.h>
 #include <km_config.h>
+#include <km_compare.h>
+#include <km_result_store.h>
+#include <km_result_history.h>
+#include <km_snapshot.h>
+#include <km_scan_work.h>
+#include <km_memory.h>
+#include <km_source.h>
+#include <km_signature.h>
+#include <km_pointer.h>
 
 ///////////////////////////////////////////////////////////
-// Locals
+// Scanner data types
+///////////////////////////////////////////////////////////
+
+typedef struct _SCAN_BATCH
+{
+  PMEMORY_SOURCE Source;
+  DWORD64 Page;
+  DWORD32 Count;
+  PDWORD64 Bases;
+  PBYTE Values;
+  PBYTE Bytes;
+} SCAN_BATCH, * PSCAN_BATCH;
+
+typedef struct _SCAN_OPERAND
+{
+  DWORD32 Filter;
+  DWORD32 Width;
+  BOOLEAN Real;
+  INT64 Value;
+  double Low;
+  double High;
+  SCAN_COMPARE Predicate;
+} SCAN_OPERAND, * PSCAN_OPERAND;
+
+typedef struct _SNAPSHOT_FILTER
+{
+  PSCAN_SESSION Session;
+  PMEMORY_SOURCE Source;
+  PSCAN_OPERAND Operand;
+  PRESULT_STORE Results;
+  PBYTE Bytes;
+  PBYTE Candidates;
+  PDWORD32 Offsets;
+} SNAPSHOT_FILTER, * PSNAPSHOT_FILTER;
+
+typedef struct _SCAN_EXACT
+{
+  PSCAN_SESSION Session;
+  PSCAN_COMPARE Compare;
+  DWORD32 Reach;
+  PDWORD32 Offsets;
+  PRESULT_STORE Results;
+} SCAN_EXACT, * PSCAN_EXACT;
+
+typedef struct _SCAN_WORKER
+{
+  PSCAN_SESSION Session;
+  PMEMORY_SOURCE Source;
+  DWORD32 Type;
+  DWORD32 Filter;
+  DWORD32 Alignment;
+  DWORD32 Rounding;
+  double Tolerance;
+  DWORD32 Case;
+  PBYTE Value;
+  DWORD32 Size;
+  SCAN_WORK_LIST Work;
+} SCAN_WORKER, * PSCAN_WORKER;
+
+typedef struct _SIGNATURE_WORKER
+{
+  PSCAN_SESSION Session;
+  PMEMORY_SOURCE Source;
+  PSIGNATURE_MATCHER Matcher;
+  SCAN_WORK_LIST Work;
+} SIGNATURE_WORKER, * PSIGNATURE_WORKER;
+
+typedef struct _SIGNATURE_SCAN
+{
+  PSIGNATURE_MATCHER Matcher;
+  PRESULT_STORE Results;
+} SIGNATURE_SCAN, * PSIGNATURE_SCAN;
+
+typedef struct _POINTER_WORKER
+{
+  PSCAN_SESSION Session;
+  PMEMORY_SOURCE Source;
+  PPOINTER_RANGES Ranges;
+  SCAN_WORK_LIST Work;
+} POINTER_WORKER, * PPOINTER_WORKER;
+
+typedef struct _POINTER_SCAN
+{
+  PSCAN_SESSION Session;
+  PPOINTER_RANGES Ranges;
+  PDWORD32 Offsets;
+  PRESULT_STORE Results;
+} POINTER_SCAN, * PPOINTER_SCAN;
+
+typedef struct _CAPTURE_SCAN
+{
+  PCAPTURE_WRITER Writer;
+  PMEMORY_BASIC_INFORMATION Region;
+  NTSTATUS Status;
+} CAPTURE_SCAN, * PCAPTURE_SCAN;
+
+typedef struct _SCAN_WINDOW_MAP
+{
+  PSCAN_SESSION Session;
+  PMEMORY_SOURCE Source;
+  PMEMORY_WINDOW Window;
+} SCAN_WINDOW_MAP, * PSCAN_WINDOW_MAP;
+
+///////////////////////////////////////////////////////////
+// Scanner utilities
 ///////////////////////////////////////////////////////////
 
-static LIST_ENTRY g_scans;
-static DWORD32 g_scanCount;
+static
+INT64
+KmLoadScanValue(
+  PBYTE bytes,
+  DWORD32 width)
+{
+  switch (width)
+  {
+    case sizeof(INT8): return *(PINT8)bytes;
+    case sizeof(INT16): return *(PINT16)bytes;
+    case sizeof(INT32): return *(PINT32)bytes;
+    default: return *(PINT64)bytes;
+  }
+}
+
+static
+double
+KmLoadScanReal(
+  PBYTE bytes,
+  DWORD32 width)
+{
+  return (width == sizeof(float)) ? *(float*)bytes : *(double*)bytes;
+}
+
+static
+BOOLEAN
+KmIsScanCancelled(
+  PSCAN_SESSION session)
+{
+  // Signature scans run without a session and can not be cancelled
+  return session && session->Cancel;
+}
+
+static
+VOID
+KmReportScanProgress(
+  PSCAN_SESSION session,
+  DWORD64 bytes,
+  DWORD64 regions,
+  DWORD64 hits)
+{
+  // Workers report concurrently, readers poll without locking
+  if (session)
+  {
+    InterlockedAdd64((LONG64 volatile*)&session->Progress.Bytes, (LONG64)bytes);
+    InterlockedAdd64((LONG64 volatile*)&session->Progress.Regions, (LONG64)regions);
+    InterlockedAdd64((LONG64 volatile*)&session->Progress.Hits, (LONG64)hits);
+  }
+}
+
+static
+NTSTATUS
+KmBeginScanCompare(
+  PSCAN_COMPARE compare,
+  DWORD32 type,
+  DWORD32 filter,
+  DWORD32 alignment,
+  DWORD32 rounding,
+  double tolerance,
+  DWORD32 textCase,
+  PBYTE value,
+  DWORD32 size)
+{
+  // Predicates carry a descriptor instead of a plain value
+  if (filter == SCAN_FILTER_PREDICATE)
+  {
+    return KmBeginPredicate(compare, type, alignment, rounding, tolerance, value, size);
+  }
+
+  return KmBeginCompare(compare, type, alignment, rounding, tolerance, textCase, value, size);
+}
+
+static
+BOOLEAN
+KmEvaluateFilter(
+  PSCAN_OPERAND operand,
+  PBYTE previous,
+  PBYTE current)
+{
+  DWORD32 width = operand->Width;
+
+  // Changes are detected bitwise for every type
+  switch (operand->Filter)
+  {
+    case SCAN_FILTER_CHANGED: return RtlEqualMemory(previous, current, width) == FALSE;
+    case SCAN_FILTER_UNCHANGED: return RtlEqualMemory(previous, current, width);
+    case SCAN_FILTER_PREDICATE: return KmCompareElement(&operand->Predicate, current);
+  }
+
+  if (operand->Real)
+  {
+    // Ordered compares, NaN fails every numeric filter
+    double before = KmLoadScanReal(previous, width);
+    double after = KmLoadScanReal(current, width);
+    switch (operand->Filter)
+    {
+      case SCAN_FILTER_EXACT: return after >= operand->Low && after <= operand->High;
+      case SCAN_FILTER_INCREASED: return after > before;
+      case SCAN_FILTER_DECREASED: return after < before;
+      case SCAN_FILTER_INCREASED_BY: return (after - before) >= operand->Low && (after - before) <= operand->High;
+      case SCAN_FILTER_DECREASED_BY: return (before - after) >= operand->Low && (before - after) <= operand->High;
+    }
+  }
+  else
+  {
+    // Differences wrap around at the scanned width
+    INT64 before = KmLoadScanValue(previous, width);
+    INT64 after = KmLoadScanValue(current, width);
+    DWORD64 mask = (width < sizeof(DWORD64)) ? ((1ULL << (width * 8)) - 1) : MAXULONG64;
+    switch (operand->Filter)
+    {
+      case SCAN_FILTER_EXACT: return after == operand->Value;
+      case SCAN_FILTER_INCREASED: return after > before;
+      case SCAN_FILTER_DECREASED: return after < before;
+      case SCAN_FILTER_INCREASED_BY: return (((DWORD64)after - (DWORD64)before - (DWORD64)operand->Value) & mask) == 0;
+      case SCAN_FILTER_DECREASED_BY: return (((DWORD64)before - (DWORD64)after - (DWORD64)operand->Value) & mask) == 0;
+    }
+  }
+
+  return FALSE;
+}
+
+static
+NTSTATUS
+KmPrepareScanOperand(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_NEXT request,
+  DWORD32 width,
+  PSCAN_OPERAND operand)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Interpret values like the first scan did
+  RtlZeroMemory(operand, sizeof(SCAN_OPERAND));
+  operand->Filter = request->Filter;
+  operand->Width = width;
+  operand->Real = KmIsRealCompare(session->Type);
+
+  // Predicates are compiled into a compare kernel, snapshots run it over whole pages at their stride
+  if (request->Filter == SCAN_FILTER_PREDICATE)
+  {
+    DWORD32 alignment = KmIsSnapshotActive(&session->Snapshot) ? session->Snapshot.Stride : SCAN_ALIGNMENT_NATURAL;
+    status = KmBeginPredicate(&operand->Predicate, session->Type, alignment, request->Rounding, request->Tolerance, request->Buffer, request->Size);
+  }
+
+  // Load operand for exact and relative filters
+  if (request->Filter == SCAN_FILTER_EXACT || request->Filter == SCAN_FILTER_INCREASED_BY || request->Filter == SCAN_FILTER_DECREASED_BY)
+  {
+    status = STATUS_INVALID_PARAMETER;
+    if (request->Size >= width)
+    {
+      BYTE value[sizeof(INT64)] = { 0 };
+      RtlCopyMemory(value, request->Buffer, width);
+      if (operand->Real)
+      {
+        // Real operands match a closed range depending on the rounding mode
+        status = KmGetRealRange(request->Rounding, KmLoadScanReal(value, width), request->Tolerance, &operand->Low, &operand->High) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+      }
+      else
+      {
+        operand->Value = KmLoadScanValue(value, width);
+        status = STATUS_SUCCESS;
+      }
+    }
+  }
+
+  return status;
+}
+
+static
+VOID
+KmReleaseScanOperand(
+  PSCAN_OPERAND operand)
+{
+  // Release predicate kernel
+  if (operand->Filter == SCAN_FILTER_PREDICATE)
+  {
+    KmEndCompare(&operand->Predicate);
+  }
+}
+
+static
+VOID
+KmFilterScanBatch(
+  PSCAN_BATCH batch,
+  PRESULT_WRITER writer,
+  PSCAN_OPERAND operand)
+{
+  DWORD32 width = writer->Store->ValueSize;
+
+  // Read page once, including values which straddle into the next page
+  DWORD32 size = (DWORD32)(batch->Bases[batch->Count - 1] + width - batch->Page);
+  NTSTATUS status = KmReadMemorySource(batch->Source, batch->Bytes, batch->Page, size);
+  if (NT_SUCCESS(status) == FALSE && size > PAGE_SIZE)
+  {
+    // Next page is not readable, keep what fits into this one
+    size = PAGE_SIZE;
+    status = KmReadMemorySource(batch->Source, batch->Bytes, batch->Page, size);
+  }
+
+  // Unreadable candidates are dropped
+  if (NT_SUCCESS(status))
+  {
+    for (DWORD32 i = 0; i < batch->Count; i++)
+    {
+      DWORD32 offset = (DWORD32)(batch->Bases[i] - batch->Page);
+      if ((offset + width) <= size)
+      {
+        if (KmEvaluateFilter(operand, batch->Values + (SIZE_T)i * width, batch->Bytes + offset))
+        {
+          KmDeriveResult(writer, batch->Bases[i], batch->Bytes + offset);
+        }
+      }
+    }
+  }
+
+  // Reset batch
+  batch->Count = 0;
+}
+
+static
+VOID
+KmFilterCleanBatch(
+  PSCAN_BATCH batch,
+  PRESULT_WRITER writer,
+  PSCAN_OPERAND operand)
+{
+  DWORD32 width = writer->Store->ValueSize;
+
+  // Clean pages still hold the previous values, filters see them as current ones without touching the process
+  for (DWORD32 i = 0; i < batch->Count; i++)
+  {
+    PBYTE value = batch->Values + (SIZE_T)i * width;
+    if (KmEvaluateFilter(operand, value, value))
+    {
+      KmDeriveResult(writer, batch->Bases[i], value);
+    }
+  }
+
+  // Reset batch
+  batch->Count = 0;
+}
+
+static
+BOOLEAN
+KmIsScanBatchClean(
+  PSCAN_SESSION session,
+  PSCAN_BATCH batch,
+  DWORD32 width)
+{
+  // Last value of the page may straddle into the next one
+  DWORD64 end = batch->Bases[batch->Count - 1] + width;
+  return KmIsRangeDirty(&session->Dirty, batch->Page, end - batch->Page) == FALSE;
+}
+
+static
+VOID
+KmFlushScanBatch(
+  PSCAN_SESSION session,
+  PSCAN_BATCH batch,
+  PRESULT_WRITER writer,
+  PSCAN_OPERAND operand)
+{
+  if (KmIsScanCancelled(session))
+  {
+    // Cancelled scans keep the remaining candidates unfiltered
+    for (DWORD32 i = 0; i < batch->Count; i++)
+    {
+      KmDeriveResult(writer, batch->Bases[i], batch->Values + (SIZE_T)i * writer->Store->ValueSize);
+    }
+    batch->Count = 0;
+  }
+  else
+  {
+    // Filter page and report its survivors, pages not written since the last pass are not read again
+    DWORD64 count = writer->Store->Count + writer->Index;
+    if (KmIsScanBatchClean(session, batch, writer->Store->ValueSize))
+    {
+      KmFilterCleanBatch(batch, writer, operand);
+    }
+    else
+    {
+      KmFilterScanBatch(batch, writer, operand);
+    }
+    KmReportScanProgress(session, PAGE_SIZE, 1, writer->Store->Count + writer->Index - count);
+  }
+}
+
+static
+BOOLEAN
+KmIsWritableProtection(
+  DWORD32 protect)
+{
+  return (protect & (PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+}
+
+static
+BOOLEAN
+KmIsExecutableProtection(
+  DWORD32 protect)
+{
+  return (protect & (PAGE_EXECUTE | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY)) != 0;
+}
+
+static
+BOOLEAN
+KmSelectScanRegion(
+  PSCAN_REGION_FILTER filter,
+  PMEMORY_BASIC_INFORMATION mbi,
+  PDWORD64 base,
+  PDWORD64 size)
+{
+  // Skip non-committed, no-access and guard pages
+  if (mbi->State != MEM_COMMIT || mbi->Protect == PAGE_NOACCESS || (mbi->Protect & PAGE_GUARD))
+  {
+    return FALSE;
+  }
+
+  // Protection and type have to carry every requested flag
+  if ((filter->Flags & SCAN_REGION_WRITABLE) && KmIsWritableProtection(mbi->Protect) == FALSE)
+  {
+    return FALSE;
+  }
+  if ((filter->Flags & SCAN_REGION_EXECUTABLE) && KmIsExecutableProtection(mbi->Protect) == FALSE)
+  {
+    return FALSE;
+  }
+  if (((filter->Flags & SCAN_REGION_PRIVATE) && mbi->Type != MEM_PRIVATE) || ((filter->Flags & SCAN_REGION_IMAGE) && mbi->Type != MEM_IMAGE) || ((filter->Flags & SCAN_REGION_MAPPED) && mbi->Type != MEM_MAPPED))
+  {
+    return FALSE;
+  }
+
+  // Modules are identified by the base of their image allocation
+  if (filter->Module && (DWORD64)mbi->AllocationBase != filter->Module)
+  {
+    return FALSE;
+  }
+
+  // Clip to the requested range in whole pages
+  DWORD64 start = filter->Start & ~(DWORD64)(PAGE_SIZE - 1);
+  DWORD64 end = filter->End ? ((filter->End + PAGE_SIZE - 1) & ~(DWORD64)(PAGE_SIZE - 1)) : MAXULONG64;
+  DWORD64 regionBase = max((DWORD64)mbi->BaseAddress, start);
+  DWORD64 regionEnd = min((DWORD64)mbi->BaseAddress + mbi->RegionSize, end);
+  if (regionBase >= regionEnd)
+  {
+    return FALSE;
+  }
+
+  *base = regionBase;
+  *size = regionEnd - regionBase;
+  return TRUE;
+}
+
+static
+NTSTATUS
+KmFilterSnapshotPage(
+  PVOID context,
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_PAGE page,
+  PBYTE previous)
+{
+  PSNAPSHOT_FILTER filter = (PSNAPSHOT_FILTER)context;
+  DWORD32 count = 0;
+
+  // Cancelled scans leave the remaining pages untouched
+  NTSTATUS status = STATUS_CANCELLED;
+  if (KmIsScanCancelled(filter->Session) == FALSE)
+  {
+    // Pages not written since the last pass keep their content, unreadable pages lose all of their candidates
+    PBYTE current = previous;
+    BOOLEAN readable = TRUE;
+    if (KmIsRangeDirty(&filter->Session->Dirty, page->Base, PAGE_SIZE))
+    {
+      current = filter->Bytes;
+      readable = NT_SUCCESS(KmReadMemorySource(filter->Source, filter->Bytes, page->Base, PAGE_SIZE));
+    }
+    if (readable)
+    {
+      RtlZeroMemory(filter->Candidates, PAGE_SIZE / 8);
+
+      if (filter->Operand->Filter == SCAN_FILTER_PREDICATE)
+      {
+        // Predicates ignore previous content, the vector kernel runs over the whole page
+        DWORD32 matchCount = KmCompareBlock(&filter->Operand->Predicate, current, PAGE_SIZE, filter->Offsets);
+        for (DWORD32 j = 0; j < matchCount; j++)
+        {
+          DWORD32 i = filter->Offsets[j] / store->Stride;
+          if (page->Candidates == NULL || (page->Candidates[i >> 3] & (1 << (i & 7))))
+          {
+            filter->Candidates[i >> 3] |= (BYTE)(1 << (i & 7));
+            count++;
+          }
+        }
+      }
+      else
+      {
+        // Diff current against previous content element wise
+        for (DWORD32 i = 0; i < store->ElementCount; i++)
+        {
+          if (page->Candidates == NULL || (page->Candidates[i >> 3] & (1 << (i & 7))))
+          {
+            SIZE_T offset = (SIZE_T)i * store->Stride;
+            if (KmEvaluateFilter(filter->Operand, previous + offset, current + offset))
+            {
+              filter->Candidates[i >> 3] |= (BYTE)(1 << (i & 7));
+              count++;
+            }
+          }
+        }
+      }
+    }
+
+    // Store new content along with surviving candidates
+    status = KmUpdateSnapshotPage(store, page, current, filter->Candidates, count);
+    KmReportScanProgress(filter->Session, PAGE_SIZE, 1, count);
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmMaterializeSnapshotPage(
+  PVOID context,
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_PAGE page,
+  PBYTE previous)
+{
+  PSNAPSHOT_FILTER filter = (PSNAPSHOT_FILTER)context;
+  DWORD32 count = 0;
+
+  // Collect candidate offsets
+  for (DWORD32 i = 0; i < store->ElementCount; i++)
+  {
+    if (page->Candidates == NULL || (page->Candidates[i >> 3] & (1 << (i & 7))))
+    {
+      filter->Offsets[count++] = i * store->Stride;
+    }
+  }
+
+  // Append candidates with their last known value
+  return KmAppendResults(filter->Results, page->Base, previous, filter->Offsets, count);
+}
+
+static
+BOOLEAN
+KmMapScanWindow(
+  PVOID context,
+  DWORD64 base,
+  DWORD32 size,
+  PBYTE* mapped)
+{
+  PSCAN_WINDOW_MAP map = (PSCAN_WINDOW_MAP)context;
+  return NT_SUCCESS(KmMapSourceWindow(map->Source, map->Window, base, size, mapped));
+}
+
+static
+VOID
+KmUnmapScanWindow(
+  PVOID context)
+{
+  PSCAN_WINDOW_MAP map = (PSCAN_WINDOW_MAP)context;
+  KmUnmapSourceWindow(map->Source, map->Window);
+}
+
+static
+BOOLEAN
+KmStepScanWindow(
+  PVOID context,
+  DWORD32 size)
+{
+  PSCAN_WINDOW_MAP map = (PSCAN_WINDOW_MAP)context;
+
+  // Report window as scanned, cancellation is checked once per window
+  KmReportScanProgress(map->Session, size, 0, 0);
+  return KmIsScanCancelled(map->Session) == FALSE;
+}
+
+static
+VOID
+KmScanRegionWindowed(
+  PSCAN_SESSION session,
+  PMEMORY_SOURCE source,
+  PMEMORY_WINDOW window,
+  DWORD64 regionBase,
+  DWORD64 regionSize,
+  DWORD64 regionLimit,
+  DWORD32 reach,
+  SCAN_WINDOW_ROUTINE routine,
+  PVOID context)
+{
+  SCAN_WINDOW_MAP map;
+  map.Session = session;
+  map.Source = source;
+  map.Window = window;
+
+  // Walk windows of the memory source
+  SCAN_WALK walk;
+  walk.Map = KmMapScanWindow;
+  walk.Unmap = KmUnmapScanWindow;
+  walk.Step = KmStepScanWindow;
+  walk.Context = &map;
+  if (KmIsScanCancelled(session) == FALSE)
+  {
+    KmWalkScanWindows(&walk, regionBase, regionSize, regionLimit, reach, routine, context);
+  }
+}
+
+static
+VOID
+KmScanExactWindow(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PSCAN_EXACT exact = (PSCAN_EXACT)context;
+
+  // Scan window block wise, unaligned values may straddle into the next block or window
+  DWORD64 hits = 0;
+  for (DWORD32 offset = 0; offset < owned; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    DWORD32 blockSize = min(KM_SCAN_BLOCK_SIZE + exact->Reach, size - offset);
+    DWORD32 matchCount = KmCompareBlock(exact->Compare, bytes + offset, blockSize, exact->Offsets);
+
+    // Starts inside the reach belong to the next block or window
+    matchCount = KmTrimOffsets(exact->Offsets, matchCount, min(KM_SCAN_BLOCK_SIZE, owned - offset));
+
+    // Append scan results
+    KmAppendResults(exact->Results, base + offset, bytes + offset, exact->Offsets, matchCount);
+    hits += matchCount;
+  }
+
+  // Report hits once per window
+  KmReportScanProgress(exact->Session, 0, 0, hits);
+}
+
+static
+VOID
+KmScanExactWorker(
+  PVOID context)
+{
+  PSCAN_WORKER worker = (PSCAN_WORKER)context;
+
+  // Allocate private offsets and mapping window
+  PDWORD32 offsets = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD32) * KM_COMPARE_MAX_OFFSETS, KM_MEMORY_POOL_TAG);
+  MEMORY_WINDOW window;
+  KmInitializeMemoryWindow(&window, KM_SCAN_WINDOW_SIZE + KM_SCAN_WINDOW_REACH);
+  if (offsets && window.Mdl)
+  {
+    // Select compare kernel, extended state is saved per thread
+    SCAN_COMPARE compare;
+    if (NT_SUCCESS(KmBeginScanCompare(&compare, worker->Type, worker->Filter, worker->Alignment, worker->Rounding, worker->Tolerance, worker->Case, worker->Value, worker->Size)))
+    {
+      // Attach to memory source
+      KAPC_STATE apc;
+      KmAttachMemorySource(worker->Source, &apc);
+
+      __try
+      {
+        // Drain work items into their private result stores
+        SCAN_EXACT exact;
+        exact.Session = worker->Session;
+        exact.Compare = &compare;
+        exact.Reach = compare.Width - min(compare.Alignment, compare.Width);
+        exact.Offsets = offsets;
+        PSCAN_WORK work = NULL;
+        while (KmIsScanCancelled(worker->Session) == FALSE && (work = KmNextScanWork(&worker->Work)) != NULL)
+        {
+          exact.Results = &work->Results;
+          KmScanRegionWindowed(worker->Session, worker->Source, &window, work->Base, work->Size, work->Limit, exact.Reach, KmScanExactWindow, &exact);
+          KmReportScanProgress(worker->Session, 0, 1, 0);
+        }
+      }
+      __except (EXCEPTION_EXECUTE_HANDLER)
+      {
+        KD_LOG("Something went wrong\n");
+      }
+
+      // Detach from memory source
+      KmDetachMemorySource(worker->Source, &apc);
+
+      // Release compare kernel
+      KmEndCompare(&compare);
+    }
+  }
+
+  // Free offsets and mapping window
+  if (offsets)
+  {
+    ExFreePoolWithTag(offsets, KM_MEMORY_POOL_TAG);
+  }
+  KmFreeMemoryWindow(&window);
+}
+
+static
+VOID
+KmScanUnknownWindow(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PSNAPSHOT_STORE snapshot = (PSNAPSHOT_STORE)context;
+
+  // Snapshot window page wise
+  for (DWORD32 offset = 0; (offset + PAGE_SIZE) <= owned; offset += PAGE_SIZE)
+  {
+    KmAppendSnapshotPage(snapshot, base + offset, bytes + offset);
+  }
+}
+
+static
+VOID
+KmScanSignatureWindow(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PSIGNATURE_SCAN scan = (PSIGNATURE_SCAN)context;
+
+  // Match every signature of the set in one pass over the window
+  KmMatchSignatures(scan->Matcher, base, bytes, size, owned, scan->Results);
+}
+
+static
+VOID
+KmScanSignatureWorker(
+  PVOID context)
+{
+  PSIGNATURE_WORKER worker = (PSIGNATURE_WORKER)context;
+
+  // Allocate private mapping window
+  MEMORY_WINDOW window;
+  KmInitializeMemoryWindow(&window, KM_SCAN_WINDOW_SIZE + KM_SCAN_WINDOW_REACH);
+  if (window.Mdl)
+  {
+    // Attach to memory source
+    KAPC_STATE apc;
+    KmAttachMemorySource(worker->Source, &apc);
+
+    __try
+    {
+      // Drain work items into their private result stores
+      SIGNATURE_SCAN scan;
+      scan.Matcher = worker->Matcher;
+      PSCAN_WORK work = NULL;
+      while (KmIsScanCancelled(worker->Session) == FALSE && (work = KmNextScanWork(&worker->Work)) != NULL)
+      {
+        scan.Results = &work->Results;
+        KmScanRegionWindowed(worker->Session, worker->Source, &window, work->Base, work->Size, work->Limit, worker->Matcher->Reach, KmScanSignatureWindow, &scan);
+      }
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+    }
+
+    // Detach from memory source
+    KmDetachMemorySource(worker->Source, &apc);
+  }
+
+  // Free mapping window
+  KmFreeMemoryWindow(&window);
+}
+
+static
+VOID
+KmScanPointerWindow(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PPOINTER_SCAN scan = (PPOINTER_SCAN)context;
+
+  // Collect aligned values pointing into committed memory block wise
+  DWORD64 hits = 0;
+  for (DWORD32 offset = 0; offset < owned; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    DWORD32 blockSize = min(KM_SCAN_BLOCK_SIZE, owned - offset);
+    DWORD32 pointerCount = KmFindPointers(scan->Ranges, bytes + offset, blockSize, scan->Offsets);
+
+    // Append pointers along with their targets
+    KmAppendResults(scan->Results, base + offset, bytes + offset, scan->Offsets, pointerCount);
+    hits += pointerCount;
+  }
+
+  // Report hits once per window
+  KmReportScanProgress(scan->Session, 0, 0, hits);
+}
+
+static
+VOID
+KmScanPointerWorker(
+  PVOID context)
+{
+  PPOINTER_WORKER worker = (PPOINTER_WORKER)context;
+
+  // Allocate private offsets and mapping window
+  PDWORD32 offsets = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD32) * (KM_SCAN_BLOCK_SIZE / sizeof(DWORD64)), KM_MEMORY_POOL_TAG);
+  MEMORY_WINDOW window;
+  KmInitializeMemoryWindow(&window, KM_SCAN_WINDOW_SIZE);
+  if (offsets && window.Mdl)
+  {
+    // Attach to memory source
+    KAPC_STATE apc;
+    KmAttachMemorySource(worker->Source, &apc);
+
+    __try
+    {
+      // Drain work items into their private result stores
+      POINTER_SCAN scan;
+      scan.Session = worker->Session;
+      scan.Ranges = worker->Ranges;
+      scan.Offsets = offsets;
+      PSCAN_WORK work = NULL;
+      while (KmIsScanCancelled(worker->Session) == FALSE && (work = KmNextScanWork(&worker->Work)) != NULL)
+      {
+        scan.Results = &work->Results;
+        KmScanRegionWindowed(worker->Session, worker->Source, &window, work->Base, work->Size, work->Limit, 0, KmScanPointerWindow, &scan);
+        KmReportScanProgress(worker->Session, 0, 1, 0);
+      }
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+    }
+
+    // Detach from memory source
+    KmDetachMemorySource(worker->Source, &apc);
+  }
+
+  // Free offsets and mapping window
+  if (offsets)
+  {
+    ExFreePoolWithTag(offsets, KM_MEMORY_POOL_TAG);
+  }
+  KmFreeMemoryWindow(&window);
+}
+
+static
+VOID
+KmCaptureWindow(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PCAPTURE_SCAN scan = (PCAPTURE_SCAN)context;
+
+  // Keep the first failure, remaining windows are skipped
+  if (NT_SUCCESS(scan->Status))
+  {
+    scan->Status = KmAppendCapture(scan->Writer, scan->Region, base, bytes, owned);
+  }
+}
+
+static
+NTSTATUS
+KmResetScanSession(
+  PSCAN_SESSION session)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Drop an unfinished import
+  if (session->Import)
+  {
+    KmDiscardResultGeneration(&session->History, session->Import);
+    session->Import = NULL;
+  }
+
+  // Free snapshot pages in bulk
+  status = KmResetSnapshotStore(&session->Snapshot);
+
+  // Free result generations in bulk
+  status = KmResetResultHistory(&session->History);
+
+  // Forget tracked writes
+  KmInvalidateDirtySource(&session->Dirty);
+
+  return status;
+}
+
+static
+VOID
+KmLockScanSession(
+  PSCAN_SESSION session)
+{
+  // Requests on the same handle are serialized, other sessions run in parallel
+  KeEnterCriticalRegion();
+  ExAcquireResourceExclusiveLite(&session->Lock, TRUE);
+}
+
+static
+VOID
+KmUnlockScanSession(
+  PSCAN_SESSION session)
+{
+  ExReleaseResourceLite(&session->Lock);
+  KeLeaveCriticalRegion();
+}
+
+static
+VOID
+KmWriteScanSummary(
+  PSCAN_SESSION session,
+  PSCAN_SUMMARY summary)
+{
+  PRESULT_STORE results = KmGetCurrentResults(&session->History);
+  summary->Results = results->Count;
+  summary->Candidates = KmIsSnapshotActive(&session->Snapshot) ? session->Snapshot.Candidates : results->Count;
+  summary->Bytes = session->History.Bytes + session->Snapshot.Bytes;
+  summary->ValueSize = results->ValueSize;
+}
+
+static
+NTSTATUS
+KmOpenScanSource(
+  PSCAN_SESSION session,
+  DWORD32 pid,
+  PMEMORY_SOURCE* source)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Sessions bound to a capture ignore the process id
+  *source = &session->Capture;
+  if (KmIsCaptureSource(&session->Capture) == FALSE)
+  {
+    *source = &session->Live;
+    status = KmOpenProcessSource(&session->Live, pid);
+  }
+
+  return status;
+}
+
+static
+VOID
+KmCloseScanSource(
+  PSCAN_SESSION session,
+  PMEMORY_SOURCE source)
+{
+  // Captures stay mapped until the session is bound to another source
+  if (source == &session->Live)
+  {
+    KmCloseMemorySource(source);
+  }
+}
+
+static
+NTSTATUS
+KmScanProcessExact(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_FIRST request)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Allocate buffer to hold bytes while attached to process
+  PBYTE buffer = ExAllocatePoolWithTag(NonPagedPool, request->Size, KM_MEMORY_POOL_TAG);
+  if (buffer)
+  {
+    // Copy bytes into buffer
+    RtlCopyMemory(buffer, request->Buffer, request->Size);
+
+    // Validate type, value and compare options once before spawning workers
+    SCAN_COMPARE compare;
+    status = KmBeginScanCompare(&compare, request->Type, request->Filter, request->Alignment, request->Rounding, request->Tolerance, request->Case, buffer, request->Size);
+    if (NT_SUCCESS(status))
+    {
+      KmEndCompare(&compare);
+
+      // Store matched values next to their addresses, patterns, text and groups keep addresses only
+      DWORD32 width = KmGetCompareWidth(request->Type);
+
+      // Results of this scan form a new generation
+      PRESULT_STORE results = NULL;
+      status = KmBeginResultGeneration(&session->History, width, &results);
+
+      // Open the process or capture the session is bound to
+      PMEMORY_SOURCE source = NULL;
+      if (NT_SUCCESS(status))
+      {
+        status = KmOpenScanSource(session, request->Pid, &source);
+      }
+      if (NT_SUCCESS(status))
+      {
+        // Setup shared worker state
+        SCAN_WORKER worker;
+        worker.Session = session;
+        worker.Source = source;
+        worker.Type = request->Type;
+        worker.Filter = request->Filter;
+        worker.Alignment = request->Alignment;
+        worker.Rounding = request->Rounding;
+        worker.Tolerance = request->Tolerance;
+        worker.Case = request->Case;
+        worker.Value = buffer;
+        worker.Size = request->Size;
+        KmInitializeScanWork(&worker.Work, width);
+
+        // Attach to memory source
+        KAPC_STATE apc;
+        KmAttachMemorySource(source, &apc);
+
+        // Setup memory information
+        MEMORY_BASIC_INFORMATION mbi;
+        mbi.BaseAddress = (PVOID)max(request->Base, request->Regions.Start);
+        DWORD64 end = request->Regions.End ? request->Regions.End : MAXULONG64;
+
+        // Partition selected process memory regions into work items, nothing gets mapped before
+        while (NT_SUCCESS(status) && (DWORD64)mbi.BaseAddress < end && NT_SUCCESS(KmQueryMemorySource(source, (DWORD64)mbi.BaseAddress, &mbi)))
+        {
+          DWORD64 regionBase;
+          DWORD64 regionSize;
+          if (KmSelectScanRegion(&request->Regions, &mbi, &regionBase, &regionSize))
+          {
+            status = KmAppendScanWork(&worker.Work, regionBase, regionSize);
+          }
+
+          // Jump to next region
+          mbi.BaseAddress = (PVOID)((DWORD64)mbi.BaseAddress + mbi.RegionSize);
+        }
+
+        // Track writes from before the first page is read
+        KmAdvanceDirtySource(&session->Dirty);
+
+        // Detach from memory source
+        KmDetachMemorySource(source, &apc);
+
+        if (NT_SUCCESS(status))
+        {
+          // Work items are the unit of progress
+          session->Progress.RegionCount = worker.Work.Count;
+
+          // Scan work items concurrently
+          KmRunScanWorkers(KmScanExactWorker, &worker);
+
+          // Merge private results, next scans and page batching rely on unique addresses in order
+          KmMergeScanWork(&worker.Work, results);
+          status = KmSortResultStore(results);
+        }
+
+        // Free work items
+        KmFreeScanWork(&worker.Work);
+
+        // Release memory source
+        KmCloseScanSource(session, source);
+      }
+
+      // Keep generation only if the scan went through
+      if (results && NT_SUCCESS(status))
+      {
+        KmCommitResultGeneration(&session->History, results);
+      }
+      else if (results)
+      {
+        KmDiscardResultGeneration(&session->History, results);
+      }
+    }
+
+    // Free buffer
+    ExFreePoolWithTag(buffer, KM_MEMORY_POOL_TAG);
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanPointerMap(
+  PSCAN_SESSION session,
+  PSCAN_POINTERS request)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Pointers are stored next to their targets
+  PRESULT_STORE results = NULL;
+  status = KmBeginResultGeneration(&session->History, sizeof(DWORD64), &results);
+
+  // Open the process or capture the session is bound to
+  PMEMORY_SOURCE source = NULL;
+  if (NT_SUCCESS(status))
+  {
+    status = KmOpenScanSource(session, request->Pid, &source);
+  }
+  if (NT_SUCCESS(status))
+  {
+    // Setup shared worker state
+    POINTER_RANGES ranges;
+    status = KmInitializePointerRanges(&ranges);
+    POINTER_WORKER worker;
+    worker.Session = session;
+    worker.Source = source;
+    worker.Ranges = &ranges;
+    KmInitializeScanWork(&worker.Work, sizeof(DWORD64));
+
+    // Attach to memory source
+    KAPC_STATE apc;
+    KmAttachMemorySource(source, &apc);
+
+    // Setup memory information
+    MEMORY_BASIC_INFORMATION mbi;
+    mbi.BaseAddress = NULL;
+    DWORD64 begin = request->Base & ~(DWORD64)(sizeof(DWORD64) - 1);
+    DWORD64 end = request->Size ? (request->Base + request->Size) : MAXULONG64;
+
+    // Every committed region is a valid target, only readable ones inside the requested range are scanned
+    while (NT_SUCCESS(status) && NT_SUCCESS(KmQueryMemorySource(source, (DWORD64)mbi.BaseAddress, &mbi)))
+    {
+      if (mbi.State == MEM_COMMIT)
+      {
+        status = KmAppendPointerRange(&ranges, (DWORD64)mbi.BaseAddress, mbi.RegionSize);
+      }
+
+      // Skip no-access and guard pages
+      DWORD64 regionBase = max((DWORD64)mbi.BaseAddress, begin);
+      DWORD64 regionEnd = min((DWORD64)mbi.BaseAddress + mbi.RegionSize, end);
+      if (NT_SUCCESS(status) && regionBase < regionEnd && mbi.State == MEM_COMMIT && mbi.Protect != PAGE_NOACCESS && (mbi.Protect & PAGE_GUARD) == FALSE)
+      {
+        status = KmAppendScanWork(&worker.Work, regionBase, regionEnd - regionBase);
+      }
+
+      // Jump to next region
+      mbi.BaseAddress = (PVOID)((DWORD64)mbi.BaseAddress + mbi.RegionSize);
+    }
+
+    // Detach from memory source
+    KmDetachMemorySource(source, &apc);
+
+    if (NT_SUCCESS(status))
+    {
+      // Work items are the unit of progress
+      session->Progress.RegionCount = worker.Work.Count;
+
+      // Scan work items concurrently
+      KmRunScanWorkers(KmScanPointerWorker, &worker);
+
+      // Merge private results, next scans and page batching rely on unique addresses in order
+      KmMergeScanWork(&worker.Work, results);
+      status = KmSortResultStore(results);
+    }
+
+    // Free work items and ranges
+    KmFreeScanWork(&worker.Work);
+    KmFreePointerRanges(&ranges);
+
+    // Release memory source
+    KmCloseScanSource(session, source);
+  }
+
+  // Keep generation only if the scan went through
+  if (results && NT_SUCCESS(status))
+  {
+    KmCommitResultGeneration(&session->History, results);
+  }
+  else if (results)
+  {
+    KmDiscardResultGeneration(&session->History, results);
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanProcessUnknown(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_FIRST request)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  // Validate type and alignment
+  DWORD32 width = KmGetCompareWidth(request->Type);
+  DWORD32 stride = KmGetCompareAlignment(request->Type, request->Alignment);
+  if (width && stride)
+  {
+    // Allocate reusable mapping window
+    MEMORY_WINDOW window;
+    status = KmInitializeMemoryWindow(&window, KM_SCAN_WINDOW_SIZE);
+    if (NT_SUCCESS(status))
+    {
+      // Snapshot pages instead of addresses
+      status = KmInitializeSnapshotStore(&session->Snapshot, width, stride);
+      if (NT_SUCCESS(status))
+      {
+        // Open the process or capture the session is bound to
+        PMEMORY_SOURCE source = NULL;
+        status = KmOpenScanSource(session, request->Pid, &source);
+        if (NT_SUCCESS(status))
+        {
+          // Attach to memory source
+          KAPC_STATE apc;
+          KmAttachMemorySource(source, &apc);
+
+          // Track writes from before the first page is read
+          KmAdvanceDirtySource(&session->Dirty);
+
+          // Only writable pages can hold values of interest
+          SCAN_REGION_FILTER regions = request->Regions;
+          regions.Flags |= SCAN_REGION_WRITABLE;
+
+          // Setup memory information
+          MEMORY_BASIC_INFORMATION mbi;
+          mbi.BaseAddress = (PVOID)max(request->Base, regions.Start);
+          DWORD64 end = regions.End ? regions.End : MAXULONG64;
+
+          // Iterate selected process memory regions
+          while (KmIsScanCancelled(session) == FALSE && (DWORD64)mbi.BaseAddress < end && NT_SUCCESS(KmQueryMemorySource(source, (DWORD64)mbi.BaseAddress, &mbi)))
+          {
+            DWORD64 regionBase;
+            DWORD64 regionSize;
+            if (KmSelectScanRegion(&regions, &mbi, &regionBase, &regionSize))
+            {
+              KmScanRegionWindowed(session, source, &window, regionBase, regionSize, regionBase + regionSize, 0, KmScanUnknownWindow, &session->Snapshot);
+              KmReportScanProgress(session, 0, 1, 0);
+            }
+
+            // Jump to next region
+            mbi.BaseAddress = (PVOID)((DWORD64)mbi.BaseAddress + mbi.RegionSize);
+          }
+
+          // Detach from memory source
+          KmDetachMemorySource(source, &apc);
+
+          // Release memory source
+          KmCloseScanSource(session, source);
+        }
+      }
+
+      // Free mapping window
+      KmFreeMemoryWindow(&window);
+    }
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanResultsNext(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_NEXT request,
+  PSCAN_OPERAND operand)
+{
+  DWORD32 width = operand->Width;
+  PRESULT_STORE current = KmGetCurrentResults(&session->History);
+  PRESULT_STORE results = NULL;
+
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Allocate page batch
+  SCAN_BATCH batch;
+  batch.Source = NULL;
+  batch.Page = 0;
+  batch.Count = 0;
+  batch.Bases = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD64) * PAGE_SIZE, KM_MEMORY_POOL_TAG);
+  batch.Values = ExAllocatePoolWithTag(NonPagedPool, sizeof(INT64) * PAGE_SIZE, KM_MEMORY_POOL_TAG);
+  batch.Bytes = ExAllocatePoolWithTag(NonPagedPool, PAGE_SIZE * 2, KM_MEMORY_POOL_TAG);
+  if (batch.Bases && batch.Values && batch.Bytes)
+  {
+    // Survivors form a new generation, the current one stays for undo
+    status = KmBeginResultGeneration(&session->History, current->ValueSize, &results);
+  }
+  if (NT_SUCCESS(status))
+  {
+    // Open the process or capture the session is bound to
+    status = KmOpenScanSource(session, request->Pid, &batch.Source);
+    if (NT_SUCCESS(status))
+    {
+      // Attach to memory source
+      KAPC_STATE apc;
+      KmAttachMemorySource(batch.Source, &apc);
+
+      // Collect pages written since the last pass and track the ones written from now on
+      KmAdvanceDirtySource(&session->Dirty);
+
+      // Chunks whose results all survive unchanged are shared with the current generation
+      RESULT_WRITER writer;
+      KmBeginDerivation(results, &writer);
+
+      // Walk results in address order
+      PLIST_ENTRY listEntry = current->Chunks.Flink;
+      while (listEntry != &current->Chunks)
+      {
+        PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+        DWORD32 chunkCount = chunk->Count;
+        KmDeriveChunk(&writer, chunk);
+        for (DWORD32 i = 0; i < chunkCount; i++)
+        {
+          // Flush batch once the candidate leaves the current page
+          DWORD64 page = (DWORD64)PAGE_ALIGN(chunk->Bases[i]);
+          if (batch.Count > 0 && batch.Page != page)
+          {
+            KmFlushScanBatch(session, &batch, &writer, operand);
+          }
+
+          // Queue candidate with its previous value
+          batch.Page = page;
+          batch.Bases[batch.Count] = chunk->Bases[i];
+          RtlCopyMemory(batch.Values + (SIZE_T)batch.Count * width, chunk->Values + (SIZE_T)i * width, width);
+          batch.Count++;
+        }
+
+        // Batches never span chunks so survivors are attributed to their source chunk
+        if (batch.Count > 0)
+        {
+          KmFlushScanBatch(session, &batch, &writer, operand);
+        }
+        listEntry = listEntry->Flink;
+      }
+
+      // Seal last chunk
+      status = KmEndDerivation(&writer);
+
+      // Detach from memory source
+      KmDetachMemorySource(batch.Source, &apc);
+
+      // Release memory source
+      KmCloseScanSource(session, batch.Source);
+    }
+
+    // Keep generation only if the scan went through
+    if (NT_SUCCESS(status))
+    {
+      KmCommitResultGeneration(&session->History, results);
+    }
+    else
+    {
+      KmDiscardResultGeneration(&session->History, results);
+    }
+  }
+
+  // Free batch
+  if (batch.Bases)
+  {
+    ExFreePoolWithTag(batch.Bases, KM_MEMORY_POOL_TAG);
+  }
+  if (batch.Values)
+  {
+    ExFreePoolWithTag(batch.Values, KM_MEMORY_POOL_TAG);
+  }
+  if (batch.Bytes)
+  {
+    ExFreePoolWithTag(batch.Bytes, KM_MEMORY_POOL_TAG);
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanSnapshotNext(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_NEXT request,
+  PSCAN_OPERAND operand)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Allocate page diff buffers
+  SNAPSHOT_FILTER filter;
+  filter.Session = session;
+  filter.Source = NULL;
+  filter.Operand = operand;
+  filter.Results = NULL;
+  filter.Bytes = ExAllocatePoolWithTag(NonPagedPool, PAGE_SIZE, KM_MEMORY_POOL_TAG);
+  filter.Candidates = ExAllocatePoolWithTag(NonPagedPool, PAGE_SIZE / 8, KM_MEMORY_POOL_TAG);
+  filter.Offsets = ExAllocatePoolWithTag(NonPagedPool, sizeof(DWORD32) * PAGE_SIZE, KM_MEMORY_POOL_TAG);
+  if (filter.Bytes && filter.Candidates && filter.Offsets)
+  {
+    // Open the process or capture the session is bound to
+    status = KmOpenScanSource(session, request->Pid, &filter.Source);
+    if (NT_SUCCESS(status))
+    {
+      // Attach to memory source
+      KAPC_STATE apc;
+      KmAttachMemorySource(filter.Source, &apc);
+
+      // Collect pages written since the last pass and track the ones written from now on
+      KmAdvanceDirtySource(&session->Dirty);
+
+      // Diff snapshot page by page
+      session->Progress.RegionCount = session->Snapshot.PageCount;
+      status = KmVisitSnapshot(&session->Snapshot, KmFilterSnapshotPage, &filter);
+
+      // Detach from memory source
+      KmDetachMemorySource(filter.Source, &apc);
+
+      // Release memory source
+      KmCloseScanSource(session, filter.Source);
+    }
+
+    // Switch to explicit addresses once the candidate set is small, history starts there
+    if (NT_SUCCESS(status) && session->Snapshot.Candidates <= KM_SNAPSHOT_RESULT_LIMIT)
+    {
+      status = KmBeginResultGeneration(&session->History, session->Snapshot.Width, &filter.Results);
+      if (NT_SUCCESS(status))
+      {
+        status = KmVisitSnapshot(&session->Snapshot, KmMaterializeSnapshotPage, &filter);
+        if (NT_SUCCESS(status))
+        {
+          KmCommitResultGeneration(&session->History, filter.Results);
+        }
+        else
+        {
+          KmDiscardResultGeneration(&session->History, filter.Results);
+        }
+      }
+      KmResetSnapshotStore(&session->Snapshot);
+    }
+  }
+
+  // Free page diff buffers
+  if (filter.Bytes)
+  {
+    ExFreePoolWithTag(filter.Bytes, KM_MEMORY_POOL_TAG);
+  }
+  if (filter.Candidates)
+  {
+    ExFreePoolWithTag(filter.Candidates, KM_MEMORY_POOL_TAG);
+  }
+  if (filter.Offsets)
+  {
+    ExFreePoolWithTag(filter.Offsets, KM_MEMORY_POOL_TAG);
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanProcessFirst(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_FIRST request,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+  // Lock session
+  KmLockScanSession(session);
+
+  __try
+  {
+    // Reset scan results
+    status = KmResetScanSession(session);
+    if (NT_SUCCESS(status))
+    {
+      // Next scans interpret values by the type of the first scan
+      session->Type = request->Type;
+
+      // Unknown initial values are tracked by page snapshots
+      if (request->Filter == SCAN_FILTER_UNKNOWN)
+      {
+        status = KmScanProcessUnknown(session, request);
+      }
+      else
+      {
+        status = KmScanProcessExact(session, request);
+      }
+
+      // Partial scans keep values older than the tracked interval
+      if (NT_SUCCESS(status) == FALSE || session->Cancel)
+      {
+        KmInvalidateDirtySource(&session->Dirty);
+      }
+
+      // Write scan summary
+      KmWriteScanSummary(session, summary);
+    }
+  }
+  __except (EXCEPTION_EXECUTE_HANDLER)
+  {
+    KD_LOG("Something went wrong\n");
+    status = STATUS_UNHANDLED_EXCEPTION;
+  }
+
+  // Unlock session
+  KmUnlockScanSession(session);
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanProcessNext(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_NEXT request,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  // Lock session
+  KmLockScanSession(session);
+
+  __try
+  {
+    // Snapshots keep the width of the first scan
+    BOOLEAN snapshot = KmIsSnapshotActive(&session->Snapshot);
+    DWORD32 width = snapshot ? session->Snapshot.Width : KmGetCurrentResults(&session->History)->ValueSize;
+
+    // Unknown values can only be filtered by the first scan
+    if (request->Filter == SCAN_FILTER_UNKNOWN)
+    {
+      width = 0;
+    }
+
+    // Filter either snapshot pages or explicit results
+    SCAN_OPERAND operand;
+    if (width && NT_SUCCESS(KmPrepareScanOperand(session, request, width, &operand)))
+    {
+      if (snapshot)
+      {
+        status = KmScanSnapshotNext(session, request, &operand);
+      }
+      else
+      {
+        status = KmScanResultsNext(session, request, &operand);
+      }
+
+      // Release predicate kernel
+      KmReleaseScanOperand(&operand);
+
+      // Partial scans keep values older than the tracked interval
+      if (NT_SUCCESS(status) == FALSE || session->Cancel)
+      {
+        KmInvalidateDirtySource(&session->Dirty);
+      }
+    }
+
+    // Write scan summary
+    KmWriteScanSummary(session, summary);
+  }
+  __except (EXCEPTION_EXECUTE_HANDLER)
+  {
+    KD_LOG("Something went wrong\n");
+    status = STATUS_UNHANDLED_EXCEPTION;
+  }
+
+  // Unlock session
+  KmUnlockScanSession(session);
+
+  return status;
+}
+
+static
+NTSTATUS
+KmScanProcessPointers(
+  PSCAN_SESSION session,
+  PSCAN_POINTERS request,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+  // Lock session
+  KmLockScanSession(session);
+
+  __try
+  {
+    // Pointer maps replace previous scan results
+    status = KmResetScanSession(session);
+    if (NT_SUCCESS(status))
+    {
+      // Targets can be refined by next scans as plain qwords
+      session->Type = SCAN_TYPE_BYTE64;
+      status = KmScanPointerMap(session, request);
+
+      // Write scan summary
+      KmWriteScanSummary(session, summary);
+    }
+  }
+  __except (EXCEPTION_EXECUTE_HANDLER)
+  {
+    KD_LOG("Something went wrong\n");
+    status = STATUS_UNHANDLED_EXCEPTION;
+  }
+
+  // Unlock session
+  KmUnlockScanSession(session);
+
+  return status;
+}
+
+static
+NTSTATUS
+KmCaptureProcessMemory(
+  PSCAN_SESSION session,
+  PSCAN_CAPTURE request,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+  // Lock session
+  KmLockScanSession(session);
+
+  __try
+  {
+    // Allocate reusable mapping window
+    MEMORY_WINDOW window;
+    status = KmInitializeMemoryWindow(&window, KM_SCAN_WINDOW_SIZE);
+    if (NT_SUCCESS(status))
+    {
+      // Search process by process id
+      MEMORY_SOURCE source;
+      status = KmOpenProcessSource(&source, request->Pid);
+      if (NT_SUCCESS(status))
+      {
+        // Create the file before attaching, the kernel handle stays valid in the target
+        CAPTURE_WRITER writer;
+        request->Path[MEMORY_CAPTURE_MAX_PATH - 1] = L'\0';
+        status = KmBeginCapture(&writer, request->Path, request->Pid);
+        if (NT_SUCCESS(status))
+        {
+          // Attach to memory source
+          KAPC_STATE apc;
+          KmAttachMemorySource(&source, &apc);
+
+          // Setup memory information
+          MEMORY_BASIC_INFORMATION mbi;
+          mbi.BaseAddress = (PVOID)request->Regions.Start;
+          DWORD64 end = request->Regions.End ? request->Regions.End : MAXULONG64;
+
+          // Copy selected regions window wise, unreadable pages split them
+          CAPTURE_SCAN scan;
+          scan.Writer = &writer;
+          scan.Region = &mbi;
+          scan.Status = STATUS_SUCCESS;
+          while (NT_SUCCESS(scan.Status) && KmIsScanCancelled(session) == FALSE && (DWORD64)mbi.BaseAddress < end && NT_SUCCESS(KmQueryMemorySource(&source, (DWORD64)mbi.BaseAddress, &mbi)))
+          {
+            DWORD64 regionBase;
+            DWORD64 regionSize;
+            if (KmSelectScanRegion(&request->Regions, &mbi, &regionBase, &regionSize))
+            {
+              KmScanRegionWindowed(session, &source, &window, regionBase, regionSize, regionBase + regionSize, 0, KmCaptureWindow, &scan);
+              KmReportScanProgress(session, 0, 1, 0);
+            }
+
+            // Jump to next region
+            mbi.BaseAddress = (PVOID)((DWORD64)mbi.BaseAddress + mbi.RegionSize);
+          }
+
+          // Detach from memory source
+          KmDetachMemorySource(&source, &apc);
+
+          // Cancelled captures are incomplete and keep an invalid header
+          if (NT_SUCCESS(scan.Status) && KmIsScanCancelled(session))
+          {
+            scan.Status = STATUS_CANCELLED;
+          }
+
+          // Write region table and header, the client reads the outcome from the file
+          MEMORY_CAPTURE capture;
+          status = KmEndCapture(&writer, scan.Status, &capture);
+        }
+
+        // Release memory source
+        KmCloseMemorySource(&source);
+      }
+
+      // Free mapping window
+      KmFreeMemoryWindow(&window);
+    }
+
+    // Captures leave the session results untouched
+    KmWriteScanSummary(session, summary);
+  }
+  __except (EXCEPTION_EXECUTE_HANDLER)
+  {
+    KD_LOG("Something went wrong\n");
+    status = STATUS_UNHANDLED_EXCEPTION;
+  }
+
+  // Unlock session
+  KmUnlockScanSession(session);
+
+  return status;
+}
+
+static
+NTSTATUS
+KmResolveSignatures(
+  PSCAN_SESSION session,
+  PSCAN_SIGNATURES request,
+  PSIGNATURE_SET set)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Validate signature set
+  SIGNATURE_MATCHER matcher;
+  status = KmInitializeSignatureMatcher(&matcher, set, request->SetSize);
+  if (NT_SUCCESS(status))
+  {
+    // Signatures are resolved in live processes only
+    MEMORY_SOURCE source;
+    status = KmOpenProcessSource(&source, request->Pid);
+    if (NT_SUCCESS(status))
+    {
+      // Setup shared worker state, results carry their signature index
+      SIGNATURE_WORKER worker;
+      worker.Session = session;
+      worker.Source = &source;
+      worker.Matcher = &matcher;
+      KmInitializeScanWork(&worker.Work, sizeof(DWORD32));
+
+      // Attach to memory source
+      KAPC_STATE apc;
+      KmAttachMemorySource(&source, &apc);
+
+      // Setup memory information
+      MEMORY_BASIC_INFORMATION mbi;
+      mbi.BaseAddress = (PVOID)request->Base;
+      DWORD64 end = request->Size ? (request->Base + request->Size) : MAXULONG64;
+
+      // Partition process memory regions inside the requested range into work items
+      while (NT_SUCCESS(status) && (DWORD64)mbi.BaseAddress < end && NT_SUCCESS(KmQueryMemorySource(&source, (DWORD64)mbi.BaseAddress, &mbi)))
+      {
+        // Skip non-committed, no-access and guard pages
+        if (mbi.State == MEM_COMMIT && mbi.Protect != PAGE_NOACCESS && (mbi.Protect & PAGE_GUARD) == FALSE)
+        {
+          DWORD64 regionBase = max((DWORD64)mbi.BaseAddress, request->Base);
+          DWORD64 regionEnd = min((DWORD64)mbi.BaseAddress + mbi.RegionSize, end);
+          status = KmAppendScanWork(&worker.Work, regionBase, regionEnd - regionBase);
+          KmReportScanProgress(session, 0, 1, 0);
+        }
+
+        // Jump to next region
+        mbi.BaseAddress = (PVOID)((DWORD64)mbi.BaseAddress + mbi.RegionSize);
+      }
+
+      // Detach from memory source
+      KmDetachMemorySource(&source, &apc);
+
+      if (NT_SUCCESS(status))
+      {
+        // Scan work items concurrently
+        KmRunScanWorkers(KmScanSignatureWorker, &worker);
+
+        // Merge private results in address order
+        RESULT_STORE results;
+        KmInitializeResultStore(&results, sizeof(DWORD32));
+        KmMergeScanWork(&worker.Work, &results);
+
+        // Keep at most limit matches per signature, the first pass only counts them
+        PDWORD32 counts = ExAllocatePoolWithTag(PagedPool, sizeof(DWORD32) * max(set->SignatureCount, 1), KM_MEMORY_POOL_TAG);
+        if (counts)
+        {
+          for (DWORD32 pass = 0; pass < 2 && NT_SUCCESS(status); pass++)
+          {
+            RtlZeroMemory(counts, sizeof(DWORD32) * max(set->SignatureCount, 1));
+            DWORD32 count = 0;
+            PLIST_ENTRY listEntry = results.Chunks.Flink;
+            while (listEntry != &results.Chunks)
+            {
+              PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+              for (DWORD32 i = 0; i < chunk->Count; i++)
+              {
+                DWORD32 signature = ((PDWORD32)chunk->Values)[i];
+                if (request->Limit == 0 || counts[signature] < request->Limit)
+                {
+                  if (session->Matches)
+                  {
+                    session->Matches[count].Signature = signature;
+                    session->Matches[count].Address = chunk->Bases[i];
+                  }
+                  counts[signature]++;
+                  count++;
+                }
+              }
+              listEntry = listEntry->Flink;
+            }
+
+            // Allocate matches once their number is known
+            if (pass == 0 && count)
+            {
+              session->Matches = ExAllocatePoolWithTag(PagedPool, sizeof(SIGNATURE_MATCH) * count, KM_MEMORY_POOL_TAG);
+              status = session->Matches ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+            }
+            session->MatchCount = session->Matches ? count : 0;
+          }
+          ExFreePoolWithTag(counts, KM_MEMORY_POOL_TAG);
+        }
+        else
+        {
+          status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        // Free merged results
+        KmResetResultStore(&results);
+      }
+
+      // Free work items
+      KmFreeScanWork(&worker.Work);
+
+      // Release memory source
+      KmCloseMemorySource(&source);
+    }
+
+    // Free key bitmap
+    KmFreeSignatureMatcher(&matcher);
+  }
+
+  return status;
+}
+
+static
+VOID
+KmFreeSignatureMatches(
+  PSCAN_SESSION session)
+{
+  // Drop matches of the previous signature scan
+  if (session->Matches)
+  {
+    ExFreePoolWithTag(session->Matches, KM_MEMORY_POOL_TAG);
+    session->Matches = NULL;
+  }
+  session->MatchCount = 0;
+}
+
+static
+NTSTATUS
+KmScanProcessSignatures(
+  PSCAN_SESSION session,
+  PSCAN_SIGNATURES request,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+  // Lock session
+  KmLockScanSession(session);
+
+  __try
+  {
+    // Matches replace those of the previous signature scan, cancelled scans keep none
+    KmFreeSignatureMatches(session);
+    status = KmResolveSignatures(session, request, (PSIGNATURE_SET)request->Set);
+    if (NT_SUCCESS(status) == FALSE || KmIsScanCancelled(session))
+    {
+      KmFreeSignatureMatches(session);
+    }
+
+    // Signature scans leave the session results untouched
+    KmWriteScanSummary(session, summary);
+  }
+  __except (EXCEPTION_EXECUTE_HANDLER)
+  {
+    KD_LOG("Something went wrong\n");
+    status = STATUS_UNHANDLED_EXCEPTION;
+  }
+
+  // Unlock session
+  KmUnlockScanSession(session);
+
+  return status;
+}
+
+static
+VOID
+KmFreeScanJob(
+  PSCAN_JOB job)
+{
+  // Free value copy
+  if (job->Value)
+  {
+    ExFreePoolWithTag(job->Value, KM_MEMORY_POOL_TAG);
+    job->Value = NULL;
+  }
+
+  // Free signature set copy
+  if (job->Set)
+  {
+    ExFreePoolWithTag(job->Set, KM_MEMORY_POOL_TAG);
+    job->Set = NULL;
+  }
+}
 
-///////////////////////////////////////////////////////////
-// Scanner data types
-///////////////////////////////////////////////////////////
+static
+VOID
+KmRunScanJob(
+  PVOID context)
+{
+  PSCAN_SESSION session = (PSCAN_SESSION)context;
+  PSCAN_JOB job = &session->Job;
+
+  // Run scan to completion, cancelled scans keep their partial results
+  SCAN_SUMMARY summary = { 0 };
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+  switch (job->Type)
+  {
+    case SCAN_JOB_FIRST: status = KmScanProcessFirst(session, &job->FirstRequest, &summary); break;
+    case SCAN_JOB_NEXT: status = KmScanProcessNext(session, &job->NextRequest, &summary); break;
+    case SCAN_JOB_POINTERS: status = KmScanProcessPointers(session, &job->PointerRequest, &summary); break;
+    case SCAN_JOB_CAPTURE: status = KmCaptureProcessMemory(session, &job->CaptureRequest, &summary); break;
+    case SCAN_JOB_SIGNATURES: status = KmScanProcessSignatures(session, &job->SignatureRequest, &summary); break;
+  }
+
+  // Publish outcome before releasing the session to the next scan
+  session->Progress.Summary = summary;
+  session->Progress.Status = status;
+  if (session->Cancel)
+  {
+    session->Progress.State = SCAN_STATE_CANCELLED;
+  }
+  else
+  {
+    session->Progress.State = NT_SUCCESS(status) ? SCAN_STATE_DONE : SCAN_STATE_FAILED;
+  }
+
+  // Free request copies
+  KmFreeScanJob(job);
+
+  InterlockedExchange(&session->Busy, FALSE);
+
+  PsTerminateSystemThread(status);
+}
+
+static
+VOID
+KmJoinScanJob(
+  PSCAN_SESSION session)
+{
+  // Wait for the previous worker thread to exit
+  if (session->Thread)
+  {
+    KeWaitForSingleObject(session->Thread, Executive, KernelMode, FALSE, NULL);
+    ObDereferenceObject(session->Thread);
+    session->Thread = NULL;
+  }
+}
 
-typedef struct _SCAN_ENTRY
+static
+NTSTATUS
+KmStartScanJob(
+  PSCAN_SESSION session,
+  PVOID* buffer,
+  DWORD32 size)
 {
-  LIST_ENTRY List;
-  DWORD64 Base;
-} SCAN_ENTRY, * PSCAN_ENTRY;
+  NTSTATUS status = STATUS_SUCCESS;
+
+  KmJoinScanJob(session);
+
+  // Copy value out of the caller, the worker runs in the system process
+  session->Job.Value = NULL;
+  if (size > KM_PATTERN_MAX_LENGTH)
+  {
+    status = STATUS_INVALID_PARAMETER;
+  }
+  else if (size)
+  {
+    session->Job.Value = ExAllocatePoolWithTag(NonPagedPool, size, KM_MEMORY_POOL_TAG);
+    status = session->Job.Value ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+    if (NT_SUCCESS(status))
+    {
+      status = KmReadUserBuffer(session->Job.Value, *buffer, size);
+    }
+  }
+  *buffer = session->Job.Value;
+
+  if (NT_SUCCESS(status))
+  {
+    // Reset progress
+    RtlZeroMemory(&session->Progress, sizeof(SCAN_PROGRESS));
+    session->Progress.State = SCAN_STATE_RUNNING;
+    session->Cancel = FALSE;
+
+    // Start worker thread, its handle stays out of the caller's handle table
+    OBJECT_ATTRIBUTES attributes;
+    InitializeObjectAttributes(&attributes, NULL, OBJ_KERNEL_HANDLE, NULL, NULL);
+    HANDLE thread;
+    status = PsCreateSystemThread(&thread, THREAD_ALL_ACCESS, &attributes, NULL, NULL, KmRunScanJob, session);
+    if (NT_SUCCESS(status))
+    {
+      status = ObReferenceObjectByHandle(thread, SYNCHRONIZE, *PsThreadType, KernelMode, (PVOID*)&session->Thread, NULL);
+      if (NT_SUCCESS(status) == FALSE)
+      {
+        // The worker can not be joined later, let it finish before the job is failed
+        ZwWaitForSingleObject(thread, FALSE, NULL);
+        session->Thread = NULL;
+      }
+      ZwClose(thread);
+    }
+    if (NT_SUCCESS(status) == FALSE)
+    {
+      session->Progress.State = SCAN_STATE_FAILED;
+      session->Progress.Status = status;
+    }
+  }
+
+  // Release session again if the worker could not be started
+  if (NT_SUCCESS(status) == FALSE)
+  {
+    KmFreeScanJob(&session->Job);
+    InterlockedExchange(&session->Busy, FALSE);
+  }
+
+  return status;
+}
 
 ///////////////////////////////////////////////////////////
 // Scanner API
 ///////////////////////////////////////////////////////////
 
 NTSTATUS
-KmInitializeScanList()
+KmCreateScanSession(
+  PSCAN_SESSION* session)
 {
-  NTSTATUS status = STATUS_SUCCESS;
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Sessions hold an executive resource and therefore live in non paged pool
+  *session = ExAllocatePoolWithTag(NonPagedPool, sizeof(SCAN_SESSION), KM_MEMORY_POOL_TAG);
+  if (*session)
+  {
+    RtlZeroMemory(*session, sizeof(SCAN_SESSION));
+    status = ExInitializeResourceLite(&(*session)->Lock);
+    if (NT_SUCCESS(status))
+    {
+      // Reset scan results
+      status = KmInitializeResultHistory(&(*session)->History);
+
+      // Live processes have no write tracking, sessions read every page until bound to a capture
+      KmInitializeDirtySource(&(*session)->Dirty, NULL, NULL, NULL);
+    }
+    else
+    {
+      ExFreePoolWithTag(*session, KM_MEMORY_POOL_TAG);
+      *session = NULL;
+    }
+  }
 
-  // Reset scan list
-  InitializeListHead(&g_scans);
+  return status;
+}
+
+VOID
+KmFreeScanSession(
+  PSCAN_SESSION session)
+{
+  // Abort running scan and wait for its worker
+  InterlockedExchange(&session->Cancel, TRUE);
+  KmJoinScanJob(session);
+
+  // Free snapshot pages and result chunks in bulk
+  KmResetScanSession(session);
+
+  // Unmap bound capture
+  KmCloseMemorySource(&session->Capture);
+
+  // Free signature matches
+  KmFreeSignatureMatches(session);
+
+  // Free session
+  ExDeleteResourceLite(&session->Lock);
+  ExFreePoolWithTag(session, KM_MEMORY_POOL_TAG);
+}
+
+NTSTATUS
+KmStartScanFirst(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_FIRST request)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
 
-  // Reset scan count
-  g_scanCount = 0;
+  // Only one scan runs per session at a time
+  if (InterlockedCompareExchange(&session->Busy, TRUE, FALSE) == FALSE)
+  {
+    session->Job.Type = SCAN_JOB_FIRST;
+    session->Job.FirstRequest = *request;
+    status = KmStartScanJob(session, &session->Job.FirstRequest.Buffer, request->Size);
+  }
 
   return status;
 }
 
 NTSTATUS
-KmResetScanList()
+KmStartScanNext(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_NEXT request)
 {
-  NTSTATUS status = STATUS_SUCCESS;
+  NTSTATUS status = STATUS_DEVICE_BUSY;
 
-  // Free entries
-  while (IsListEmpty(&g_scans) == FALSE)
+  // Only one scan runs per session at a time
+  if (InterlockedCompareExchange(&session->Busy, TRUE, FALSE) == FALSE)
   {
-    PLIST_ENTRY listEntry = RemoveHeadList(&g_scans);
-    PSCAN_ENTRY scanEntry = CONTAINING_RECORD(listEntry, SCAN_ENTRY, List);
-    ExFreePoolWithTag(scanEntry, KM_MEMORY_POOL_TAG);
+    session->Job.Type = SCAN_JOB_NEXT;
+    session->Job.NextRequest = *request;
+    status = KmStartScanJob(session, &session->Job.NextRequest.Buffer, request->Size);
   }
 
-  // Reset scan list
-  InitializeListHead(&g_scans);
+  return status;
+}
+
+NTSTATUS
+KmStartScanPointers(
+  PSCAN_SESSION session,
+  PSCAN_POINTERS request)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
 
-  // Reset scan count
-  g_scanCount = 0;
+  // Only one scan runs per session at a time
+  if (InterlockedCompareExchange(&session->Busy, TRUE, FALSE) == FALSE)
+  {
+    PVOID buffer = NULL;
+    session->Job.Type = SCAN_JOB_POINTERS;
+    session->Job.PointerRequest = *request;
+    status = KmStartScanJob(session, &buffer, 0);
+  }
 
   return status;
 }
 
 NTSTATUS
-KmScanProcessFirst(
-  PSCAN_PROCESS_FIRST request,
-  PDWORD32 count)
+KmStartScanCapture(
+  PSCAN_SESSION session,
+  PSCAN_CAPTURE request)
 {
-  NTSTATUS status = STATUS_UNSUCCESSFUL;
+  NTSTATUS status = STATUS_DEVICE_BUSY;
 
-  __try
+  // Only one scan runs per session at a time
+  if (InterlockedCompareExchange(&session->Busy, TRUE, FALSE) == FALSE)
   {
-    // Reset scan results
-    status = KmResetScanList();
+    PVOID buffer = NULL;
+    session->Job.Type = SCAN_JOB_CAPTURE;
+    session->Job.CaptureRequest = *request;
+    status = KmStartScanJob(session, &buffer, 0);
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmStartScanSignatures(
+  PSCAN_SESSION session,
+  PSCAN_SIGNATURES request)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  // Only one scan runs per session at a time
+  if (InterlockedCompareExchange(&session->Busy, TRUE, FALSE) == FALSE)
+  {
+    session->Job.Type = SCAN_JOB_SIGNATURES;
+    session->Job.SignatureRequest = *request;
+
+    // Copy signature set out of the caller, the worker runs in the system process
+    status = STATUS_INVALID_PARAMETER;
+    if (request->SetSize >= sizeof(SIGNATURE_SET) && request->SetSize <= KM_SIGNATURE_MAX_SET_SIZE)
+    {
+      session->Job.Set = ExAllocatePoolWithTag(PagedPool, request->SetSize, KM_MEMORY_POOL_TAG);
+      status = session->Job.Set ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES;
+    }
     if (NT_SUCCESS(status))
     {
-      // Allocate buffer to hold bytes while attached to process
-      PBYTE buffer = ExAllocatePoolWithTag(NonPagedPool, request->Size, KM_MEMORY_POOL_TAG);
-      if (buffer)
-      {
-        // Copy bytes into buffer
-        RtlCopyMemory(buffer, request->Buffer, request->Size);
+      status = KmReadUserBuffer(session->Job.Set, request->Set, request->SetSize);
+      session->Job.SignatureRequest.Set = session->Job.Set;
+    }
 
-        // Search process by process id
-        PEPROCESS process;
-        status = PsLookupProcessByProcessId((HANDLE)request->Pid, &process);
-        if (NT_SUCCESS(status))
-        {
-          // Attach to process
-          KAPC_STATE apc;
-          KeStackAttachProcess(process, &apc);
+    if (NT_SUCCESS(status))
+    {
+      PVOID buffer = NULL;
+      status = KmStartScanJob(session, &buffer, 0);
+    }
+    else
+    {
+      // Release session again, no worker was started
+      KmFreeScanJob(&session->Job);
+      InterlockedExchange(&session->Busy, FALSE);
+    }
+  }
 
-          // Setup memory information
-          MEMORY_BASIC_INFORMATION mbi;
-          mbi.BaseAddress = (PVOID)request->Base;
+  return status;
+}
 
-          // Iterate process memory regions
-          while (NT_SUCCESS(ZwQueryVirtualMemory(ZwCurrentProcess(), mbi.BaseAddress, MemoryBasicInformation, &mbi, sizeof(mbi), NULL)))
-          {
-            // Skip non-committed, no-access and guard pages
-            if (mbi.State == MEM_COMMIT && mbi.Protect != PAGE_NOACCESS && (mbi.Protect & PAGE_GUARD) == FALSE)
-            {
-              // Create MDL for supplied range
-              PMDL mdl = IoAllocateMdl(mbi.BaseAddress, (DWORD32)mbi.RegionSize, FALSE, FALSE, NULL); // TODO: Fix me! (Convert address space to user mode, which is possible since we are attached)
-              if (mdl)
-              {
-                __try
-                {
-                  // Try lock pages
-                  MmProbeAndLockPages(mdl, KernelMode, IoReadAccess);
-                  status = STATUS_SUCCESS;
-                }
-                __except (EXCEPTION_EXECUTE_HANDLER)
-                {
-                  status = STATUS_INVALID_USER_BUFFER;
-                }
+NTSTATUS
+KmQueryScanProgress(
+  PSCAN_SESSION session,
+  PSCAN_PROGRESS progress)
+{
+  // Outcome is final only once the worker released the session
+  BOOLEAN busy = session->Busy != FALSE;
+  RtlCopyMemory(progress, &session->Progress, sizeof(SCAN_PROGRESS));
+  if (busy)
+  {
+    progress->State = SCAN_STATE_RUNNING;
+  }
 
-                if (NT_SUCCESS(status))
-                {
-                  // Remap to system space address
-                  PVOID mapped = MmMapLockedPagesSpecifyCache(mdl, KernelMode, MmNonCached, NULL, FALSE, HighPagePriority);
-                  if (mapped)
-                  {
-                    // Set page protection
-                    status = MmProtectMdlSystemAddress(mdl, PAGE_READONLY);
-                    if (NT_SUCCESS(status))
-                    {
-                      // Scan region
-                      for (DWORD64 base = (DWORD64)mapped; base <= ((DWORD64)mapped + mbi.RegionSize - request->Size); base += request->Size) // TODO: Fix me! (Double check loop range)
-                      {
-                        switch (request->Type)
-                        {
-                          case SCAN_TYPE_BYTE8:
-                          {
-                            if (*(PINT8)base == *(PINT8)buffer)
-                            {
-                              // Insert scan result
-                              PSCAN_ENTRY scanEntry = ExAllocatePoolWithTag(NonPagedPool, sizeof(SCAN_ENTRY), KM_MEMORY_POOL_TAG);
-                              scanEntry->Base = base;
-                              InsertTailList(&g_scans, &scanEntry->List);
-
-                              // Increment scan count
-                              g_scanCount++;
-                            }
-                            break;
-                          }
-                          case SCAN_TYPE_BYTE16:
-                          {
-                            if (*(PINT16)base == *(PINT16)buffer)
-                            {
-                              // Insert scan result
-                              PSCAN_ENTRY scanEntry = ExAllocatePoolWithTag(NonPagedPool, sizeof(SCAN_ENTRY), KM_MEMORY_POOL_TAG);
-                              scanEntry->Base = base;
-                              InsertTailList(&g_scans, &scanEntry->List);
-
-                              // Increment scan count
-                              g_scanCount++;
-                            }
-                            break;
-                          }
-                          case SCAN_TYPE_BYTE32:
-                          {
-                            if (*(PINT32)base == *(PINT32)buffer)
-                            {
-                              // Insert scan result
-                              PSCAN_ENTRY scanEntry = ExAllocatePoolWithTag(NonPagedPool, sizeof(SCAN_ENTRY), KM_MEMORY_POOL_TAG);
-                              scanEntry->Base = base;
-                              InsertTailList(&g_scans, &scanEntry->List);
-
-                              // Increment scan count
-                              g_scanCount++;
-                            }
-                            break;
-                          }
-                          case SCAN_TYPE_BYTE64:
-                          {
-                            if (*(PINT64)base == *(PINT64)buffer)
-                            {
-                              // Insert scan result
-                              PSCAN_ENTRY scanEntry = ExAllocatePoolWithTag(NonPagedPool, sizeof(SCAN_ENTRY), KM_MEMORY_POOL_TAG);
-                              scanEntry->Base = base;
-                              InsertTailList(&g_scans, &scanEntry->List);
-
-                              // Increment scan count
-                              g_scanCount++;
-                            }
-                            break;
-                          }
-                        }
-                      }
-                    }
-
-                    // Unmap locked pages
-                    MmUnmapLockedPages(mapped, mdl);
-                  }
+  return STATUS_SUCCESS;
+}
 
-                  // Unlock MDL
-                  MmUnlockPages(mdl);
-                }
+NTSTATUS
+KmCancelScan(
+  PSCAN_SESSION session)
+{
+  // Workers poll the flag between windows, pages and regions
+  InterlockedExchange(&session->Cancel, TRUE);
 
-                // Free MDL
-                IoFreeMdl(mdl);
-              }
-            }
+  return STATUS_SUCCESS;
+}
 
-            // Jump to next region
-            mbi.BaseAddress = (PVOID)((DWORD64)mbi.BaseAddress + mbi.RegionSize);
-          }
+NTSTATUS
+KmUndoScan(
+  PSCAN_SESSION session,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  // Generations can not be switched while a scan derives a new one
+  if (session->Busy == FALSE)
+  {
+    KmLockScanSession(session);
+
+    // Step back without touching the process, restored values predate the tracked interval
+    status = KmUndoResultGeneration(&session->History);
+    KmInvalidateDirtySource(&session->Dirty);
+    KmWriteScanSummary(session, summary);
+
+    KmUnlockScanSession(session);
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmRedoScan(
+  PSCAN_SESSION session,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  // Generations can not be switched while a scan derives a new one
+  if (session->Busy == FALSE)
+  {
+    KmLockScanSession(session);
+
+    // Step forward without touching the process, restored values predate the tracked interval
+    status = KmRedoResultGeneration(&session->History);
+    KmInvalidateDirtySource(&session->Dirty);
+    KmWriteScanSummary(session, summary);
+
+    KmUnlockScanSession(session);
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmImportScanResults(
+  PSCAN_SESSION session,
+  PSCAN_IMPORT request,
+  PDWORD64 bases,
+  PBYTE values,
+  PSCAN_SUMMARY summary)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  // Imports replace results like first scans and can not run next to one
+  if (session->Busy == FALSE)
+  {
+    KmLockScanSession(session);
+
+    __try
+    {
+      // Next scans batch stored values at the width of their type, imports of other types or widths are rejected on every batch
+      status = (KmGetCompareWidth(request->Type) && request->ValueSize == KmGetCompareWidth(request->Type)) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+
+      // The first batch resets the session and starts a detached generation
+      if (NT_SUCCESS(status) && (request->Flags & SCAN_IMPORT_BEGIN))
+      {
+        status = KmResetScanSession(session);
+        if (NT_SUCCESS(status))
+        {
+          session->Type = request->Type;
+          status = KmBeginResultGeneration(&session->History, request->ValueSize, &session->Import);
+        }
+      }
 
-          // Detach from process
-          KeUnstackDetachProcess(&apc);
+      // Batches are appended as they arrive
+      if (NT_SUCCESS(status))
+      {
+        status = (session->Import && session->Import->ValueSize == request->ValueSize && session->Type == request->Type) ? STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+      }
+      for (DWORD32 i = 0; i < request->Count && NT_SUCCESS(status); i++)
+      {
+        status = KmAppendResult(session->Import, bases[i], values + (SIZE_T)i * request->ValueSize);
+      }
 
-          // Dereference process handle
-          ObDereferenceObject(process);
+      // The last batch publishes the generation, files of other tools may be unordered
+      if (NT_SUCCESS(status) && (request->Flags & SCAN_IMPORT_END))
+      {
+        status = KmSortResultStore(session->Import);
+        if (NT_SUCCESS(status))
+        {
+          KmCommitResultGeneration(&session->History, session->Import);
+          session->Import = NULL;
         }
+      }
 
-        // Free buffer
-        ExFreePoolWithTag(buffer, KM_MEMORY_POOL_TAG);
+      // Failed imports leave no partial generation behind
+      if (NT_SUCCESS(status) == FALSE && session->Import)
+      {
+        KmDiscardResultGeneration(&session->History, session->Import);
+        session->Import = NULL;
       }
 
-      // Write occurrence count
-      *count = g_scanCount;
+      // Imported values predate the tracked interval
+      KmInvalidateDirtySource(&session->Dirty);
+      KmWriteScanSummary(session, summary);
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+      status = STATUS_UNHANDLED_EXCEPTION;
     }
+
+    KmUnlockScanSession(session);
   }
-  __except (EXCEPTION_EXECUTE_HANDLER)
+
+  return status;
+}
+
+NTSTATUS
+KmSetScanSource(
+  PSCAN_SESSION session,
+  PSCAN_SOURCE request)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  // Sources can not be switched below a running scan
+  if (session->Busy == FALSE)
   {
-    KD_LOG("Something went wrong\n");
-    status = STATUS_UNHANDLED_EXCEPTION;
+    KmLockScanSession(session);
+
+    __try
+    {
+      // Results stay, next scans compare them against the new source, an empty path binds live processes again
+      KmCloseMemorySource(&session->Capture);
+      request->Path[MEMORY_CAPTURE_MAX_PATH - 1] = L'\0';
+      status = STATUS_SUCCESS;
+      if (request->Path[0])
+      {
+        status = KmOpenCaptureSource(&session->Capture, request->Path);
+      }
+
+      // Captures never change, pages of live processes are read in full since foreign writes can not be tracked safely
+      if (KmIsCaptureSource(&session->Capture))
+      {
+        KmInitializeDirtySource(&session->Dirty, KmAdvanceStaticSource, KmQueryStaticSource, NULL);
+      }
+      else
+      {
+        KmInitializeDirtySource(&session->Dirty, NULL, NULL, NULL);
+      }
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+      status = STATUS_UNHANDLED_EXCEPTION;
+    }
+
+    KmUnlockScanSession(session);
   }
 
   return status;
 }
 
 NTSTATUS
-KmScanProcessNext(
-  PSCAN_PROCESS_NEXT request)
+KmReadSignatureMatches(
+  PSCAN_SESSION session,
+  DWORD64 offset,
+  DWORD32 count,
+  PSIGNATURE_MATCH matches,
+  PDWORD32 written)
 {
-  NTSTATUS status = STATUS_UNSUCCESSFUL;
-  UNREFERENCED_PARAMETER(request);
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  *written = 0;
+
+  // Matches are not readable while a signature scan replaces them
+  if (session->Busy == FALSE)
+  {
+    // Lock session
+    KmLockScanSession(session);
+
+    __try
+    {
+      // Copy one page of matches
+      status = STATUS_SUCCESS;
+      if (offset < session->MatchCount)
+      {
+        *written = (DWORD32)min(count, session->MatchCount - offset);
+        RtlCopyMemory(matches, session->Matches + offset, sizeof(SIGNATURE_MATCH) * *written);
+      }
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+      status = STATUS_UNHANDLED_EXCEPTION;
+    }
+
+    // Unlock session
+    KmUnlockScanSession(session);
+  }
+
   return status;
 }
 
 NTSTATUS
 KmReadScanList(
+  PSCAN_SESSION session,
+  DWORD64 offset,
   DWORD32 count,
   PDWORD64 scans)
 {
-  NTSTATUS status = STATUS_SUCCESS;
+  NTSTATUS status = STATUS_DEVICE_BUSY;
 
-  __try
+  // Results are not readable while a scan rewrites them
+  if (session->Busy == FALSE)
   {
-    // Iterate scans
-    DWORD32 i = 0;
-    PLIST_ENTRY listEntry = g_scans.Flink;
-    while (listEntry != &g_scans)
+    // Lock session
+    KmLockScanSession(session);
+
+    __try
     {
-      // Copy scan
-      PSCAN_ENTRY scanEntry = CONTAINING_RECORD(listEntry, SCAN_ENTRY, List);
-      scans[i] = scanEntry->Base;
+      // Copy one page of scans
+      status = KmReadResultStore(KmGetCurrentResults(&session->History), offset, count, scans, NULL);
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+      status = STATUS_UNHANDLED_EXCEPTION;
+    }
+
+    // Unlock session
+    KmUnlockScanSession(session);
+  }
+
+  return status;
+}
 
-      // Increment to next record
-      i++;
-      listEntry = listEntry->Flink;
+NTSTATUS
+KmReadScanValues(
+  PSCAN_SESSION session,
+  DWORD64 offset,
+  DWORD32 count,
+  PBYTE values,
+  DWORD32 capacity,
+  PDWORD32 written)
+{
+  NTSTATUS status = STATUS_DEVICE_BUSY;
+
+  // Results are not readable while a scan rewrites them
+  *written = 0;
+  if (session->Busy == FALSE)
+  {
+    // Lock session
+    KmLockScanSession(session);
 
-      // Break if list exceeds buffer
-      if (i > count)
+    __try
+    {
+      // Copy one page of values, the caller sizes its buffer by the result width
+      PRESULT_STORE results = KmGetCurrentResults(&session->History);
+      DWORD64 size = (DWORD64)count * results->ValueSize;
+      status = size <= capacity ? STATUS_SUCCESS : STATUS_BUFFER_TOO_SMALL;
+      if (NT_SUCCESS(status))
+      {
+        status = KmReadResultStore(results, offset, count, NULL, values);
+      }
+      if (NT_SUCCESS(status))
       {
-        break;
+        *written = (DWORD32)size;
       }
     }
-  }
-  __except (EXCEPTION_EXECUTE_HANDLER)
-  {
-    KD_LOG("Something went wrong\n");
-    status = STATUS_UNHANDLED_EXCEPTION;
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      KD_LOG("Something went wrong\n");
+      status = STATUS_UNHANDLED_EXCEPTION;
+    }
+
+    // Unlock session
+    KmUnlockScanSession(session);
   }
 
   return status;
@@ -3,29 +3,148 @@
 
 #include <km_core.h>
 #include <km_ioctrl.h>
+#include <km_result_store.h>
+#include <km_result_history.h>
+#include <km_snapshot.h>
+#include <km_dirty.h>
+#include <km_source.h>
+
+///////////////////////////////////////////////////////////
+// Scanner data types
+///////////////////////////////////////////////////////////
+
+typedef enum _SCAN_JOB_TYPE
+{
+  SCAN_JOB_FIRST,
+  SCAN_JOB_NEXT,
+  SCAN_JOB_POINTERS,
+  SCAN_JOB_CAPTURE,
+  SCAN_JOB_SIGNATURES,
+} SCAN_JOB_TYPE, * PSCAN_JOB_TYPE;
+
+typedef struct _SCAN_JOB
+{
+  DWORD32 Type;
+  SCAN_PROCESS_FIRST FirstRequest;
+  SCAN_PROCESS_NEXT NextRequest;
+  SCAN_POINTERS PointerRequest;
+  SCAN_CAPTURE CaptureRequest;
+  SCAN_SIGNATURES SignatureRequest;
+  PBYTE Value;
+  PVOID Set;
+} SCAN_JOB, * PSCAN_JOB;
+
+typedef struct _SCAN_SESSION
+{
+  ERESOURCE Lock;
+  RESULT_HISTORY History;
+  SNAPSHOT_STORE Snapshot;
+  DIRTY_SOURCE Dirty;
+  PRESULT_STORE Import;
+  MEMORY_SOURCE Live;
+  MEMORY_SOURCE Capture;
+  DWORD32 Type;
+  SCAN_JOB Job;
+  PSIGNATURE_MATCH Matches;
+  DWORD32 MatchCount;
+  PETHREAD Thread;
+  SCAN_PROGRESS Progress;
+  volatile LONG Busy;
+  volatile LONG Cancel;
+} SCAN_SESSION, * PSCAN_SESSION;
 
 ///////////////////////////////////////////////////////////
 // Scanner API
 ///////////////////////////////////////////////////////////
 
 NTSTATUS
-KmInitializeScanList();
+KmCreateScanSession(
+  PSCAN_SESSION* session);
 
-NTSTATUS
-KmResetScanList();
+VOID
+KmFreeScanSession(
+  PSCAN_SESSION session);
 
 NTSTATUS
-KmScanProcessFirst(
-  PSCAN_PROCESS_FIRST request,
-  PDWORD32 count);
+KmStartScanFirst(
+  PSCAN_SESSION session,
+  PSCAN_PROCESS_FIRST request);
 
 NTSTATUS
-KmScanProcessNext(
+KmStartScanNext(
+  PSCAN_SESSION session,
   PSCAN_PROCESS_NEXT request);
 
+NTSTATUS
+KmStartScanPointers(
+  PSCAN_SESSION session,
+  PSCAN_POINTERS request);
+
+NTSTATUS
+KmStartScanCapture(
+  PSCAN_SESSION session,
+  PSCAN_CAPTURE request);
+
+NTSTATUS
+KmStartScanSignatures(
+  PSCAN_SESSION session,
+  PSCAN_SIGNATURES request);
+
+NTSTATUS
+KmQueryScanProgress(
+  PSCAN_SESSION session,
+  PSCAN_PROGRESS progress);
+
+NTSTATUS
+KmCancelScan(
+  PSCAN_SESSION session);
+
+NTSTATUS
+KmUndoScan(
+  PSCAN_SESSION session,
+  PSCAN_SUMMARY summary);
+
+NTSTATUS
+KmRedoScan(
+  PSCAN_SESSION session,
+  PSCAN_SUMMARY summary);
+
+NTSTATUS
+KmImportScanResults(
+  PSCAN_SESSION session,
+  PSCAN_IMPORT request,
+  PDWORD64 bases,
+  PBYTE values,
+  PSCAN_SUMMARY summary);
+
+NTSTATUS
+KmSetScanSource(
+  PSCAN_SESSION session,
+  PSCAN_SOURCE request);
+
+
+NTSTATUS
+KmReadSignatureMatches(
+  PSCAN_SESSION session,
+  DWORD64 offset,
+  DWORD32 count,
+  PSIGNATURE_MATCH matches,
+  PDWORD32 written);
+
 NTSTATUS
 KmReadScanList(
+  PSCAN_SESSION session,
+  DWORD64 offset,
   DWORD32 count,
   PDWORD64 scans);
 
+NTSTATUS
+KmReadScanValues(
+  PSCAN_SESSION session,
+  DWORD64 offset,
+  DWORD32 count,
+  PBYTE values,
+  DWORD32 capacity,
+  PDWORD32 written);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include <km_signature.h>
+#include <km_debug.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Signature utilities
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+KmValidateSignatureSet(
+  PSIGNATURE_MATCHER matcher)
+{
+  PSIGNATURE_SET set = matcher->Set;
+
+  // Key offsets have to partition the anchors
+  if (matcher->Keys[0] != 0 || matcher->Keys[SIGNATURE_SET_KEYS] != set->AnchorCount)
+  {
+    return FALSE;
+  }
+  for (DWORD32 key = 0; key < SIGNATURE_SET_KEYS; key++)
+  {
+    if (matcher->Keys[key] > matcher->Keys[key + 1])
+    {
+      return FALSE;
+    }
+  }
+
+  // Anchors have to refer to existing signatures
+  for (DWORD32 i = 0; i < set->AnchorCount; i++)
+  {
+    if (matcher->Anchors[i] >= set->SignatureCount)
+    {
+      return FALSE;
+    }
+  }
+
+  // Signatures have to stay inside the pattern bytes and contain their anchor pair
+  for (DWORD32 i = 0; i < set->SignatureCount; i++)
+  {
+    PSIGNATURE signature = &matcher->Signatures[i];
+    if (signature->Length < 2 || signature->Length > KM_PATTERN_MAX_LENGTH || (signature->Anchor + 1) >= signature->Length)
+    {
+      return FALSE;
+    }
+    if (((DWORD64)signature->Offset + (DWORD64)signature->Length * 2) > set->PatternSize)
+    {
+      return FALSE;
+    }
+
+    // Windows overlap by the longest signature
+    matcher->Reach = max(matcher->Reach, signature->Length - 1);
+  }
+
+  return TRUE;
+}
+
+static __forceinline
+BOOLEAN
+KmVerifySignature(
+  PSIGNATURE_MATCHER matcher,
+  PSIGNATURE signature,
+  PBYTE bytes)
+{
+  PBYTE expected = matcher->Patterns + signature->Offset;
+  PBYTE masks = expected + signature->Length;
+
+  // Masked compare of every byte
+  for (DWORD32 i = 0; i < signature->Length; i++)
+  {
+    if ((bytes[i] ^ expected[i]) & masks[i])
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+///////////////////////////////////////////////////////////
+// Signature API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeSignatureMatcher(
+  PSIGNATURE_MATCHER matcher,
+  PSIGNATURE_SET set,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  RtlZeroMemory(matcher, sizeof(SIGNATURE_MATCHER));
+
+  // Validate header and overall layout
+  if (size >= sizeof(SIGNATURE_SET) && set->Magic == SIGNATURE_SET_MAGIC && set->Version == SIGNATURE_SET_VERSION && set->Size == size)
+  {
+    SIZE_T signatureSize = (SIZE_T)set->SignatureCount * sizeof(SIGNATURE);
+    SIZE_T keySize = (SIZE_T)(SIGNATURE_SET_KEYS + 1) * sizeof(DWORD32);
+    SIZE_T anchorSize = (SIZE_T)set->AnchorCount * sizeof(DWORD32);
+    if ((sizeof(SIGNATURE_SET) + signatureSize + keySize + anchorSize + set->PatternSize) == size)
+    {
+      // Resolve sections
+      matcher->Set = set;
+      matcher->Signatures = (PSIGNATURE)(set + 1);
+      matcher->Keys = (PDWORD32)((PBYTE)matcher->Signatures + signatureSize);
+      matcher->Anchors = (PDWORD32)((PBYTE)matcher->Keys + keySize);
+      matcher->Patterns = (PBYTE)matcher->Anchors + anchorSize;
+
+      // Validate sections
+      if (KmValidateSignatureSet(matcher))
+      {
+        // Build bitmap of occupied keys to skip empty ones cheaply
+        matcher->Bitmap = ExAllocatePoolWithTag(NonPagedPool, SIGNATURE_SET_KEYS / 8, KM_MEMORY_POOL_TAG);
+        if (matcher->Bitmap)
+        {
+          RtlZeroMemory(matcher->Bitmap, SIGNATURE_SET_KEYS / 8);
+          for (DWORD32 key = 0; key < SIGNATURE_SET_KEYS; key++)
+          {
+            if (matcher->Keys[key] != matcher->Keys[key + 1])
+            {
+              matcher->Bitmap[key >> 3] |= (BYTE)(1 << (key & 7));
+            }
+          }
+          status = STATUS_SUCCESS;
+        }
+        else
+        {
+          status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+      }
+    }
+  }
+
+  return status;
+}
+
+VOID
+KmFreeSignatureMatcher(
+  PSIGNATURE_MATCHER matcher)
+{
+  // Free key bitmap
+  if (matcher->Bitmap)
+  {
+    ExFreePoolWithTag(matcher->Bitmap, KM_MEMORY_POOL_TAG);
+    matcher->Bitmap = NULL;
+  }
+}
+
+NTSTATUS
+KmMatchSignatures(
+  PSIGNATURE_MATCHER matcher,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned,
+  PRESULT_STORE results)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Single pass, every byte pair selects the signatures anchored on it
+  for (DWORD32 position = 0; (position + 1) < size && NT_SUCCESS(status); position++)
+  {
+    USHORT key = *(PUSHORT)(bytes + position);
+    if (matcher->Bitmap[key >> 3] & (1 << (key & 7)))
+    {
+      for (DWORD32 i = matcher->Keys[key]; i < matcher->Keys[key + 1]; i++)
+      {
+        // Verify signatures which fit into the block around their anchor, starts past the owned bytes belong to the next window
+        PSIGNATURE signature = &matcher->Signatures[matcher->Anchors[i]];
+        if (position >= signature->Anchor && (position - signature->Anchor) < owned && ((DWORD64)position - signature->Anchor + signature->Length) <= size)
+        {
+          DWORD32 start = position - signature->Anchor;
+          if (KmVerifySignature(matcher, signature, bytes + start))
+          {
+            status = KmAppendResult(results, base + start, (PBYTE)&matcher->Anchors[i]);
+          }
+        }
+      }
+    }
+  }
+
+  return status;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef KM_SIGNATURE_H
+#define KM_SIGNATURE_H
+
+#include <km_core.h>
+#include <km_ioctrl.h>
+#include <km_result_store.h>
+
+///////////////////////////////////////////////////////////
+// Signature data types
+///////////////////////////////////////////////////////////
+
+typedef struct _SIGNATURE_MATCHER
+{
+  PSIGNATURE_SET Set;
+  PSIGNATURE Signatures;
+  PDWORD32 Keys;
+  PDWORD32 Anchors;
+  PBYTE Patterns;
+  PBYTE Bitmap;
+  DWORD32 Reach;
+} SIGNATURE_MATCHER, * PSIGNATURE_MATCHER;
+
+///////////////////////////////////////////////////////////
+// Signature API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeSignatureMatcher(
+  PSIGNATURE_MATCHER matcher,
+  PSIGNATURE_SET set,
+  DWORD32 size);
+
+VOID
+KmFreeSignatureMatcher(
+  PSIGNATURE_MATCHER matcher);
+
+NTSTATUS
+KmMatchSignatures(
+  PSIGNATURE_MATCHER matcher,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned,
+  PRESULT_STORE results);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,481 @@
+#include <km_snapshot.h>
+#include <km_debug.h>
+
+///////////////////////////////////////////////////////////
+// Snapshot utilities
+///////////////////////////////////////////////////////////
+
+static
+DWORD64
+KmHashPage(
+  PBYTE bytes)
+{
+  DWORD64 hash = 0xCBF29CE484222325;
+
+  // Mix page word by word
+  PDWORD64 words = (PDWORD64)bytes;
+  for (DWORD32 i = 0; i < (PAGE_SIZE / sizeof(DWORD64)); i++)
+  {
+    hash = (hash ^ words[i]) * 0x9E3779B97F4A7C15;
+    hash ^= hash >> 32;
+  }
+
+  return hash;
+}
+
+static
+DWORD32
+KmGetCandidateBitmapSize(
+  PSNAPSHOT_STORE store)
+{
+  return (store->ElementCount + 7) / 8;
+}
+
+static
+NTSTATUS
+KmDecompressSnapshotBlob(
+  PSNAPSHOT_BLOB blob,
+  PBYTE bytes)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  if (blob->Size == PAGE_SIZE)
+  {
+    // Blob is stored uncompressed
+    RtlCopyMemory(bytes, blob->Data, PAGE_SIZE);
+  }
+  else
+  {
+    // Decompress blob and zero whatever the codec did not produce
+    ULONG size = 0;
+    status = RtlDecompressBuffer(KM_SNAPSHOT_COMPRESSION, bytes, PAGE_SIZE, blob->Data, blob->Size, &size);
+    if (NT_SUCCESS(status) && size < PAGE_SIZE)
+    {
+      RtlZeroMemory(bytes + size, PAGE_SIZE - size);
+    }
+  }
+
+  return status;
+}
+
+static
+PSNAPSHOT_BLOB
+KmAcquireSnapshotBlob(
+  PSNAPSHOT_STORE store,
+  PBYTE bytes)
+{
+  // Search for an identical page
+  DWORD64 hash = KmHashPage(bytes);
+  PLIST_ENTRY bucket = &store->Buckets[hash & (KM_SNAPSHOT_HASH_BUCKETS - 1)];
+  PLIST_ENTRY listEntry = bucket->Flink;
+  while (listEntry != bucket)
+  {
+    PSNAPSHOT_BLOB blob = CONTAINING_RECORD(listEntry, SNAPSHOT_BLOB, List);
+    if (blob->Hash == hash)
+    {
+      if (NT_SUCCESS(KmDecompressSnapshotBlob(blob, store->Scratch)) && RtlEqualMemory(store->Scratch, bytes, PAGE_SIZE))
+      {
+        blob->References++;
+        return blob;
+      }
+    }
+    listEntry = listEntry->Flink;
+  }
+
+  // Compress page, incompressible pages are stored as they are
+  ULONG size = 0;
+  PBYTE data = store->Scratch;
+  NTSTATUS status = RtlCompressBuffer(KM_SNAPSHOT_COMPRESSION | COMPRESSION_ENGINE_STANDARD, bytes, PAGE_SIZE, store->Scratch, PAGE_SIZE, PAGE_SIZE, &size, store->Workspace);
+  if (NT_SUCCESS(status) == FALSE || size == 0 || size >= PAGE_SIZE)
+  {
+    size = PAGE_SIZE;
+    data = bytes;
+  }
+
+  // Insert new blob
+  SIZE_T blobSize = FIELD_OFFSET(SNAPSHOT_BLOB, Data) + size;
+  PSNAPSHOT_BLOB blob = ExAllocatePoolWithTag(PagedPool, blobSize, KM_MEMORY_POOL_TAG);
+  if (blob)
+  {
+    blob->Hash = hash;
+    blob->References = 1;
+    blob->Size = size;
+    RtlCopyMemory(blob->Data, data, size);
+    InsertTailList(bucket, &blob->List);
+
+    // Update statistics
+    store->BlobCount++;
+    store->Bytes += blobSize;
+  }
+
+  return blob;
+}
+
+static
+VOID
+KmReleaseSnapshotBlob(
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_BLOB blob)
+{
+  // Free blob once the last page is gone
+  if (--blob->References == 0)
+  {
+    RemoveEntryList(&blob->List);
+
+    // Update statistics
+    store->BlobCount--;
+    store->Bytes -= FIELD_OFFSET(SNAPSHOT_BLOB, Data) + blob->Size;
+
+    ExFreePoolWithTag(blob, KM_MEMORY_POOL_TAG);
+  }
+}
+
+static
+VOID
+KmReleaseSnapshotPage(
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_PAGE page)
+{
+  // Release content
+  if (page->Blob)
+  {
+    KmReleaseSnapshotBlob(store, page->Blob);
+    page->Blob = NULL;
+  }
+
+  // Release candidates
+  if (page->Candidates)
+  {
+    store->Bytes -= KmGetCandidateBitmapSize(store);
+    ExFreePoolWithTag(page->Candidates, KM_MEMORY_POOL_TAG);
+    page->Candidates = NULL;
+  }
+
+  store->Candidates -= page->CandidateCount;
+  page->CandidateCount = 0;
+}
+
+///////////////////////////////////////////////////////////
+// Snapshot API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeSnapshotStore(
+  PSNAPSHOT_STORE store,
+  DWORD32 width,
+  DWORD32 stride)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Reset page list
+  InitializeListHead(&store->Chunks);
+
+  // Reset statistics
+  store->PageCount = 0;
+  store->BlobCount = 0;
+  store->Candidates = 0;
+  store->Bytes = 0;
+  store->Width = width;
+  store->Stride = stride;
+
+  // Elements start every stride bytes and must not leave the page
+  store->ElementCount = ((PAGE_SIZE - width) / stride) + 1;
+
+  // Query compression workspace size
+  ULONG workspaceSize = 0;
+  ULONG fragmentSize = 0;
+  if (NT_SUCCESS(RtlGetCompressionWorkSpaceSize(KM_SNAPSHOT_COMPRESSION | COMPRESSION_ENGINE_STANDARD, &workspaceSize, &fragmentSize)))
+  {
+    // Allocate hash buckets, compression workspace and scratch pages
+    store->Buckets = ExAllocatePoolWithTag(PagedPool, sizeof(LIST_ENTRY) * KM_SNAPSHOT_HASH_BUCKETS, KM_MEMORY_POOL_TAG);
+    store->Workspace = ExAllocatePoolWithTag(PagedPool, workspaceSize, KM_MEMORY_POOL_TAG);
+    store->Scratch = ExAllocatePoolWithTag(PagedPool, PAGE_SIZE * 2, KM_MEMORY_POOL_TAG);
+    if (store->Buckets && store->Workspace && store->Scratch)
+    {
+      for (DWORD32 i = 0; i < KM_SNAPSHOT_HASH_BUCKETS; i++)
+      {
+        InitializeListHead(&store->Buckets[i]);
+      }
+      status = STATUS_SUCCESS;
+    }
+  }
+
+  // Undo partial initialization
+  if (NT_SUCCESS(status) == FALSE)
+  {
+    if (store->Buckets)
+    {
+      ExFreePoolWithTag(store->Buckets, KM_MEMORY_POOL_TAG);
+      store->Buckets = NULL;
+    }
+    if (store->Workspace)
+    {
+      ExFreePoolWithTag(store->Workspace, KM_MEMORY_POOL_TAG);
+      store->Workspace = NULL;
+    }
+    if (store->Scratch)
+    {
+      ExFreePoolWithTag(store->Scratch, KM_MEMORY_POOL_TAG);
+      store->Scratch = NULL;
+    }
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmResetSnapshotStore(
+  PSNAPSHOT_STORE store)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  if (KmIsSnapshotActive(store))
+  {
+    // Free pages
+    while (IsListEmpty(&store->Chunks) == FALSE)
+    {
+      PLIST_ENTRY listEntry = RemoveHeadList(&store->Chunks);
+      PSNAPSHOT_CHUNK chunk = CONTAINING_RECORD(listEntry, SNAPSHOT_CHUNK, List);
+      for (DWORD32 i = 0; i < chunk->Count; i++)
+      {
+        KmReleaseSnapshotPage(store, &chunk->Pages[i]);
+      }
+      ExFreePoolWithTag(chunk, KM_MEMORY_POOL_TAG);
+    }
+
+    // Free hash buckets, compression workspace and scratch pages
+    ExFreePoolWithTag(store->Buckets, KM_MEMORY_POOL_TAG);
+    ExFreePoolWithTag(store->Workspace, KM_MEMORY_POOL_TAG);
+    ExFreePoolWithTag(store->Scratch, KM_MEMORY_POOL_TAG);
+  }
+
+  // Reset page list
+  InitializeListHead(&store->Chunks);
+  store->Buckets = NULL;
+  store->Workspace = NULL;
+  store->Scratch = NULL;
+
+  // Reset statistics
+  store->PageCount = 0;
+  store->BlobCount = 0;
+  store->Candidates = 0;
+  store->Bytes = 0;
+
+  return status;
+}
+
+BOOLEAN
+KmIsSnapshotActive(
+  PSNAPSHOT_STORE store)
+{
+  return store->Buckets != NULL;
+}
+
+NTSTATUS
+KmAppendSnapshotPage(
+  PSNAPSHOT_STORE store,
+  DWORD64 base,
+  PBYTE bytes)
+{
+  NTSTATUS status = STATUS_INSUFFICIENT_RESOURCES;
+
+  // Allocate new chunk once the tail is full
+  PSNAPSHOT_CHUNK chunk = NULL;
+  if (IsListEmpty(&store->Chunks) == FALSE)
+  {
+    chunk = CONTAINING_RECORD(store->Chunks.Blink, SNAPSHOT_CHUNK, List);
+  }
+  if (chunk == NULL || chunk->Count == KM_SNAPSHOT_CHUNK_PAGES)
+  {
+    chunk = ExAllocatePoolWithTag(PagedPool, sizeof(SNAPSHOT_CHUNK), KM_MEMORY_POOL_TAG);
+    if (chunk)
+    {
+      chunk->Count = 0;
+      InsertTailList(&store->Chunks, &chunk->List);
+    }
+  }
+
+  if (chunk)
+  {
+    // Every element of a new page is a candidate
+    PSNAPSHOT_BLOB blob = KmAcquireSnapshotBlob(store, bytes);
+    if (blob)
+    {
+      PSNAPSHOT_PAGE page = &chunk->Pages[chunk->Count++];
+      page->Base = base;
+      page->Blob = blob;
+      page->Candidates = NULL;
+      page->CandidateCount = store->ElementCount;
+
+      // Update statistics
+      store->PageCount++;
+      store->Candidates += page->CandidateCount;
+
+      status = STATUS_SUCCESS;
+    }
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmUpdateSnapshotPage(
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_PAGE page,
+  PBYTE bytes,
+  PBYTE candidates,
+  DWORD32 candidateCount)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  if (candidateCount == 0)
+  {
+    // Page has nothing left to offer
+    KmReleaseSnapshotPage(store, page);
+  }
+  else
+  {
+    // Swap content, identical pages are shared
+    PSNAPSHOT_BLOB blob = KmAcquireSnapshotBlob(store, bytes);
+    if (blob)
+    {
+      KmReleaseSnapshotBlob(store, page->Blob);
+      page->Blob = blob;
+
+      if (candidateCount == store->ElementCount)
+      {
+        // Every element survived, no bitmap required
+        if (page->Candidates)
+        {
+          store->Bytes -= KmGetCandidateBitmapSize(store);
+          ExFreePoolWithTag(page->Candidates, KM_MEMORY_POOL_TAG);
+          page->Candidates = NULL;
+        }
+      }
+      else
+      {
+        // Track surviving elements
+        if (page->Candidates == NULL)
+        {
+          page->Candidates = ExAllocatePoolWithTag(PagedPool, KmGetCandidateBitmapSize(store), KM_MEMORY_POOL_TAG);
+          if (page->Candidates)
+          {
+            store->Bytes += KmGetCandidateBitmapSize(store);
+          }
+        }
+        if (page->Candidates)
+        {
+          RtlCopyMemory(page->Candidates, candidates, KmGetCandidateBitmapSize(store));
+        }
+        else
+        {
+          status = STATUS_INSUFFICIENT_RESOURCES;
+        }
+      }
+    }
+    else
+    {
+      status = STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    // Update candidate count
+    if (NT_SUCCESS(status))
+    {
+      store->Candidates -= page->CandidateCount;
+      store->Candidates += candidateCount;
+      page->CandidateCount = candidateCount;
+    }
+    else
+    {
+      KmReleaseSnapshotPage(store, page);
+    }
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmVisitSnapshot(
+  PSNAPSHOT_STORE store,
+  SNAPSHOT_VISIT_ROUTINE visit,
+  PVOID context)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Pages which lost all candidates are compacted out
+  PSNAPSHOT_CHUNK writeChunk = NULL;
+  DWORD32 writeIndex = 0;
+  if (IsListEmpty(&store->Chunks) == FALSE)
+  {
+    writeChunk = CONTAINING_RECORD(store->Chunks.Flink, SNAPSHOT_CHUNK, List);
+  }
+
+  // Visit pages with their previous content
+  PLIST_ENTRY listEntry = store->Chunks.Flink;
+  while (listEntry != &store->Chunks)
+  {
+    PSNAPSHOT_CHUNK chunk = CONTAINING_RECORD(listEntry, SNAPSHOT_CHUNK, List);
+    DWORD32 chunkCount = chunk->Count;
+    for (DWORD32 i = 0; i < chunkCount; i++)
+    {
+      PSNAPSHOT_PAGE page = &chunk->Pages[i];
+      PBYTE previous = store->Scratch + PAGE_SIZE;
+
+      // Cancelled visits keep the remaining pages untouched
+      if (status != STATUS_CANCELLED)
+      {
+        NTSTATUS visitStatus = KmDecompressSnapshotBlob(page->Blob, previous);
+        if (NT_SUCCESS(visitStatus))
+        {
+          visitStatus = visit(context, store, page, previous);
+        }
+        if (visitStatus == STATUS_CANCELLED)
+        {
+          status = visitStatus;
+        }
+        else if (NT_SUCCESS(visitStatus) == FALSE)
+        {
+          KmReleaseSnapshotPage(store, page);
+        }
+      }
+
+      // Move surviving page to the write position
+      if (page->CandidateCount > 0)
+      {
+        if (writeIndex == KM_SNAPSHOT_CHUNK_PAGES)
+        {
+          writeChunk->Count = writeIndex;
+          writeChunk = CONTAINING_RECORD(writeChunk->List.Flink, SNAPSHOT_CHUNK, List);
+          writeIndex = 0;
+        }
+        writeChunk->Pages[writeIndex++] = *page;
+      }
+    }
+    listEntry = listEntry->Flink;
+  }
+
+  if (writeChunk)
+  {
+    // Seal last written chunk
+    writeChunk->Count = writeIndex;
+
+    // Free every chunk behind the last written one
+    PLIST_ENTRY last = (writeIndex > 0) ? &writeChunk->List : writeChunk->List.Blink;
+    while (last->Flink != &store->Chunks)
+    {
+      PLIST_ENTRY tailEntry = RemoveTailList(&store->Chunks);
+      ExFreePoolWithTag(CONTAINING_RECORD(tailEntry, SNAPSHOT_CHUNK, List), KM_MEMORY_POOL_TAG);
+    }
+  }
+
+  // Recompute page count
+  store->PageCount = 0;
+  listEntry = store->Chunks.Flink;
+  while (listEntry != &store->Chunks)
+  {
+    store->PageCount += CONTAINING_RECORD(listEntry, SNAPSHOT_CHUNK, List)->Count;
+    listEntry = listEntry->Flink;
+  }
+
+  return status;
+}
\ No newline at end of file
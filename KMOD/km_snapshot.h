@@ -0,0 +1,94 @@
+#ifndef KM_SNAPSHOT_H
+#define KM_SNAPSHOT_H
+
+#include <km_core.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Snapshot data types
+///////////////////////////////////////////////////////////
+
+typedef struct _SNAPSHOT_BLOB
+{
+  LIST_ENTRY List;
+  DWORD64 Hash;
+  LONG References;
+  DWORD32 Size;
+  BYTE Data[1];
+} SNAPSHOT_BLOB, * PSNAPSHOT_BLOB;
+
+typedef struct _SNAPSHOT_PAGE
+{
+  DWORD64 Base;
+  PSNAPSHOT_BLOB Blob;
+  PBYTE Candidates;
+  DWORD32 CandidateCount;
+} SNAPSHOT_PAGE, * PSNAPSHOT_PAGE;
+
+typedef struct _SNAPSHOT_CHUNK
+{
+  LIST_ENTRY List;
+  DWORD32 Count;
+  SNAPSHOT_PAGE Pages[KM_SNAPSHOT_CHUNK_PAGES];
+} SNAPSHOT_CHUNK, * PSNAPSHOT_CHUNK;
+
+typedef struct _SNAPSHOT_STORE
+{
+  LIST_ENTRY Chunks;
+  PLIST_ENTRY Buckets;
+  PVOID Workspace;
+  PBYTE Scratch;
+  DWORD64 PageCount;
+  DWORD64 BlobCount;
+  DWORD64 Candidates;
+  DWORD64 Bytes;
+  DWORD32 Width;
+  DWORD32 Stride;
+  DWORD32 ElementCount;
+} SNAPSHOT_STORE, * PSNAPSHOT_STORE;
+
+typedef NTSTATUS(*SNAPSHOT_VISIT_ROUTINE)(
+  PVOID context,
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_PAGE page,
+  PBYTE previous);
+
+///////////////////////////////////////////////////////////
+// Snapshot API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmInitializeSnapshotStore(
+  PSNAPSHOT_STORE store,
+  DWORD32 width,
+  DWORD32 stride);
+
+NTSTATUS
+KmResetSnapshotStore(
+  PSNAPSHOT_STORE store);
+
+BOOLEAN
+KmIsSnapshotActive(
+  PSNAPSHOT_STORE store);
+
+NTSTATUS
+KmAppendSnapshotPage(
+  PSNAPSHOT_STORE store,
+  DWORD64 base,
+  PBYTE bytes);
+
+NTSTATUS
+KmUpdateSnapshotPage(
+  PSNAPSHOT_STORE store,
+  PSNAPSHOT_PAGE page,
+  PBYTE bytes,
+  PBYTE candidates,
+  DWORD32 candidateCount);
+
+NTSTATUS
+KmVisitSnapshot(
+  PSNAPSHOT_STORE store,
+  SNAPSHOT_VISIT_ROUTINE visit,
+  PVOID context);
+
+#endif
\ No newline at end of file
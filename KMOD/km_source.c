@@ -0,0 +1,486 @@
+#include <km_source.h>
+#include <km_debug.h>
+#include <km_config.h>
+
+///////////////////////////////////////////////////////////
+// Capture utilities
+///////////////////////////////////////////////////////////
+
+static
+PMEMORY_CAPTURE_REGION
+KmFindCaptureRegion(
+  PMEMORY_SOURCE source,
+  DWORD64 address)
+{
+  // Regions are sorted and disjoint, find the first one ending behind the address
+  DWORD32 low = 0;
+  DWORD32 high = source->RegionCount;
+  while (low < high)
+  {
+    DWORD32 middle = low + (high - low) / 2;
+    if ((source->Regions[middle].Base + source->Regions[middle].Size) <= address)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return (low < source->RegionCount) ? &source->Regions[low] : NULL;
+}
+
+static
+NTSTATUS
+KmValidateCapture(
+  PMEMORY_CAPTURE capture,
+  DWORD64 size)
+{
+  NTSTATUS status = STATUS_INVALID_IMAGE_FORMAT;
+
+  // Region table has to follow the page data, empty captures end with their header
+  if (size >= sizeof(MEMORY_CAPTURE) && capture->Magic == MEMORY_CAPTURE_MAGIC && capture->Version == MEMORY_CAPTURE_VERSION &&
+    capture->RegionOffset >= PAGE_SIZE && (capture->RegionOffset % sizeof(DWORD64)) == 0 &&
+    (capture->RegionCount == 0 || (capture->RegionOffset <= size && capture->RegionCount <= ((size - capture->RegionOffset) / sizeof(MEMORY_CAPTURE_REGION)))))
+  {
+    // Regions have to be page aligned, ordered and backed by page data
+    PMEMORY_CAPTURE_REGION regions = (PMEMORY_CAPTURE_REGION)((PBYTE)capture + capture->RegionOffset);
+    status = STATUS_SUCCESS;
+    for (DWORD32 i = 0; i < capture->RegionCount && NT_SUCCESS(status); i++)
+    {
+      BOOLEAN aligned = ((regions[i].Base | regions[i].Size | regions[i].Offset) & (PAGE_SIZE - 1)) == 0;
+      BOOLEAN backed = regions[i].Size > 0 && regions[i].Offset >= PAGE_SIZE && regions[i].Offset <= capture->RegionOffset && regions[i].Size <= (capture->RegionOffset - regions[i].Offset);
+      BOOLEAN ordered = (regions[i].Base + regions[i].Size) > regions[i].Base && (i == 0 || regions[i].Base >= (regions[i - 1].Base + regions[i - 1].Size));
+      if (aligned == FALSE || backed == FALSE || ordered == FALSE)
+      {
+        status = STATUS_INVALID_IMAGE_FORMAT;
+      }
+    }
+  }
+
+  return status;
+}
+
+static
+NTSTATUS
+KmWriteCapture(
+  PCAPTURE_WRITER writer,
+  DWORD64 offset,
+  PVOID bytes,
+  DWORD32 size)
+{
+  // Writes are synchronous and positioned, the file pointer is never used
+  IO_STATUS_BLOCK io;
+  LARGE_INTEGER position;
+  position.QuadPart = (LONGLONG)offset;
+  NTSTATUS status = ZwWriteFile(writer->File, NULL, NULL, NULL, &io, bytes, size, &position, NULL);
+  if (NT_SUCCESS(status) && io.Information != size)
+  {
+    status = STATUS_DISK_FULL;
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Memory source API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmOpenProcessSource(
+  PMEMORY_SOURCE source,
+  DWORD32 pid)
+{
+  RtlZeroMemory(source, sizeof(MEMORY_SOURCE));
+
+  // Search process by process id
+  return PsLookupProcessByProcessId((HANDLE)pid, &source->Process);
+}
+
+NTSTATUS
+KmOpenCaptureSource(
+  PMEMORY_SOURCE source,
+  PWCHAR path)
+{
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+  RtlZeroMemory(source, sizeof(MEMORY_SOURCE));
+
+  // Open file with the access rights of the caller
+  UNICODE_STRING name;
+  RtlInitUnicodeString(&name, path);
+  OBJECT_ATTRIBUTES attributes;
+  InitializeObjectAttributes(&attributes, &name, OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE | OBJ_FORCE_ACCESS_CHECK, NULL, NULL);
+  IO_STATUS_BLOCK io;
+  HANDLE file = NULL;
+  status = ZwOpenFile(&file, GENERIC_READ | SYNCHRONIZE, &attributes, &io, FILE_SHARE_READ, FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE);
+  if (NT_SUCCESS(status))
+  {
+    // Query file size
+    FILE_STANDARD_INFORMATION info;
+    status = ZwQueryInformationFile(file, &io, &info, sizeof(info), FileStandardInformation);
+
+    // Back the file by a read only section, pages are faulted in once scans touch them
+    HANDLE section = NULL;
+    if (NT_SUCCESS(status))
+    {
+      InitializeObjectAttributes(&attributes, NULL, OBJ_KERNEL_HANDLE, NULL, NULL);
+      status = ZwCreateSection(&section, SECTION_MAP_READ | SECTION_QUERY, &attributes, NULL, PAGE_READONLY, SEC_COMMIT, file);
+    }
+    if (NT_SUCCESS(status))
+    {
+      status = ObReferenceObjectByHandle(section, SECTION_MAP_READ, NULL, KernelMode, &source->Section, NULL);
+      ZwClose(section);
+    }
+
+    // Map the whole file into system space, the view is shared by all scan workers
+    if (NT_SUCCESS(status))
+    {
+      status = MmMapViewInSystemSpace(source->Section, (PVOID*)&source->View, &source->ViewSize);
+    }
+
+    // Validate region table once, scans trust it afterwards
+    if (NT_SUCCESS(status))
+    {
+      __try
+      {
+        status = KmValidateCapture((PMEMORY_CAPTURE)source->View, min((DWORD64)info.EndOfFile.QuadPart, (DWORD64)source->ViewSize));
+      }
+      __except (EXCEPTION_EXECUTE_HANDLER)
+      {
+        KD_LOG("Something went wrong\n");
+        status = STATUS_IN_PAGE_ERROR;
+      }
+    }
+    if (NT_SUCCESS(status))
+    {
+      PMEMORY_CAPTURE capture = (PMEMORY_CAPTURE)source->View;
+      source->Regions = (PMEMORY_CAPTURE_REGION)(source->View + capture->RegionOffset);
+      source->RegionCount = capture->RegionCount;
+    }
+
+    // The section keeps the file referenced
+    ZwClose(file);
+  }
+
+  // Undo partial setup
+  if (NT_SUCCESS(status) == FALSE)
+  {
+    KmCloseMemorySource(source);
+  }
+
+  return status;
+}
+
+VOID
+KmCloseMemorySource(
+  PMEMORY_SOURCE source)
+{
+  // Dereference process
+  if (source->Process)
+  {
+    ObDereferenceObject(source->Process);
+  }
+
+  // Unmap view and release section
+  if (source->View)
+  {
+    MmUnmapViewInSystemSpace(source->View);
+  }
+  if (source->Section)
+  {
+    ObDereferenceObject(source->Section);
+  }
+
+  RtlZeroMemory(source, sizeof(MEMORY_SOURCE));
+}
+
+BOOLEAN
+KmIsCaptureSource(
+  PMEMORY_SOURCE source)
+{
+  return source->View != NULL;
+}
+
+VOID
+KmAttachMemorySource(
+  PMEMORY_SOURCE source,
+  PKAPC_STATE apc)
+{
+  // Captures live in system space and need no attach
+  if (source->Process)
+  {
+    KeStackAttachProcess(source->Process, apc);
+  }
+}
+
+VOID
+KmDetachMemorySource(
+  PMEMORY_SOURCE source,
+  PKAPC_STATE apc)
+{
+  if (source->Process)
+  {
+    KeUnstackDetachProcess(apc);
+  }
+}
+
+NTSTATUS
+KmQueryMemorySource(
+  PMEMORY_SOURCE source,
+  DWORD64 address,
+  PMEMORY_BASIC_INFORMATION mbi)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  if (KmIsCaptureSource(source))
+  {
+    // Gaps between captured regions are free, the space behind the last region ends the enumeration
+    PMEMORY_CAPTURE_REGION region = KmFindCaptureRegion(source, address);
+    if (region)
+    {
+      DWORD64 page = address & ~(DWORD64)(PAGE_SIZE - 1);
+      RtlZeroMemory(mbi, sizeof(MEMORY_BASIC_INFORMATION));
+      mbi->BaseAddress = (PVOID)page;
+      if (region->Base > page)
+      {
+        mbi->RegionSize = region->Base - page;
+        mbi->State = MEM_FREE;
+        mbi->Protect = PAGE_NOACCESS;
+      }
+      else
+      {
+        mbi->AllocationBase = (PVOID)region->AllocationBase;
+        mbi->AllocationProtect = region->Protect;
+        mbi->RegionSize = region->Base + region->Size - page;
+        mbi->State = MEM_COMMIT;
+        mbi->Protect = region->Protect;
+        mbi->Type = region->Type;
+      }
+      status = STATUS_SUCCESS;
+    }
+  }
+  else
+  {
+    // Processes are queried while attached
+    status = ZwQueryVirtualMemory(ZwCurrentProcess(), (PVOID)address, MemoryBasicInformation, mbi, sizeof(MEMORY_BASIC_INFORMATION), NULL);
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmMapSourceWindow(
+  PMEMORY_SOURCE source,
+  PMEMORY_WINDOW window,
+  DWORD64 base,
+  DWORD32 size,
+  PBYTE* mapped)
+{
+  NTSTATUS status = STATUS_INVALID_PARAMETER;
+
+  if (KmIsCaptureSource(source))
+  {
+    // Captured windows point into the view and have to lie inside one region
+    PMEMORY_CAPTURE_REGION region = KmFindCaptureRegion(source, base);
+    if (size <= window->Size && region && region->Base <= base && (base + size) <= (region->Base + region->Size))
+    {
+      *mapped = source->View + region->Offset + (base - region->Base);
+      status = STATUS_SUCCESS;
+    }
+  }
+  else
+  {
+    status = KmMapMemoryWindow(window, (PVOID)base, size, mapped);
+  }
+
+  return status;
+}
+
+VOID
+KmUnmapSourceWindow(
+  PMEMORY_SOURCE source,
+  PMEMORY_WINDOW window)
+{
+  if (KmIsCaptureSource(source) == FALSE)
+  {
+    KmUnmapMemoryWindow(window);
+  }
+}
+
+NTSTATUS
+KmReadMemorySource(
+  PMEMORY_SOURCE source,
+  PVOID dst,
+  DWORD64 base,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  if (KmIsCaptureSource(source))
+  {
+    __try
+    {
+      // Reads may span adjacent regions, gaps fail like unreadable pages
+      DWORD32 offset = 0;
+      while (offset < size && NT_SUCCESS(status))
+      {
+        DWORD64 address = base + offset;
+        PMEMORY_CAPTURE_REGION region = KmFindCaptureRegion(source, address);
+        if (region && region->Base <= address)
+        {
+          DWORD32 count = (DWORD32)min((DWORD64)(size - offset), region->Base + region->Size - address);
+          RtlCopyMemory((PBYTE)dst + offset, source->View + region->Offset + (address - region->Base), count);
+          offset += count;
+        }
+        else
+        {
+          status = STATUS_INVALID_USER_BUFFER;
+        }
+      }
+    }
+    __except (EXCEPTION_EXECUTE_HANDLER)
+    {
+      status = STATUS_IN_PAGE_ERROR;
+    }
+  }
+  else
+  {
+    status = KmReadMemorySafe(dst, (PVOID)base, size);
+  }
+
+  return status;
+}
+
+///////////////////////////////////////////////////////////
+// Memory capture API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmBeginCapture(
+  PCAPTURE_WRITER writer,
+  PWCHAR path,
+  DWORD32 pid)
+{
+  NTSTATUS status = STATUS_UNSUCCESSFUL;
+
+  RtlZeroMemory(writer, sizeof(CAPTURE_WRITER));
+  writer->Header.Magic = MEMORY_CAPTURE_MAGIC;
+  writer->Header.Version = MEMORY_CAPTURE_VERSION;
+  writer->Header.Pid = pid;
+
+  // Page data starts behind the header page so views of the file keep page alignment
+  writer->Offset = PAGE_SIZE;
+
+  // Create file with the access rights of the caller, the header is written last
+  UNICODE_STRING name;
+  RtlInitUnicodeString(&name, path);
+  OBJECT_ATTRIBUTES attributes;
+  InitializeObjectAttributes(&attributes, &name, OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE | OBJ_FORCE_ACCESS_CHECK, NULL, NULL);
+  IO_STATUS_BLOCK io;
+  status = ZwCreateFile(&writer->File, GENERIC_WRITE | SYNCHRONIZE, &attributes, &io, NULL, FILE_ATTRIBUTE_NORMAL, 0, FILE_OVERWRITE_IF, FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE | FILE_SEQUENTIAL_ONLY, NULL, 0);
+  if (NT_SUCCESS(status) == FALSE)
+  {
+    writer->File = NULL;
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmAppendCapture(
+  PCAPTURE_WRITER writer,
+  PMEMORY_BASIC_INFORMATION mbi,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size)
+{
+  NTSTATUS status = STATUS_SUCCESS;
+
+  // Windows continuing the last region extend it, unreadable pages and attribute changes start a new one
+  PMEMORY_CAPTURE_REGION last = writer->Header.RegionCount ? &writer->Regions[writer->Header.RegionCount - 1] : NULL;
+  if (last == NULL || (last->Base + last->Size) != base || last->AllocationBase != (DWORD64)mbi->AllocationBase || last->Protect != mbi->Protect || last->Type != mbi->Type)
+  {
+    if (writer->Header.RegionCount == writer->Capacity)
+    {
+      // Double region capacity
+      DWORD32 capacity = writer->Capacity ? writer->Capacity * 2 : 0x100;
+      PMEMORY_CAPTURE_REGION regions = ExAllocatePoolWithTag(PagedPool, sizeof(MEMORY_CAPTURE_REGION) * capacity, KM_MEMORY_POOL_TAG);
+      if (regions)
+      {
+        if (writer->Regions)
+        {
+          RtlCopyMemory(regions, writer->Regions, sizeof(MEMORY_CAPTURE_REGION) * writer->Header.RegionCount);
+          ExFreePoolWithTag(writer->Regions, KM_MEMORY_POOL_TAG);
+        }
+        writer->Regions = regions;
+        writer->Capacity = capacity;
+      }
+      else
+      {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+      }
+    }
+
+    if (NT_SUCCESS(status))
+    {
+      last = &writer->Regions[writer->Header.RegionCount++];
+      last->Base = base;
+      last->AllocationBase = (DWORD64)mbi->AllocationBase;
+      last->Size = 0;
+      last->Offset = writer->Offset;
+      last->Protect = mbi->Protect;
+      last->Type = mbi->Type;
+    }
+  }
+
+  // Append page data
+  if (NT_SUCCESS(status))
+  {
+    status = KmWriteCapture(writer, writer->Offset, bytes, size);
+  }
+  if (NT_SUCCESS(status))
+  {
+    last->Size += size;
+    writer->Offset += size;
+    writer->Header.Bytes += size;
+  }
+
+  return status;
+}
+
+NTSTATUS
+KmEndCapture(
+  PCAPTURE_WRITER writer,
+  NTSTATUS status,
+  PMEMORY_CAPTURE capture)
+{
+  // Append region table and publish the header, failed captures keep an invalid header
+  if (NT_SUCCESS(status))
+  {
+    writer->Header.RegionOffset = writer->Offset;
+    if (writer->Header.RegionCount)
+    {
+      status = KmWriteCapture(writer, writer->Offset, writer->Regions, sizeof(MEMORY_CAPTURE_REGION) * writer->Header.RegionCount);
+    }
+  }
+  if (NT_SUCCESS(status))
+  {
+    status = KmWriteCapture(writer, 0, &writer->Header, sizeof(MEMORY_CAPTURE));
+  }
+  *capture = writer->Header;
+
+  // Close file and free region table
+  if (writer->File)
+  {
+    ZwClose(writer->File);
+  }
+  if (writer->Regions)
+  {
+    ExFreePoolWithTag(writer->Regions, KM_MEMORY_POOL_TAG);
+  }
+  RtlZeroMemory(writer, sizeof(CAPTURE_WRITER));
+
+  return status;
+}
\ No newline at end of file
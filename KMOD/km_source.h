@@ -0,0 +1,113 @@
+#ifndef KM_SOURCE_H
+#define KM_SOURCE_H
+
+#include <km_core.h>
+#include <km_ioctrl.h>
+#include <km_memory.h>
+
+///////////////////////////////////////////////////////////
+// Memory source data types
+///////////////////////////////////////////////////////////
+
+typedef struct _MEMORY_SOURCE
+{
+  PEPROCESS Process;
+  PVOID Section;
+  PBYTE View;
+  SIZE_T ViewSize;
+  PMEMORY_CAPTURE_REGION Regions;
+  DWORD32 RegionCount;
+} MEMORY_SOURCE, * PMEMORY_SOURCE;
+
+typedef struct _CAPTURE_WRITER
+{
+  HANDLE File;
+  MEMORY_CAPTURE Header;
+  PMEMORY_CAPTURE_REGION Regions;
+  DWORD32 Capacity;
+  DWORD64 Offset;
+} CAPTURE_WRITER, * PCAPTURE_WRITER;
+
+///////////////////////////////////////////////////////////
+// Memory source API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmOpenProcessSource(
+  PMEMORY_SOURCE source,
+  DWORD32 pid);
+
+NTSTATUS
+KmOpenCaptureSource(
+  PMEMORY_SOURCE source,
+  PWCHAR path);
+
+VOID
+KmCloseMemorySource(
+  PMEMORY_SOURCE source);
+
+BOOLEAN
+KmIsCaptureSource(
+  PMEMORY_SOURCE source);
+
+VOID
+KmAttachMemorySource(
+  PMEMORY_SOURCE source,
+  PKAPC_STATE apc);
+
+VOID
+KmDetachMemorySource(
+  PMEMORY_SOURCE source,
+  PKAPC_STATE apc);
+
+NTSTATUS
+KmQueryMemorySource(
+  PMEMORY_SOURCE source,
+  DWORD64 address,
+  PMEMORY_BASIC_INFORMATION mbi);
+
+NTSTATUS
+KmMapSourceWindow(
+  PMEMORY_SOURCE source,
+  PMEMORY_WINDOW window,
+  DWORD64 base,
+  DWORD32 size,
+  PBYTE* mapped);
+
+VOID
+KmUnmapSourceWindow(
+  PMEMORY_SOURCE source,
+  PMEMORY_WINDOW window);
+
+NTSTATUS
+KmReadMemorySource(
+  PMEMORY_SOURCE source,
+  PVOID dst,
+  DWORD64 base,
+  DWORD32 size);
+
+///////////////////////////////////////////////////////////
+// Memory capture API
+///////////////////////////////////////////////////////////
+
+NTSTATUS
+KmBeginCapture(
+  PCAPTURE_WRITER writer,
+  PWCHAR path,
+  DWORD32 pid);
+
+NTSTATUS
+KmAppendCapture(
+  PCAPTURE_WRITER writer,
+  PMEMORY_BASIC_INFORMATION mbi,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size);
+
+NTSTATUS
+KmEndCapture(
+  PCAPTURE_WRITER writer,
+  NTSTATUS status,
+  PMEMORY_CAPTURE capture);
+
+#endif
\ No newline at end of file
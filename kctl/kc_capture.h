@@ -0,0 +1,637 @@
+#ifndef KC_CAPTURE_H
+#define KC_CAPTURE_H
+
+// Captures are scanned offline as well, only taking them and binding sessions to them requires the driver
+#include <kc_results.h>
+#ifndef _WIN32
+#include <algorithm>
+#include <memory>
+#endif
+
+// Offline scans match with the same kernels the driver runs
+#include <km_kernels.h>
+
+///////////////////////////////////////////////////////////
+// Memory capture format
+///////////////////////////////////////////////////////////
+
+// Captures written by the driver, see the memory capture format of the I/O control header
+#ifndef MEMORY_CAPTURE_MAGIC
+#define MEMORY_CAPTURE_MAGIC   0x50414D4B
+#define MEMORY_CAPTURE_VERSION 1
+#endif
+#define MEMORY_CAPTURE_PAGE_SIZE 0x1000
+
+#ifndef PF_AVX2_INSTRUCTIONS_AVAILABLE
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+#endif
+
+namespace kdbg::capture
+{
+  struct CaptureRegion
+  {
+    uint64_t Base;
+    uint64_t AllocationBase;
+    uint64_t Size;
+    uint64_t Offset;
+    uint32_t Protect;
+    uint32_t Type;
+  };
+
+  struct CaptureHeader
+  {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Pid;
+    uint32_t RegionCount;
+    uint64_t Bytes;
+    uint64_t RegionOffset;
+  };
+
+#ifdef _WIN32
+  static_assert(sizeof(CaptureRegion) == sizeof(MEMORY_CAPTURE_REGION) && sizeof(CaptureHeader) == sizeof(MEMORY_CAPTURE));
+#endif
+
+  ///////////////////////////////////////////////////////////
+  // Capture view
+  ///////////////////////////////////////////////////////////
+
+  // Captures are mapped read only, regions are validated once like the driver does
+  class CaptureView
+  {
+  public:
+    CaptureView() = default;
+    ~CaptureView() { Close(); }
+
+    CaptureView(const CaptureView&) = delete;
+    CaptureView& operator = (const CaptureView&) = delete;
+
+  public:
+    bool Open(const std::string& path)
+    {
+      Close();
+      uint64_t size = 0;
+#ifdef _WIN32
+      _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      LARGE_INTEGER fileSize = {};
+      if (_file != INVALID_HANDLE_VALUE && GetFileSizeEx(_file, &fileSize) && (uint64_t)fileSize.QuadPart >= sizeof(CaptureHeader))
+      {
+        size = (uint64_t)fileSize.QuadPart;
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        _view = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+      }
+#else
+      _file = open(path.c_str(), O_RDONLY);
+      struct stat fileStat = {};
+      if (_file >= 0 && fstat(_file, &fileStat) == 0 && (uint64_t)fileStat.st_size >= sizeof(CaptureHeader))
+      {
+        size = (uint64_t)fileStat.st_size;
+        _view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, _file, 0);
+        _view = (_view == MAP_FAILED) ? nullptr : _view;
+        _size = size;
+      }
+#endif
+      if (_view && Validate(size))
+      {
+        return true;
+      }
+      Close();
+      return false;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+      if (_view)
+      {
+        UnmapViewOfFile(_view);
+      }
+      if (_mapping)
+      {
+        CloseHandle(_mapping);
+      }
+      if (_file != INVALID_HANDLE_VALUE)
+      {
+        CloseHandle(_file);
+      }
+      _file = INVALID_HANDLE_VALUE;
+      _mapping = nullptr;
+#else
+      if (_view)
+      {
+        munmap(_view, _size);
+      }
+      if (_file >= 0)
+      {
+        close(_file);
+      }
+      _file = -1;
+      _size = 0;
+#endif
+      _view = nullptr;
+      _header = nullptr;
+      _regions = nullptr;
+    }
+
+  public:
+    inline const CaptureHeader& GetHeader() const { return *_header; }
+    inline const CaptureRegion* GetRegions() const { return _regions; }
+    inline uint32_t GetRegionCount() const { return _header ? _header->RegionCount : 0; }
+    inline const uint8_t* GetBytes(const CaptureRegion& region) const { return (const uint8_t*)_view + region.Offset; }
+
+    // Captured bytes of a range, values spanning two regions are not resolved
+    const uint8_t* Find(uint64_t address, uint64_t size) const
+    {
+      const CaptureRegion* end = _regions + GetRegionCount();
+      const CaptureRegion* region = std::partition_point(_regions, end, [address](const CaptureRegion& region) { return (region.Base + region.Size) <= address; });
+      if (region == end || address < region->Base || size > (region->Base + region->Size - address))
+      {
+        return nullptr;
+      }
+      return GetBytes(*region) + (address - region->Base);
+    }
+
+  private:
+    bool Validate(uint64_t size)
+    {
+      // Region table has to follow the page data, empty captures end with their header
+      _header = (const CaptureHeader*)_view;
+      bool valid = _header->Magic == MEMORY_CAPTURE_MAGIC && _header->Version == MEMORY_CAPTURE_VERSION;
+      valid = valid && _header->RegionOffset >= MEMORY_CAPTURE_PAGE_SIZE && (_header->RegionOffset % sizeof(uint64_t)) == 0;
+      valid = valid && (_header->RegionCount == 0 || (_header->RegionOffset <= size && _header->RegionCount <= ((size - _header->RegionOffset) / sizeof(CaptureRegion))));
+      if (valid == false)
+      {
+        return false;
+      }
+
+      // Regions have to be page aligned, ordered and backed by page data
+      _regions = (const CaptureRegion*)((const uint8_t*)_view + _header->RegionOffset);
+      for (uint32_t i = 0; i < _header->RegionCount && valid; i++)
+      {
+        const CaptureRegion& region = _regions[i];
+        valid = ((region.Base | region.Size | region.Offset) & (MEMORY_CAPTURE_PAGE_SIZE - 1)) == 0;
+        valid = valid && region.Size > 0 && region.Offset >= MEMORY_CAPTURE_PAGE_SIZE && region.Offset <= _header->RegionOffset && region.Size <= (_header->RegionOffset - region.Offset);
+        valid = valid && (region.Base + region.Size) > region.Base && (i == 0 || region.Base >= (_regions[i - 1].Base + _regions[i - 1].Size));
+      }
+      return valid;
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _file = -1;
+    size_t _size = 0;
+#endif
+    void* _view = nullptr;
+    const CaptureHeader* _header = nullptr;
+    const CaptureRegion* _regions = nullptr;
+  };
+
+  ///////////////////////////////////////////////////////////
+  // Capture compare
+  ///////////////////////////////////////////////////////////
+
+  static bool IsAvx2Supported()
+  {
+    // User mode threads always preserve the YMM state, only the processor has to support AVX2
+#ifdef _WIN32
+    return IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE) != FALSE;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+  }
+
+  static double LoadReal(const uint8_t* bytes, uint32_t width)
+  {
+    float narrow = 0.0f;
+    double wide = 0.0;
+    std::memcpy((width == sizeof(float)) ? (void*)&narrow : (void*)&wide, bytes, width);
+    return (width == sizeof(float)) ? narrow : wide;
+  }
+
+  static int64_t LoadValue(const uint8_t* bytes, uint32_t width)
+  {
+    alignas(int64_t) BYTE value[sizeof(int64_t)] = {};
+    std::memcpy(value, bytes, width);
+    return KmLoadCompareValue(value, width);
+  }
+
+  // Values, predicates, patterns and text compiled like the driver compiles them, groups are only scanned by the driver
+  class Compare
+  {
+  public:
+    static constexpr uint32_t MaxOffsets = KM_SCAN_BLOCK_SIZE + KM_PATTERN_MAX_LENGTH;
+
+  public:
+    bool Begin(uint32_t type, uint32_t alignment, uint32_t rounding, double tolerance, uint32_t textCase, const uint8_t* value, uint32_t size)
+    {
+      Reset();
+      bool valid = false;
+      if (type == SCAN_TYPE_BYTES)
+      {
+        // Patterns carry their bytes followed by their masks
+        _pattern = std::make_unique<PATTERN>();
+        valid = (size % 2) == 0 && KmGetCompareAlignment(type, alignment) && KmCompilePattern(_pattern.get(), (PBYTE)value, (PBYTE)value + (size / 2), size / 2);
+        _width = valid ? _pattern->Length : 0;
+        _alignment = 1;
+      }
+      else if (KmIsTextCompare(type))
+      {
+        // Text arrives as UTF-16 and is compiled once per requested encoding
+        std::vector<WCHAR> text(size / sizeof(WCHAR));
+        std::memcpy(text.data(), value, text.size() * sizeof(WCHAR));
+        BOOLEAN ignoreCase = textCase == SCAN_CASE_INSENSITIVE;
+        valid = (size % sizeof(WCHAR)) == 0 && KmGetCompareAlignment(type, alignment);
+        _pattern = std::make_unique<PATTERN>();
+        if (valid && type == SCAN_TYPE_TEXT)
+        {
+          // Text beyond the first code page has no narrow encoding and is searched wide only
+          _widePattern = std::make_unique<PATTERN>();
+          valid = KmCompileText(_widePattern.get(), text.data(), (DWORD32)text.size(), TRUE, ignoreCase);
+          if (valid && !KmCompileText(_pattern.get(), text.data(), (DWORD32)text.size(), FALSE, ignoreCase))
+          {
+            _pattern = std::move(_widePattern);
+          }
+          _scratch.resize(MaxOffsets * 2);
+        }
+        else if (valid)
+        {
+          valid = KmCompileText(_pattern.get(), text.data(), (DWORD32)text.size(), type == SCAN_TYPE_UTF16, ignoreCase);
+        }
+
+        // The wide encoding is the longest and determines how far matches reach
+        _width = valid ? (_widePattern ? _widePattern->Length : _pattern->Length) : 0;
+        _alignment = 1;
+      }
+      else if (KmGetCompareWidth(type) && size >= KmGetCompareWidth(type) && KmGetCompareAlignment(type, alignment))
+      {
+        _width = KmGetCompareWidth(type);
+        _alignment = KmGetCompareAlignment(type, alignment);
+        _routine = KmGetCompareKernel(type, IsAvx2Supported());
+        valid = true;
+        if (KmIsRealCompare(type))
+        {
+          // Real types compare against a closed range
+          double low = 0.0;
+          double high = 0.0;
+          valid = KmGetRealRange(rounding, LoadReal(value, _width), tolerance, &low, &high);
+          KmStoreRealRange(_value, _width, low, high);
+        }
+        else
+        {
+          // Integer types compare bitwise
+          std::memcpy(_value, value, _width);
+        }
+      }
+
+      if (!valid)
+      {
+        Reset();
+      }
+      return valid;
+    }
+
+    bool BeginPredicate(uint32_t type, uint32_t alignment, uint32_t rounding, double tolerance, const SCAN_PREDICATE& predicate)
+    {
+      Reset();
+      bool valid = false;
+      SCAN_PREDICATE request = predicate;
+      if (KmGetCompareWidth(type) && KmGetCompareAlignment(type, alignment))
+      {
+        switch (request.Type)
+        {
+          case SCAN_PREDICATE_EQUAL:
+          case SCAN_PREDICATE_NOT_EQUAL:
+          {
+            // Equality keeps the exact kernels, inequality reports the aligned offsets they reject
+            valid = Begin(type, alignment, rounding, tolerance, SCAN_CASE_SENSITIVE, request.Operand, sizeof(request.Operand));
+            _invert = valid && request.Type == SCAN_PREDICATE_NOT_EQUAL;
+            _scratch.resize(_invert ? MaxOffsets : 0);
+            break;
+          }
+          case SCAN_PREDICATE_LESS:
+          case SCAN_PREDICATE_GREATER:
+          case SCAN_PREDICATE_BETWEEN:
+          case SCAN_PREDICATE_MASK:
+          {
+            // Ordered and masked predicates reduce to a closed range
+            _width = KmGetCompareWidth(type);
+            _alignment = KmGetCompareAlignment(type, alignment);
+            if (KmIsRealCompare(type) && request.Type != SCAN_PREDICATE_MASK)
+            {
+              double low = 0.0;
+              double high = 0.0;
+              valid = KmGetRealPredicateRange(&request, _width, &low, &high);
+              KmStoreRealRange(_value, _width, low, high);
+              _routine = KmGetCompareKernel(type, IsAvx2Supported());
+            }
+            else
+            {
+              // Integers and bit masks over reals compare masked signed values of the same width
+              INT64 low = 0;
+              INT64 high = 0;
+              INT64 bits = 0;
+              valid = KmGetIntegerPredicateRange(&request, _width, &low, &high, &bits);
+              std::memcpy(_value, &low, _width);
+              std::memcpy(_value + _width, &high, _width);
+              std::memcpy(_value + _width * 2, &bits, _width);
+              _routine = KmGetRangeKernel(_width, IsAvx2Supported());
+            }
+            break;
+          }
+        }
+      }
+
+      if (!valid)
+      {
+        Reset();
+      }
+      return valid;
+    }
+
+    void Reset()
+    {
+      _routine = nullptr;
+      _pattern.reset();
+      _widePattern.reset();
+      _scratch.clear();
+      std::memset(_value, 0, sizeof(_value));
+      _width = 0;
+      _alignment = 0;
+      _invert = false;
+    }
+
+  public:
+    // Block relative start offsets in ascending order, blocks hold at most MaxOffsets bytes
+    uint32_t Match(const uint8_t* bytes, uint32_t size, uint32_t* offsets)
+    {
+      // Both encodings are matched on the same block and merged in address order
+      if (_widePattern)
+      {
+        PDWORD32 narrow = _scratch.data();
+        PDWORD32 wide = _scratch.data() + MaxOffsets;
+        DWORD32 narrowCount = KmMatchPattern(_pattern.get(), (PBYTE)bytes, size, narrow);
+        DWORD32 wideCount = KmMatchPattern(_widePattern.get(), (PBYTE)bytes, size, wide);
+        return KmMergeOffsets(narrow, narrowCount, wide, wideCount, offsets);
+      }
+
+      // Patterns use their own matcher
+      if (_pattern)
+      {
+        return KmMatchPattern(_pattern.get(), (PBYTE)bytes, size, offsets);
+      }
+
+      // Inverted compares report the complement of the kernel hits
+      if (_invert)
+      {
+        DWORD32 hitCount = _routine((PBYTE)bytes, size, _value, _alignment, _scratch.data());
+        return KmInvertOffsets(_scratch.data(), hitCount, size, _width, _alignment, offsets);
+      }
+
+      return _routine((PBYTE)bytes, size, (PBYTE)_value, _alignment, offsets);
+    }
+
+    bool MatchElement(const uint8_t* bytes) const
+    {
+      // Kernels fall through to their scalar tail for a single element
+      DWORD32 offset = 0;
+      bool match = _routine((PBYTE)bytes, _width, (PBYTE)_value, _alignment, &offset) != 0;
+      return match != _invert;
+    }
+
+  public:
+    inline bool IsValid() const { return _width > 0; }
+    inline uint32_t GetWidth() const { return _width; }
+    inline uint32_t GetAlignment() const { return _alignment; }
+    inline uint32_t GetReach() const { return _width - (std::min)(_alignment, _width); }
+
+  private:
+    SCAN_COMPARE_ROUTINE _routine = nullptr;
+    std::unique_ptr<PATTERN> _pattern = {};
+    std::unique_ptr<PATTERN> _widePattern = {};
+    std::vector<DWORD32> _scratch = {};
+    BYTE _value[24] = {};
+    uint32_t _width = 0;
+    uint32_t _alignment = 0;
+    bool _invert = false;
+  };
+
+  // Next scan filter, results are filtered the way the driver filters them on a live process
+  class Operand
+  {
+  public:
+    bool Begin(uint32_t type, uint32_t width, uint32_t filter, uint32_t rounding, double tolerance, const uint8_t* value, uint32_t size)
+    {
+      _filter = filter;
+      _width = width;
+      _real = KmIsRealCompare(type);
+      _value = 0;
+      _low = 0.0;
+      _high = 0.0;
+      _predicate.Reset();
+
+      // Changes are bitwise for every type, everything else needs the width of the type
+      switch (filter)
+      {
+        case SCAN_FILTER_CHANGED:
+        case SCAN_FILTER_UNCHANGED:
+        {
+          return true;
+        }
+        case SCAN_FILTER_INCREASED:
+        case SCAN_FILTER_DECREASED:
+        {
+          return width > 0 && width == KmGetCompareWidth(type);
+        }
+        case SCAN_FILTER_PREDICATE:
+        {
+          // Predicates are compiled into a compare kernel
+          SCAN_PREDICATE predicate = {};
+          std::memcpy(&predicate, value, (std::min<size_t>)(size, sizeof(SCAN_PREDICATE)));
+          return size == sizeof(SCAN_PREDICATE) && width == KmGetCompareWidth(type) && _predicate.BeginPredicate(type, SCAN_ALIGNMENT_NATURAL, rounding, tolerance, predicate);
+        }
+        case SCAN_FILTER_EXACT:
+        case SCAN_FILTER_INCREASED_BY:
+        case SCAN_FILTER_DECREASED_BY:
+        {
+          // Real operands match a closed range depending on the rounding mode
+          if (width == 0 || width != KmGetCompareWidth(type) || size < width)
+          {
+            return false;
+          }
+          if (_real)
+          {
+            return KmGetRealRange(rounding, LoadReal(value, width), tolerance, &_low, &_high);
+          }
+          _value = LoadValue(value, width);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool Evaluate(const uint8_t* previous, const uint8_t* current) const
+    {
+      // Changes are detected bitwise for every type
+      switch (_filter)
+      {
+        case SCAN_FILTER_CHANGED: return std::memcmp(previous, current, _width) != 0;
+        case SCAN_FILTER_UNCHANGED: return std::memcmp(previous, current, _width) == 0;
+        case SCAN_FILTER_PREDICATE: return _predicate.MatchElement(current);
+      }
+
+      if (_real)
+      {
+        // Ordered compares, NaN fails every numeric filter
+        double before = LoadReal(previous, _width);
+        double after = LoadReal(current, _width);
+        switch (_filter)
+        {
+          case SCAN_FILTER_EXACT: return after >= _low && after <= _high;
+          case SCAN_FILTER_INCREASED: return after > before;
+          case SCAN_FILTER_DECREASED: return after < before;
+          case SCAN_FILTER_INCREASED_BY: return (after - before) >= _low && (after - before) <= _high;
+          case SCAN_FILTER_DECREASED_BY: return (before - after) >= _low && (before - after) <= _high;
+        }
+      }
+      else
+      {
+        // Differences wrap around at the scanned width
+        int64_t before = LoadValue(previous, _width);
+        int64_t after = LoadValue(current, _width);
+        uint64_t mask = (_width < sizeof(uint64_t)) ? ((1ULL << (_width * 8)) - 1) : UINT64_MAX;
+        switch (_filter)
+        {
+          case SCAN_FILTER_EXACT: return after == _value;
+          case SCAN_FILTER_INCREASED: return after > before;
+          case SCAN_FILTER_DECREASED: return after < before;
+          case SCAN_FILTER_INCREASED_BY: return (((uint64_t)after - (uint64_t)before - (uint64_t)_value) & mask) == 0;
+          case SCAN_FILTER_DECREASED_BY: return (((uint64_t)before - (uint64_t)after - (uint64_t)_value) & mask) == 0;
+        }
+      }
+      return false;
+    }
+
+  public:
+    inline uint32_t GetWidth() const { return _width; }
+
+  private:
+    uint32_t _filter = 0;
+    uint32_t _width = 0;
+    bool _real = false;
+    int64_t _value = 0;
+    double _low = 0.0;
+    double _high = 0.0;
+    Compare _predicate = {};
+  };
+
+  ///////////////////////////////////////////////////////////
+  // Capture scanning
+  ///////////////////////////////////////////////////////////
+
+  // First scan over every captured region, fixed width matches are written with their value into a result file
+  static bool Scan(const CaptureView& capture, Compare& compare, uint32_t type, const std::string& path)
+  {
+    uint32_t width = KmGetCompareWidth(type);
+    results::FileWriter writer = {};
+    bool written = compare.IsValid() && writer.Open(path, capture.GetHeader().Pid, type, width);
+    std::vector<uint32_t> offsets(Compare::MaxOffsets);
+    std::vector<uint64_t> bases(Compare::MaxOffsets);
+    std::vector<uint8_t> values(Compare::MaxOffsets * sizeof(uint64_t));
+    for (uint32_t i = 0; i < capture.GetRegionCount() && written; i++)
+    {
+      // Scan region block wise, unaligned values may straddle into the next block but not into the next region
+      const CaptureRegion& region = capture.GetRegions()[i];
+      const uint8_t* bytes = capture.GetBytes(region);
+      for (uint64_t offset = 0; offset < region.Size && written; offset += KM_SCAN_BLOCK_SIZE)
+      {
+        uint32_t blockSize = (uint32_t)(std::min<uint64_t>)(KM_SCAN_BLOCK_SIZE + compare.GetReach(), region.Size - offset);
+        uint32_t count = compare.Match(bytes + offset, blockSize, offsets.data());
+
+        // Starts inside the reach belong to the next block
+        count = KmTrimOffsets(offsets.data(), count, (uint32_t)(std::min<uint64_t>)(KM_SCAN_BLOCK_SIZE, region.Size - offset));
+        for (uint32_t j = 0; j < count; j++)
+        {
+          bases[j] = region.Base + offset + offsets[j];
+          std::memcpy(&values[(size_t)j * width], bytes + offset + offsets[j], width);
+        }
+        written = writer.Append(bases.data(), values.data(), count);
+      }
+    }
+    return writer.Close() && written;
+  }
+
+  // Pointer scan over every captured region, naturally aligned qwords targeting captured memory inside [base, base + size) are kept
+  static bool ScanPointers(const CaptureView& capture, uint64_t base, uint64_t size, const std::string& path)
+  {
+    results::FileWriter writer = {};
+    bool written = writer.Open(path, capture.GetHeader().Pid, SCAN_TYPE_BYTE64, sizeof(uint64_t));
+    uint32_t regionCount = capture.GetRegionCount();
+    if (regionCount == 0)
+    {
+      return writer.Close() && written;
+    }
+
+    // Range kernel drops everything outside the captured span first, survivors are looked up in the region table
+    const CaptureRegion& first = capture.GetRegions()[0];
+    const CaptureRegion& last = capture.GetRegions()[regionCount - 1];
+    uint64_t low = (std::max)(base, first.Base);
+    uint64_t high = (std::min)(size ? base + (size - 1) : UINT64_MAX, last.Base + last.Size - 1);
+    high = (std::min<uint64_t>)(high, INT64_MAX);
+    INT64 range[3] = { (INT64)low, (INT64)high, -1 };
+    SCAN_COMPARE_ROUTINE routine = KmGetRangeKernel(sizeof(INT64), IsAvx2Supported());
+
+    std::vector<uint32_t> offsets(Compare::MaxOffsets);
+    std::vector<uint64_t> bases(Compare::MaxOffsets);
+    std::vector<uint64_t> values(Compare::MaxOffsets);
+    for (uint32_t i = 0; i < regionCount && written && low <= high; i++)
+    {
+      // Regions are page aligned, qwords never straddle blocks
+      const CaptureRegion& region = capture.GetRegions()[i];
+      const uint8_t* bytes = capture.GetBytes(region);
+      for (uint64_t offset = 0; offset < region.Size && written; offset += KM_SCAN_BLOCK_SIZE)
+      {
+        uint32_t blockSize = (uint32_t)(std::min<uint64_t>)(KM_SCAN_BLOCK_SIZE, region.Size - offset);
+        uint32_t hitCount = routine((PBYTE)bytes + offset, blockSize, (PBYTE)range, sizeof(uint64_t), offsets.data());
+        uint32_t count = 0;
+        for (uint32_t j = 0; j < hitCount; j++)
+        {
+          uint64_t target = 0;
+          std::memcpy(&target, bytes + offset + offsets[j], sizeof(uint64_t));
+          if (capture.Find(target, 1))
+          {
+            bases[count] = region.Base + offset + offsets[j];
+            values[count++] = target;
+          }
+        }
+        written = writer.Append(bases.data(), (const uint8_t*)values.data(), count);
+      }
+    }
+    return writer.Close() && written;
+  }
+
+  // Next scan of a result file against a later capture, the operand sees previous and current value
+  static bool Next(const results::FileView& previous, const CaptureView& capture, const Operand& operand, const std::string& path)
+  {
+    const results::FileHeader& header = previous.GetHeader();
+    results::FileWriter writer = {};
+    bool written = operand.GetWidth() == header.ValueSize && writer.Open(path, header.Pid, header.Type, header.ValueSize);
+    results::FileCursor cursor(previous);
+    for (; cursor.IsValid() && written; cursor.Next())
+    {
+      // Results outside the capture are dropped like unreadable pages
+      const uint8_t* current = capture.Find(cursor.GetBase(), header.ValueSize);
+      if (current && operand.Evaluate(cursor.GetValue(), current))
+      {
+        uint64_t base = cursor.GetBase();
+        written = writer.Append(&base, current, 1);
+      }
+    }
+    written = written && !cursor.IsFailed();
+    return writer.Close() && written;
+  }
+}
+
+#endif
\ No newline at end of file
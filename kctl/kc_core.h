@@ -17,6 +17,14 @@
 #include <vector>
 #include <algorithm>
 #include <format>
+#include <bit>
+#include <cstring>
+#include <unordered_set>
+#include <thread>
+#include <future>
+#include <execution>
+#include <functional>
+#include <memory>
 
 ///////////////////////////////////////////////////////////
 // Windows library
@@ -27,6 +35,8 @@
 #include <winioctl.h>
 #include <fileapi.h>
 #include <handleapi.h>
+#include <memoryapi.h>
+#include <stringapiset.h>
 #include <tlhelp32.h>
 
 #endif
\ No newline at end of file
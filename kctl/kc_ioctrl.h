@@ -1,7 +1,14 @@
 #ifndef KC_IOCTRL_H
 #define KC_IOCTRL_H
 
+// Request and response types are used offline as well, only the I/O utilities require the driver
+#ifdef _WIN32
 #include <kc_core.h>
+#else
+#include <km_platform.h>
+#endif
+
+#ifdef _WIN32
 
 ///////////////////////////////////////////////////////////
 // Externals
@@ -9,6 +16,8 @@
 
 extern HANDLE g_driverHandle;
 
+#endif
+
 ///////////////////////////////////////////////////////////
 // I/O control codes
 ///////////////////////////////////////////////////////////
@@ -21,12 +30,70 @@ extern HANDLE g_driverHandle;
 #define IOCTRL_READ_PROCESS_MEMORY   CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0202, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_READ_KERNEL_MEMORY    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0203, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_READ_SCAN_RESULTS     CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0204, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_READ_SCAN_VALUES      CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0205, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_READ_PROCESS_VALUES   CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0206, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_READ_SIGNATURES       CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0207, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 
 #define IOCTRL_WRITE_PROCESS_MEMORY  CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0300, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_WRITE_KERNEL_MEMORY   CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0301, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 
 #define IOCTRL_SCAN_PROCESS_FIRST    CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0400, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
 #define IOCTRL_SCAN_PROCESS_NEXT     CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0401, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_SIGNATURES       CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0402, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_PROGRESS         CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0403, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_CANCEL           CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0404, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_UNDO             CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0405, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_REDO             CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0406, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_POINTERS         CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0407, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_IMPORT           CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0408, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_CAPTURE          CTL_CODE(FILE_DEVICE_UNKNOWN, 0x0409, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+#define IOCTRL_SCAN_SOURCE           CTL_CODE(FILE_DEVICE_UNKNOWN, 0x040A, METHOD_BUFFERED, FILE_SPECIAL_ACCESS)
+
+///////////////////////////////////////////////////////////
+// Signature set format
+///////////////////////////////////////////////////////////
+
+// Sets are a header followed by signatures, key offsets, anchors and pattern bytes
+#define SIGNATURE_SET_MAGIC   0x4749534B
+#define SIGNATURE_SET_VERSION 1
+#define SIGNATURE_SET_KEYS    0x10000
+
+///////////////////////////////////////////////////////////
+// Group scan format
+///////////////////////////////////////////////////////////
+
+// Groups are matched relative to their start, members without offset may be anywhere inside the window
+#define SCAN_GROUP_MAX_MEMBERS 8
+#define SCAN_GROUP_MAX_WINDOW  0x100
+#define SCAN_GROUP_ANY_OFFSET  0xFFFFFFFF
+
+///////////////////////////////////////////////////////////
+// Region filter format
+///////////////////////////////////////////////////////////
+
+// Regions have to carry every requested flag, a cleared filter scans all readable regions
+#define SCAN_REGION_WRITABLE   0x1
+#define SCAN_REGION_EXECUTABLE 0x2
+#define SCAN_REGION_PRIVATE    0x4
+#define SCAN_REGION_IMAGE      0x8
+#define SCAN_REGION_MAPPED     0x10
+
+///////////////////////////////////////////////////////////
+// Result import format
+///////////////////////////////////////////////////////////
+
+// Imports are streamed in batches, addresses follow the request and values follow the addresses
+#define SCAN_IMPORT_BEGIN 0x1
+#define SCAN_IMPORT_END   0x2
+
+///////////////////////////////////////////////////////////
+// Memory capture format
+///////////////////////////////////////////////////////////
+
+// Captures are a page sized header followed by the page data of every region and a trailing region table
+#define MEMORY_CAPTURE_MAGIC    0x50414D4B
+#define MEMORY_CAPTURE_VERSION  1
+#define MEMORY_CAPTURE_MAX_PATH 260
 
 ///////////////////////////////////////////////////////////
 // I/O request data types
@@ -38,8 +105,70 @@ typedef enum _SCAN_TYPE
   SCAN_TYPE_BYTE16,
   SCAN_TYPE_BYTE32,
   SCAN_TYPE_BYTE64,
+  SCAN_TYPE_FLOAT32,
+  SCAN_TYPE_FLOAT64,
+  SCAN_TYPE_BYTES,
+  SCAN_TYPE_ASCII,
+  SCAN_TYPE_UTF16,
+  SCAN_TYPE_TEXT,
+  SCAN_TYPE_GROUP,
 } SCAN_TYPE, * PSCAN_TYPE;
 
+typedef enum _SCAN_FILTER
+{
+  SCAN_FILTER_EXACT,
+  SCAN_FILTER_CHANGED,
+  SCAN_FILTER_UNCHANGED,
+  SCAN_FILTER_INCREASED,
+  SCAN_FILTER_DECREASED,
+  SCAN_FILTER_INCREASED_BY,
+  SCAN_FILTER_DECREASED_BY,
+  SCAN_FILTER_UNKNOWN,
+  SCAN_FILTER_PREDICATE,
+} SCAN_FILTER, * PSCAN_FILTER;
+
+typedef enum _SCAN_ALIGNMENT
+{
+  SCAN_ALIGNMENT_NATURAL = 0,
+  SCAN_ALIGNMENT_BYTE8 = 1,
+  SCAN_ALIGNMENT_BYTE16 = 2,
+  SCAN_ALIGNMENT_BYTE32 = 4,
+  SCAN_ALIGNMENT_BYTE64 = 8,
+} SCAN_ALIGNMENT, * PSCAN_ALIGNMENT;
+
+typedef enum _SCAN_STATE
+{
+  SCAN_STATE_IDLE,
+  SCAN_STATE_RUNNING,
+  SCAN_STATE_DONE,
+  SCAN_STATE_CANCELLED,
+  SCAN_STATE_FAILED,
+} SCAN_STATE, * PSCAN_STATE;
+
+typedef enum _SCAN_ROUNDING
+{
+  SCAN_ROUNDING_EXACT,
+  SCAN_ROUNDING_ROUNDED,
+  SCAN_ROUNDING_TRUNCATED,
+  SCAN_ROUNDING_EPSILON,
+} SCAN_ROUNDING, * PSCAN_ROUNDING;
+
+typedef enum _SCAN_CASE
+{
+  SCAN_CASE_SENSITIVE,
+  SCAN_CASE_INSENSITIVE,
+} SCAN_CASE, * PSCAN_CASE;
+
+typedef enum _SCAN_PREDICATE_TYPE
+{
+  SCAN_PREDICATE_EQUAL,
+  SCAN_PREDICATE_NOT_EQUAL,
+  SCAN_PREDICATE_LESS,
+  SCAN_PREDICATE_GREATER,
+  SCAN_PREDICATE_BETWEEN,
+  SCAN_PREDICATE_MASK,
+} SCAN_PREDICATE_TYPE, * PSCAN_PREDICATE_TYPE;
+
 typedef struct _READ_PROCESS_MEMORY
 {
   DWORD32 Pid;
@@ -51,6 +180,17 @@ typedef struct _READ_KERNEL_MEMORY
   DWORD64 Base;
   DWORD32 Size;
 } READ_KERNEL_MEMORY, * PREAD_KERNEL_MEMORY;
+typedef struct _READ_SCAN_RESULTS
+{
+  DWORD64 Offset;
+  DWORD32 Count;
+} READ_SCAN_RESULTS, * PREAD_SCAN_RESULTS;
+typedef struct _READ_PROCESS_VALUES
+{
+  DWORD32 Pid;
+  DWORD32 Count;
+  DWORD32 Width;
+} READ_PROCESS_VALUES, * PREAD_PROCESS_VALUES;
 
 typedef struct _WRITE_PROCESS_MEMORY
 {
@@ -66,6 +206,14 @@ typedef struct _WRITE_KERNEL_MEMORY
   PVOID Buffer;
 } WRITE_KERNEL_MEMORY, * PWRITE_KERNEL_MEMORY;
 
+typedef struct _SCAN_REGION_FILTER
+{
+  DWORD32 Flags;
+  DWORD64 Start;
+  DWORD64 End;
+  DWORD64 Module;
+} SCAN_REGION_FILTER, * PSCAN_REGION_FILTER;
+
 typedef struct _SCAN_PROCESS_FIRST
 {
   DWORD32 Pid;
@@ -73,11 +221,111 @@ typedef struct _SCAN_PROCESS_FIRST
   DWORD32 Size;
   PVOID Buffer;
   DWORD32 Type;
+  DWORD32 Filter;
+  DWORD32 Alignment;
+  DWORD32 Rounding;
+  double Tolerance;
+  DWORD32 Case;
+  SCAN_REGION_FILTER Regions;
 } SCAN_PROCESS_FIRST, * PSCAN_PROCESS_FIRST;
 typedef struct _SCAN_PROCESS_NEXT
 {
   DWORD32 Pid;
+  DWORD32 Size;
+  PVOID Buffer;
+  DWORD32 Filter;
+  DWORD32 Rounding;
+  double Tolerance;
 } SCAN_PROCESS_NEXT, * PSCAN_PROCESS_NEXT;
+typedef struct _SCAN_SIGNATURES
+{
+  DWORD32 Pid;
+  DWORD64 Base;
+  DWORD64 Size;
+  DWORD32 Limit;
+  DWORD32 SetSize;
+  PVOID Set;
+} SCAN_SIGNATURES, * PSCAN_SIGNATURES;
+typedef struct _SCAN_POINTERS
+{
+  DWORD32 Pid;
+  DWORD64 Base;
+  DWORD64 Size;
+} SCAN_POINTERS, * PSCAN_POINTERS;
+typedef struct _SCAN_IMPORT
+{
+  DWORD32 Type;
+  DWORD32 ValueSize;
+  DWORD32 Count;
+  DWORD32 Flags;
+} SCAN_IMPORT, * PSCAN_IMPORT;
+typedef struct _SCAN_CAPTURE
+{
+  DWORD32 Pid;
+  SCAN_REGION_FILTER Regions;
+  WCHAR Path[MEMORY_CAPTURE_MAX_PATH];
+} SCAN_CAPTURE, * PSCAN_CAPTURE;
+typedef struct _SCAN_SOURCE
+{
+  WCHAR Path[MEMORY_CAPTURE_MAX_PATH];
+} SCAN_SOURCE, * PSCAN_SOURCE;
+
+typedef struct _SCAN_GROUP_MEMBER
+{
+  DWORD32 Type;
+  DWORD32 Offset;
+  BYTE Value[8];
+} SCAN_GROUP_MEMBER, * PSCAN_GROUP_MEMBER;
+
+typedef struct _SCAN_GROUP
+{
+  DWORD32 Window;
+  DWORD32 Count;
+  SCAN_GROUP_MEMBER Members[SCAN_GROUP_MAX_MEMBERS];
+} SCAN_GROUP, * PSCAN_GROUP;
+
+typedef struct _SCAN_PREDICATE
+{
+  DWORD32 Type;
+  BYTE Operand[8];
+  BYTE Limit[8];
+} SCAN_PREDICATE, * PSCAN_PREDICATE;
+
+typedef struct _SIGNATURE
+{
+  DWORD32 Offset;
+  DWORD32 Length;
+  DWORD32 Anchor;
+} SIGNATURE, * PSIGNATURE;
+typedef struct _SIGNATURE_SET
+{
+  DWORD32 Magic;
+  DWORD32 Version;
+  DWORD32 Size;
+  DWORD32 SignatureCount;
+  DWORD32 AnchorCount;
+  DWORD32 PatternSize;
+  DWORD64 SourceHash;
+} SIGNATURE_SET, * PSIGNATURE_SET;
+
+typedef struct _MEMORY_CAPTURE_REGION
+{
+  DWORD64 Base;
+  DWORD64 AllocationBase;
+  DWORD64 Size;
+  DWORD64 Offset;
+  DWORD32 Protect;
+  DWORD32 Type;
+} MEMORY_CAPTURE_REGION, * PMEMORY_CAPTURE_REGION;
+typedef struct _MEMORY_CAPTURE
+{
+  DWORD32 Magic;
+  DWORD32 Version;
+  DWORD32 Pid;
+  DWORD32 RegionCount;
+  DWORD64 Bytes;
+  DWORD64 RegionOffset;
+} MEMORY_CAPTURE, * PMEMORY_CAPTURE;
 
 ///////////////////////////////////////////////////////////
 // I/O response data types
@@ -95,6 +343,30 @@ typedef struct _KERNEL_IMAGE
   DWORD32 Size;
   CHAR Name[260];
 } KERNEL_IMAGE, * PKERNEL_IMAGE;
+typedef struct _SCAN_SUMMARY
+{
+  DWORD64 Results;
+  DWORD64 Candidates;
+  DWORD64 Bytes;
+  DWORD32 ValueSize;
+} SCAN_SUMMARY, * PSCAN_SUMMARY;
+typedef struct _SCAN_PROGRESS
+{
+  DWORD32 State;
+  LONG Status;
+  DWORD64 Bytes;
+  DWORD64 Regions;
+  DWORD64 RegionCount;
+  DWORD64 Hits;
+  SCAN_SUMMARY Summary;
+} SCAN_PROGRESS, * PSCAN_PROGRESS;
+typedef struct _SIGNATURE_MATCH
+{
+  DWORD32 Signature;
+  DWORD64 Address;
+} SIGNATURE_MATCH, * PSIGNATURE_MATCH;
+
+#ifdef _WIN32
 
 ///////////////////////////////////////////////////////////
 // I/O utilities
@@ -146,6 +418,24 @@ namespace kdbg::ioctrl
     DeviceIoControl(g_driverHandle, IOCTRL_READ_PROCESS_MEMORY, &request, sizeof(READ_PROCESS_MEMORY), buffer, sizeof(T) * count, nullptr, nullptr);
   }
 
+  static void ReadProcessValues(DWORD32 pid, const DWORD64* bases, DWORD32 count, DWORD32 width, std::vector<BYTE>& values)
+  {
+    values.clear();
+    if (count > 0 && width > 0)
+    {
+      // Addresses follow the request, values of all of them come back in one go
+      READ_PROCESS_VALUES header{ pid, count, width };
+      std::vector<BYTE> request(sizeof(READ_PROCESS_VALUES) + sizeof(DWORD64) * count);
+      std::memcpy(&request[0], &header, sizeof(READ_PROCESS_VALUES));
+      std::memcpy(&request[sizeof(READ_PROCESS_VALUES)], bases, sizeof(DWORD64) * count);
+      values.resize((size_t)count * width);
+      if (!DeviceIoControl(g_driverHandle, IOCTRL_READ_PROCESS_VALUES, &request[0], (DWORD)request.size(), &values[0], (DWORD)values.size(), nullptr, nullptr))
+      {
+        values.clear();
+      }
+    }
+  }
+
   // Read kernel memory
 
   template<typename T>
@@ -198,26 +488,208 @@ namespace kdbg::ioctrl
 
   // Scan process memory
 
-  template<typename T>
-  static void ScanProcessFirst(DWORD32 pid, DWORD64 base, T value, SCAN_TYPE type, std::vector<DWORD64>& scans)
+  // Every handle to the driver owns an independent scan session
+
+  static HANDLE OpenScanSession()
+  {
+    return CreateFileA("\\\\.\\KMOD", GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, 0, 0);
+  }
+
+  static void CloseScanSession(HANDLE session)
+  {
+    if (session != INVALID_HANDLE_VALUE)
+    {
+      CloseHandle(session);
+    }
+  }
+
+  static void ReadScanResults(HANDLE session, DWORD64 offset, DWORD32 count, std::vector<DWORD64>& scans)
   {
-    SCAN_PROCESS_FIRST request{ pid, base, sizeof(T), &value, (DWORD32)type };
-    DWORD32 count = 0;
-    DeviceIoControl(g_driverHandle, IOCTRL_SCAN_PROCESS_FIRST, &request, sizeof(SCAN_PROCESS_FIRST), &count, sizeof(DWORD32), nullptr, nullptr);
     scans.clear();
     if (count > 0)
     {
+      READ_SCAN_RESULTS request{ offset, count };
       scans.resize(count);
-      DeviceIoControl(g_driverHandle, IOCTRL_READ_SCAN_RESULTS, &count, sizeof(DWORD32), &scans[0], sizeof(DWORD64) * count, nullptr, nullptr);
+      if (!DeviceIoControl(session, IOCTRL_READ_SCAN_RESULTS, &request, sizeof(READ_SCAN_RESULTS), &scans[0], sizeof(DWORD64) * count, nullptr, nullptr))
+      {
+        scans.clear();
+      }
+    }
+  }
+
+  static void ReadScanValues(HANDLE session, DWORD64 offset, DWORD32 count, DWORD32 width, std::vector<BYTE>& values)
+  {
+    values.clear();
+    if (count > 0 && width > 0)
+    {
+      READ_SCAN_RESULTS request{ offset, count };
+      values.resize((size_t)count * width);
+      if (!DeviceIoControl(session, IOCTRL_READ_SCAN_VALUES, &request, sizeof(READ_SCAN_RESULTS), &values[0], (DWORD)values.size(), nullptr, nullptr))
+      {
+        values.clear();
+      }
+    }
+  }
+
+  template<typename T>
+  static bool ScanProcessFirst(HANDLE session, DWORD32 pid, DWORD64 base, T value, SCAN_TYPE type, SCAN_FILTER filter, SCAN_ALIGNMENT alignment, SCAN_ROUNDING rounding, double tolerance, const SCAN_REGION_FILTER& regions)
+  {
+    SCAN_PROCESS_FIRST request{ pid, base, sizeof(T), &value, (DWORD32)type, (DWORD32)filter, (DWORD32)alignment, (DWORD32)rounding, tolerance, SCAN_CASE_SENSITIVE, regions };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_FIRST, &request, sizeof(SCAN_PROCESS_FIRST), nullptr, 0, nullptr, nullptr);
+  }
+
+  template<typename T>
+  static SCAN_PREDICATE MakePredicate(SCAN_PREDICATE_TYPE type, T operand, T limit)
+  {
+    SCAN_PREDICATE predicate{ (DWORD32)type };
+    std::memcpy(predicate.Operand, &operand, sizeof(T));
+    std::memcpy(predicate.Limit, &limit, sizeof(T));
+    return predicate;
+  }
+
+  static bool ScanProcessPredicate(HANDLE session, DWORD32 pid, DWORD64 base, const SCAN_PREDICATE& predicate, SCAN_TYPE type, SCAN_ALIGNMENT alignment, SCAN_ROUNDING rounding, double tolerance, const SCAN_REGION_FILTER& regions)
+  {
+    SCAN_PROCESS_FIRST request{ pid, base, sizeof(SCAN_PREDICATE), (PVOID)&predicate, (DWORD32)type, SCAN_FILTER_PREDICATE, (DWORD32)alignment, (DWORD32)rounding, tolerance, SCAN_CASE_SENSITIVE, regions };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_FIRST, &request, sizeof(SCAN_PROCESS_FIRST), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool ScanProcessPattern(HANDLE session, DWORD32 pid, DWORD64 base, const std::vector<BYTE>& bytes, const std::vector<BYTE>& masks, const SCAN_REGION_FILTER& regions)
+  {
+    std::vector<BYTE> buffer = bytes;
+    buffer.insert(buffer.end(), masks.begin(), masks.end());
+    SCAN_PROCESS_FIRST request{ pid, base, (DWORD32)buffer.size(), buffer.data(), SCAN_TYPE_BYTES, SCAN_FILTER_EXACT, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_SENSITIVE, regions };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_FIRST, &request, sizeof(SCAN_PROCESS_FIRST), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool ScanProcessText(HANDLE session, DWORD32 pid, DWORD64 base, const std::wstring& text, SCAN_TYPE type, SCAN_CASE textCase, const SCAN_REGION_FILTER& regions)
+  {
+    SCAN_PROCESS_FIRST request{ pid, base, (DWORD32)(sizeof(WCHAR) * text.size()), (PVOID)text.data(), (DWORD32)type, SCAN_FILTER_EXACT, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, (DWORD32)textCase, regions };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_FIRST, &request, sizeof(SCAN_PROCESS_FIRST), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool ScanProcessGroup(HANDLE session, DWORD32 pid, DWORD64 base, const SCAN_GROUP& group, SCAN_ALIGNMENT alignment, SCAN_ROUNDING rounding, double tolerance, const SCAN_REGION_FILTER& regions)
+  {
+    SCAN_PROCESS_FIRST request{ pid, base, sizeof(SCAN_GROUP), (PVOID)&group, SCAN_TYPE_GROUP, SCAN_FILTER_EXACT, (DWORD32)alignment, (DWORD32)rounding, tolerance, SCAN_CASE_SENSITIVE, regions };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_FIRST, &request, sizeof(SCAN_PROCESS_FIRST), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool ScanSignatures(HANDLE session, DWORD32 pid, DWORD64 base, DWORD64 size, const std::vector<BYTE>& set, DWORD32 limit)
+  {
+    SCAN_SIGNATURES request{ pid, base, size, limit, (DWORD32)set.size(), (PVOID)set.data() };
+    return DeviceIoControl(session, IOCTRL_SCAN_SIGNATURES, &request, sizeof(SCAN_SIGNATURES), nullptr, 0, nullptr, nullptr);
+  }
+
+  static std::vector<std::vector<DWORD64>> ReadSignatures(HANDLE session, DWORD32 signatureCount, DWORD32 limit)
+  {
+    // Matches of the last completed signature scan, grouped by signature
+    std::vector<std::vector<DWORD64>> table(signatureCount);
+    if (signatureCount > 0 && limit > 0)
+    {
+      READ_SCAN_RESULTS request{ 0, signatureCount * limit };
+      std::vector<SIGNATURE_MATCH> matches(request.Count);
+      DWORD written = 0;
+      if (DeviceIoControl(session, IOCTRL_READ_SIGNATURES, &request, sizeof(READ_SCAN_RESULTS), matches.data(), (DWORD)(sizeof(SIGNATURE_MATCH) * matches.size()), &written, nullptr))
+      {
+        for (size_t i = 0; i < (written / sizeof(SIGNATURE_MATCH)); i++)
+        {
+          if (matches[i].Signature < signatureCount)
+          {
+            table[matches[i].Signature].push_back(matches[i].Address);
+          }
+        }
+      }
     }
+    return table;
   }
 
   template<typename T>
-  static void ScanProcessNext(DWORD32 pid)
+  static bool ScanProcessNext(HANDLE session, DWORD32 pid, T value, SCAN_FILTER filter, SCAN_ROUNDING rounding, double tolerance)
+  {
+    SCAN_PROCESS_NEXT request{ pid, sizeof(T), &value, (DWORD32)filter, (DWORD32)rounding, tolerance };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_NEXT, &request, sizeof(SCAN_PROCESS_NEXT), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool ScanNextPredicate(HANDLE session, DWORD32 pid, const SCAN_PREDICATE& predicate, SCAN_ROUNDING rounding, double tolerance)
+  {
+    SCAN_PROCESS_NEXT request{ pid, sizeof(SCAN_PREDICATE), (PVOID)&predicate, SCAN_FILTER_PREDICATE, (DWORD32)rounding, tolerance };
+    return DeviceIoControl(session, IOCTRL_SCAN_PROCESS_NEXT, &request, sizeof(SCAN_PROCESS_NEXT), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool ScanPointers(HANDLE session, DWORD32 pid, DWORD64 base, DWORD64 size)
+  {
+    SCAN_POINTERS request{ pid, base, size };
+    return DeviceIoControl(session, IOCTRL_SCAN_POINTERS, &request, sizeof(SCAN_POINTERS), nullptr, 0, nullptr, nullptr);
+  }
+
+  static SCAN_PROGRESS QueryScanProgress(HANDLE session)
+  {
+    SCAN_PROGRESS progress{};
+    DeviceIoControl(session, IOCTRL_SCAN_PROGRESS, nullptr, 0, &progress, sizeof(SCAN_PROGRESS), nullptr, nullptr);
+    return progress;
+  }
+
+  static void CancelScan(HANDLE session)
+  {
+    DeviceIoControl(session, IOCTRL_SCAN_CANCEL, nullptr, 0, nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool UndoScan(HANDLE session, SCAN_SUMMARY& summary)
+  {
+    return DeviceIoControl(session, IOCTRL_SCAN_UNDO, nullptr, 0, &summary, sizeof(SCAN_SUMMARY), nullptr, nullptr);
+  }
+
+  static bool RedoScan(HANDLE session, SCAN_SUMMARY& summary)
   {
-    //SCAN_PROCESS_NEXT request{ pid };
-    //DeviceIoControl(g_driverHandle, IOCTRL_SCAN_PROCESS_NEXT, &request, sizeof(SCAN_PROCESS_NEXT), nullptr, 0, nullptr, nullptr);
+    return DeviceIoControl(session, IOCTRL_SCAN_REDO, nullptr, 0, &summary, sizeof(SCAN_SUMMARY), nullptr, nullptr);
+  }
+
+  static bool ImportScanResults(HANDLE session, DWORD32 type, DWORD32 valueSize, const DWORD64* bases, const BYTE* values, DWORD32 count, DWORD32 flags, SCAN_SUMMARY& summary)
+  {
+    // Addresses and values follow the request
+    SCAN_IMPORT header{ type, valueSize, count, flags };
+    std::vector<BYTE> request(sizeof(SCAN_IMPORT) + (sizeof(DWORD64) + valueSize) * (size_t)count);
+    std::memcpy(&request[0], &header, sizeof(SCAN_IMPORT));
+    if (count > 0)
+    {
+      std::memcpy(&request[sizeof(SCAN_IMPORT)], bases, sizeof(DWORD64) * count);
+      std::memcpy(&request[sizeof(SCAN_IMPORT) + sizeof(DWORD64) * count], values, (size_t)valueSize * count);
+    }
+    return DeviceIoControl(session, IOCTRL_SCAN_IMPORT, &request[0], (DWORD)request.size(), &summary, sizeof(SCAN_SUMMARY), nullptr, nullptr);
+  }
+
+  // Captures
+
+  static bool GetCapturePath(const std::string& path, WCHAR(&ntPath)[MEMORY_CAPTURE_MAX_PATH])
+  {
+    // The driver opens files by their NT path
+    WCHAR wide[MEMORY_CAPTURE_MAX_PATH] = {};
+    WCHAR full[MEMORY_CAPTURE_MAX_PATH] = {};
+    int size = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wide, MEMORY_CAPTURE_MAX_PATH);
+    DWORD length = (size > 0) ? GetFullPathNameW(wide, MEMORY_CAPTURE_MAX_PATH, full, nullptr) : 0;
+    if (length == 0 || (length + 4) >= MEMORY_CAPTURE_MAX_PATH)
+    {
+      return false;
+    }
+    wcscpy_s(ntPath, L"\\??\\");
+    wcscat_s(ntPath, full);
+    return true;
+  }
+
+  static bool CaptureProcessMemory(HANDLE session, DWORD32 pid, const SCAN_REGION_FILTER& regions, const std::string& path)
+  {
+    // Captures run as session jobs, progress and outcome are polled like scans
+    SCAN_CAPTURE request{ pid, regions };
+    return GetCapturePath(path, request.Path) && DeviceIoControl(session, IOCTRL_SCAN_CAPTURE, &request, sizeof(SCAN_CAPTURE), nullptr, 0, nullptr, nullptr);
+  }
+
+  static bool SetScanSource(HANDLE session, const std::string& path)
+  {
+    // Empty paths bind the session to live processes again
+    SCAN_SOURCE request = {};
+    return (path.empty() || GetCapturePath(path, request.Path)) && DeviceIoControl(session, IOCTRL_SCAN_SOURCE, &request, sizeof(SCAN_SOURCE), nullptr, 0, nullptr, nullptr);
   }
 }
 
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,74 @@
+#ifndef KC_PATTERN_H
+#define KC_PATTERN_H
+
+// Patterns are parsed offline as well
+#ifdef _WIN32
+#include <kc_core.h>
+#else
+#include <km_platform.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#endif
+
+///////////////////////////////////////////////////////////
+// Pattern utilities
+///////////////////////////////////////////////////////////
+
+namespace kdbg::pattern
+{
+  static bool ParseNibble(char c, BYTE& value, BYTE& mask)
+  {
+    if (c == '?') { value = 0; mask = 0; return true; }
+    if (c >= '0' && c <= '9') { value = (BYTE)(c - '0'); mask = 0xF; return true; }
+    if (c >= 'a' && c <= 'f') { value = (BYTE)(c - 'a' + 10); mask = 0xF; return true; }
+    if (c >= 'A' && c <= 'F') { value = (BYTE)(c - 'A' + 10); mask = 0xF; return true; }
+    return false;
+  }
+
+  // Parse patterns like "48 8B ?? ?? 89 5?" into bytes and nibble masks
+  static bool Parse(const std::string& text, std::vector<BYTE>& bytes, std::vector<BYTE>& masks)
+  {
+    bytes.clear();
+    masks.clear();
+
+    size_t i = 0;
+    while (i < text.size())
+    {
+      // Skip separators
+      if (text[i] == ' ' || text[i] == '\t')
+      {
+        i++;
+        continue;
+      }
+
+      // Single question marks stand for a whole byte
+      size_t length = 0;
+      while ((i + length) < text.size() && text[i + length] != ' ' && text[i + length] != '\t')
+      {
+        length++;
+      }
+      BYTE high = 0, highMask = 0, low = 0, lowMask = 0;
+      if (length == 1 && text[i] == '?')
+      {
+        bytes.push_back(0);
+        masks.push_back(0);
+      }
+      else if (length == 2 && ParseNibble(text[i], high, highMask) && ParseNibble(text[i + 1], low, lowMask))
+      {
+        bytes.push_back((BYTE)((high << 4) | low));
+        masks.push_back((BYTE)((highMask << 4) | lowMask));
+      }
+      else
+      {
+        return false;
+      }
+      i += length;
+    }
+
+    // Patterns need at least one fixed bit to be searchable
+    return std::any_of(masks.begin(), masks.end(), [](BYTE mask) { return mask != 0; });
+  }
+}
+
+#endif
\ No newline at end of file
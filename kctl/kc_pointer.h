@@ -0,0 +1,499 @@
+#ifndef KC_POINTER_H
+#define KC_POINTER_H
+
+// Maps are compared offline as well, only building them requires the driver
+#ifdef _WIN32
+#include <kc_core.h>
+#include <kc_ioctrl.h>
+#else
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <format>
+#include <cstring>
+#include <unordered_set>
+#include <thread>
+#include <functional>
+#endif
+
+///////////////////////////////////////////////////////////
+// Pointer map format
+///////////////////////////////////////////////////////////
+
+// Maps are a header followed by modules and entries sorted by value
+#define POINTER_MAP_MAGIC   0x5254504B
+#define POINTER_MAP_VERSION 1
+
+namespace kdbg::pointer
+{
+  struct MapHeader
+  {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Pid;
+    uint32_t ModuleCount;
+    uint64_t EntryCount;
+  };
+
+  struct MapModule
+  {
+    uint64_t Base;
+    uint64_t Size;
+    char Name[64];
+  };
+
+  struct MapEntry
+  {
+    uint64_t Address;
+    uint64_t Value;
+  };
+
+  struct Options
+  {
+    uint32_t MaxDepth = 4;
+    uint64_t MaxOffset = 0x800;
+    size_t MaxResults = 0x1000;
+    size_t MaxNodes = 0x400000;
+  };
+
+  // Module relative base followed by the offset applied after every dereference
+  struct Path
+  {
+    uint32_t Module;
+    uint64_t Rva;
+    std::vector<uint64_t> Offsets;
+  };
+
+  // Split work evenly across hardware threads, every worker owns its slice
+  template<typename F>
+  static void ParallelFor(size_t count, F&& work)
+  {
+    size_t threadCount = (std::max<size_t>)(std::thread::hardware_concurrency(), 1);
+    size_t stride = (count + threadCount - 1) / threadCount;
+    std::vector<std::thread> threads = {};
+    for (size_t t = 0; t < threadCount && (t * stride) < count; t++)
+    {
+      threads.emplace_back([&, t]()
+      {
+        work(t, t * stride, (std::min)((t + 1) * stride, count));
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+  }
+
+  ///////////////////////////////////////////////////////////
+  // Pointer map building
+  ///////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+
+  // Fetch pointers of a completed pointer scan and save them sorted by target
+  static bool Build(HANDLE session, DWORD32 pid, uint64_t count, const std::string& path)
+  {
+    static constexpr DWORD32 BatchSize = 0x10000;
+
+    // Addresses and values are paged separately, both follow result order
+    std::vector<MapEntry> entries = {};
+    entries.reserve(count);
+    std::vector<DWORD64> bases = {};
+    std::vector<BYTE> values = {};
+    for (uint64_t offset = 0; offset < count; offset += BatchSize)
+    {
+      DWORD32 batch = (DWORD32)(std::min<uint64_t>)(count - offset, BatchSize);
+      ioctrl::ReadScanResults(session, offset, batch, bases);
+      ioctrl::ReadScanValues(session, offset, batch, sizeof(uint64_t), values);
+      if (bases.size() != batch || values.size() != (sizeof(uint64_t) * batch))
+      {
+        return false;
+      }
+      for (DWORD32 i = 0; i < batch; i++)
+      {
+        uint64_t value = 0;
+        std::memcpy(&value, values.data() + sizeof(uint64_t) * i, sizeof(uint64_t));
+        entries.push_back({ bases[i], value });
+      }
+    }
+
+    // Searches walk backwards from targets, therefore entries are ordered by value
+    std::sort(std::execution::par_unseq, entries.begin(), entries.end(), [](const MapEntry& lhs, const MapEntry& rhs)
+    {
+      return (lhs.Value != rhs.Value) ? (lhs.Value < rhs.Value) : (lhs.Address < rhs.Address);
+    });
+
+    // Static bases are resolved against the images loaded at build time
+    std::vector<PROCESS_IMAGE> images = {};
+    ioctrl::ReadProcessImages(pid, images);
+    std::vector<MapModule> modules = {};
+    for (const auto& image : images)
+    {
+      MapModule module = {};
+      module.Base = image.Base;
+      module.Size = image.Size;
+      for (size_t i = 0; i < (sizeof(module.Name) - 1) && image.Name[i]; i++)
+      {
+        module.Name[i] = (image.Name[i] < 0x80) ? (char)image.Name[i] : '?';
+      }
+      modules.push_back(module);
+    }
+
+    // Write header followed by modules and entries
+    MapHeader header = { POINTER_MAP_MAGIC, POINTER_MAP_VERSION, pid, (uint32_t)modules.size(), entries.size() };
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file)
+    {
+      bool written = fwrite(&header, sizeof(MapHeader), 1, file) == 1;
+      written = written && fwrite(modules.data(), sizeof(MapModule), modules.size(), file) == modules.size();
+      written = written && fwrite(entries.data(), sizeof(MapEntry), entries.size(), file) == entries.size();
+      fclose(file);
+      return written;
+    }
+    return false;
+  }
+#endif
+
+  ///////////////////////////////////////////////////////////
+  // Pointer map view
+  ///////////////////////////////////////////////////////////
+
+  // Maps are searched in place, they easily outgrow what is worth copying into memory
+  class MapView
+  {
+  public:
+    MapView() = default;
+    ~MapView() { Close(); }
+
+    MapView(const MapView&) = delete;
+    MapView& operator = (const MapView&) = delete;
+
+  public:
+    bool Open(const std::string& path)
+    {
+      Close();
+      uint64_t size = 0;
+#ifdef _WIN32
+      _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+      LARGE_INTEGER fileSize = {};
+      if (_file != INVALID_HANDLE_VALUE && GetFileSizeEx(_file, &fileSize) && (uint64_t)fileSize.QuadPart >= sizeof(MapHeader))
+      {
+        size = (uint64_t)fileSize.QuadPart;
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        _view = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+      }
+#else
+      _file = open(path.c_str(), O_RDONLY);
+      struct stat fileStat = {};
+      if (_file >= 0 && fstat(_file, &fileStat) == 0 && (uint64_t)fileStat.st_size >= sizeof(MapHeader))
+      {
+        size = (uint64_t)fileStat.st_size;
+        _view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, _file, 0);
+        _view = (_view == MAP_FAILED) ? nullptr : _view;
+        _size = size;
+      }
+#endif
+      if (_view)
+      {
+        // Validate counts against the file size before trusting any offset
+        _header = (const MapHeader*)_view;
+        _modules = (const MapModule*)(_header + 1);
+        _entries = (const MapEntry*)(_modules + _header->ModuleCount);
+        uint64_t required = sizeof(MapHeader) + sizeof(MapModule) * (uint64_t)_header->ModuleCount;
+        bool valid = _header->Magic == POINTER_MAP_MAGIC && _header->Version == POINTER_MAP_VERSION;
+        valid = valid && size >= required && _header->EntryCount <= ((size - required) / sizeof(MapEntry));
+        if (valid)
+        {
+          return true;
+        }
+      }
+      Close();
+      return false;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+      if (_view)
+      {
+        UnmapViewOfFile(_view);
+      }
+      if (_mapping)
+      {
+        CloseHandle(_mapping);
+      }
+      if (_file != INVALID_HANDLE_VALUE)
+      {
+        CloseHandle(_file);
+      }
+      _file = INVALID_HANDLE_VALUE;
+      _mapping = nullptr;
+#else
+      if (_view)
+      {
+        munmap(_view, _size);
+      }
+      if (_file >= 0)
+      {
+        close(_file);
+      }
+      _file = -1;
+      _size = 0;
+#endif
+      _view = nullptr;
+      _header = nullptr;
+      _modules = nullptr;
+      _entries = nullptr;
+      _addresses.clear();
+    }
+
+  public:
+    inline uint32_t GetModuleCount() const { return _header ? _header->ModuleCount : 0; }
+    inline uint64_t GetEntryCount() const { return _header ? _header->EntryCount : 0; }
+    inline const MapModule& GetModule(uint32_t index) const { return _modules[index]; }
+    inline const MapEntry* begin() const { return _entries; }
+    inline const MapEntry* end() const { return _entries + GetEntryCount(); }
+
+    // Module containing an address or the module count if there is none
+    uint32_t FindModule(uint64_t address) const
+    {
+      for (uint32_t i = 0; i < GetModuleCount(); i++)
+      {
+        if (address >= _modules[i].Base && (address - _modules[i].Base) < _modules[i].Size)
+        {
+          return i;
+        }
+      }
+      return GetModuleCount();
+    }
+
+    // Modules move between sessions, they are matched by name instead
+    uint32_t FindModule(const char* name) const
+    {
+      for (uint32_t i = 0; i < GetModuleCount(); i++)
+      {
+        if (strncmp(_modules[i].Name, name, sizeof(_modules[i].Name)) == 0)
+        {
+          return i;
+        }
+      }
+      return GetModuleCount();
+    }
+
+    // Entries are ordered by value, dereferencing needs a second order by address
+    void IndexAddresses()
+    {
+      if (_addresses.size() != GetEntryCount())
+      {
+        _addresses.clear();
+        _addresses.reserve(GetEntryCount());
+        for (const MapEntry* entry = begin(); entry != end(); entry++)
+        {
+          _addresses.push_back(entry);
+        }
+        std::sort(_addresses.begin(), _addresses.end(), [](const MapEntry* lhs, const MapEntry* rhs) { return lhs->Address < rhs->Address; });
+      }
+    }
+
+    // Value stored at an address, only addresses holding a pointer are known
+    bool Dereference(uint64_t address, uint64_t& value) const
+    {
+      auto entry = std::lower_bound(_addresses.begin(), _addresses.end(), address, [](const MapEntry* lhs, uint64_t value) { return lhs->Address < value; });
+      if (entry != _addresses.end() && (*entry)->Address == address)
+      {
+        value = (*entry)->Value;
+        return true;
+      }
+      return false;
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _file = -1;
+    size_t _size = 0;
+#endif
+    void* _view = nullptr;
+    const MapHeader* _header = nullptr;
+    const MapModule* _modules = nullptr;
+    const MapEntry* _entries = nullptr;
+    std::vector<const MapEntry*> _addresses = {};
+  };
+
+  ///////////////////////////////////////////////////////////
+  // Pointer path search
+  ///////////////////////////////////////////////////////////
+
+  // Breadth first walk from the target towards static bases, one level per dereference
+  static void FindPaths(const MapView& map, uint64_t target, const Options& options, const std::function<bool(const Path&)>& visit)
+  {
+    struct Node
+    {
+      uint64_t Address;
+      uint64_t Offset;
+      size_t Parent;
+    };
+
+    // Every level keeps its nodes so paths can be rebuilt from parent links
+    std::vector<std::vector<Node>> levels = {};
+    levels.push_back({ { target, 0, SIZE_MAX } });
+    std::unordered_set<uint64_t> visited = { target };
+    bool searching = true;
+    for (uint32_t depth = 1; depth <= options.MaxDepth && searching && !levels.back().empty(); depth++)
+    {
+      const std::vector<Node>& frontier = levels.back();
+      std::vector<std::vector<Node>> nexts((std::max<size_t>)(std::thread::hardware_concurrency(), 1));
+      ParallelFor(frontier.size(), [&](size_t t, size_t first, size_t last)
+      {
+        for (size_t i = first; i < last; i++)
+        {
+          // Pointers into the reach of the node, lower values mean larger offsets
+          uint64_t low = (frontier[i].Address > options.MaxOffset) ? (frontier[i].Address - options.MaxOffset) : 0;
+          const MapEntry* entry = std::lower_bound(map.begin(), map.end(), low, [](const MapEntry& lhs, uint64_t value) { return lhs.Value < value; });
+          for (; entry != map.end() && entry->Value <= frontier[i].Address; entry++)
+          {
+            nexts[t].push_back({ entry->Address, frontier[i].Address - entry->Value, i });
+          }
+        }
+      });
+
+      // Static nodes terminate a path, the rest is expanded once on the next level
+      std::vector<Node> next = {};
+      for (const auto& nodes : nexts)
+      {
+        for (const auto& node : nodes)
+        {
+          uint32_t module = map.FindModule(node.Address);
+          if (module < map.GetModuleCount())
+          {
+            if (searching)
+            {
+              Path path = { module, node.Address - map.GetModule(module).Base, { node.Offset } };
+              for (size_t level = depth - 1, parent = node.Parent; level > 0; parent = levels[level][parent].Parent, level--)
+              {
+                path.Offsets.push_back(levels[level][parent].Offset);
+              }
+              searching = visit(path);
+            }
+          }
+          else if (next.size() < options.MaxNodes && visited.insert(node.Address).second)
+          {
+            next.push_back(node);
+          }
+        }
+      }
+      levels.push_back(std::move(next));
+    }
+  }
+
+  static std::vector<Path> FindPaths(const MapView& map, uint64_t target, const Options& options)
+  {
+    std::vector<Path> paths = {};
+    FindPaths(map, target, options, [&](const Path& path)
+    {
+      paths.push_back(path);
+      return paths.size() < options.MaxResults;
+    });
+    return paths;
+  }
+
+  // Follow a path found in another map, modules are rebased by name
+  static bool Resolve(const MapView& map, const char* name, const Path& path, uint64_t& address)
+  {
+    uint32_t module = map.FindModule(name);
+    if (module >= map.GetModuleCount() || path.Rva >= map.GetModule(module).Size)
+    {
+      return false;
+    }
+    address = map.GetModule(module).Base + path.Rva;
+    for (uint64_t offset : path.Offsets)
+    {
+      uint64_t value = 0;
+      if (!map.Dereference(address, value))
+      {
+        return false;
+      }
+      address = value + offset;
+    }
+    return true;
+  }
+
+  // Paths of the first map which reach the target in every other map as well
+  static void IntersectPaths(std::vector<MapView*>& maps, const std::vector<uint64_t>& targets, const Options& options, const std::function<bool(const Path&)>& visit)
+  {
+    static constexpr size_t BatchSize = 0x10000;
+
+    if (maps.empty() || maps.size() != targets.size())
+    {
+      return;
+    }
+    for (size_t i = 1; i < maps.size(); i++)
+    {
+      maps[i]->IndexAddresses();
+    }
+
+    // Candidates are validated batch wise, no path set is ever held as a whole
+    std::vector<Path> batch = {};
+    std::vector<char> valid = {};
+    size_t found = 0;
+    auto flush = [&]()
+    {
+      valid.assign(batch.size(), 0);
+      ParallelFor(batch.size(), [&](size_t t, size_t first, size_t last)
+      {
+        for (size_t i = first; i < last; i++)
+        {
+          const char* name = maps[0]->GetModule(batch[i].Module).Name;
+          bool reached = true;
+          for (size_t m = 1; m < maps.size() && reached; m++)
+          {
+            uint64_t address = 0;
+            reached = Resolve(*maps[m], name, batch[i], address) && address == targets[m];
+          }
+          valid[i] = reached;
+        }
+      });
+      bool more = true;
+      for (size_t i = 0; i < batch.size() && more; i++)
+      {
+        if (valid[i])
+        {
+          more = visit(batch[i]) && (++found < options.MaxResults);
+        }
+      }
+      batch.clear();
+      return more;
+    };
+    bool more = true;
+    FindPaths(*maps[0], targets[0], Options{ options.MaxDepth, options.MaxOffset, SIZE_MAX, options.MaxNodes }, [&](const Path& path)
+    {
+      batch.push_back(path);
+      more = (batch.size() < BatchSize) || flush();
+      return more;
+    });
+    if (more)
+    {
+      flush();
+    }
+  }
+
+  static std::string Format(const MapView& map, const Path& path)
+  {
+    std::string text = std::format("{}+0x{:X}", map.GetModule(path.Module).Name, path.Rva);
+    for (uint64_t offset : path.Offsets)
+    {
+      text += std::format(" -> +0x{:X}", offset);
+    }
+    return text;
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,476 @@
+#ifndef KC_RESULTS_H
+#define KC_RESULTS_H
+
+// Result files are read offline as well, only exporting and importing them requires the driver
+#ifdef _WIN32
+#include <kc_core.h>
+#include <kc_ioctrl.h>
+#else
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#endif
+
+///////////////////////////////////////////////////////////
+// Result file format
+///////////////////////////////////////////////////////////
+
+// Files are a header followed by blocks of results and an index of block offsets
+#define RESULT_FILE_MAGIC      0x5345524B
+#define RESULT_FILE_VERSION    1
+#define RESULT_FILE_BLOCK_SIZE 0x10000
+
+namespace kdbg::results
+{
+  struct FileHeader
+  {
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t Pid;
+    uint32_t Type;
+    uint32_t ValueSize;
+    uint32_t BlockSize;
+    uint64_t Count;
+    uint64_t BlockCount;
+    uint64_t IndexOffset;
+  };
+
+  // Addresses after the first are varint deltas to their predecessor, values follow as one array of the scan type
+  struct FileBlock
+  {
+    uint64_t First;
+    uint32_t Count;
+    uint32_t AddressBytes;
+  };
+
+  static size_t EncodeVarint(uint64_t value, uint8_t* bytes)
+  {
+    size_t size = 0;
+    while (value >= 0x80)
+    {
+      bytes[size++] = (uint8_t)(value | 0x80);
+      value >>= 7;
+    }
+    bytes[size++] = (uint8_t)value;
+    return size;
+  }
+
+  static size_t DecodeVarint(const uint8_t* bytes, const uint8_t* end, uint64_t& value)
+  {
+    value = 0;
+    for (size_t size = 0, shift = 0; (bytes + size) < end && shift < 64; size++, shift += 7)
+    {
+      value |= (uint64_t)(bytes[size] & 0x7F) << shift;
+      if ((bytes[size] & 0x80) == 0)
+      {
+        return size + 1;
+      }
+    }
+    return 0;
+  }
+
+  ///////////////////////////////////////////////////////////
+  // Result file writer
+  ///////////////////////////////////////////////////////////
+
+  // Results are appended in address order, only the current block is held in memory
+  class FileWriter
+  {
+  public:
+    FileWriter() = default;
+    ~FileWriter() { Close(); }
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator = (const FileWriter&) = delete;
+
+  public:
+    bool Open(const std::string& path, uint32_t pid, uint32_t type, uint32_t valueSize)
+    {
+      Close();
+
+      // Header is written again once counts and index are known
+      _header = { RESULT_FILE_MAGIC, RESULT_FILE_VERSION, pid, type, valueSize, RESULT_FILE_BLOCK_SIZE, 0, 0, 0 };
+      _offset = sizeof(FileHeader);
+      _file = fopen(path.c_str(), "wb");
+      _valid = _file && fwrite(&_header, sizeof(FileHeader), 1, _file) == 1;
+      return _valid;
+    }
+
+    bool Append(const uint64_t* bases, const uint8_t* values, size_t count)
+    {
+      for (size_t i = 0; i < count && _valid; i++)
+      {
+        // Deltas require strictly increasing addresses
+        _valid = (_header.Count == 0 && _bases.empty()) || bases[i] > _last;
+        if (_valid)
+        {
+          _bases.push_back(bases[i]);
+          _values.insert(_values.end(), values + i * _header.ValueSize, values + (i + 1) * _header.ValueSize);
+          _last = bases[i];
+          if (_bases.size() == _header.BlockSize)
+          {
+            _valid = Flush();
+          }
+        }
+      }
+      return _valid;
+    }
+
+    bool Close()
+    {
+      bool written = false;
+      if (_file)
+      {
+        // Flush the last block, append the index and complete the header
+        written = _valid && Flush();
+        _header.BlockCount = _index.size();
+        _header.IndexOffset = _offset;
+        written = written && (_index.empty() || fwrite(_index.data(), sizeof(uint64_t), _index.size(), _file) == _index.size());
+        written = written && fseek(_file, 0, SEEK_SET) == 0 && fwrite(&_header, sizeof(FileHeader), 1, _file) == 1;
+        fclose(_file);
+      }
+      _file = nullptr;
+      _valid = false;
+      _bases.clear();
+      _values.clear();
+      _index.clear();
+      return written;
+    }
+
+  private:
+    bool Flush()
+    {
+      if (_bases.empty())
+      {
+        return true;
+      }
+
+      // Encode deltas of the block
+      _addresses.clear();
+      uint8_t bytes[10];
+      for (size_t i = 1; i < _bases.size(); i++)
+      {
+        size_t size = EncodeVarint(_bases[i] - _bases[i - 1], bytes);
+        _addresses.insert(_addresses.end(), bytes, bytes + size);
+      }
+
+      // Write block header followed by addresses and values
+      FileBlock block = { _bases[0], (uint32_t)_bases.size(), (uint32_t)_addresses.size() };
+      bool written = fwrite(&block, sizeof(FileBlock), 1, _file) == 1;
+      written = written && (_addresses.empty() || fwrite(_addresses.data(), 1, _addresses.size(), _file) == _addresses.size());
+      written = written && (_values.empty() || fwrite(_values.data(), 1, _values.size(), _file) == _values.size());
+      _index.push_back(_offset);
+      _offset += sizeof(FileBlock) + _addresses.size() + _values.size();
+      _header.Count += _bases.size();
+      _bases.clear();
+      _values.clear();
+      return written;
+    }
+
+  private:
+    FILE* _file = nullptr;
+    bool _valid = false;
+    FileHeader _header = {};
+    uint64_t _offset = 0;
+    uint64_t _last = 0;
+    std::vector<uint64_t> _bases = {};
+    std::vector<uint8_t> _values = {};
+    std::vector<uint8_t> _addresses = {};
+    std::vector<uint64_t> _index = {};
+  };
+
+  ///////////////////////////////////////////////////////////
+  // Result file view
+  ///////////////////////////////////////////////////////////
+
+  // Files are mapped and decoded block by block, they easily outgrow what is worth copying into memory
+  class FileView
+  {
+  public:
+    FileView() = default;
+    ~FileView() { Close(); }
+
+    FileView(const FileView&) = delete;
+    FileView& operator = (const FileView&) = delete;
+
+  public:
+    bool Open(const std::string& path)
+    {
+      Close();
+      uint64_t size = 0;
+#ifdef _WIN32
+      _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      LARGE_INTEGER fileSize = {};
+      if (_file != INVALID_HANDLE_VALUE && GetFileSizeEx(_file, &fileSize) && (uint64_t)fileSize.QuadPart >= sizeof(FileHeader))
+      {
+        size = (uint64_t)fileSize.QuadPart;
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        _view = _mapping ? MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+      }
+#else
+      _file = open(path.c_str(), O_RDONLY);
+      struct stat fileStat = {};
+      if (_file >= 0 && fstat(_file, &fileStat) == 0 && (uint64_t)fileStat.st_size >= sizeof(FileHeader))
+      {
+        size = (uint64_t)fileStat.st_size;
+        _view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, _file, 0);
+        _view = (_view == MAP_FAILED) ? nullptr : _view;
+        _size = size;
+      }
+#endif
+      if (_view)
+      {
+        // Validate the index against the file size, blocks are validated when decoded
+        _header = (const FileHeader*)_view;
+        _bytes = (const uint8_t*)_view;
+        bool valid = _header->Magic == RESULT_FILE_MAGIC && _header->Version == RESULT_FILE_VERSION;
+        valid = valid && _header->BlockSize > 0 && _header->BlockSize <= RESULT_FILE_BLOCK_SIZE;
+        valid = valid && _header->IndexOffset >= sizeof(FileHeader) && _header->IndexOffset <= size;
+        valid = valid && _header->BlockCount <= ((size - _header->IndexOffset) / sizeof(uint64_t));
+        if (valid)
+        {
+          return true;
+        }
+      }
+      Close();
+      return false;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+      if (_view)
+      {
+        UnmapViewOfFile(_view);
+      }
+      if (_mapping)
+      {
+        CloseHandle(_mapping);
+      }
+      if (_file != INVALID_HANDLE_VALUE)
+      {
+        CloseHandle(_file);
+      }
+      _file = INVALID_HANDLE_VALUE;
+      _mapping = nullptr;
+#else
+      if (_view)
+      {
+        munmap(_view, _size);
+      }
+      if (_file >= 0)
+      {
+        close(_file);
+      }
+      _file = -1;
+      _size = 0;
+#endif
+      _view = nullptr;
+      _header = nullptr;
+      _bytes = nullptr;
+    }
+
+  public:
+    inline const FileHeader& GetHeader() const { return *_header; }
+    inline uint64_t GetCount() const { return _header ? _header->Count : 0; }
+    inline uint64_t GetBlockCount() const { return _header ? _header->BlockCount : 0; }
+
+    // Decode the addresses of one block, values are left in the mapping
+    bool ReadBlock(uint64_t index, std::vector<uint64_t>& bases, const uint8_t*& values) const
+    {
+      bases.clear();
+      if (index >= GetBlockCount())
+      {
+        return false;
+      }
+
+      // Blocks have to end before the index
+      uint64_t offset = 0;
+      std::memcpy(&offset, _bytes + _header->IndexOffset + sizeof(uint64_t) * index, sizeof(uint64_t));
+      if (offset < sizeof(FileHeader) || (offset + sizeof(FileBlock)) > _header->IndexOffset)
+      {
+        return false;
+      }
+      FileBlock block = {};
+      std::memcpy(&block, _bytes + offset, sizeof(FileBlock));
+      uint64_t available = _header->IndexOffset - offset - sizeof(FileBlock);
+      uint64_t valueBytes = (uint64_t)block.Count * _header->ValueSize;
+      if (block.Count == 0 || block.Count > _header->BlockSize || block.AddressBytes > available || valueBytes > (available - block.AddressBytes))
+      {
+        return false;
+      }
+
+      // Accumulate deltas
+      const uint8_t* cursor = _bytes + offset + sizeof(FileBlock);
+      const uint8_t* end = cursor + block.AddressBytes;
+      bases.reserve(block.Count);
+      bases.push_back(block.First);
+      while (bases.size() < block.Count)
+      {
+        uint64_t delta = 0;
+        size_t size = DecodeVarint(cursor, end, delta);
+        if (size == 0)
+        {
+          bases.clear();
+          return false;
+        }
+        bases.push_back(bases.back() + delta);
+        cursor += size;
+      }
+      values = end;
+      return true;
+    }
+
+  private:
+#ifdef _WIN32
+    HANDLE _file = INVALID_HANDLE_VALUE;
+    HANDLE _mapping = nullptr;
+#else
+    int _file = -1;
+    size_t _size = 0;
+#endif
+    void* _view = nullptr;
+    const FileHeader* _header = nullptr;
+    const uint8_t* _bytes = nullptr;
+  };
+
+  // Walk a file result by result with one decoded block at a time
+  class FileCursor
+  {
+  public:
+    explicit FileCursor(const FileView& view) : _view(view) { Load(); }
+
+  public:
+    inline bool IsValid() const { return _index < _bases.size(); }
+    inline bool IsFailed() const { return _failed; }
+    inline uint64_t GetBase() const { return _bases[_index]; }
+    inline const uint8_t* GetValue() const { return _values + (size_t)_index * _view.GetHeader().ValueSize; }
+
+    void Next()
+    {
+      if (++_index == _bases.size())
+      {
+        _block++;
+        Load();
+      }
+    }
+
+  private:
+    void Load()
+    {
+      _index = 0;
+      _bases.clear();
+      if (_block < _view.GetBlockCount())
+      {
+        _failed = !_view.ReadBlock(_block, _bases, _values);
+      }
+    }
+
+  private:
+    const FileView& _view;
+    uint64_t _block = 0;
+    size_t _index = 0;
+    bool _failed = false;
+    std::vector<uint64_t> _bases = {};
+    const uint8_t* _values = nullptr;
+  };
+
+  ///////////////////////////////////////////////////////////
+  // Result file diffing
+  ///////////////////////////////////////////////////////////
+
+  // Keep results of the newer file that exist in the older one with another value, both are merged in address order
+  static bool Diff(const FileView& previous, const FileView& next, const std::string& path)
+  {
+    const FileHeader& header = next.GetHeader();
+    if (previous.GetHeader().ValueSize != header.ValueSize)
+    {
+      return false;
+    }
+
+    FileWriter writer = {};
+    bool written = writer.Open(path, header.Pid, header.Type, header.ValueSize);
+    FileCursor before(previous);
+    FileCursor after(next);
+    while (written && before.IsValid() && after.IsValid())
+    {
+      if (before.GetBase() < after.GetBase())
+      {
+        before.Next();
+      }
+      else if (after.GetBase() < before.GetBase())
+      {
+        after.Next();
+      }
+      else
+      {
+        if (std::memcmp(before.GetValue(), after.GetValue(), header.ValueSize) != 0)
+        {
+          uint64_t base = after.GetBase();
+          written = writer.Append(&base, after.GetValue(), 1);
+        }
+        before.Next();
+        after.Next();
+      }
+    }
+    written = written && !before.IsFailed() && !after.IsFailed();
+    return writer.Close() && written;
+  }
+
+  ///////////////////////////////////////////////////////////
+  // Result file transfer
+  ///////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+
+  // Stream results and values of a session into a file batch by batch
+  static bool Export(HANDLE session, DWORD32 pid, DWORD32 type, const SCAN_SUMMARY& summary, const std::string& path)
+  {
+    FileWriter writer = {};
+    bool written = writer.Open(path, pid, type, summary.ValueSize);
+    std::vector<DWORD64> bases = {};
+    std::vector<BYTE> values = {};
+    for (uint64_t offset = 0; offset < summary.Results && written; offset += RESULT_FILE_BLOCK_SIZE)
+    {
+      DWORD32 batch = (DWORD32)(std::min<uint64_t>)(summary.Results - offset, RESULT_FILE_BLOCK_SIZE);
+      ioctrl::ReadScanResults(session, offset, batch, bases);
+      ioctrl::ReadScanValues(session, offset, batch, summary.ValueSize, values);
+      written = bases.size() == batch && values.size() == ((size_t)summary.ValueSize * batch);
+      written = written && writer.Append(bases.data(), values.data(), batch);
+    }
+    return writer.Close() && written;
+  }
+
+  // Stream a file into a session block by block, the driver publishes the results with the last one
+  static bool Import(HANDLE session, const std::string& path, FileHeader& header, SCAN_SUMMARY& summary)
+  {
+    FileView view = {};
+    if (!view.Open(path))
+    {
+      return false;
+    }
+    header = view.GetHeader();
+
+    // Empty files still replace the session results with a single empty batch
+    std::vector<uint64_t> bases = {};
+    const uint8_t* values = nullptr;
+    uint64_t blockCount = view.GetBlockCount();
+    bool imported = true;
+    for (uint64_t block = 0; block < (std::max<uint64_t>)(blockCount, 1) && imported; block++)
+    {
+      DWORD32 flags = ((block == 0) ? SCAN_IMPORT_BEGIN : 0) | (((block + 1) >= blockCount) ? SCAN_IMPORT_END : 0);
+      imported = (block >= blockCount) || view.ReadBlock(block, bases, values);
+      imported = imported && ioctrl::ImportScanResults(session, header.Type, header.ValueSize, bases.data(), values, (DWORD32)bases.size(), flags, summary);
+    }
+    return imported;
+  }
+#endif
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,173 @@
+#ifndef KC_SIGNATURE_H
+#define KC_SIGNATURE_H
+
+#include <kc_core.h>
+#include <kc_ioctrl.h>
+#include <kc_pattern.h>
+
+// Anchors are picked with the same byte frequencies the driver uses for patterns
+#include <km_kernels.h>
+
+///////////////////////////////////////////////////////////
+// Signature utilities
+///////////////////////////////////////////////////////////
+
+namespace kdbg::signature
+{
+  static uint64_t Hash(const std::vector<std::string>& sources)
+  {
+    // FNV-1a over all sources, each terminated by a line break
+    uint64_t hash = 0xCBF29CE484222325;
+    for (const auto& source : sources)
+    {
+      for (char c : source)
+      {
+        hash = (hash ^ (BYTE)c) * 0x100000001B3;
+      }
+      hash = (hash ^ '\n') * 0x100000001B3;
+    }
+    return hash;
+  }
+
+  // Compile sources into a flat set which the driver matches in a single pass
+  static bool Compile(const std::vector<std::string>& sources, std::vector<BYTE>& set)
+  {
+    std::vector<SIGNATURE> signatures = {};
+    std::vector<BYTE> patterns = {};
+    std::vector<std::pair<uint16_t, uint16_t>> keys = {};
+    for (const auto& source : sources)
+    {
+      std::vector<BYTE> bytes = {};
+      std::vector<BYTE> masks = {};
+      if (!pattern::Parse(source, bytes, masks) || bytes.size() < 2 || bytes.size() > 0x100)
+      {
+        return false;
+      }
+
+      // Anchor on the byte pair with the most fixed bits, prefer rare bytes on ties
+      uint32_t anchor = 0;
+      uint32_t bestBits = 0;
+      uint32_t bestScore = 0;
+      for (uint32_t i = 0; (i + 1) < bytes.size(); i++)
+      {
+        uint32_t bits = std::popcount(masks[i]) + std::popcount(masks[i + 1]);
+        uint32_t score = KmGetByteFrequency(bytes[i]) + KmGetByteFrequency(bytes[i + 1]);
+        if (bits > bestBits || (bits == bestBits && score < bestScore))
+        {
+          anchor = i;
+          bestBits = bits;
+          bestScore = score;
+        }
+      }
+
+      // Pairs with less than a byte of fixed bits would flood the key table
+      if (bestBits < 8)
+      {
+        return false;
+      }
+
+      // Register every key compatible with the anchor pair
+      uint16_t key = (uint16_t)((bytes[anchor] & masks[anchor]) | ((bytes[anchor + 1] & masks[anchor + 1]) << 8));
+      uint16_t free = (uint16_t)~(masks[anchor] | (masks[anchor + 1] << 8));
+      uint16_t subset = 0;
+      do
+      {
+        keys.emplace_back((uint16_t)(key | subset), (uint16_t)signatures.size());
+        subset = (uint16_t)((subset - free) & free);
+      } while (subset != 0);
+
+      // Store normalized bytes followed by their masks
+      signatures.push_back({ (DWORD32)patterns.size(), (DWORD32)bytes.size(), anchor });
+      for (size_t i = 0; i < bytes.size(); i++)
+      {
+        patterns.push_back(bytes[i] & masks[i]);
+      }
+      patterns.insert(patterns.end(), masks.begin(), masks.end());
+    }
+
+    // Bucket anchors by key
+    std::vector<DWORD32> offsets(SIGNATURE_SET_KEYS + 1, 0);
+    for (const auto& [key, index] : keys)
+    {
+      offsets[key + 1]++;
+    }
+    for (size_t i = 0; i < SIGNATURE_SET_KEYS; i++)
+    {
+      offsets[i + 1] += offsets[i];
+    }
+    std::vector<DWORD32> anchors(keys.size(), 0);
+    std::vector<DWORD32> cursors(offsets.begin(), offsets.end() - 1);
+    for (const auto& [key, index] : keys)
+    {
+      anchors[cursors[key]++] = index;
+    }
+
+    // Write header followed by signatures, key offsets, anchors and pattern bytes
+    SIGNATURE_SET header = {};
+    header.Magic = SIGNATURE_SET_MAGIC;
+    header.Version = SIGNATURE_SET_VERSION;
+    header.SignatureCount = (DWORD32)signatures.size();
+    header.AnchorCount = (DWORD32)anchors.size();
+    header.PatternSize = (DWORD32)patterns.size();
+    header.SourceHash = Hash(sources);
+    header.Size = (DWORD32)(sizeof(SIGNATURE_SET) + sizeof(SIGNATURE) * signatures.size() + sizeof(DWORD32) * (offsets.size() + anchors.size()) + patterns.size());
+    set.clear();
+    set.reserve(header.Size);
+    set.insert(set.end(), (BYTE*)&header, (BYTE*)(&header + 1));
+    set.insert(set.end(), (BYTE*)signatures.data(), (BYTE*)(signatures.data() + signatures.size()));
+    set.insert(set.end(), (BYTE*)offsets.data(), (BYTE*)(offsets.data() + offsets.size()));
+    set.insert(set.end(), (BYTE*)anchors.data(), (BYTE*)(anchors.data() + anchors.size()));
+    set.insert(set.end(), patterns.begin(), patterns.end());
+    return true;
+  }
+
+  static bool Save(const std::string& path, const std::vector<BYTE>& set)
+  {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file)
+    {
+      bool written = fwrite(set.data(), 1, set.size(), file) == set.size();
+      fclose(file);
+      return written;
+    }
+    return false;
+  }
+
+  // Load a cached set, it has to be compiled from the very same sources
+  static bool Load(const std::string& path, const std::vector<std::string>& sources, std::vector<BYTE>& set)
+  {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file)
+    {
+      SIGNATURE_SET header = {};
+      bool valid = fread(&header, 1, sizeof(SIGNATURE_SET), file) == sizeof(SIGNATURE_SET);
+      valid = valid && header.Magic == SIGNATURE_SET_MAGIC && header.Version == SIGNATURE_SET_VERSION && header.Size >= sizeof(SIGNATURE_SET);
+      valid = valid && header.SignatureCount == sources.size() && header.SourceHash == Hash(sources);
+      if (valid)
+      {
+        set.resize(header.Size);
+        std::memcpy(set.data(), &header, sizeof(SIGNATURE_SET));
+        valid = fread(set.data() + sizeof(SIGNATURE_SET), 1, header.Size - sizeof(SIGNATURE_SET), file) == (header.Size - sizeof(SIGNATURE_SET));
+      }
+      fclose(file);
+      return valid;
+    }
+    return false;
+  }
+
+  static bool LoadOrCompile(const std::string& path, const std::vector<std::string>& sources, std::vector<BYTE>& set)
+  {
+    if (Load(path, sources, set))
+    {
+      return true;
+    }
+    if (Compile(sources, set))
+    {
+      Save(path, set);
+      return true;
+    }
+    return false;
+  }
+}
+
+#endif
\ No newline at end of file
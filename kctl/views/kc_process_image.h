@@ -29,6 +29,7 @@ namespace kdbg
     void Draw(float time);
 
     inline uint64_t GetImageBase() const { return _selectedImage.Base; }
+    inline uint64_t GetImageSize() const { return _selectedImage.Size; }
 
   private:
     void Update();
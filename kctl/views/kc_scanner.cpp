@@ -3,6 +3,8 @@
 #include <views/kc_process_image.h>
 
 #include <kc_ioctrl.h>
+#include <kc_pattern.h>
+#include <kc_signature.h>
 
 #include <imgui/imgui.h>
 
@@ -19,42 +21,931 @@ extern kdbg::ProcessImage g_processImage;
 
 namespace kdbg
 {
+  Scanner::~Scanner()
+  {
+    for (auto& session : _sessions)
+    {
+      ioctrl::CloseScanSession(session.Handle);
+    }
+  }
+
   void Scanner::Draw(float time)
   {
     ImGui::Begin("Scanner");
 
+    // Scans run in the driver, completed ones are picked up here
+    PollSessions();
+
+    // Sessions are independent handles to the driver, each may target another process
+    if (ImGui::BeginCombo("Session", (_session >= 0) ? _sessions[_session].Name.c_str() : "None"))
+    {
+      for (int32_t i = 0; i < (int32_t)_sessions.size(); i++)
+      {
+        if (ImGui::Selectable(std::format("{} ({})", _sessions[i].Name, _sessions[i].Pid).c_str(), i == _session))
+        {
+          _session = i;
+        }
+      }
+      ImGui::EndCombo();
+    }
+    ImGui::InputText("Name", _sessionName, sizeof(_sessionName));
+    ImGui::SameLine();
+    if (ImGui::Button("New Session"))
+    {
+      OpenSession();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Close Session"))
+    {
+      CloseSession();
+    }
+
     // Controls
+    ImGui::Combo("Type", &_type, "Byte8\0Byte16\0Byte32\0Byte64\0Float32\0Float64\0Bytes\0Ascii\0Utf16\0Text\0Group\0");
+    ImGui::Combo("Filter", &_filter, "Exact\0Changed\0Unchanged\0Increased\0Decreased\0Increased By\0Decreased By\0Not Equal\0Less\0Greater\0Between\0Mask\0");
+    if (_type == SCAN_TYPE_BYTES)
+    {
+      ImGui::InputText("Pattern", _pattern, sizeof(_pattern));
+    }
+    else if (_type == SCAN_TYPE_ASCII || _type == SCAN_TYPE_UTF16 || _type == SCAN_TYPE_TEXT)
+    {
+      ImGui::InputText("Text", _pattern, sizeof(_pattern));
+      ImGui::Checkbox("Ignore case", &_ignoreCase);
+    }
+    else if (_type == SCAN_TYPE_GROUP)
+    {
+      DrawGroup();
+    }
+    else if ((_type == SCAN_TYPE_FLOAT32 || _type == SCAN_TYPE_FLOAT64) && _filter == (PredicateFilter + SCAN_PREDICATE_MASK - SCAN_PREDICATE_NOT_EQUAL))
+    {
+      // Masks test the raw bits of reals
+      ImGui::InputScalar("Bits", ImGuiDataType_S64, &_value, nullptr, nullptr, "%llX", ImGuiInputTextFlags_CharsHexadecimal);
+      ImGui::InputScalar("Mask", ImGuiDataType_S64, &_limit, nullptr, nullptr, "%llX", ImGuiInputTextFlags_CharsHexadecimal);
+    }
+    else if (_type == SCAN_TYPE_FLOAT32 || _type == SCAN_TYPE_FLOAT64)
+    {
+      ImGui::InputDouble("Value", &_real);
+      if (_filter == (PredicateFilter + SCAN_PREDICATE_BETWEEN - SCAN_PREDICATE_NOT_EQUAL))
+      {
+        ImGui::InputDouble("Upper", &_realLimit);
+      }
+      ImGui::Combo("Rounding", &_rounding, "Exact\0Rounded\0Truncated\0Epsilon\0");
+      if (_rounding == SCAN_ROUNDING_EPSILON)
+      {
+        ImGui::InputDouble("Tolerance", &_tolerance);
+      }
+    }
+    else
+    {
+      ImGui::InputScalar("Value", ImGuiDataType_S64, &_value);
+      if (_filter == (PredicateFilter + SCAN_PREDICATE_BETWEEN - SCAN_PREDICATE_NOT_EQUAL))
+      {
+        ImGui::InputScalar("Upper", ImGuiDataType_S64, &_limit);
+      }
+      else if (_filter == (PredicateFilter + SCAN_PREDICATE_MASK - SCAN_PREDICATE_NOT_EQUAL))
+      {
+        ImGui::InputScalar("Mask", ImGuiDataType_S64, &_limit, nullptr, nullptr, "%llX", ImGuiInputTextFlags_CharsHexadecimal);
+      }
+    }
+    ImGui::Combo("Alignment", &_alignment, "Natural\0Byte8\0Byte16\0Byte32\0Byte64\0");
+    ImGui::Checkbox("Unknown initial value", &_unknown);
+    DrawRegions();
     if (ImGui::Button("First Scan"))
     {
-      ioctrl::ScanProcessFirst<int32_t>(g_process.GetPid(), g_processImage.GetImageBase(), 1234, SCAN_TYPE_BYTE32, _scans);
+      ScanFirst();
     }
     ImGui::SameLine();
     if (ImGui::Button("Next Scan"))
     {
-      ioctrl::ScanProcessNext<void>(g_process.GetPid());
+      ScanNext();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Undo"))
+    {
+      UndoScan();
     }
+    ImGui::SameLine();
+    if (ImGui::Button("Redo"))
+    {
+      RedoScan();
+    }
+    ImGui::SameLine();
+    Session empty = {};
+    Session& session = (_session >= 0) ? _sessions[_session] : empty;
+    if (session.Running)
+    {
+      // Region totals are only known upfront for some scans, the overlay always shows counters
+      const SCAN_PROGRESS& progress = session.Progress;
+      float fraction = progress.RegionCount ? (float)progress.Regions / (float)progress.RegionCount : 0.0f;
+      ImGui::ProgressBar(fraction, ImVec2(200.0f, 0.0f), std::format("{} MB, {} regions, {} hits", progress.Bytes >> 20, progress.Regions, progress.Hits).c_str());
+      ImGui::SameLine();
+      if (ImGui::Button("Cancel"))
+      {
+        ioctrl::CancelScan(session.Handle);
+      }
+    }
+    else
+    {
+      ImGui::Text("%llu results, %llu candidates, %llu KB", session.Summary.Results, session.Summary.Candidates, session.Summary.Bytes / 1024);
+    }
+
+    // Values of visible rows are read together at this rate
+    ImGui::SliderFloat("Refresh", &_refreshRate, 0.5f, 30.0f, "%.1f Hz");
 
-    if (ImGui::BeginTable("ScanTable", 1, ImGuiTableFlags_Reorderable | ImGuiTableFlags_RowBg | ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV))
+    if (ImGui::BeginTable("ScanTable", 2, ImGuiTableFlags_Reorderable | ImGuiTableFlags_RowBg | ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV))
     {
       // Draw header
       ImGui::TableSetupColumn("Base", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoSort, 120.0f);
+      ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthStretch | ImGuiTableColumnFlags_NoSort);
       ImGui::TableSetupScrollFreeze(0, 1);
       ImGui::TableHeadersRow();
 
-      // Draw scans
-      for (const auto& scan : _scans)
+      // Only visible rows are fetched and drawn, the number of results does not matter
+      uint64_t visibleFirst = 0;
+      uint64_t visibleCount = 0;
+      uint32_t width = GetValueWidth(session.Type);
+      ImGuiListClipper clipper;
+      clipper.Begin((int)(std::min<uint64_t>)(session.Summary.Results, INT_MAX), ImGui::GetTextLineHeightWithSpacing());
+      while (clipper.Step())
       {
-        ImGui::TableNextRow();
-        ImGui::TableNextColumn();
-        if (ImGui::Selectable(std::format("{:016X}", scan).c_str(), false, ImGuiSelectableFlags_SpanAllColumns))
+        ReadRows(session, clipper.DisplayStart, clipper.DisplayEnd - clipper.DisplayStart);
+        for (int32_t row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
         {
-          
+          uint64_t index = row - session.First;
+          uint64_t valueIndex = row - session.ValueFirst;
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::Selectable((index < session.Scans.size()) ? std::format("{:016X}", session.Scans[index]).c_str() : "?", false, ImGuiSelectableFlags_SpanAllColumns);
+          ImGui::TableNextColumn();
+          if (valueIndex < (session.Values.size() / width))
+          {
+            ImGui::TextUnformatted(FormatValue(session.Type, &session.Values[valueIndex * width]).c_str());
+          }
+        }
+        if ((uint64_t)(clipper.DisplayEnd - clipper.DisplayStart) > visibleCount)
+        {
+          visibleFirst = clipper.DisplayStart;
+          visibleCount = clipper.DisplayEnd - clipper.DisplayStart;
         }
       }
+      RefreshValues(session, visibleFirst, visibleCount, time);
 
       ImGui::EndTable();
     }
 
+    // Signatures are resolved against the selected image in a single pass
+    if (ImGui::CollapsingHeader("Signatures"))
+    {
+      ImGui::InputTextMultiline("##Signatures", _signatures, sizeof(_signatures), ImVec2(-1.0f, ImGui::GetTextLineHeight() * 8));
+      if (ImGui::Button("Resolve"))
+      {
+        ResolveSignatures();
+      }
+
+      if (ImGui::BeginTable("SignatureTable", 2, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV, ImVec2(0.0f, ImGui::GetTextLineHeight() * 12)))
+      {
+        // Draw header
+        ImGui::TableSetupColumn("Signature", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Matches", ImGuiTableColumnFlags_WidthFixed, 240.0f);
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableHeadersRow();
+
+        // Draw signatures
+        for (size_t i = 0; i < _signatureMatches.size(); i++)
+        {
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::TextUnformatted(_signatureSources[i].c_str());
+          ImGui::TableNextColumn();
+          if (_signatureMatches[i].empty())
+          {
+            ImGui::TextUnformatted("-");
+          }
+          else
+          {
+            ImGui::Text("%016llX (%zu)", _signatureMatches[i][0], _signatureMatches[i].size());
+          }
+        }
+
+        ImGui::EndTable();
+      }
+    }
+
+    // Pointer maps are saved per session and searched offline in the background
+    if (ImGui::CollapsingHeader("Pointers"))
+    {
+      ImGui::InputScalar("Target", ImGuiDataType_U64, &_pointerTarget, nullptr, nullptr, "%016llX", ImGuiInputTextFlags_CharsHexadecimal);
+      ImGui::SliderInt("Depth", &_pointerDepth, 1, 8);
+      ImGui::InputInt("Max Offset", &_pointerOffset, 8, 0x100, ImGuiInputTextFlags_CharsHexadecimal);
+      if (ImGui::Button("Build Map"))
+      {
+        ScanPointers();
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Find Paths"))
+      {
+        FindPointerPaths();
+      }
+
+      // One saved map and its target per line, paths have to hold in all of them
+      ImGui::InputTextMultiline("##Maps", _pointerMaps, sizeof(_pointerMaps), ImVec2(-1.0f, ImGui::GetTextLineHeight() * 4));
+      if (ImGui::Button("Compare Maps"))
+      {
+        ComparePointerMaps();
+      }
+
+      // Pick up finished searches
+      if (_pointerSearch.valid() && _pointerSearch.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+      {
+        _pointerPaths = _pointerSearch.get();
+      }
+      ImGui::SameLine();
+      ImGui::Text(_pointerSearch.valid() ? "Searching..." : "%zu paths", _pointerPaths.size());
+
+      if (ImGui::BeginTable("PointerTable", 1, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_BordersInnerV, ImVec2(0.0f, ImGui::GetTextLineHeight() * 12)))
+      {
+        // Draw header
+        ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableHeadersRow();
+
+        // Draw paths
+        for (const auto& path : _pointerPaths)
+        {
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::TextUnformatted(path.c_str());
+        }
+
+        ImGui::EndTable();
+      }
+    }
+
+    // Results are exported per session, other files are imported or diffed against the export, captures are taken per session and bound by file
+    if (ImGui::CollapsingHeader("Files"))
+    {
+      if (ImGui::Button("Export"))
+      {
+        ExportResults();
+      }
+      ImGui::SameLine();
+      ImGui::InputText("File", _resultFile, sizeof(_resultFile));
+      if (ImGui::Button("Import"))
+      {
+        ImportResults();
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Diff"))
+      {
+        DiffResults();
+      }
+      if (ImGui::Button("Capture"))
+      {
+        CaptureMemory();
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Bind"))
+      {
+        BindCapture(false);
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Live"))
+      {
+        BindCapture(true);
+      }
+      ImGui::SameLine();
+      ImGui::TextUnformatted(_resultStatus.c_str());
+    }
+
     ImGui::End();
   }
+  void Scanner::OpenSession()
+  {
+    HANDLE handle = ioctrl::OpenScanSession();
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+      Session session = {};
+      session.Name = _sessionName;
+      session.Handle = handle;
+      _sessions.push_back(session);
+      _session = (int32_t)_sessions.size() - 1;
+    }
+  }
+
+  void Scanner::CloseSession()
+  {
+    if (_session >= 0)
+    {
+      ioctrl::CloseScanSession(_sessions[_session].Handle);
+      _sessions.erase(_sessions.begin() + _session);
+      _session = _sessions.empty() ? -1 : 0;
+    }
+  }
+
+  void Scanner::ScanFirst()
+  {
+    // Scan into a fresh session if none is selected
+    if (_session < 0)
+    {
+      OpenSession();
+      if (_session < 0)
+      {
+        return;
+      }
+    }
+
+    // First scans bind the session to the selected process
+    Session& session = _sessions[_session];
+    if (session.Running)
+    {
+      return;
+    }
+    session.Pid = g_process.GetPid();
+    session.Type = _type;
+    SCAN_FILTER filter = _unknown ? SCAN_FILTER_UNKNOWN : SCAN_FILTER_EXACT;
+    SCAN_ALIGNMENT alignment = (SCAN_ALIGNMENT)(_alignment ? (1 << (_alignment - 1)) : SCAN_ALIGNMENT_NATURAL);
+    SCAN_ROUNDING rounding = (SCAN_ROUNDING)_rounding;
+    SCAN_REGION_FILTER regions = BuildRegionFilter();
+
+    // Predicates share one descriptor for every fixed width type
+    if (!_unknown && _filter >= PredicateFilter && _type <= SCAN_TYPE_FLOAT64)
+    {
+      session.Running = ioctrl::ScanProcessPredicate(session.Handle, session.Pid, g_processImage.GetImageBase(), BuildPredicate(), (SCAN_TYPE)_type, alignment, rounding, _tolerance, regions);
+      return;
+    }
+    switch (_type)
+    {
+      case SCAN_TYPE_BYTE8:  session.Running = ioctrl::ScanProcessFirst<int8_t>(session.Handle, session.Pid, g_processImage.GetImageBase(), (int8_t)_value, SCAN_TYPE_BYTE8, filter, alignment, rounding, _tolerance, regions);    break;
+      case SCAN_TYPE_BYTE16: session.Running = ioctrl::ScanProcessFirst<int16_t>(session.Handle, session.Pid, g_processImage.GetImageBase(), (int16_t)_value, SCAN_TYPE_BYTE16, filter, alignment, rounding, _tolerance, regions); break;
+      case SCAN_TYPE_BYTE32: session.Running = ioctrl::ScanProcessFirst<int32_t>(session.Handle, session.Pid, g_processImage.GetImageBase(), (int32_t)_value, SCAN_TYPE_BYTE32, filter, alignment, rounding, _tolerance, regions); break;
+      case SCAN_TYPE_BYTE64: session.Running = ioctrl::ScanProcessFirst<int64_t>(session.Handle, session.Pid, g_processImage.GetImageBase(), (int64_t)_value, SCAN_TYPE_BYTE64, filter, alignment, rounding, _tolerance, regions); break;
+      case SCAN_TYPE_FLOAT32: session.Running = ioctrl::ScanProcessFirst<float>(session.Handle, session.Pid, g_processImage.GetImageBase(), (float)_real, SCAN_TYPE_FLOAT32, filter, alignment, rounding, _tolerance, regions); break;
+      case SCAN_TYPE_FLOAT64: session.Running = ioctrl::ScanProcessFirst<double>(session.Handle, session.Pid, g_processImage.GetImageBase(), _real, SCAN_TYPE_FLOAT64, filter, alignment, rounding, _tolerance, regions); break;
+      case SCAN_TYPE_BYTES:
+      {
+        // Patterns are matched by the driver, only addresses are returned
+        std::vector<BYTE> bytes = {};
+        std::vector<BYTE> masks = {};
+        if (pattern::Parse(_pattern, bytes, masks))
+        {
+          session.Running = ioctrl::ScanProcessPattern(session.Handle, session.Pid, g_processImage.GetImageBase(), bytes, masks, regions);
+        }
+        break;
+      }
+      case SCAN_TYPE_ASCII:
+      case SCAN_TYPE_UTF16:
+      case SCAN_TYPE_TEXT:
+      {
+        // Text is sent as UTF-16, the driver derives the narrow encoding itself
+        std::wstring text(strlen(_pattern), L'\0');
+        text.resize(MultiByteToWideChar(CP_UTF8, 0, _pattern, (int)strlen(_pattern), text.data(), (int)text.size()));
+        if (!text.empty())
+        {
+          session.Running = ioctrl::ScanProcessText(session.Handle, session.Pid, g_processImage.GetImageBase(), text, (SCAN_TYPE)_type, _ignoreCase ? SCAN_CASE_INSENSITIVE : SCAN_CASE_SENSITIVE, regions);
+        }
+        break;
+      }
+      case SCAN_TYPE_GROUP:
+      {
+        // Members are packed into their declared width, the driver picks the anchor
+        SCAN_GROUP group{ (DWORD32)_groupWindow, (DWORD32)_groupCount };
+        for (int32_t i = 0; i < _groupCount; i++)
+        {
+          SCAN_GROUP_MEMBER& member = group.Members[i];
+          member.Type = (DWORD32)_groupTypes[i];
+          member.Offset = _groupAny[i] ? SCAN_GROUP_ANY_OFFSET : (DWORD32)_groupOffsets[i];
+          if (member.Type == SCAN_TYPE_FLOAT32)
+          {
+            float real = (float)_groupReals[i];
+            std::memcpy(member.Value, &real, sizeof(float));
+          }
+          else if (member.Type == SCAN_TYPE_FLOAT64)
+          {
+            std::memcpy(member.Value, &_groupReals[i], sizeof(double));
+          }
+          else
+          {
+            std::memcpy(member.Value, &_groupValues[i], sizeof(int64_t));
+          }
+        }
+        session.Running = ioctrl::ScanProcessGroup(session.Handle, session.Pid, g_processImage.GetImageBase(), group, alignment, rounding, _tolerance, regions);
+        break;
+      }
+    }
+  }
+
+  void Scanner::DrawGroup()
+  {
+    // Window bounds the distance of all members from the group start
+    ImGui::InputInt("Window", &_groupWindow, 8, 0x20, ImGuiInputTextFlags_CharsHexadecimal);
+    ImGui::SliderInt("Members", &_groupCount, 1, 4);
+    _groupWindow = std::clamp(_groupWindow, 1, (int32_t)SCAN_GROUP_MAX_WINDOW);
+    for (int32_t i = 0; i < _groupCount; i++)
+    {
+      ImGui::PushID(i);
+      ImGui::Combo("Type", &_groupTypes[i], "Byte8\0Byte16\0Byte32\0Byte64\0Float32\0Float64\0");
+      if (_groupTypes[i] == SCAN_TYPE_FLOAT32 || _groupTypes[i] == SCAN_TYPE_FLOAT64)
+      {
+        ImGui::InputDouble("Value", &_groupReals[i]);
+      }
+      else
+      {
+        ImGui::InputScalar("Value", ImGuiDataType_S64, &_groupValues[i]);
+      }
+      ImGui::Checkbox("Any offset", &_groupAny[i]);
+      if (!_groupAny[i])
+      {
+        ImGui::SameLine();
+        ImGui::InputInt("Offset", &_groupOffsets[i], 1, 8, ImGuiInputTextFlags_CharsHexadecimal);
+      }
+      ImGui::Separator();
+      ImGui::PopID();
+    }
+  }
+
+  void Scanner::DrawRegions()
+  {
+    // Regions are selected in the driver before any of their pages get mapped
+    if (ImGui::TreeNode("Regions"))
+    {
+      ImGui::Checkbox("Writable", &_regionWritable);
+      ImGui::SameLine();
+      ImGui::Checkbox("Executable", &_regionExecutable);
+      ImGui::SameLine();
+      ImGui::Checkbox("Selected module", &_regionModule);
+      ImGui::Combo("Memory", &_regionType, "Any\0Private\0Image\0Mapped\0");
+      ImGui::InputScalar("Start", ImGuiDataType_U64, &_regionStart, nullptr, nullptr, "%llX", ImGuiInputTextFlags_CharsHexadecimal);
+      ImGui::InputScalar("End", ImGuiDataType_U64, &_regionEnd, nullptr, nullptr, "%llX", ImGuiInputTextFlags_CharsHexadecimal);
+      ImGui::TreePop();
+    }
+  }
+
+  void Scanner::ScanNext()
+  {
+    if (_session < 0)
+    {
+      return;
+    }
+
+    // Next scans stay on the process of the first scan
+    Session& session = _sessions[_session];
+    if (session.Running)
+    {
+      return;
+    }
+    SCAN_ROUNDING rounding = (SCAN_ROUNDING)_rounding;
+    if (_filter >= PredicateFilter && _type <= SCAN_TYPE_FLOAT64)
+    {
+      session.Running = ioctrl::ScanNextPredicate(session.Handle, session.Pid, BuildPredicate(), rounding, _tolerance);
+      return;
+    }
+    switch (_type)
+    {
+      case SCAN_TYPE_BYTE8:  session.Running = ioctrl::ScanProcessNext<int8_t>(session.Handle, session.Pid, (int8_t)_value, (SCAN_FILTER)_filter, rounding, _tolerance);   break;
+      case SCAN_TYPE_BYTE16: session.Running = ioctrl::ScanProcessNext<int16_t>(session.Handle, session.Pid, (int16_t)_value, (SCAN_FILTER)_filter, rounding, _tolerance); break;
+      case SCAN_TYPE_BYTE32: session.Running = ioctrl::ScanProcessNext<int32_t>(session.Handle, session.Pid, (int32_t)_value, (SCAN_FILTER)_filter, rounding, _tolerance); break;
+      case SCAN_TYPE_BYTE64: session.Running = ioctrl::ScanProcessNext<int64_t>(session.Handle, session.Pid, (int64_t)_value, (SCAN_FILTER)_filter, rounding, _tolerance); break;
+      case SCAN_TYPE_FLOAT32: session.Running = ioctrl::ScanProcessNext<float>(session.Handle, session.Pid, (float)_real, (SCAN_FILTER)_filter, rounding, _tolerance); break;
+      case SCAN_TYPE_FLOAT64: session.Running = ioctrl::ScanProcessNext<double>(session.Handle, session.Pid, _real, (SCAN_FILTER)_filter, rounding, _tolerance); break;
+    }
+  }
+
+  SCAN_PREDICATE Scanner::BuildPredicate() const
+  {
+    // Filters past the relative ones select predicates in descriptor order
+    SCAN_PREDICATE_TYPE type = (SCAN_PREDICATE_TYPE)(_filter - PredicateFilter + SCAN_PREDICATE_NOT_EQUAL);
+    switch (_type)
+    {
+      case SCAN_TYPE_BYTE8:  return ioctrl::MakePredicate<int8_t>(type, (int8_t)_value, (int8_t)_limit);
+      case SCAN_TYPE_BYTE16: return ioctrl::MakePredicate<int16_t>(type, (int16_t)_value, (int16_t)_limit);
+      case SCAN_TYPE_BYTE32: return ioctrl::MakePredicate<int32_t>(type, (int32_t)_value, (int32_t)_limit);
+      case SCAN_TYPE_BYTE64: return ioctrl::MakePredicate<int64_t>(type, (int64_t)_value, (int64_t)_limit);
+      case SCAN_TYPE_FLOAT32: return (type == SCAN_PREDICATE_MASK) ? ioctrl::MakePredicate<int32_t>(type, (int32_t)_value, (int32_t)_limit) : ioctrl::MakePredicate<float>(type, (float)_real, (float)_realLimit);
+      case SCAN_TYPE_FLOAT64: return (type == SCAN_PREDICATE_MASK) ? ioctrl::MakePredicate<int64_t>(type, _value, _limit) : ioctrl::MakePredicate<double>(type, _real, _realLimit);
+    }
+    return {};
+  }
+
+  SCAN_REGION_FILTER Scanner::BuildRegionFilter() const
+  {
+    // Memory types map onto their flag in selection order
+    SCAN_REGION_FILTER regions{};
+    regions.Flags |= _regionWritable ? SCAN_REGION_WRITABLE : 0;
+    regions.Flags |= _regionExecutable ? SCAN_REGION_EXECUTABLE : 0;
+    regions.Flags |= _regionType ? (SCAN_REGION_PRIVATE << (_regionType - 1)) : 0;
+    regions.Start = _regionStart;
+    regions.End = _regionEnd;
+    regions.Module = _regionModule ? g_processImage.GetImageBase() : 0;
+    return regions;
+  }
+
+  void Scanner::PollSessions()
+  {
+    for (auto& session : _sessions)
+    {
+      if (session.Running)
+      {
+        // Results become readable once the scan completed or was cancelled
+        session.Progress = ioctrl::QueryScanProgress(session.Handle);
+        if (session.Progress.State != SCAN_STATE_RUNNING)
+        {
+          session.Running = false;
+          session.Summary = session.Progress.Summary;
+
+          // Completed pointer scans are persisted right away, the driver only keeps the latest ones
+          if (session.Pointers && session.Progress.State == SCAN_STATE_DONE)
+          {
+            pointer::Build(session.Handle, session.Pid, session.Summary.Results, session.Name + ".kptr");
+          }
+          session.Pointers = false;
+
+          // Captures report from their file, only complete files carry a valid header
+          if (session.Capturing)
+          {
+            std::string path = session.Name + ".kcap";
+            capture::CaptureView view = {};
+            _resultStatus = (session.Progress.State == SCAN_STATE_DONE && view.Open(path)) ? std::format("{} ({} regions, {} bytes)", path, view.GetRegionCount(), view.GetHeader().Bytes) : "Capture failed";
+          }
+          session.Capturing = false;
+
+          // Signature matches are kept apart from the scan results
+          if (session.Signatures && session.Progress.State == SCAN_STATE_DONE)
+          {
+            _signatureMatches = ioctrl::ReadSignatures(session.Handle, (DWORD32)_signatureSources.size(), SignatureLimit);
+          }
+          session.Signatures = false;
+          ClearRows(session);
+        }
+      }
+    }
+  }
+
+  void Scanner::UndoScan()
+  {
+    // Previous generations are kept by the driver, no rescan is needed
+    if (_session >= 0 && !_sessions[_session].Running)
+    {
+      Session& session = _sessions[_session];
+      if (ioctrl::UndoScan(session.Handle, session.Summary))
+      {
+        ClearRows(session);
+      }
+    }
+  }
+
+  void Scanner::RedoScan()
+  {
+    if (_session >= 0 && !_sessions[_session].Running)
+    {
+      Session& session = _sessions[_session];
+      if (ioctrl::RedoScan(session.Handle, session.Summary))
+      {
+        ClearRows(session);
+      }
+    }
+  }
+
+  void Scanner::ClearRows(Session& session)
+  {
+    // Results changed, rows and values are fetched again on the next draw
+    session.First = 0;
+    session.Scans.clear();
+    session.ValueFirst = 0;
+    session.Values.clear();
+  }
+
+  void Scanner::ReadRows(Session& session, uint64_t first, uint64_t count)
+  {
+    // Addresses are fetched in blocks around the visible rows, scrolling inside a block costs nothing
+    if (first < session.First || (first + count) > (session.First + session.Scans.size()))
+    {
+      uint64_t start = first - (std::min<uint64_t>)(first, RowBlock / 2);
+      uint64_t end = (std::min<uint64_t>)((std::max<uint64_t>)(first + count, start + RowBlock), session.Summary.Results);
+      session.First = start;
+      ioctrl::ReadScanResults(session.Handle, start, (DWORD32)(end - start), session.Scans);
+    }
+  }
+
+  void Scanner::RefreshValues(Session& session, uint64_t first, uint64_t count, float time)
+  {
+    // One batched read per refresh, rows scrolled into view are read right away
+    uint32_t width = GetValueWidth(session.Type);
+    bool captured = !session.Capture.empty();
+    bool moved = first != session.ValueFirst || (count * width) != session.Values.size();
+    if (count > 0 && first >= session.First && (first + count) <= (session.First + session.Scans.size()) && (moved || (!captured && (time - session.Refreshed) >= (1.0f / _refreshRate))))
+    {
+      // Captured sessions show the values stored by their last scan, captures do not change
+      if (captured && session.Summary.ValueSize == width)
+      {
+        ioctrl::ReadScanValues(session.Handle, first, (DWORD32)count, width, session.Values);
+      }
+      else if (captured)
+      {
+        session.Values.clear();
+      }
+      else
+      {
+        ioctrl::ReadProcessValues(session.Pid, &session.Scans[first - session.First], (DWORD32)count, width, session.Values);
+      }
+      session.ValueFirst = first;
+      session.Refreshed = time;
+    }
+  }
+
+  uint32_t Scanner::GetValueWidth(int32_t type)
+  {
+    switch (type)
+    {
+      case SCAN_TYPE_BYTE8: return sizeof(int8_t);
+      case SCAN_TYPE_BYTE16: return sizeof(int16_t);
+      case SCAN_TYPE_BYTE32: return sizeof(int32_t);
+      case SCAN_TYPE_FLOAT32: return sizeof(float);
+    }
+    return sizeof(int64_t);
+  }
+
+  std::string Scanner::FormatValue(int32_t type, const BYTE* value)
+  {
+    // Values are packed without alignment, small integers are promoted so they do not print as characters
+    auto format = [value]<typename T>(T scalar) { std::memcpy(&scalar, value, sizeof(T)); return std::format("{}", +scalar); };
+    switch (type)
+    {
+      case SCAN_TYPE_BYTE8:  return format(int8_t{});
+      case SCAN_TYPE_BYTE16: return format(int16_t{});
+      case SCAN_TYPE_BYTE32: return format(int32_t{});
+      case SCAN_TYPE_BYTE64: return format(int64_t{});
+      case SCAN_TYPE_FLOAT32: return format(float{});
+      case SCAN_TYPE_FLOAT64: return format(double{});
+    }
+
+    // Patterns, text and groups show their leading bytes
+    return std::format("{:02X} {:02X} {:02X} {:02X} {:02X} {:02X} {:02X} {:02X}", value[0], value[1], value[2], value[3], value[4], value[5], value[6], value[7]);
+  }
+
+  void Scanner::ResolveSignatures()
+  {
+    // Signatures resolve in the background on the selected session
+    if (_session < 0)
+    {
+      OpenSession();
+      if (_session < 0)
+      {
+        return;
+      }
+    }
+    Session& session = _sessions[_session];
+    if (session.Running)
+    {
+      return;
+    }
+
+    // One signature per line
+    _signatureSources.clear();
+    std::string text = _signatures;
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+      size_t end = (std::min)(text.find('\n', begin), text.size());
+      std::string line = text.substr(begin, end - begin);
+      if (line.find_first_not_of(" \t\r") != std::string::npos)
+      {
+        _signatureSources.push_back(line);
+      }
+      begin = end + 1;
+    }
+
+    // Reuse the compiled set of previous sessions, the driver copies it before the call returns
+    std::vector<BYTE> set = {};
+    _signatureMatches.clear();
+    if (signature::LoadOrCompile("signatures.ksig", _signatureSources, set))
+    {
+      session.Running = ioctrl::ScanSignatures(session.Handle, g_process.GetPid(), g_processImage.GetImageBase(), g_processImage.GetImageSize(), set, SignatureLimit);
+      session.Signatures = session.Running;
+    }
+  }
+
+  void Scanner::ScanPointers()
+  {
+    // Map into a fresh session if none is selected
+    if (_session < 0)
+    {
+      OpenSession();
+      if (_session < 0)
+      {
+        return;
+      }
+    }
+
+    // Pointer maps cover the whole address space of the selected process
+    Session& session = _sessions[_session];
+    if (session.Running)
+    {
+      return;
+    }
+    session.Pid = g_process.GetPid();
+    session.Type = SCAN_TYPE_BYTE64;
+    session.Running = ioctrl::ScanPointers(session.Handle, session.Pid, 0, 0);
+    session.Pointers = session.Running;
+  }
+
+  void Scanner::FindPointerPaths()
+  {
+    if (_session < 0 || _pointerSearch.valid())
+    {
+      return;
+    }
+
+    // Searches run on the saved map, the driver is not involved anymore
+    std::string path = _sessions[_session].Name + ".kptr";
+    pointer::Options options = {};
+    options.MaxDepth = (uint32_t)_pointerDepth;
+    options.MaxOffset = (uint64_t)(std::max)(_pointerOffset, 0);
+    uint64_t target = _pointerTarget;
+    _pointerPaths.clear();
+    _pointerSearch = std::async(std::launch::async, [path, target, options]()
+    {
+      std::vector<std::string> paths = {};
+      pointer::MapView map = {};
+      if (map.Open(path))
+      {
+        for (const auto& found : pointer::FindPaths(map, target, options))
+        {
+          paths.push_back(pointer::Format(map, found));
+        }
+      }
+      return paths;
+    });
+  }
+
+  void Scanner::ComparePointerMaps()
+  {
+    if (_pointerSearch.valid())
+    {
+      return;
+    }
+
+    // Lines are a map path followed by the target address in that session
+    std::vector<std::string> paths = {};
+    std::vector<uint64_t> targets = {};
+    std::string text = _pointerMaps;
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+      size_t end = (std::min)(text.find('\n', begin), text.size());
+      std::string line = text.substr(begin, end - begin);
+      size_t split = line.find_last_of(" \t");
+      if (split != std::string::npos && split > 0)
+      {
+        paths.push_back(line.substr(0, line.find_last_not_of(" \t", split) + 1));
+        targets.push_back(strtoull(line.c_str() + split + 1, nullptr, 16));
+      }
+      begin = end + 1;
+    }
+    if (paths.size() < 2)
+    {
+      return;
+    }
+
+    // Intersection runs on the saved maps only
+    pointer::Options options = {};
+    options.MaxDepth = (uint32_t)_pointerDepth;
+    options.MaxOffset = (uint64_t)(std::max)(_pointerOffset, 0);
+    _pointerPaths.clear();
+    _pointerSearch = std::async(std::launch::async, [paths, targets, options]()
+    {
+      std::vector<std::string> found = {};
+      std::vector<std::unique_ptr<pointer::MapView>> views = {};
+      std::vector<pointer::MapView*> maps = {};
+      for (const auto& path : paths)
+      {
+        views.push_back(std::make_unique<pointer::MapView>());
+        if (!views.back()->Open(path))
+        {
+          return found;
+        }
+        maps.push_back(views.back().get());
+      }
+      pointer::IntersectPaths(maps, targets, options, [&](const pointer::Path& path)
+      {
+        found.push_back(pointer::Format(*maps[0], path));
+        return true;
+      });
+      return found;
+    });
+  }
+
+  void Scanner::ExportResults()
+  {
+    if (_session < 0 || _sessions[_session].Running)
+    {
+      return;
+    }
+
+    // Results are streamed out of the driver batch by batch
+    Session& session = _sessions[_session];
+    std::string path = session.Name + ".kres";
+    bool exported = results::Export(session.Handle, session.Pid, (DWORD32)session.Type, session.Summary, path);
+    _resultStatus = exported ? path : "Export failed";
+  }
+
+  void Scanner::ImportResults()
+  {
+    // Import into a fresh session if none is selected
+    if (_session < 0)
+    {
+      OpenSession();
+      if (_session < 0)
+      {
+        return;
+      }
+    }
+
+    // Imported results replace the session and become a new generation to scan next on
+    Session& session = _sessions[_session];
+    if (session.Running)
+    {
+      return;
+    }
+    results::FileHeader header = {};
+    if (results::Import(session.Handle, _resultFile, header, session.Summary))
+    {
+      session.Pid = header.Pid;
+      session.Type = (int32_t)header.Type;
+      _resultStatus = std::to_string(header.Count) + " results";
+    }
+    else
+    {
+      _resultStatus = "Import failed";
+    }
+    ClearRows(session);
+  }
+
+  void Scanner::DiffResults()
+  {
+    if (_session < 0)
+    {
+      return;
+    }
+
+    // Diffs run on the files only, the older file is compared against the session export
+    std::string path = _sessions[_session].Name + ".kres";
+    std::string diff = _sessions[_session].Name + ".diff.kres";
+    results::FileView previous = {};
+    results::FileView next = {};
+    bool compared = previous.Open(_resultFile) && next.Open(path) && results::Diff(previous, next, diff);
+    _resultStatus = compared ? diff : "Diff failed";
+  }
+
+  void Scanner::CaptureMemory()
+  {
+    // Map into a fresh session if none is selected
+    if (_session < 0)
+    {
+      OpenSession();
+      if (_session < 0)
+      {
+        return;
+      }
+    }
+
+    // Captures take the regions the filter selects, scans bind to them later on
+    Session& session = _sessions[_session];
+    if (session.Running)
+    {
+      return;
+    }
+    std::string path = session.Name + ".kcap";
+    session.Running = ioctrl::CaptureProcessMemory(session.Handle, g_process.GetPid(), BuildRegionFilter(), path);
+    session.Capturing = session.Running;
+    _resultStatus = session.Running ? path : "Capture failed";
+  }
+
+  void Scanner::BindCapture(bool live)
+  {
+    if (_session < 0 || _sessions[_session].Running)
+    {
+      return;
+    }
+
+    // Captures are validated here first so the session shows the process they were taken from
+    Session& session = _sessions[_session];
+    capture::CaptureView view = {};
+    if (live)
+    {
+      bool bound = ioctrl::SetScanSource(session.Handle, "");
+      session.Capture = bound ? "" : session.Capture;
+      _resultStatus = bound ? "Live" : "Bind failed";
+    }
+    else if (view.Open(_resultFile) && ioctrl::SetScanSource(session.Handle, _resultFile))
+    {
+      session.Pid = view.GetHeader().Pid;
+      session.Capture = _resultFile;
+      _resultStatus = std::format("{} ({} regions)", session.Capture, view.GetRegionCount());
+    }
+    else
+    {
+      _resultStatus = "Bind failed";
+    }
+    ClearRows(session);
+  }
 }
\ No newline at end of file
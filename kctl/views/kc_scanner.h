@@ -2,6 +2,9 @@
 #define KC_SCANNER_H
 
 #include <kc_core.h>
+#include <kc_ioctrl.h>
+#include <kc_pointer.h>
+#include <kc_capture.h>
 
 ///////////////////////////////////////////////////////////
 // Scanner utilities
@@ -11,14 +14,106 @@ namespace kdbg
 {
   class Scanner
   {
+  public:
+    static constexpr uint64_t RowBlock = 256;
+    static constexpr int32_t PredicateFilter = 7;
+    static constexpr uint32_t SignatureLimit = 16;
+
+    struct Session
+    {
+      std::string Name = "";
+      HANDLE Handle = INVALID_HANDLE_VALUE;
+      uint32_t Pid = 0;
+      int32_t Type = 0;
+      SCAN_SUMMARY Summary = {};
+      SCAN_PROGRESS Progress = {};
+      bool Running = false;
+      bool Pointers = false;
+      bool Capturing = false;
+      bool Signatures = false;
+      uint64_t First = 0;
+      std::vector<uint64_t> Scans = {};
+      uint64_t ValueFirst = 0;
+      std::vector<BYTE> Values = {};
+      float Refreshed = 0.0f;
+      std::string Capture = "";
+    };
+
   public:
     Scanner() = default;
+    ~Scanner();
 
   public:
     void Draw(float time);
 
   private:
-    std::vector<uint64_t> _scans = {};
+    void OpenSession();
+    void CloseSession();
+    void ScanFirst();
+    void ScanNext();
+    void PollSessions();
+    void UndoScan();
+    void RedoScan();
+    void ClearRows(Session& session);
+    void ReadRows(Session& session, uint64_t first, uint64_t count);
+    void RefreshValues(Session& session, uint64_t first, uint64_t count, float time);
+    void ResolveSignatures();
+    void ScanPointers();
+    void FindPointerPaths();
+    void ComparePointerMaps();
+    void ExportResults();
+    void ImportResults();
+    void DiffResults();
+    void CaptureMemory();
+    void BindCapture(bool live);
+    void DrawGroup();
+    void DrawRegions();
+    SCAN_PREDICATE BuildPredicate() const;
+    SCAN_REGION_FILTER BuildRegionFilter() const;
+    static uint32_t GetValueWidth(int32_t type);
+    static std::string FormatValue(int32_t type, const BYTE* value);
+
+  private:
+    std::vector<Session> _sessions = {};
+    int32_t _session = -1;
+    char _sessionName[64] = "Scan";
+    bool _unknown = false;
+    bool _ignoreCase = false;
+    int32_t _type = 2;
+    int32_t _filter = 0;
+    int32_t _alignment = 0;
+    int32_t _rounding = 0;
+    int64_t _value = 0;
+    int64_t _limit = 0;
+    double _real = 0.0;
+    double _realLimit = 0.0;
+    double _tolerance = 0.0;
+    float _refreshRate = 4.0f;
+    char _pattern[256] = {};
+    int32_t _groupWindow = 0x40;
+    int32_t _groupCount = 2;
+    int32_t _groupTypes[4] = { 2, 2, 2, 2 };
+    int64_t _groupValues[4] = {};
+    double _groupReals[4] = {};
+    int32_t _groupOffsets[4] = {};
+    bool _groupAny[4] = { false, true, true, true };
+    bool _regionWritable = false;
+    bool _regionExecutable = false;
+    int32_t _regionType = 0;
+    bool _regionModule = false;
+    uint64_t _regionStart = 0;
+    uint64_t _regionEnd = 0;
+    char _signatures[0x4000] = {};
+    std::vector<std::string> _signatureSources = {};
+    std::vector<std::vector<uint64_t>> _signatureMatches = {};
+    uint64_t _pointerTarget = 0;
+    int32_t _pointerDepth = 4;
+    int32_t _pointerOffset = 0x800;
+    char _pointerMaps[0x1000] = {};
+    std::future<std::vector<std::string>> _pointerSearch = {};
+    std::vector<std::string> _pointerPaths = {};
+    char _resultFile[260] = {};
+    std::string _resultStatus = "";
   };
 }
 
@@ -0,0 +1,184 @@
+#include <test_core.h>
+
+///////////////////////////////////////////////////////////
+// Benchmark limits
+///////////////////////////////////////////////////////////
+
+#define BENCH_DEFAULT_MEGABYTES 256
+#define BENCH_MAX_OFFSETS (KM_SCAN_BLOCK_SIZE + KM_PATTERN_MAX_LENGTH)
+
+///////////////////////////////////////////////////////////
+// Benchmark utilities
+///////////////////////////////////////////////////////////
+
+static
+VOID
+BenchReport(
+  const char* name,
+  DWORD64 size,
+  DWORD64 hits,
+  double seconds)
+{
+  // Bytes per hit shows how selective a compare is on the benchmark data
+  printf("%-26s %8.2f GB/s %12llu hits %12.1f bytes/hit\n", name, (double)size / seconds / 1e9, (unsigned long long)hits, hits ? (double)size / (double)hits : 0.0);
+}
+
+static
+VOID
+BenchCompare(
+  const char* name,
+  SCAN_COMPARE_ROUTINE routine,
+  PBYTE bytes,
+  DWORD64 size,
+  PBYTE value,
+  DWORD32 alignment,
+  PDWORD32 offsets)
+{
+  DWORD64 hits = 0;
+
+  // Blocks are compared like the scanner does, one page at a time
+  double start = TestSeconds();
+  for (DWORD64 offset = 0; (offset + KM_SCAN_BLOCK_SIZE) <= size; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    hits += routine(bytes + offset, KM_SCAN_BLOCK_SIZE, value, alignment, offsets);
+  }
+  BenchReport(name, size, hits, TestSeconds() - start);
+}
+
+static
+VOID
+BenchPlant(
+  PBYTE bytes,
+  DWORD64 size,
+  PBYTE value,
+  DWORD32 length)
+{
+  // Roughly one occurrence per 64 KB so both matchers report hits
+  for (DWORD64 offset = TestRandom() % 0x10000; (offset + length) <= size; offset += 1 + TestRandom() % 0x20000)
+  {
+    memcpy(bytes + offset, value, length);
+  }
+}
+
+static
+DWORD32
+BenchMatchNaive(
+  PPATTERN pattern,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+
+  // Masked compare at every start, byte by byte
+  for (DWORD32 offset = 0; (offset + pattern->Length) <= size; offset++)
+  {
+    DWORD32 i = 0;
+    while (i < pattern->Length && ((bytes[offset + i] ^ pattern->Bytes[i]) & pattern->Masks[i]) == 0)
+    {
+      i++;
+    }
+    if (i == pattern->Length)
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+static
+VOID
+BenchPattern(
+  const char* name,
+  PPATTERN pattern,
+  PBYTE bytes,
+  DWORD64 size,
+  PDWORD32 offsets)
+{
+  DWORD64 hits = 0;
+  DWORD64 naiveHits = 0;
+  char naiveName[64];
+
+  // Patterns run over blocks including their reach, like the scanner hands them out
+  double start = TestSeconds();
+  for (DWORD64 offset = 0; (offset + KM_SCAN_BLOCK_SIZE + pattern->Length - 1) <= size; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    hits += KmMatchPattern(pattern, bytes + offset, KM_SCAN_BLOCK_SIZE + pattern->Length - 1, offsets);
+  }
+  BenchReport(name, size, hits, TestSeconds() - start);
+
+  // Baseline over the same blocks, hit counts have to agree
+  start = TestSeconds();
+  for (DWORD64 offset = 0; (offset + KM_SCAN_BLOCK_SIZE + pattern->Length - 1) <= size; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    naiveHits += BenchMatchNaive(pattern, bytes + offset, KM_SCAN_BLOCK_SIZE + pattern->Length - 1, offsets);
+  }
+  snprintf(naiveName, sizeof(naiveName), "%s naive", name);
+  BenchReport(naiveName, size, naiveHits, TestSeconds() - start);
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main(
+  int argc,
+  char** argv)
+{
+  DWORD64 size = (DWORD64)((argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_MEGABYTES) << 20;
+  PBYTE bytes = malloc(size);
+  PDWORD32 offsets = malloc(BENCH_MAX_OFFSETS * sizeof(DWORD32));
+  if (bytes == NULL || offsets == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Mostly zero pages with sparse small integers, roughly what process heaps look like
+  memset(bytes, 0, size);
+  for (DWORD64 i = 0; i < size; i += 1 + TestRandom() % 64)
+  {
+    bytes[i] = (BYTE)TestRandom();
+  }
+
+  static const char* names[] = { "byte8", "byte16", "byte32", "byte64", "float32", "float64" };
+  BOOLEAN avx2 = TestIsAvx2Supported();
+  for (DWORD32 type = SCAN_TYPE_BYTE8; type <= SCAN_TYPE_FLOAT64; type++)
+  {
+    // Integers search for a small value, reals for the unit range
+    BYTE value[16] = { 0x2A };
+    if (KmIsRealCompare(type))
+    {
+      KmStoreRealRange(value, KmGetCompareWidth(type), 1.0, 2.0);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s sse2", names[type]);
+    BenchCompare(name, KmGetCompareKernel(type, FALSE), bytes, size, value, KmGetCompareWidth(type), offsets);
+    if (avx2)
+    {
+      snprintf(name, sizeof(name), "%s avx2", names[type]);
+      BenchCompare(name, KmGetCompareKernel(type, TRUE), bytes, size, value, KmGetCompareWidth(type), offsets);
+    }
+    snprintf(name, sizeof(name), "%s sse2 byte aligned", names[type]);
+    BenchCompare(name, KmGetCompareKernel(type, FALSE), bytes, size, value, 1, offsets);
+  }
+
+  // Code like patterns with a wildcard, and a long fixed one which takes the skip path
+  PATTERN pattern;
+  BYTE anchored[] = { 0x48, 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85, 0xC0 };
+  BYTE anchoredMasks[] = { 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF };
+  KmCompilePattern(&pattern, anchored, anchoredMasks, sizeof(anchored));
+  BenchPlant(bytes, size, anchored, sizeof(anchored));
+  BenchPattern("pattern anchored", &pattern, bytes, size, offsets);
+  BYTE skipped[] = { 0x40, 0x53, 0x48, 0x83, 0xEC, 0x20, 0x48, 0x8B, 0xD9, 0xE8 };
+  BYTE skippedMasks[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  KmCompilePattern(&pattern, skipped, skippedMasks, sizeof(skipped));
+  BenchPlant(bytes, size, skipped, sizeof(skipped));
+  BenchPattern("pattern skip", &pattern, bytes, size, offsets);
+
+  free(offsets);
+  free(bytes);
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <test_dirty.h>
+
+///////////////////////////////////////////////////////////
+// Benchmark limits
+///////////////////////////////////////////////////////////
+
+#define BENCH_DEFAULT_MEGABYTES 256
+#define BENCH_RESULT_STRIDE 0x10
+#define BENCH_MEMORY_BASE 0x10000000000ULL
+
+///////////////////////////////////////////////////////////
+// Benchmark utilities
+///////////////////////////////////////////////////////////
+
+static
+double
+BenchNextPass(
+  PTEST_MEMORY memory,
+  PDIRTY_SOURCE source,
+  PTEST_RESULT results,
+  DWORD64 count,
+  PBYTE page,
+  PDWORD64 kept,
+  PDWORD64 readCount)
+{
+  // Unchanged filter over a copy, so every pass starts from the same results
+  PTEST_RESULT copy = malloc(count * sizeof(TEST_RESULT));
+  if (copy == NULL)
+  {
+    return 0.0;
+  }
+  memcpy(copy, results, count * sizeof(TEST_RESULT));
+
+  *readCount = 0;
+  double start = TestSeconds();
+  *kept = TestNextPass(memory, source, SCAN_FILTER_UNCHANGED, copy, count, page, readCount);
+  double seconds = TestSeconds() - start;
+
+  free(copy);
+  return seconds;
+}
+
+static
+VOID
+BenchSoftDirty(
+  DWORD64 size)
+{
+  DIRTY_SOURCE source;
+  SOFT_DIRTY dirty;
+  if (KmOpenSoftDirtySource(&source, &dirty, getpid()) == FALSE)
+  {
+    printf("soft dirty not supported by this kernel\n");
+    return;
+  }
+
+  // Populated private memory of the requested size, the advance cost grows with tracked pages
+  PBYTE bytes = mmap(NULL, (SIZE_T)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (bytes != MAP_FAILED)
+  {
+    memset(bytes, 1, (SIZE_T)size);
+    KmAdvanceDirtySource(&source);
+    double start = TestSeconds();
+    KmAdvanceDirtySource(&source);
+    double seconds = TestSeconds() - start;
+    printf("soft dirty advance %8.3f ms\n", seconds * 1e3);
+    munmap(bytes, (SIZE_T)size);
+  }
+
+  KmCloseSoftDirtySource(&source, &dirty);
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main(
+  int argc,
+  char** argv)
+{
+  // Values every few bytes like an unknown first scan of 32 bit integers
+  DWORD64 size = (DWORD64)((argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_MEGABYTES) << 20;
+  TEST_MEMORY memory;
+  PTEST_RESULT results = malloc((size / BENCH_RESULT_STRIDE + 1) * sizeof(TEST_RESULT));
+  PBYTE page = malloc(KM_SCAN_PAGE_SIZE + sizeof(INT32));
+  if (TestInitializeMemory(&memory, BENCH_MEMORY_BASE, size / KM_SCAN_PAGE_SIZE) == FALSE || results == NULL || page == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  for (DWORD64 i = 0; i < size; i += 1 + TestRandom() % 64)
+  {
+    memory.Bytes[i] = (BYTE)TestRandom();
+  }
+  DWORD64 count = TestCollectResults(&memory, BENCH_RESULT_STRIDE, results);
+  printf("%llu MB, %llu results\n", (unsigned long long)(size >> 20), (unsigned long long)count);
+
+  DIRTY_SOURCE untracked;
+  KmInitializeDirtySource(&untracked, NULL, NULL, NULL);
+
+  // Write a share of the pages between two passes, the full pass reads every page regardless
+  DWORD32 percents[] = { 1, 10, 100 };
+  for (DWORD32 i = 0; i < ARRAYSIZE(percents); i++)
+  {
+    DIRTY_SOURCE source;
+    KmInitializeDirtySource(&source, TestAdvanceWrites, TestQueryWrites, &memory);
+    KmAdvanceDirtySource(&source);
+    for (DWORD64 index = 0; index < memory.PageCount; index++)
+    {
+      if (TestRandom() % 100 < percents[i])
+      {
+        DWORD64 offset = index * KM_SCAN_PAGE_SIZE;
+        INT32 value;
+        memcpy(&value, memory.Bytes + offset, sizeof(value));
+        TestWriteMemory(&memory, offset, value);
+      }
+    }
+    KmAdvanceDirtySource(&source);
+
+    DWORD64 fullKept = 0;
+    DWORD64 fullReads = 0;
+    DWORD64 trackedKept = 0;
+    DWORD64 trackedReads = 0;
+    double fullSeconds = BenchNextPass(&memory, &untracked, results, count, page, &fullKept, &fullReads);
+    double trackedSeconds = BenchNextPass(&memory, &source, results, count, page, &trackedKept, &trackedReads);
+    printf("%3u%% written  full %8.3f ms %10llu pages  tracked %8.3f ms %10llu pages %6.2fx speedup%s\n", percents[i], fullSeconds * 1e3, (unsigned long long)fullReads, trackedSeconds * 1e3, (unsigned long long)trackedReads, fullSeconds / trackedSeconds, (fullKept == trackedKept) ? "" : " (mismatch)");
+  }
+
+  BenchSoftDirty(size);
+
+  free(page);
+  free(results);
+  TestFreeMemory(&memory);
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
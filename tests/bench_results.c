@@ -0,0 +1,218 @@
+#include <test_core.h>
+#include <km_result_store.h>
+
+///////////////////////////////////////////////////////////
+// Benchmark limits
+///////////////////////////////////////////////////////////
+
+#define BENCH_DEFAULT_HITS 10000000
+#define BENCH_DEFAULT_SORT_ENTRIES 10000000
+#define BENCH_POOL_HEADER_SIZE 16
+
+///////////////////////////////////////////////////////////
+// Benchmark data types
+///////////////////////////////////////////////////////////
+
+typedef struct _BENCH_RESULT
+{
+  LIST_ENTRY List;
+  DWORD64 Base;
+  BYTE Value[8];
+} BENCH_RESULT, * PBENCH_RESULT;
+
+///////////////////////////////////////////////////////////
+// Benchmark utilities
+///////////////////////////////////////////////////////////
+
+static
+VOID
+BenchReport(
+  const char* name,
+  DWORD64 hits,
+  DWORD64 bytes,
+  double seconds)
+{
+  // Bytes per hit include every header the store keeps
+  printf("%-26s %12.0f hits/s %12llu hits %8.1f bytes/hit\n", name, (double)hits / seconds, (unsigned long long)hits, hits ? (double)bytes / (double)hits : 0.0);
+}
+
+static
+VOID
+BenchStore(
+  const char* name,
+  DWORD64 hits,
+  DWORD32 valueSize,
+  DWORD32 stride,
+  PBYTE bytes,
+  PDWORD32 offsets)
+{
+  RESULT_STORE store;
+  KmInitializeResultStore(&store, valueSize);
+
+  // Hits arrive one block at a time like the compare kernels report them
+  DWORD32 count = KM_SCAN_BLOCK_SIZE / stride;
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    offsets[i] = i * stride;
+  }
+  double start = TestSeconds();
+  for (DWORD64 base = 0; store.Count < hits; base += KM_SCAN_BLOCK_SIZE)
+  {
+    if (NT_SUCCESS(KmAppendResults(&store, base, bytes, offsets, count)) == FALSE)
+    {
+      printf("%s: out of memory\n", name);
+      break;
+    }
+  }
+  BenchReport(name, store.Count, store.Bytes, TestSeconds() - start);
+
+  KmResetResultStore(&store);
+}
+
+static
+VOID
+BenchAllocations(
+  const char* name,
+  DWORD64 hits,
+  DWORD32 valueSize,
+  DWORD32 stride,
+  PBYTE bytes)
+{
+  LIST_ENTRY results;
+  InitializeListHead(&results);
+
+  // One allocation per hit, pool allocations carry their own header
+  DWORD64 count = 0;
+  double start = TestSeconds();
+  for (DWORD64 base = 0; count < hits; base += stride)
+  {
+    PBENCH_RESULT result = ExAllocatePoolWithTag(PagedPool, sizeof(BENCH_RESULT), KM_MEMORY_POOL_TAG);
+    if (result == NULL)
+    {
+      printf("%s: out of memory\n", name);
+      break;
+    }
+    result->Base = base;
+    RtlCopyMemory(result->Value, bytes + base % KM_SCAN_BLOCK_SIZE, valueSize);
+    InsertTailList(&results, &result->List);
+    count++;
+  }
+  BenchReport(name, count, count * (sizeof(BENCH_RESULT) + BENCH_POOL_HEADER_SIZE), TestSeconds() - start);
+
+  while (IsListEmpty(&results) == FALSE)
+  {
+    ExFreePoolWithTag(CONTAINING_RECORD(RemoveHeadList(&results), BENCH_RESULT, List), KM_MEMORY_POOL_TAG);
+  }
+}
+
+static
+BOOLEAN
+BenchIsSorted(
+  PRESULT_STORE store)
+{
+  // Addresses have to be strictly increasing across all chunks
+  DWORD64 count = 0;
+  DWORD64 last = 0;
+  for (PLIST_ENTRY listEntry = store->Chunks.Flink; listEntry != &store->Chunks; listEntry = listEntry->Flink)
+  {
+    PRESULT_CHUNK chunk = CONTAINING_RECORD(listEntry, RESULT_CHUNK, List);
+    for (DWORD32 i = 0; i < chunk->Count; i++)
+    {
+      if (count++ && chunk->Bases[i] <= last)
+      {
+        return FALSE;
+      }
+      last = chunk->Bases[i];
+    }
+  }
+  return count == store->Count;
+}
+
+static
+VOID
+BenchSort(
+  const char* name,
+  DWORD64 entries,
+  DWORD32 passes,
+  BOOLEAN random)
+{
+  RESULT_STORE store;
+  KmInitializeResultStore(&store, sizeof(DWORD64));
+
+  // Every pass appends its share in address order like one work item, passes overlap by half a stride
+  DWORD64 seed = 0x9E3779B97F4A7C15ULL;
+  for (DWORD32 pass = 0; pass < passes; pass++)
+  {
+    RESULT_STORE results;
+    KmInitializeResultStore(&results, sizeof(DWORD64));
+    for (DWORD64 i = 0; i < entries / passes; i++)
+    {
+      DWORD64 base = i * 8 + pass * 4;
+      if (random)
+      {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        base = seed & 0x7FFFFFFFFFF8ULL;
+      }
+      if (NT_SUCCESS(KmAppendResult(&results, base, (PBYTE)&base)) == FALSE)
+      {
+        printf("%s: out of memory\n", name);
+        break;
+      }
+    }
+    KmSpliceResultStore(&store, &results);
+  }
+
+  // Duplicates of random runs are dropped by the sort
+  double start = TestSeconds();
+  NTSTATUS status = KmSortResultStore(&store);
+  double seconds = TestSeconds() - start;
+  printf("%-26s %12llu entries %8.2f s %s\n", name, (unsigned long long)entries, seconds, NT_SUCCESS(status) ? (BenchIsSorted(&store) ? "sorted" : "unsorted") : "failed");
+
+  KmResetResultStore(&store);
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main(
+  int argc,
+  char** argv)
+{
+  DWORD64 hits = (argc > 1) ? (DWORD64)atoll(argv[1]) : BENCH_DEFAULT_HITS;
+  DWORD64 entries = (argc > 2) ? (DWORD64)atoll(argv[2]) : BENCH_DEFAULT_SORT_ENTRIES;
+  PBYTE bytes = malloc(KM_SCAN_BLOCK_SIZE + 8);
+  PDWORD32 offsets = malloc(KM_SCAN_BLOCK_SIZE * sizeof(DWORD32));
+  if (bytes == NULL || offsets == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  TestFill(bytes, KM_SCAN_BLOCK_SIZE + 8, (const BYTE[]){ 0x00, 0x2A, 0xFF }, 3);
+
+  // Dense hits stress appends, sparse ones the per block overhead
+  static const DWORD32 valueSizes[] = { 0, 4, 8 };
+  static const DWORD32 strides[] = { 4, 64 };
+  for (DWORD32 i = 0; i < ARRAYSIZE(valueSizes); i++)
+  {
+    for (DWORD32 j = 0; j < ARRAYSIZE(strides); j++)
+    {
+      char name[64];
+      snprintf(name, sizeof(name), "store value%u stride%u", valueSizes[i], strides[j]);
+      BenchStore(name, hits, valueSizes[i], strides[j], bytes, offsets);
+      snprintf(name, sizeof(name), "pool value%u stride%u", valueSizes[i], strides[j]);
+      BenchAllocations(name, hits, valueSizes[i], strides[j], bytes);
+    }
+  }
+
+  // Merged work items are ordered, overlapping passes need a merge and random input a full sort
+  BenchSort("sort ordered", entries, 1, FALSE);
+  BenchSort("sort overlapping passes", entries, 2, FALSE);
+  BenchSort("sort random", entries, 1, TRUE);
+
+  free(offsets);
+  free(bytes);
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include <test_work.h>
+
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////
+// Benchmark limits
+///////////////////////////////////////////////////////////
+
+#define BENCH_DEFAULT_GIGABYTES 8
+#define BENCH_PERIOD_SIZE (32 * KM_SCAN_WINDOW_SIZE)
+#define BENCH_SPACE_BASE 0x10000000000ULL
+
+///////////////////////////////////////////////////////////
+// Benchmark utilities
+///////////////////////////////////////////////////////////
+
+static
+double
+BenchWork(
+  PTEST_WORK work,
+  DWORD32 threadCount,
+  PDWORD64 hits)
+{
+  // Best of three so one slow start does not skew the speedup
+  double best = 0.0;
+  for (DWORD32 i = 0; i < 3; i++)
+  {
+    double start = TestSeconds();
+    *hits = TestRunWork(work, threadCount, NULL);
+    double seconds = TestSeconds() - start;
+    best = (i == 0 || seconds < best) ? seconds : best;
+  }
+
+  return best;
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main(
+  int argc,
+  char** argv)
+{
+  // A synthetic space of several gigabytes repeats one period, only the period is backed by memory
+  TEST_SPACE space;
+  space.Base = BENCH_SPACE_BASE;
+  space.Size = (DWORD64)((argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_GIGABYTES) << 30;
+  space.Period = BENCH_PERIOD_SIZE;
+  space.Bytes = malloc(BENCH_PERIOD_SIZE + KM_SCAN_WINDOW_SIZE + KM_PATTERN_MAX_LENGTH);
+  if (space.Bytes == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Mostly zero pages with sparse small integers, the tail repeats the head so spans wrap seamlessly
+  memset(space.Bytes, 0, BENCH_PERIOD_SIZE);
+  for (DWORD64 i = 0; i < BENCH_PERIOD_SIZE; i += 1 + TestRandom() % 64)
+  {
+    space.Bytes[i] = (BYTE)TestRandom();
+  }
+  memcpy(space.Bytes + BENCH_PERIOD_SIZE, space.Bytes, KM_SCAN_WINDOW_SIZE + KM_PATTERN_MAX_LENGTH);
+
+  // Byte aligned 32 bit values, the most common exact scan
+  TEST_WORK work;
+  if (TestInitializeWork(&work, &space, SCAN_TYPE_BYTE32, 1, 0) == FALSE)
+  {
+    return EXIT_FAILURE;
+  }
+  work.Value[0] = 0x2A;
+
+  // Worker counts double up to the processor count or the requested count, capped like the driver pool
+  DWORD32 processors = (DWORD32)sysconf(_SC_NPROCESSORS_ONLN);
+  DWORD32 maxWorkers = (argc > 2) ? (DWORD32)atoi(argv[2]) : processors;
+  maxWorkers = (maxWorkers < 1) ? 1 : (maxWorkers < KM_SCAN_MAX_WORKERS) ? maxWorkers : KM_SCAN_MAX_WORKERS;
+  printf("%llu MB in %u items, %u processors\n", (unsigned long long)(space.Size >> 20), work.Count, processors);
+
+  DWORD64 baseHits = 0;
+  double baseSeconds = BenchWork(&work, 1, &baseHits);
+  for (DWORD32 workers = 1;; workers = (workers * 2 < maxWorkers) ? workers * 2 : maxWorkers)
+  {
+    DWORD64 hits = baseHits;
+    double seconds = (workers == 1) ? baseSeconds : BenchWork(&work, workers, &hits);
+    printf("%2u workers %8.3f s %8.2f GB/s %6.2fx speedup %12llu hits%s\n", workers, seconds, (double)space.Size / seconds / 1e9, baseSeconds / seconds, (unsigned long long)hits, (hits == baseHits) ? "" : " (mismatch)");
+    if (workers == maxWorkers)
+    {
+      break;
+    }
+  }
+
+  TestFreeWork(&work);
+  free(space.Bytes);
+  return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include <test_core.h>
+#include <kc_capture.h>
+
+#include <functional>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_CAPTURE_PID 0x1234
+
+///////////////////////////////////////////////////////////
+// Test utilities
+///////////////////////////////////////////////////////////
+
+typedef std::vector<uint64_t> TEST_ADDRESSES;
+typedef std::function<bool(const uint8_t*, uint64_t)> TEST_MATCH;
+
+static
+BOOLEAN
+TestWriteCapture(
+  const std::string& path,
+  const std::vector<kdbg::capture::CaptureRegion>& regions,
+  const std::vector<uint8_t>& bytes)
+{
+  // Header page, page data in region order and the region table last
+  kdbg::capture::CaptureHeader header = { MEMORY_CAPTURE_MAGIC, MEMORY_CAPTURE_VERSION, TEST_CAPTURE_PID, (uint32_t)regions.size(), bytes.size(), MEMORY_CAPTURE_PAGE_SIZE + bytes.size() };
+  std::vector<uint8_t> page(MEMORY_CAPTURE_PAGE_SIZE);
+  std::memcpy(page.data(), &header, sizeof(header));
+  FILE* file = fopen(path.c_str(), "wb");
+  bool written = file && fwrite(page.data(), page.size(), 1, file) == 1;
+  written = written && fwrite(bytes.data(), bytes.size(), 1, file) == 1;
+  written = written && fwrite(regions.data(), sizeof(kdbg::capture::CaptureRegion), regions.size(), file) == regions.size();
+  return file && fclose(file) == 0 && written;
+}
+
+static
+TEST_ADDRESSES
+TestReadAddresses(
+  const kdbg::capture::CaptureView& capture,
+  const std::string& path)
+{
+  // Stored values have to be the captured bytes at their address
+  TEST_ADDRESSES addresses = {};
+  kdbg::results::FileView view = {};
+  TEST_CHECK(view.Open(path), "opening %s failed", path.c_str());
+  kdbg::results::FileCursor cursor(view);
+  for (; cursor.IsValid(); cursor.Next())
+  {
+    uint32_t valueSize = view.GetHeader().ValueSize;
+    const uint8_t* bytes = capture.Find(cursor.GetBase(), valueSize);
+    TEST_CHECK(bytes && memcmp(bytes, cursor.GetValue(), valueSize) == 0, "value at %llX differs", (unsigned long long)cursor.GetBase());
+    addresses.push_back(cursor.GetBase());
+  }
+  return addresses;
+}
+
+static
+TEST_ADDRESSES
+TestBruteForce(
+  const kdbg::capture::CaptureView& capture,
+  uint32_t width,
+  uint32_t alignment,
+  const TEST_MATCH& match)
+{
+  // Every aligned start offset of every region, matches see how many bytes their region has left
+  TEST_ADDRESSES addresses = {};
+  for (uint32_t i = 0; i < capture.GetRegionCount(); i++)
+  {
+    const kdbg::capture::CaptureRegion& region = capture.GetRegions()[i];
+    for (uint64_t offset = 0; (offset + width) <= region.Size; offset += alignment)
+    {
+      if (match(capture.GetBytes(region) + offset, region.Size - offset))
+      {
+        addresses.push_back(region.Base + offset);
+      }
+    }
+  }
+  return addresses;
+}
+
+static
+VOID
+TestScan(
+  const kdbg::capture::CaptureView& capture,
+  kdbg::capture::Compare& compare,
+  uint32_t type,
+  uint32_t width,
+  uint32_t alignment,
+  const TEST_MATCH& match,
+  const char* name)
+{
+  std::string path = "test_capture_scan.bin";
+  TEST_CHECK(compare.IsValid(), "%s: compare rejected", name);
+  TEST_CHECK(kdbg::capture::Scan(capture, compare, type, path), "%s: scan failed", name);
+  TEST_ADDRESSES expected = TestBruteForce(capture, width, alignment, match);
+  TEST_ADDRESSES actual = TestReadAddresses(capture, path);
+  TEST_CHECK(actual == expected, "%s: %zu results instead of %zu", name, actual.size(), expected.size());
+  TEST_CHECK(expected.size() > 0, "%s: nothing to find", name);
+  remove(path.c_str());
+}
+
+template<typename T>
+static
+T
+TestLoad(
+  const uint8_t* bytes)
+{
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  std::string previousPath = "test_capture_previous.kcap";
+  std::string nextPath = "test_capture_next.kcap";
+  std::string resultPath = "test_capture_results.bin";
+  std::string filterPath = "test_capture_filter.bin";
+
+  // Regions of several blocks, adjacent ones and a gap, filled from a small alphabet
+  std::vector<kdbg::capture::CaptureRegion> regions = {};
+  uint64_t bases[] = { 0x7FF600000000, 0x7FF600005000, 0x7FF600009000 };
+  uint64_t sizes[] = { 0x5000, 0x2000, 0x3000 };
+  uint64_t offset = MEMORY_CAPTURE_PAGE_SIZE;
+  for (uint32_t i = 0; i < ARRAYSIZE(bases); i++)
+  {
+    regions.push_back({ bases[i], bases[i], sizes[i], offset, 0x04, 0x20000 });
+    offset += sizes[i];
+  }
+  std::vector<uint8_t> bytes(offset - MEMORY_CAPTURE_PAGE_SIZE);
+  static const BYTE alphabet[] = { 0x00, 0x00, 0x01, 0x41, 0x62, 0x61, 0x80, 0x3F, 0xFF };
+  TestFill(bytes.data(), (DWORD32)bytes.size(), alphabet, ARRAYSIZE(alphabet));
+
+  // Plant pointers into, between and past the regions
+  for (uint32_t i = 0; i < 0x100; i++)
+  {
+    uint64_t target = bases[0] + (TestRandom() % 0x10000);
+    std::memcpy(&bytes[(TestRandom() % (bytes.size() / 8)) * 8], &target, sizeof(target));
+  }
+  TEST_CHECK(TestWriteCapture(previousPath, regions, bytes), "writing previous capture failed");
+
+  // Later capture changes some values of the same regions
+  std::vector<uint8_t> nextBytes = bytes;
+  for (uint32_t i = 0; i < 0x400; i++)
+  {
+    nextBytes[TestRandom() % nextBytes.size()] += 1;
+  }
+  TEST_CHECK(TestWriteCapture(nextPath, regions, nextBytes), "writing next capture failed");
+
+  kdbg::capture::CaptureView previous = {};
+  kdbg::capture::CaptureView next = {};
+  TEST_CHECK(previous.Open(previousPath), "opening previous capture failed");
+  TEST_CHECK(next.Open(nextPath), "opening next capture failed");
+
+  // Values at natural and byte alignment, unaligned ones straddle block boundaries
+  kdbg::capture::Compare compare = {};
+  int32_t integer = 0x4100;
+  compare.Begin(SCAN_TYPE_BYTE32, SCAN_ALIGNMENT_BYTE8, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_SENSITIVE, (const uint8_t*)&integer, sizeof(integer));
+  TestScan(previous, compare, SCAN_TYPE_BYTE32, 4, 1, [](const uint8_t* bytes, uint64_t) { return TestLoad<int32_t>(bytes) == 0x4100; }, "int32 unaligned");
+  int16_t word = 0x0041;
+  compare.Begin(SCAN_TYPE_BYTE16, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_SENSITIVE, (const uint8_t*)&word, sizeof(word));
+  TestScan(previous, compare, SCAN_TYPE_BYTE16, 2, 2, [](const uint8_t* bytes, uint64_t) { return TestLoad<int16_t>(bytes) == 0x0041; }, "int16 natural");
+
+  // Reals compare against the range of their rounding mode
+  float real = 0.0f;
+  compare.Begin(SCAN_TYPE_FLOAT32, SCAN_ALIGNMENT_BYTE8, SCAN_ROUNDING_TRUNCATED, 0.0, SCAN_CASE_SENSITIVE, (const uint8_t*)&real, sizeof(real));
+  TestScan(previous, compare, SCAN_TYPE_FLOAT32, 4, 1, [](const uint8_t* bytes, uint64_t) { float value = TestLoad<float>(bytes); return value > -1.0f && value < 1.0f; }, "float32 truncated");
+
+  // Predicates invert the exact kernels or reduce to ranges
+  SCAN_PREDICATE predicate = {};
+  predicate.Type = SCAN_PREDICATE_NOT_EQUAL;
+  compare.BeginPredicate(SCAN_TYPE_BYTE16, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, predicate);
+  TestScan(previous, compare, SCAN_TYPE_BYTE16, 2, 2, [](const uint8_t* bytes, uint64_t) { return TestLoad<int16_t>(bytes) != 0; }, "int16 not equal");
+  int32_t low = -0x100;
+  int32_t high = 0x4141;
+  predicate.Type = SCAN_PREDICATE_BETWEEN;
+  std::memcpy(predicate.Operand, &low, sizeof(low));
+  std::memcpy(predicate.Limit, &high, sizeof(high));
+  compare.BeginPredicate(SCAN_TYPE_BYTE32, SCAN_ALIGNMENT_BYTE8, SCAN_ROUNDING_EXACT, 0.0, predicate);
+  TestScan(previous, compare, SCAN_TYPE_BYTE32, 4, 1, [=](const uint8_t* bytes, uint64_t) { int32_t value = TestLoad<int32_t>(bytes); return value >= low && value <= high; }, "int32 between");
+  int64_t bits = 0x00FF00FF;
+  int64_t masked = 0x00410001;
+  predicate.Type = SCAN_PREDICATE_MASK;
+  std::memcpy(predicate.Operand, &masked, sizeof(masked));
+  std::memcpy(predicate.Limit, &bits, sizeof(bits));
+  compare.BeginPredicate(SCAN_TYPE_BYTE64, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, predicate);
+  TestScan(previous, compare, SCAN_TYPE_BYTE64, 8, 8, [=](const uint8_t* bytes, uint64_t) { return (TestLoad<int64_t>(bytes) & bits) == masked; }, "int64 mask");
+
+  // Patterns and text match at every byte, narrow and wide text are merged
+  BYTE pattern[] = { 0x41, 0x00, 0x62, 0x00, 0xFF, 0x00, 0xFF, 0xFF };
+  compare.Begin(SCAN_TYPE_BYTES, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_SENSITIVE, pattern, sizeof(pattern));
+  TestScan(previous, compare, SCAN_TYPE_BYTES, sizeof(pattern), 1, [](const uint8_t* bytes, uint64_t) { return bytes[0] == 0x41 && bytes[2] == 0x62 && bytes[3] == 0x00; }, "pattern");
+  WCHAR text[] = { 'a', 'B' };
+  compare.Begin(SCAN_TYPE_TEXT, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_INSENSITIVE, (const uint8_t*)text, sizeof(text));
+  TestScan(previous, compare, SCAN_TYPE_TEXT, 2, 1, [](const uint8_t* bytes, uint64_t size) { return ((bytes[0] | 0x20) == 'a' && (bytes[1] | 0x20) == 'b') || (size >= 4 && (bytes[0] | 0x20) == 'a' && bytes[1] == 0 && (bytes[2] | 0x20) == 'b' && bytes[3] == 0); }, "text");
+  TEST_CHECK(compare.Begin(SCAN_TYPE_GROUP, SCAN_ALIGNMENT_NATURAL, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_SENSITIVE, pattern, sizeof(pattern)) == false, "group accepted");
+
+  // Pointers are aligned qwords targeting captured memory
+  TEST_CHECK(kdbg::capture::ScanPointers(previous, 0, 0, resultPath), "pointer scan failed");
+  TEST_ADDRESSES expected = TestBruteForce(previous, sizeof(uint64_t), sizeof(uint64_t), [&](const uint8_t* bytes, uint64_t) { return previous.Find(TestLoad<uint64_t>(bytes), 1) != nullptr; });
+  TEST_ADDRESSES actual = TestReadAddresses(previous, resultPath);
+  TEST_CHECK(actual == expected && expected.size() > 0, "pointers: %zu results instead of %zu", actual.size(), expected.size());
+  TEST_CHECK(kdbg::capture::ScanPointers(previous, bases[1], sizes[1], resultPath), "bounded pointer scan failed");
+  expected = TestBruteForce(previous, sizeof(uint64_t), sizeof(uint64_t), [&](const uint8_t* bytes, uint64_t) { uint64_t target = TestLoad<uint64_t>(bytes); return target >= bases[1] && target < (bases[1] + sizes[1]); });
+  actual = TestReadAddresses(previous, resultPath);
+  TEST_CHECK(actual == expected, "bounded pointers: %zu results instead of %zu", actual.size(), expected.size());
+
+  // Next scans filter previous results against the later capture
+  predicate = {};
+  predicate.Type = SCAN_PREDICATE_NOT_EQUAL;
+  compare.BeginPredicate(SCAN_TYPE_BYTE32, SCAN_ALIGNMENT_BYTE8, SCAN_ROUNDING_EXACT, 0.0, predicate);
+  TEST_CHECK(kdbg::capture::Scan(previous, compare, SCAN_TYPE_BYTE32, resultPath), "first scan failed");
+  kdbg::results::FileView results = {};
+  TEST_CHECK(results.Open(resultPath), "opening first scan failed");
+
+  struct
+  {
+    uint32_t Filter;
+    int32_t Value;
+    const char* Name;
+    std::function<bool(int32_t, int32_t)> Keep;
+  } filters[] = {
+    { SCAN_FILTER_CHANGED, 0, "changed", [](int32_t before, int32_t after) { return before != after; } },
+    { SCAN_FILTER_UNCHANGED, 0, "unchanged", [](int32_t before, int32_t after) { return before == after; } },
+    { SCAN_FILTER_INCREASED, 0, "increased", [](int32_t before, int32_t after) { return after > before; } },
+    { SCAN_FILTER_INCREASED_BY, 1, "increased by", [](int32_t before, int32_t after) { return (uint32_t)after - (uint32_t)before == 1; } },
+    { SCAN_FILTER_DECREASED_BY, -0x100, "decreased by", [](int32_t before, int32_t after) { return (uint32_t)before - (uint32_t)after == (uint32_t)-0x100; } },
+    { SCAN_FILTER_EXACT, 0x4100, "exact", [](int32_t, int32_t after) { return after == 0x4100; } },
+  };
+  for (const auto& filter : filters)
+  {
+    kdbg::capture::Operand operand = {};
+    TEST_CHECK(operand.Begin(SCAN_TYPE_BYTE32, sizeof(int32_t), filter.Filter, SCAN_ROUNDING_EXACT, 0.0, (const uint8_t*)&filter.Value, sizeof(filter.Value)), "%s: operand rejected", filter.Name);
+    TEST_CHECK(kdbg::capture::Next(results, next, operand, filterPath), "%s: next scan failed", filter.Name);
+
+    expected.clear();
+    kdbg::results::FileCursor cursor(results);
+    for (; cursor.IsValid(); cursor.Next())
+    {
+      if (filter.Keep(TestLoad<int32_t>(cursor.GetValue()), TestLoad<int32_t>(next.Find(cursor.GetBase(), sizeof(int32_t)))))
+      {
+        expected.push_back(cursor.GetBase());
+      }
+    }
+    actual = TestReadAddresses(next, filterPath);
+    TEST_CHECK(actual == expected, "%s: %zu results instead of %zu", filter.Name, actual.size(), expected.size());
+  }
+
+  // Changed results differ from their previous value in every entry, diffing them keeps them all
+  std::string diffPath = "test_capture_diff.bin";
+  kdbg::capture::Operand changed = {};
+  TEST_CHECK(changed.Begin(SCAN_TYPE_BYTE32, sizeof(int32_t), SCAN_FILTER_CHANGED, SCAN_ROUNDING_EXACT, 0.0, nullptr, 0), "changed operand rejected");
+  TEST_CHECK(kdbg::capture::Next(results, next, changed, filterPath), "changed next scan failed");
+  kdbg::results::FileView changedView = {};
+  TEST_CHECK(changedView.Open(filterPath) && kdbg::results::Diff(results, changedView, diffPath), "diff failed");
+  TEST_CHECK(TestReadAddresses(next, diffPath) == TestReadAddresses(next, filterPath), "diff of changed results differs");
+  changedView.Close();
+  remove(diffPath.c_str());
+
+  // Predicates of next scans run the compare kernel per element
+  predicate.Type = SCAN_PREDICATE_LESS;
+  std::memcpy(predicate.Operand, &integer, sizeof(integer));
+  kdbg::capture::Operand operand = {};
+  TEST_CHECK(operand.Begin(SCAN_TYPE_BYTE32, sizeof(int32_t), SCAN_FILTER_PREDICATE, SCAN_ROUNDING_EXACT, 0.0, (const uint8_t*)&predicate, sizeof(predicate)), "predicate operand rejected");
+  TEST_CHECK(kdbg::capture::Next(results, next, operand, filterPath), "predicate next scan failed");
+  expected.clear();
+  kdbg::results::FileCursor cursor(results);
+  for (; cursor.IsValid(); cursor.Next())
+  {
+    if (TestLoad<int32_t>(next.Find(cursor.GetBase(), sizeof(int32_t))) < integer)
+    {
+      expected.push_back(cursor.GetBase());
+    }
+  }
+  actual = TestReadAddresses(next, filterPath);
+  TEST_CHECK(actual == expected, "predicate: %zu results instead of %zu", actual.size(), expected.size());
+
+  // Operands of another width are rejected before any result is filtered
+  TEST_CHECK(operand.Begin(SCAN_TYPE_BYTE16, sizeof(int16_t), SCAN_FILTER_INCREASED, SCAN_ROUNDING_EXACT, 0.0, nullptr, 0), "int16 operand rejected");
+  TEST_CHECK(kdbg::capture::Next(results, next, operand, filterPath) == false, "operand of another width accepted");
+
+  results.Close();
+  previous.Close();
+  next.Close();
+  remove(previousPath.c_str());
+  remove(nextPath.c_str());
+  remove(resultPath.c_str());
+  remove(filterPath.c_str());
+  return TestReport("capture");
+}
\ No newline at end of file
@@ -0,0 +1,368 @@
+#include <test_core.h>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_MAX_SIZE 0x180
+#define TEST_TRIALS 8
+
+///////////////////////////////////////////////////////////
+// Scalar references
+///////////////////////////////////////////////////////////
+
+static
+DWORD32
+TestReferenceCompare(
+  DWORD32 type,
+  PBYTE bytes,
+  DWORD32 size,
+  PBYTE value,
+  DWORD32 alignment,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+  DWORD32 width = KmGetCompareWidth(type);
+
+  // Integers compare bitwise, reals against the closed range following the value
+  for (DWORD32 offset = 0; (offset + width) <= size; offset += alignment)
+  {
+    BOOLEAN match = FALSE;
+    if (type == SCAN_TYPE_FLOAT32)
+    {
+      float element;
+      float low;
+      float high;
+      memcpy(&element, bytes + offset, sizeof(float));
+      memcpy(&low, value, sizeof(float));
+      memcpy(&high, value + sizeof(float), sizeof(float));
+      match = element >= low && element <= high;
+    }
+    else if (type == SCAN_TYPE_FLOAT64)
+    {
+      double element;
+      double low;
+      double high;
+      memcpy(&element, bytes + offset, sizeof(double));
+      memcpy(&low, value, sizeof(double));
+      memcpy(&high, value + sizeof(double), sizeof(double));
+      match = element >= low && element <= high;
+    }
+    else
+    {
+      match = memcmp(bytes + offset, value, width) == 0;
+    }
+    if (match)
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+static
+INT64
+TestLoadSigned(
+  PBYTE bytes,
+  DWORD32 width)
+{
+  INT64 value = 0;
+  memcpy(&value, bytes, width);
+
+  // Sign extend from the element width
+  DWORD32 shift = 64 - width * 8;
+  return (INT64)((DWORD64)value << shift) >> shift;
+}
+
+static
+DWORD32
+TestReferenceRange(
+  DWORD32 width,
+  PBYTE bytes,
+  DWORD32 size,
+  PBYTE value,
+  DWORD32 alignment,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+  INT64 low = TestLoadSigned(value, width);
+  INT64 high = TestLoadSigned(value + width, width);
+  INT64 bits = TestLoadSigned(value + width * 2, width);
+
+  // Masked signed elements inside the closed range
+  for (DWORD32 offset = 0; (offset + width) <= size; offset += alignment)
+  {
+    INT64 element = TestLoadSigned(bytes + offset, width) & bits;
+    if (element >= low && element <= high)
+    {
+      offsets[count++] = offset;
+    }
+  }
+
+  return count;
+}
+
+static
+DWORD32
+TestReferencePattern(
+  PBYTE pattern,
+  PBYTE masks,
+  DWORD32 length,
+  PBYTE bytes,
+  DWORD32 size,
+  PDWORD32 offsets)
+{
+  DWORD32 count = 0;
+
+  // Masked compare at every start
+  for (DWORD32 start = 0; (start + length) <= size; start++)
+  {
+    BOOLEAN match = TRUE;
+    for (DWORD32 i = 0; i < length && match; i++)
+    {
+      match = ((bytes[start + i] ^ pattern[i]) & masks[i]) == 0;
+    }
+    if (match)
+    {
+      offsets[count++] = start;
+    }
+  }
+
+  return count;
+}
+
+///////////////////////////////////////////////////////////
+// Value generators
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestFillReals(
+  DWORD32 type,
+  PBYTE bytes,
+  DWORD32 size)
+{
+  // Mostly boundary values, including both zeros, denormals, infinities and NaN
+  static const double reals[] = { 0.0, -0.0, 1.0, -1.0, 0.5, 2.5, 1e-310, -1e-310, 1e300, -1e300, 1.0 / 0.0, -1.0 / 0.0, 0.0 / 0.0 };
+  DWORD32 width = KmGetCompareWidth(type);
+  for (DWORD32 offset = 0; (offset + width) <= size; offset += width)
+  {
+    double real = reals[TestRandom() % ARRAYSIZE(reals)];
+    if (type == SCAN_TYPE_FLOAT32)
+    {
+      float element = (float)real;
+      memcpy(bytes + offset, &element, sizeof(float));
+    }
+    else
+    {
+      memcpy(bytes + offset, &real, sizeof(double));
+    }
+  }
+}
+
+static
+VOID
+TestPickRange(
+  DWORD32 type,
+  PBYTE value)
+{
+  // Ranges between two boundary values, some of them empty
+  static const double bounds[] = { -1.0 / 0.0, -1.0, -1e-310, -0.0, 0.0, 1e-310, 0.5, 1.0, 2.5, 1.0 / 0.0 };
+  double low = bounds[TestRandom() % ARRAYSIZE(bounds)];
+  double high = bounds[TestRandom() % ARRAYSIZE(bounds)];
+  KmStoreRealRange(value, KmGetCompareWidth(type), low, high);
+}
+
+///////////////////////////////////////////////////////////
+// Kernel tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestCompareKernels(
+  BOOLEAN avx2)
+{
+  static const BYTE alphabet[] = { 0x00, 0x01, 0x80, 0xFF };
+  static const DWORD32 alignments[] = { 1, 2, 4, 8 };
+  BYTE buffer[TEST_MAX_SIZE + 1];
+  DWORD32 expected[TEST_MAX_SIZE];
+  DWORD32 actual[TEST_MAX_SIZE];
+
+  for (DWORD32 type = SCAN_TYPE_BYTE8; type <= SCAN_TYPE_FLOAT64; type++)
+  {
+    SCAN_COMPARE_ROUTINE routine = KmGetCompareKernel(type, avx2);
+    DWORD32 width = KmGetCompareWidth(type);
+    for (DWORD32 a = 0; a < ARRAYSIZE(alignments); a++)
+    {
+      for (DWORD32 size = 0; size <= TEST_MAX_SIZE; size += 1 + (size / 16))
+      {
+        for (DWORD32 trial = 0; trial < TEST_TRIALS; trial++)
+        {
+          // Kernels load unaligned, start one byte into the buffer
+          PBYTE bytes = buffer + 1;
+          BYTE value[16] = { 0 };
+          if (KmIsRealCompare(type))
+          {
+            TestFillReals(type, bytes, size);
+            TestPickRange(type, value);
+          }
+          else
+          {
+            TestFill(bytes, size, alphabet, ARRAYSIZE(alphabet));
+            TestFill(value, width, alphabet, ARRAYSIZE(alphabet));
+            if (size >= width)
+            {
+              memcpy(value, bytes + TestRandom() % (size - width + 1), width);
+            }
+          }
+
+          DWORD32 expectedCount = TestReferenceCompare(type, bytes, size, value, alignments[a], expected);
+          DWORD32 actualCount = routine(bytes, size, value, alignments[a], actual);
+          TEST_CHECK(TestSameOffsets(expected, expectedCount, actual, actualCount), "%s compare type %u alignment %u size %u: %u hits, expected %u", avx2 ? "AVX2" : "SSE2", type, alignments[a], size, actualCount, expectedCount);
+        }
+      }
+    }
+  }
+}
+
+static
+VOID
+TestRangeKernels(
+  BOOLEAN avx2)
+{
+  static const BYTE alphabet[] = { 0x00, 0x01, 0x7F, 0x80, 0xFE, 0xFF };
+  static const INT64 bounds[] = { -129, -128, -2, -1, 0, 1, 2, 127, 128, 0x7FFF, 0x10000 };
+  static const DWORD32 alignments[] = { 1, 2, 4, 8 };
+  BYTE buffer[TEST_MAX_SIZE + 1];
+  DWORD32 expected[TEST_MAX_SIZE];
+  DWORD32 actual[TEST_MAX_SIZE];
+
+  for (DWORD32 width = 1; width <= sizeof(INT64); width *= 2)
+  {
+    SCAN_COMPARE_ROUTINE routine = KmGetRangeKernel(width, avx2);
+    for (DWORD32 a = 0; a < ARRAYSIZE(alignments); a++)
+    {
+      for (DWORD32 size = 0; size <= TEST_MAX_SIZE; size += 1 + (size / 16))
+      {
+        for (DWORD32 trial = 0; trial < TEST_TRIALS; trial++)
+        {
+          // Bounds and masks are truncated to the element width like the driver stores them
+          PBYTE bytes = buffer + 1;
+          BYTE value[24] = { 0 };
+          INT64 low = bounds[TestRandom() % ARRAYSIZE(bounds)];
+          INT64 high = bounds[TestRandom() % ARRAYSIZE(bounds)];
+          INT64 bits = (TestRandom() % 2) ? -1 : (INT64)TestRandom();
+          memcpy(value, &low, width);
+          memcpy(value + width, &high, width);
+          memcpy(value + width * 2, &bits, width);
+          TestFill(bytes, size, alphabet, ARRAYSIZE(alphabet));
+
+          DWORD32 expectedCount = TestReferenceRange(width, bytes, size, value, alignments[a], expected);
+          DWORD32 actualCount = routine(bytes, size, value, alignments[a], actual);
+          TEST_CHECK(TestSameOffsets(expected, expectedCount, actual, actualCount), "%s range width %u alignment %u size %u: %u hits, expected %u", avx2 ? "AVX2" : "SSE2", width, alignments[a], size, actualCount, expectedCount);
+        }
+      }
+    }
+  }
+}
+
+static
+VOID
+TestPatternKernels()
+{
+  static const BYTE alphabet[] = { 0x00, 0x41, 0x61, 0xCC };
+  static const BYTE maskAlphabet[] = { 0xFF, 0xFF, 0xFF, 0x00, 0xDF, 0x0F };
+  BYTE bytes[TEST_MAX_SIZE * 4];
+  DWORD32 expected[TEST_MAX_SIZE * 4];
+  DWORD32 actual[TEST_MAX_SIZE * 4];
+  PATTERN pattern;
+
+  for (DWORD32 trial = 0; trial < 2000; trial++)
+  {
+    // Long fixed runs take the skip path, others anchor on their rarest byte or verify every start
+    DWORD32 length = 1 + (DWORD32)(TestRandom() % 48);
+    DWORD32 size = (DWORD32)(TestRandom() % ARRAYSIZE(bytes));
+    BOOLEAN fixed = (trial % 3) == 0;
+    BYTE patternBytes[48];
+    BYTE masks[48];
+    TestFill(bytes, size, alphabet, ARRAYSIZE(alphabet));
+    TestFill(patternBytes, length, alphabet, ARRAYSIZE(alphabet));
+    TestFill(masks, length, fixed ? maskAlphabet : maskAlphabet + 3, fixed ? 1 : 3);
+    if (size >= length && (trial % 2) == 0)
+    {
+      memcpy(patternBytes, bytes + TestRandom() % (size - length + 1), length);
+    }
+
+    // Patterns of wildcards only are rejected
+    BOOLEAN wildcards = TRUE;
+    for (DWORD32 i = 0; i < length; i++)
+    {
+      wildcards &= masks[i] == 0;
+    }
+    BOOLEAN compiled = KmCompilePattern(&pattern, patternBytes, masks, length);
+    TEST_CHECK(compiled != wildcards, "pattern length %u compiled %u", length, compiled);
+    if (compiled)
+    {
+      DWORD32 expectedCount = TestReferencePattern(patternBytes, masks, length, bytes, size, expected);
+      DWORD32 actualCount = KmMatchPattern(&pattern, bytes, size, actual);
+      TEST_CHECK(TestSameOffsets(expected, expectedCount, actual, actualCount), "pattern length %u run %u size %u: %u hits, expected %u", length, pattern.RunLength, size, actualCount, expectedCount);
+    }
+  }
+
+  // Text folds ASCII case in both encodings and rejects narrow text beyond the first code page
+  static const BYTE text[] = "xxHeLLo, hello\0h\0E\0l\0L\0o\0";
+  WCHAR hello[] = { 'H', 'e', 'l', 'l', 'o' };
+  WCHAR wide[] = { 'H', 0x100 };
+  DWORD32 count = 0;
+  TEST_CHECK(KmCompileText(&pattern, hello, ARRAYSIZE(hello), FALSE, TRUE), "narrow text");
+  count = KmMatchPattern(&pattern, (PBYTE)text, sizeof(text) - 1, actual);
+  TEST_CHECK(count == 2 && actual[0] == 2 && actual[1] == 9, "narrow text: %u hits", count);
+  TEST_CHECK(KmCompileText(&pattern, hello, ARRAYSIZE(hello), TRUE, TRUE), "wide text");
+  count = KmMatchPattern(&pattern, (PBYTE)text, sizeof(text) - 1, actual);
+  TEST_CHECK(count == 1 && actual[0] == 15, "wide text: %u hits", count);
+  TEST_CHECK(KmCompileText(&pattern, wide, ARRAYSIZE(wide), FALSE, FALSE) == FALSE, "narrow text beyond the first code page");
+}
+
+static
+VOID
+TestOffsetUtilities()
+{
+  DWORD32 hits[] = { 0, 8, 12 };
+  DWORD32 left[] = { 1, 4, 9 };
+  DWORD32 right[] = { 0, 4, 10, 11 };
+  DWORD32 offsets[16];
+
+  // Inversion reports aligned starts which fit the block
+  DWORD32 expectedInverted[] = { 4, 16 };
+  DWORD32 count = KmInvertOffsets(hits, ARRAYSIZE(hits), 20, 4, 4, offsets);
+  TEST_CHECK(TestSameOffsets(expectedInverted, ARRAYSIZE(expectedInverted), offsets, count), "invert: %u offsets", count);
+
+  // Merging keeps order and reports shared starts once
+  DWORD32 expectedMerged[] = { 0, 1, 4, 9, 10, 11 };
+  count = KmMergeOffsets(left, ARRAYSIZE(left), right, ARRAYSIZE(right), offsets);
+  TEST_CHECK(TestSameOffsets(expectedMerged, ARRAYSIZE(expectedMerged), offsets, count), "merge: %u offsets", count);
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  TestCompareKernels(FALSE);
+  TestRangeKernels(FALSE);
+  if (TestIsAvx2Supported())
+  {
+    TestCompareKernels(TRUE);
+    TestRangeKernels(TRUE);
+  }
+  else
+  {
+    printf("AVX2 not supported, skipping AVX2 kernels\n");
+  }
+  TestPatternKernels();
+  TestOffsetUtilities();
+  return TestReport("compare");
+}
\ No newline at end of file
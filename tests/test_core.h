@@ -0,0 +1,93 @@
+#ifndef TEST_CORE_H
+#define TEST_CORE_H
+
+#include <km_kernels.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+///////////////////////////////////////////////////////////
+// Test utilities
+///////////////////////////////////////////////////////////
+
+// Failures are counted instead of aborting so one run reports every broken case
+static DWORD32 s_failures = 0;
+
+#define TEST_CHECK(condition, ...)                        \
+  do                                                      \
+  {                                                       \
+    if (!(condition))                                     \
+    {                                                     \
+      printf("%s:%d: ", __FILE__, __LINE__);              \
+      printf(__VA_ARGS__);                                \
+      printf("\n");                                       \
+      s_failures++;                                       \
+    }                                                     \
+  } while (0)
+
+static DWORD64 s_random = 0x9E3779B97F4A7C15;
+
+static __inline
+DWORD64
+TestRandom()
+{
+  // Fixed seed xorshift, failures reproduce on every run
+  s_random ^= s_random << 13;
+  s_random ^= s_random >> 7;
+  s_random ^= s_random << 17;
+  return s_random;
+}
+
+static __inline
+VOID
+TestFill(
+  PBYTE bytes,
+  DWORD32 size,
+  const BYTE* alphabet,
+  DWORD32 count)
+{
+  // Small alphabets make hits of every width likely
+  for (DWORD32 i = 0; i < size; i++)
+  {
+    bytes[i] = alphabet[TestRandom() % count];
+  }
+}
+
+static __inline
+BOOLEAN
+TestSameOffsets(
+  PDWORD32 left,
+  DWORD32 leftCount,
+  PDWORD32 right,
+  DWORD32 rightCount)
+{
+  return leftCount == rightCount && (leftCount == 0 || memcmp(left, right, leftCount * sizeof(DWORD32)) == 0);
+}
+
+static __inline
+BOOLEAN
+TestIsAvx2Supported()
+{
+  return __builtin_cpu_supports("avx2") != 0;
+}
+
+static __inline
+double
+TestSeconds()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static __inline
+int
+TestReport(
+  const char* name)
+{
+  printf("%s: %u failures\n", name, s_failures);
+  return s_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
\ No newline at end of file
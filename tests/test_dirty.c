@@ -0,0 +1,197 @@
+#include <test_dirty.h>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_MEMORY_BASE 0x7FF000000000ULL
+#define TEST_PAGE_COUNT 0x40
+#define TEST_RESULT_STRIDE 0x3F
+#define TEST_ROUND_COUNT 0x20
+
+///////////////////////////////////////////////////////////
+// Interval tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestIntervals()
+{
+  TEST_MEMORY memory;
+  if (TestInitializeMemory(&memory, TEST_MEMORY_BASE, TEST_PAGE_COUNT) == FALSE)
+  {
+    TEST_CHECK(FALSE, "out of memory");
+    return;
+  }
+
+  DIRTY_SOURCE source;
+  KmInitializeDirtySource(&source, TestAdvanceWrites, TestQueryWrites, &memory);
+
+  // Nothing is known before the first interval closed
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, 1), "page clean before tracking");
+  KmAdvanceDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, 1), "page clean after the first advance");
+
+  // Only written pages are dirty, values straddling into them as well
+  TestWriteMemory(&memory, 3 * KM_SCAN_PAGE_SIZE + 8, 1);
+  KmAdvanceDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE + 2 * KM_SCAN_PAGE_SIZE, KM_SCAN_PAGE_SIZE) == FALSE, "unwritten page dirty");
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE + 3 * KM_SCAN_PAGE_SIZE, KM_SCAN_PAGE_SIZE), "written page clean");
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE + 2 * KM_SCAN_PAGE_SIZE, KM_SCAN_PAGE_SIZE + 2), "straddling value clean");
+
+  // Invalidated sources read every page until a full interval passed again
+  KmInvalidateDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, 1), "page clean after invalidate");
+  KmAdvanceDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, 1), "page clean in the interval after invalidate");
+  KmAdvanceDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, 1) == FALSE, "page dirty after a full interval");
+
+  // Untracked sources never report clean pages
+  KmInitializeDirtySource(&source, NULL, NULL, NULL);
+  KmAdvanceDirtySource(&source);
+  KmAdvanceDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, 1), "untracked page clean");
+
+  // Static sources are clean once armed
+  KmInitializeDirtySource(&source, KmAdvanceStaticSource, KmQueryStaticSource, NULL);
+  KmAdvanceDirtySource(&source);
+  KmAdvanceDirtySource(&source);
+  TEST_CHECK(KmIsRangeDirty(&source, TEST_MEMORY_BASE, KM_SCAN_PAGE_SIZE * 2) == FALSE, "static page dirty");
+
+  TestFreeMemory(&memory);
+}
+
+///////////////////////////////////////////////////////////
+// Next scan tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestNextScans()
+{
+  TEST_MEMORY memory;
+  if (TestInitializeMemory(&memory, TEST_MEMORY_BASE, TEST_PAGE_COUNT) == FALSE)
+  {
+    TEST_CHECK(FALSE, "out of memory");
+    return;
+  }
+
+  // Odd stride so values straddle page boundaries
+  DWORD64 capacity = TEST_PAGE_COUNT * KM_SCAN_PAGE_SIZE / TEST_RESULT_STRIDE + 1;
+  PTEST_RESULT tracked = malloc(capacity * sizeof(TEST_RESULT));
+  PTEST_RESULT full = malloc(capacity * sizeof(TEST_RESULT));
+  PBYTE page = malloc(KM_SCAN_PAGE_SIZE + sizeof(INT32));
+  if (tracked && full && page)
+  {
+    DIRTY_SOURCE source;
+    DIRTY_SOURCE untracked;
+    KmInitializeDirtySource(&source, TestAdvanceWrites, TestQueryWrites, &memory);
+    KmInitializeDirtySource(&untracked, NULL, NULL, NULL);
+
+    // Unchanged passes keep most results alive, the others narrow them down
+    DWORD32 filters[] = { SCAN_FILTER_UNCHANGED, SCAN_FILTER_UNCHANGED, SCAN_FILTER_DECREASED, SCAN_FILTER_UNCHANGED, SCAN_FILTER_CHANGED, SCAN_FILTER_INCREASED };
+    DWORD64 trackedCount = 0;
+    DWORD64 fullCount = 0;
+    DWORD64 trackedTotal = 0;
+    DWORD64 fullTotal = 0;
+    for (DWORD32 round = 0; round < TEST_ROUND_COUNT; round++)
+    {
+      // Every cycle starts with a first scan, which arms the interval before reading values
+      if (round % ARRAYSIZE(filters) == 0)
+      {
+        KmAdvanceDirtySource(&source);
+        trackedCount = TestCollectResults(&memory, TEST_RESULT_STRIDE, tracked);
+        fullCount = TestCollectResults(&memory, TEST_RESULT_STRIDE, full);
+      }
+
+      // A few writes on a few pages, some on page boundaries
+      DWORD32 writeCount = (DWORD32)(TestRandom() % 8);
+      for (DWORD32 i = 0; i < writeCount; i++)
+      {
+        DWORD64 offset = (round & 1) ? (TestRandom() % TEST_PAGE_COUNT) * KM_SCAN_PAGE_SIZE + KM_SCAN_PAGE_SIZE - 2 : TestRandom() % (TEST_PAGE_COUNT * KM_SCAN_PAGE_SIZE);
+        TestWriteMemory(&memory, offset, (INT32)(TestRandom() % 4));
+      }
+
+      DWORD32 filter = filters[round % ARRAYSIZE(filters)];
+      DWORD64 trackedReads = 0;
+      DWORD64 fullReads = 0;
+      KmAdvanceDirtySource(&source);
+      trackedCount = TestNextPass(&memory, &source, filter, tracked, trackedCount, page, &trackedReads);
+      fullCount = TestNextPass(&memory, &untracked, filter, full, fullCount, page, &fullReads);
+
+      // Skipping clean pages must not change a single result
+      TEST_CHECK(trackedCount == fullCount, "round %u keeps %llu results instead of %llu", round, (unsigned long long)trackedCount, (unsigned long long)fullCount);
+      TEST_CHECK(trackedCount != fullCount || memcmp(tracked, full, trackedCount * sizeof(TEST_RESULT)) == 0, "round %u results differ", round);
+      TEST_CHECK(trackedReads <= fullReads, "round %u reads %llu pages instead of %llu", round, (unsigned long long)trackedReads, (unsigned long long)fullReads);
+      trackedTotal += trackedReads;
+      fullTotal += fullReads;
+    }
+
+    // Most pages stay clean between passes
+    TEST_CHECK(trackedTotal * 2 < fullTotal, "tracked passes read %llu of %llu pages", (unsigned long long)trackedTotal, (unsigned long long)fullTotal);
+  }
+  else
+  {
+    TEST_CHECK(FALSE, "out of memory");
+  }
+
+  free(page);
+  free(full);
+  free(tracked);
+  TestFreeMemory(&memory);
+}
+
+///////////////////////////////////////////////////////////
+// Soft dirty tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestSoftDirty()
+{
+  // Kernels without soft dirty support leave the source untracked
+  DIRTY_SOURCE source;
+  SOFT_DIRTY dirty;
+  BOOLEAN supported = KmIsSoftDirtySupported();
+  TEST_CHECK(KmOpenSoftDirtySource(&source, &dirty, getpid()) == supported, "source tracked without kernel support");
+  if (supported == FALSE)
+  {
+    printf("soft dirty not supported by this kernel, only the untracked fallback is tested\n");
+    KmAdvanceDirtySource(&source);
+    KmAdvanceDirtySource(&source);
+    TEST_CHECK(KmIsRangeDirty(&source, 0, 1), "untracked soft dirty page clean");
+    KmCloseSoftDirtySource(&source, &dirty);
+    return;
+  }
+
+  // Pages are populated before tracking starts
+  PBYTE pages = mmap(NULL, 4 * KM_SCAN_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  TEST_CHECK(pages != MAP_FAILED, "out of memory");
+  if (pages != MAP_FAILED)
+  {
+    memset(pages, 1, 4 * KM_SCAN_PAGE_SIZE);
+    KmAdvanceDirtySource(&source);
+    pages[2 * KM_SCAN_PAGE_SIZE + 5] = 2;
+    KmAdvanceDirtySource(&source);
+    TEST_CHECK(KmIsRangeDirty(&source, (DWORD64)pages, KM_SCAN_PAGE_SIZE) == FALSE, "unwritten soft dirty page dirty");
+    TEST_CHECK(KmIsRangeDirty(&source, (DWORD64)pages + 2 * KM_SCAN_PAGE_SIZE, KM_SCAN_PAGE_SIZE), "written soft dirty page clean");
+    munmap(pages, 4 * KM_SCAN_PAGE_SIZE);
+  }
+
+  KmCloseSoftDirtySource(&source, &dirty);
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  TestIntervals();
+  TestNextScans();
+  TestSoftDirty();
+
+  return TestReport("dirty");
+}
\ No newline at end of file
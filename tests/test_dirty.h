@@ -0,0 +1,195 @@
+#ifndef TEST_DIRTY_H
+#define TEST_DIRTY_H
+
+#include <test_core.h>
+#include <km_dirty.h>
+
+///////////////////////////////////////////////////////////
+// Dirty data types
+///////////////////////////////////////////////////////////
+
+typedef struct _TEST_MEMORY
+{
+  PBYTE Bytes;
+  DWORD64 Base;
+  DWORD64 PageCount;
+  PBYTE Pending;
+  PBYTE Closed;
+} TEST_MEMORY, * PTEST_MEMORY;
+
+typedef struct _TEST_RESULT
+{
+  DWORD64 Address;
+  INT32 Value;
+} TEST_RESULT, * PTEST_RESULT;
+
+///////////////////////////////////////////////////////////
+// Recorded writes
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+TestAdvanceWrites(
+  PVOID context)
+{
+  PTEST_MEMORY memory = (PTEST_MEMORY)context;
+
+  // Writes of the running interval become the closed one, like a clear_refs after reading the bits
+  SIZE_T size = (SIZE_T)((memory->PageCount + 7) / 8);
+  memcpy(memory->Closed, memory->Pending, size);
+  memset(memory->Pending, 0, size);
+  return TRUE;
+}
+
+static
+BOOLEAN
+TestQueryWrites(
+  PVOID context,
+  DWORD64 page)
+{
+  PTEST_MEMORY memory = (PTEST_MEMORY)context;
+
+  // Pages past the memory are unknown and dirty
+  DWORD64 index = (page - memory->Base) / KM_SCAN_PAGE_SIZE;
+  return page < memory->Base || index >= memory->PageCount || (memory->Closed[index >> 3] & (1 << (index & 7)));
+}
+
+static
+VOID
+TestWriteMemory(
+  PTEST_MEMORY memory,
+  DWORD64 offset,
+  INT32 value)
+{
+  memcpy(memory->Bytes + offset, &value, sizeof(value));
+  for (DWORD64 index = offset / KM_SCAN_PAGE_SIZE; index <= (offset + sizeof(value) - 1) / KM_SCAN_PAGE_SIZE; index++)
+  {
+    memory->Pending[index >> 3] |= (BYTE)(1 << (index & 7));
+  }
+}
+
+///////////////////////////////////////////////////////////
+// Next scan model
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+TestEvaluateFilter(
+  DWORD32 filter,
+  INT32 previous,
+  INT32 current)
+{
+  switch (filter)
+  {
+    case SCAN_FILTER_CHANGED: return current != previous;
+    case SCAN_FILTER_UNCHANGED: return current == previous;
+    case SCAN_FILTER_INCREASED: return current > previous;
+    case SCAN_FILTER_DECREASED: return current < previous;
+    default: return FALSE;
+  }
+}
+
+static
+DWORD64
+TestNextPass(
+  PTEST_MEMORY memory,
+  PDIRTY_SOURCE source,
+  DWORD32 filter,
+  PTEST_RESULT results,
+  DWORD64 count,
+  PBYTE page,
+  PDWORD64 readCount)
+{
+  DWORD64 kept = 0;
+
+  // Results are batched per page like the driver does, dirty pages are copied out before filtering
+  for (DWORD64 first = 0; first < count;)
+  {
+    DWORD64 pageBase = results[first].Address & ~(DWORD64)(KM_SCAN_PAGE_SIZE - 1);
+    DWORD64 last = first;
+    while (last + 1 < count && (results[last + 1].Address & ~(DWORD64)(KM_SCAN_PAGE_SIZE - 1)) == pageBase)
+    {
+      last++;
+    }
+
+    DWORD64 end = results[last].Address + sizeof(INT32);
+    BOOLEAN dirty = KmIsRangeDirty(source, pageBase, end - pageBase);
+    if (dirty)
+    {
+      memcpy(page, memory->Bytes + (pageBase - memory->Base), (SIZE_T)(end - pageBase));
+      (*readCount)++;
+    }
+
+    // Clean pages evaluate the stored values as current ones
+    for (DWORD64 i = first; i <= last; i++)
+    {
+      INT32 current = results[i].Value;
+      if (dirty)
+      {
+        memcpy(&current, page + (results[i].Address - pageBase), sizeof(current));
+      }
+      if (TestEvaluateFilter(filter, results[i].Value, current))
+      {
+        results[kept].Address = results[i].Address;
+        results[kept].Value = current;
+        kept++;
+      }
+    }
+
+    first = last + 1;
+  }
+
+  return kept;
+}
+
+///////////////////////////////////////////////////////////
+// Dirty API
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+TestInitializeMemory(
+  PTEST_MEMORY memory,
+  DWORD64 base,
+  DWORD64 pageCount)
+{
+  // One spare page so values may straddle past the last one
+  memory->Base = base;
+  memory->PageCount = pageCount;
+  memory->Bytes = calloc((SIZE_T)(pageCount + 1), KM_SCAN_PAGE_SIZE);
+  memory->Pending = calloc((SIZE_T)((pageCount + 7) / 8), 1);
+  memory->Closed = calloc((SIZE_T)((pageCount + 7) / 8), 1);
+  return memory->Bytes && memory->Pending && memory->Closed;
+}
+
+static
+VOID
+TestFreeMemory(
+  PTEST_MEMORY memory)
+{
+  free(memory->Closed);
+  free(memory->Pending);
+  free(memory->Bytes);
+}
+
+static
+DWORD64
+TestCollectResults(
+  PTEST_MEMORY memory,
+  DWORD64 stride,
+  PTEST_RESULT results)
+{
+  DWORD64 count = 0;
+
+  // Every value at the stride, like an unknown first scan
+  for (DWORD64 offset = 0; offset + sizeof(INT32) <= memory->PageCount * KM_SCAN_PAGE_SIZE; offset += stride)
+  {
+    results[count].Address = memory->Base + offset;
+    memcpy(&results[count].Value, memory->Bytes + offset, sizeof(INT32));
+    count++;
+  }
+
+  return count;
+}
+
+#endif
\ No newline at end of file
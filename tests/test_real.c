@@ -0,0 +1,288 @@
+#include <test_core.h>
+
+#include <float.h>
+#include <math.h>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_TRIALS 20000
+#define TEST_ELEMENTS 64
+
+///////////////////////////////////////////////////////////
+// Scalar references
+///////////////////////////////////////////////////////////
+
+static
+double
+TestReferenceRound(
+  DWORD32 rounding,
+  double value)
+{
+  // The C library rounds half away from zero like the scanner
+  return (rounding == SCAN_ROUNDING_ROUNDED) ? round(value) : trunc(value);
+}
+
+static
+double
+TestRandomReal()
+{
+  DWORD64 bits = TestRandom();
+  double value;
+
+  // Mix halves, near halves, denormals and arbitrary bit patterns
+  switch (TestRandom() % 5)
+  {
+    case 0: value = (double)((INT64)(TestRandom() % 2001) - 1000) + 0.5; break;
+    case 1: value = nextafter((double)((INT64)(TestRandom() % 2001) - 1000) + 0.5, (TestRandom() & 1) ? INFINITY : -INFINITY); break;
+    case 2: bits &= 0x800FFFFFFFFFFFFF; memcpy(&value, &bits, sizeof(value)); break;
+    case 3: value = ((double)(INT64)TestRandom() / 9223372036854775808.0) * 3.0; break;
+    default: memcpy(&value, &bits, sizeof(value)); break;
+  }
+
+  return value;
+}
+
+///////////////////////////////////////////////////////////
+// Range tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestNanRanges()
+{
+  double low;
+  double high;
+
+  // NaN values and tolerances are rejected for every rounding
+  for (DWORD32 rounding = SCAN_ROUNDING_EXACT; rounding <= SCAN_ROUNDING_EPSILON; rounding++)
+  {
+    TEST_CHECK(KmGetRealRange(rounding, NAN, 0.0, &low, &high) == FALSE, "rounding %u: NaN value accepted", rounding);
+    TEST_CHECK(KmGetRealRange(rounding, -NAN, 0.0, &low, &high) == FALSE, "rounding %u: negative NaN value accepted", rounding);
+  }
+  TEST_CHECK(KmGetRealRange(SCAN_ROUNDING_EPSILON, 1.0, NAN, &low, &high) == FALSE, "epsilon: NaN tolerance accepted");
+  TEST_CHECK(KmGetRealRange(SCAN_ROUNDING_EPSILON, 1.0, -0.5, &low, &high) == FALSE, "epsilon: negative tolerance accepted");
+
+  // NaN operands and open ranges beyond infinity match nothing
+  SCAN_PREDICATE predicate;
+  memset(&predicate, 0, sizeof(predicate));
+  double operand = NAN;
+  memcpy(predicate.Operand, &operand, sizeof(double));
+  memcpy(predicate.Limit, &operand, sizeof(double));
+  for (DWORD32 type = SCAN_PREDICATE_LESS; type <= SCAN_PREDICATE_BETWEEN; type++)
+  {
+    predicate.Type = type;
+    TEST_CHECK(KmGetRealPredicateRange(&predicate, sizeof(double), &low, &high) == FALSE, "predicate %u: NaN operand accepted", type);
+  }
+  operand = INFINITY;
+  memcpy(predicate.Operand, &operand, sizeof(double));
+  predicate.Type = SCAN_PREDICATE_GREATER;
+  TEST_CHECK(KmGetRealPredicateRange(&predicate, sizeof(double), &low, &high) == FALSE, "predicate: greater than infinity accepted");
+}
+
+static
+VOID
+TestDenormalSteps()
+{
+  double smallest = nextafter(0.0, 1.0);
+  float smallestFloat = nextafterf(0.0f, 1.0f);
+
+  // Both zeros step onto the smallest denormal, denormals step by one unit
+  TEST_CHECK(KmNextUpReal(0.0) == smallest, "next up of 0 is %a", KmNextUpReal(0.0));
+  TEST_CHECK(KmNextUpReal(-0.0) == smallest, "next up of -0 is %a", KmNextUpReal(-0.0));
+  TEST_CHECK(KmNextDownReal(0.0) == -smallest, "next down of 0 is %a", KmNextDownReal(0.0));
+  TEST_CHECK(KmNextUpReal(-smallest) == 0.0, "next up of the negative denormal is %a", KmNextUpReal(-smallest));
+  TEST_CHECK(KmNextUpReal(DBL_MIN) == nextafter(DBL_MIN, 1.0), "next up of the smallest normal is %a", KmNextUpReal(DBL_MIN));
+  TEST_CHECK(KmNextDownReal(DBL_MIN) == nextafter(DBL_MIN, 0.0), "next down of the smallest normal is %a", KmNextDownReal(DBL_MIN));
+  TEST_CHECK(KmNextUpFloat(0.0f) == smallestFloat, "next up float of 0 is %a", (double)KmNextUpFloat(0.0f));
+  TEST_CHECK(KmNextDownFloat(0.0f) == -smallestFloat, "next down float of 0 is %a", (double)KmNextDownFloat(0.0f));
+
+  // Infinities and NaN do not move
+  TEST_CHECK(KmNextUpReal(INFINITY) == INFINITY, "next up of infinity moved");
+  TEST_CHECK(KmNextDownReal(-INFINITY) == -INFINITY, "next down of negative infinity moved");
+  TEST_CHECK(isnan(KmNextUpReal(NAN)), "next up of NaN is a number");
+  TEST_CHECK(KmNextUpReal(-INFINITY) == -DBL_MAX, "next up of negative infinity is %a", KmNextUpReal(-INFINITY));
+}
+
+static
+VOID
+TestRoundingRanges()
+{
+  // Ranges hold exactly the values which round onto the same integer as the searched one
+  for (DWORD32 trial = 0; trial < TEST_TRIALS; trial++)
+  {
+    double value = TestRandomReal();
+    if (isnan(value))
+    {
+      continue;
+    }
+    for (DWORD32 rounding = SCAN_ROUNDING_ROUNDED; rounding <= SCAN_ROUNDING_TRUNCATED; rounding++)
+    {
+      double low = 0.0;
+      double high = 0.0;
+      double expected = TestReferenceRound(rounding, value);
+      TEST_CHECK(KmGetRealRange(rounding, value, 0.0, &low, &high), "rounding %u: %a rejected", rounding, value);
+      TEST_CHECK(low <= value && value <= high, "rounding %u: %a outside [%a, %a]", rounding, value, low, high);
+      TEST_CHECK(TestReferenceRound(rounding, low) == expected, "rounding %u: low %a of %a rounds elsewhere", rounding, low, value);
+      TEST_CHECK(TestReferenceRound(rounding, high) == expected, "rounding %u: high %a of %a rounds elsewhere", rounding, high, value);
+      TEST_CHECK(isinf(low) || TestReferenceRound(rounding, nextafter(low, -INFINITY)) != expected, "rounding %u: low %a of %a is not tight", rounding, low, value);
+      TEST_CHECK(isinf(high) || TestReferenceRound(rounding, nextafter(high, INFINITY)) != expected, "rounding %u: high %a of %a is not tight", rounding, high, value);
+    }
+  }
+
+  // Halves round away from zero on both signs
+  double low;
+  double high;
+  KmGetRealRange(SCAN_ROUNDING_ROUNDED, 2.5, 0.0, &low, &high);
+  TEST_CHECK(low == 2.5 && high == nextafter(3.5, 0.0), "rounded 2.5: [%a, %a]", low, high);
+  KmGetRealRange(SCAN_ROUNDING_ROUNDED, -2.5, 0.0, &low, &high);
+  TEST_CHECK(low == nextafter(-3.5, 0.0) && high == -2.5, "rounded -2.5: [%a, %a]", low, high);
+  KmGetRealRange(SCAN_ROUNDING_TRUNCATED, -0.25, 0.0, &low, &high);
+  TEST_CHECK(low == nextafter(-1.0, 0.0) && high == nextafter(1.0, 0.0), "truncated -0.25: [%a, %a]", low, high);
+}
+
+static
+VOID
+TestFloatRanges()
+{
+  // Narrowed bounds stay inside the double range and are the outermost floats which do
+  for (DWORD32 trial = 0; trial < TEST_TRIALS; trial++)
+  {
+    double low = TestRandomReal();
+    double high = TestRandomReal();
+    if (isnan(low) || isnan(high))
+    {
+      continue;
+    }
+    if (low > high)
+    {
+      double swap = low;
+      low = high;
+      high = swap;
+    }
+
+    BYTE value[2 * sizeof(float)];
+    float lowFloat;
+    float highFloat;
+    KmStoreRealRange(value, sizeof(float), low, high);
+    memcpy(&lowFloat, value, sizeof(float));
+    memcpy(&highFloat, value + sizeof(float), sizeof(float));
+    TEST_CHECK((double)lowFloat >= low, "float range [%a, %a]: low %a widened", low, high, (double)lowFloat);
+    TEST_CHECK((double)highFloat <= high, "float range [%a, %a]: high %a widened", low, high, (double)highFloat);
+    TEST_CHECK(isinf(lowFloat) || (double)nextafterf(lowFloat, -INFINITY) < low, "float range [%a, %a]: low %a not tight", low, high, (double)lowFloat);
+    TEST_CHECK(isinf(highFloat) || (double)nextafterf(highFloat, INFINITY) > high, "float range [%a, %a]: high %a not tight", low, high, (double)highFloat);
+  }
+
+  // Ranges between two adjacent floats hold none of them
+  BYTE value[2 * sizeof(float)];
+  float lowFloat;
+  float highFloat;
+  double between = ((double)1.0f + (double)nextafterf(1.0f, 2.0f)) / 2.0;
+  KmStoreRealRange(value, sizeof(float), between, between);
+  memcpy(&lowFloat, value, sizeof(float));
+  memcpy(&highFloat, value + sizeof(float), sizeof(float));
+  TEST_CHECK(lowFloat > highFloat, "float range between adjacent floats holds [%a, %a]", (double)lowFloat, (double)highFloat);
+}
+
+///////////////////////////////////////////////////////////
+// Kernel tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestRealKernels(
+  BOOLEAN avx2)
+{
+  float floats[TEST_ELEMENTS];
+  double doubles[TEST_ELEMENTS];
+  DWORD32 offsets[TEST_ELEMENTS];
+
+  // Special values the hardware compare must handle without flushing denormals
+  float specialFloats[] = { NAN, -NAN, INFINITY, -INFINITY, 0.0f, -0.0f, nextafterf(0.0f, 1.0f), -nextafterf(0.0f, 1.0f), FLT_MIN, nextafterf(FLT_MIN, 0.0f), 1.0f, -1.0f };
+  double specialDoubles[] = { NAN, -NAN, INFINITY, -INFINITY, 0.0, -0.0, nextafter(0.0, 1.0), -nextafter(0.0, 1.0), DBL_MIN, nextafter(DBL_MIN, 0.0), 1.0, -1.0 };
+  for (DWORD32 i = 0; i < TEST_ELEMENTS; i++)
+  {
+    floats[i] = specialFloats[i % ARRAYSIZE(specialFloats)];
+    doubles[i] = specialDoubles[i % ARRAYSIZE(specialDoubles)];
+  }
+
+  // Every special value is searched exactly, NaN and the full range are searched as ranges
+  for (DWORD32 i = 0; i <= ARRAYSIZE(specialDoubles); i++)
+  {
+    double low = (i < ARRAYSIZE(specialDoubles)) ? specialDoubles[i] : -INFINITY;
+    double high = (i < ARRAYSIZE(specialDoubles)) ? specialDoubles[i] : INFINITY;
+
+    BYTE value[2 * sizeof(double)];
+    KmStoreRealRange(value, sizeof(float), low, high);
+    DWORD32 count = KmGetCompareKernel(SCAN_TYPE_FLOAT32, avx2)((PBYTE)floats, sizeof(floats), value, sizeof(float), offsets);
+    DWORD32 expected = 0;
+    for (DWORD32 j = 0; j < TEST_ELEMENTS; j++)
+    {
+      expected += ((double)floats[j] >= low && (double)floats[j] <= high) ? 1 : 0;
+    }
+    TEST_CHECK(count == expected, "float32 %s: [%a, %a] %u hits, expected %u", avx2 ? "avx2" : "sse2", low, high, count, expected);
+
+    KmStoreRealRange(value, sizeof(double), low, high);
+    count = KmGetCompareKernel(SCAN_TYPE_FLOAT64, avx2)((PBYTE)doubles, sizeof(doubles), value, sizeof(double), offsets);
+    expected = 0;
+    for (DWORD32 j = 0; j < TEST_ELEMENTS; j++)
+    {
+      expected += (doubles[j] >= low && doubles[j] <= high) ? 1 : 0;
+    }
+    TEST_CHECK(count == expected, "float64 %s: [%a, %a] %u hits, expected %u", avx2 ? "avx2" : "sse2", low, high, count, expected);
+  }
+
+  // Rounded float searches find exactly the floats which round onto the same integer
+  for (DWORD32 trial = 0; trial < TEST_TRIALS / 100; trial++)
+  {
+    double searched = (double)((INT64)(TestRandom() % 21) - 10) + 0.5;
+    for (DWORD32 i = 0; i < TEST_ELEMENTS; i++)
+    {
+      // Halves around the searched value and their neighbours
+      float half = (float)searched + (float)((INT64)(TestRandom() % 3) - 1) * 0.5f;
+      switch (TestRandom() % 3)
+      {
+        case 0: floats[i] = half; break;
+        case 1: floats[i] = nextafterf(half, INFINITY); break;
+        default: floats[i] = nextafterf(half, -INFINITY); break;
+      }
+    }
+
+    double low = 0.0;
+    double high = 0.0;
+    BYTE value[2 * sizeof(float)];
+    KmGetRealRange(SCAN_ROUNDING_ROUNDED, searched, 0.0, &low, &high);
+    KmStoreRealRange(value, sizeof(float), low, high);
+    DWORD32 count = KmGetCompareKernel(SCAN_TYPE_FLOAT32, avx2)((PBYTE)floats, sizeof(floats), value, sizeof(float), offsets);
+    DWORD32 expected = 0;
+    for (DWORD32 i = 0; i < TEST_ELEMENTS; i++)
+    {
+      expected += (round((double)floats[i]) == round(searched)) ? 1 : 0;
+    }
+    TEST_CHECK(count == expected, "float32 %s: rounded %a %u hits, expected %u", avx2 ? "avx2" : "sse2", searched, count, expected);
+  }
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  TestNanRanges();
+  TestDenormalSteps();
+  TestRoundingRanges();
+  TestFloatRanges();
+  TestRealKernels(FALSE);
+  if (TestIsAvx2Supported())
+  {
+    TestRealKernels(TRUE);
+  }
+  else
+  {
+    printf("AVX2 not supported, skipping AVX2 kernels\n");
+  }
+  return TestReport("real");
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include <test_core.h>
+#include <kc_results.h>
+
+#include <map>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_RESULT_COUNT (3 * RESULT_FILE_BLOCK_SIZE + 17)
+#define TEST_VALUE_SIZE 4
+
+///////////////////////////////////////////////////////////
+// Test utilities
+///////////////////////////////////////////////////////////
+
+typedef std::map<uint64_t, uint32_t> TEST_RESULTS;
+
+static
+BOOLEAN
+TestWriteFile(
+  const std::string& path,
+  const TEST_RESULTS& results)
+{
+  kdbg::results::FileWriter writer = {};
+  bool written = writer.Open(path, 4, SCAN_TYPE_BYTE32, TEST_VALUE_SIZE);
+  for (const auto& [base, value] : results)
+  {
+    written = written && writer.Append(&base, (const uint8_t*)&value, 1);
+  }
+  return writer.Close() && written;
+}
+
+static
+TEST_RESULTS
+TestReadFile(
+  const kdbg::results::FileView& view)
+{
+  TEST_RESULTS results = {};
+  kdbg::results::FileCursor cursor(view);
+  for (; cursor.IsValid(); cursor.Next())
+  {
+    uint32_t value = 0;
+    std::memcpy(&value, cursor.GetValue(), TEST_VALUE_SIZE);
+    results[cursor.GetBase()] = value;
+  }
+  TEST_CHECK(cursor.IsFailed() == false, "cursor failed");
+  return results;
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  std::string previousPath = "test_results_previous.bin";
+  std::string nextPath = "test_results_next.bin";
+  std::string diffPath = "test_results_diff.bin";
+
+  // Gaps from one byte up to far beyond a single varint byte
+  TEST_RESULTS previous = {};
+  uint64_t base = 0x7FF000000000ULL;
+  while (previous.size() < TEST_RESULT_COUNT)
+  {
+    base += 1 + (TestRandom() % ((TestRandom() & 1) ? 0x10 : 0x100000));
+    previous[base] = (uint32_t)TestRandom();
+  }
+
+  // Next pass drops some results, changes some values and keeps the rest
+  TEST_RESULTS next = {};
+  TEST_RESULTS changed = {};
+  for (const auto& [address, value] : previous)
+  {
+    DWORD64 action = TestRandom() % 4;
+    if (action == 1)
+    {
+      next[address] = value + 1;
+      changed[address] = value + 1;
+    }
+    else if (action != 0)
+    {
+      next[address] = value;
+    }
+  }
+
+  // Files read back exactly what was written, across block boundaries
+  TEST_CHECK(TestWriteFile(previousPath, previous), "writing previous failed");
+  TEST_CHECK(TestWriteFile(nextPath, next), "writing next failed");
+  kdbg::results::FileView previousView = {};
+  kdbg::results::FileView nextView = {};
+  TEST_CHECK(previousView.Open(previousPath), "opening previous failed");
+  TEST_CHECK(nextView.Open(nextPath), "opening next failed");
+  TEST_CHECK(previousView.GetCount() == previous.size(), "previous holds %llu results", (unsigned long long)previousView.GetCount());
+  TEST_CHECK(previousView.GetBlockCount() == 4, "previous holds %llu blocks", (unsigned long long)previousView.GetBlockCount());
+  TEST_CHECK(TestReadFile(previousView) == previous, "previous differs");
+  TEST_CHECK(TestReadFile(nextView) == next, "next differs");
+
+  // Diffs keep results of the next file whose value changed
+  TEST_CHECK(kdbg::results::Diff(previousView, nextView, diffPath), "diff failed");
+  kdbg::results::FileView diffView = {};
+  TEST_CHECK(diffView.Open(diffPath), "opening diff failed");
+  TEST_CHECK(TestReadFile(diffView) == changed, "diff holds %llu results instead of %llu", (unsigned long long)diffView.GetCount(), (unsigned long long)changed.size());
+  diffView.Close();
+
+  // Writers refuse addresses out of order
+  kdbg::results::FileWriter writer = {};
+  uint64_t bases[] = { 0x2000, 0x1000 };
+  uint32_t values[] = { 1, 2 };
+  TEST_CHECK(writer.Open(diffPath, 0, SCAN_TYPE_BYTE32, TEST_VALUE_SIZE), "opening writer failed");
+  TEST_CHECK(writer.Append(bases, (const uint8_t*)values, 2) == false, "unordered addresses accepted");
+  writer.Close();
+
+  // Truncated files are rejected before any block is decoded
+  FILE* file = fopen(diffPath.c_str(), "wb");
+  fwrite(&previousView.GetHeader(), sizeof(kdbg::results::FileHeader), 1, file);
+  fclose(file);
+  TEST_CHECK(diffView.Open(diffPath) == false, "truncated file accepted");
+
+  previousView.Close();
+  nextView.Close();
+  remove(previousPath.c_str());
+  remove(nextPath.c_str());
+  remove(diffPath.c_str());
+  return TestReport("results");
+}
\ No newline at end of file
@@ -0,0 +1,262 @@
+#include <test_core.h>
+#include <km_partition.h>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_PAGE_SIZE KM_SCAN_PAGE_SIZE
+#define TEST_REGION_BASE 0x7FF000000000ULL
+#define TEST_REGION_SIZE (KM_SCAN_WORK_SIZE + KM_SCAN_WINDOW_SIZE + 3 * TEST_PAGE_SIZE)
+#define TEST_MAX_HITS 0x100
+
+///////////////////////////////////////////////////////////
+// Test data types
+///////////////////////////////////////////////////////////
+
+typedef struct _TEST_MATCHER
+{
+  SCAN_COMPARE_ROUTINE Routine;
+  PPATTERN Pattern;
+  BYTE Value[KM_PATTERN_MAX_LENGTH];
+  DWORD32 Width;
+  DWORD32 Alignment;
+  DWORD32 Reach;
+} TEST_MATCHER, * PTEST_MATCHER;
+
+typedef struct _TEST_REGION
+{
+  PBYTE Bytes;
+  DWORD64 Base;
+  DWORD64 Limit;
+  PBOOLEAN BadPages;
+  DWORD64 Hits[TEST_MAX_HITS];
+  DWORD32 HitCount;
+} TEST_REGION, * PTEST_REGION;
+
+typedef struct _TEST_SCAN
+{
+  PTEST_REGION Region;
+  PTEST_MATCHER Matcher;
+} TEST_SCAN, * PTEST_SCAN;
+
+///////////////////////////////////////////////////////////
+// Scanner model
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+TestMapSpan(
+  PVOID context,
+  DWORD64 base,
+  DWORD32 size,
+  PBYTE* mapped)
+{
+  PTEST_REGION region = (PTEST_REGION)context;
+
+  // Mapping fails like an MDL probe if any page of the range is bad
+  for (DWORD64 page = (base - region->Base) / TEST_PAGE_SIZE; page < (base - region->Base + size + TEST_PAGE_SIZE - 1) / TEST_PAGE_SIZE; page++)
+  {
+    if (region->BadPages[page])
+    {
+      return FALSE;
+    }
+  }
+  *mapped = region->Bytes + (base - region->Base);
+  return TRUE;
+}
+
+static
+VOID
+TestScanSpan(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PTEST_SCAN scan = (PTEST_SCAN)context;
+  PTEST_REGION region = scan->Region;
+  PTEST_MATCHER matcher = scan->Matcher;
+  DWORD32 offsets[KM_SCAN_BLOCK_SIZE + KM_PATTERN_MAX_LENGTH];
+
+  // Same block walk as the exact scan window routine
+  for (DWORD32 offset = 0; offset < owned; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    DWORD32 blockSize = (KM_SCAN_BLOCK_SIZE + matcher->Reach < size - offset) ? (KM_SCAN_BLOCK_SIZE + matcher->Reach) : (size - offset);
+    DWORD32 count = matcher->Pattern ? KmMatchPattern(matcher->Pattern, bytes + offset, blockSize, offsets) : matcher->Routine(bytes + offset, blockSize, matcher->Value, matcher->Alignment, offsets);
+    count = KmTrimOffsets(offsets, count, (KM_SCAN_BLOCK_SIZE < owned - offset) ? KM_SCAN_BLOCK_SIZE : (owned - offset));
+    for (DWORD32 i = 0; i < count && region->HitCount < TEST_MAX_HITS; i++)
+    {
+      region->Hits[region->HitCount++] = base + offset + offsets[i];
+    }
+  }
+}
+
+static
+VOID
+TestScanRegion(
+  PTEST_REGION region,
+  PTEST_MATCHER matcher,
+  DWORD64 regionBase,
+  DWORD64 regionSize,
+  DWORD64 regionLimit)
+{
+  TEST_SCAN scan;
+  scan.Region = region;
+  scan.Matcher = matcher;
+
+  // Window walk and page fallback of the driver over the fake region
+  SCAN_WALK walk;
+  walk.Map = TestMapSpan;
+  walk.Unmap = NULL;
+  walk.Step = NULL;
+  walk.Context = region;
+  KmWalkScanWindows(&walk, regionBase, regionSize, regionLimit, matcher->Reach, TestScanSpan, &scan);
+}
+
+static
+VOID
+TestScanWork(
+  PTEST_REGION region,
+  PTEST_MATCHER matcher)
+{
+  // Split into work items like the driver, every item may read up to the region end
+  DWORD32 count = KmCountPartitions(region->Limit - region->Base);
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    SCAN_PARTITION partition = KmGetPartition(region->Base, region->Limit - region->Base, i);
+    TestScanRegion(region, matcher, partition.Base, partition.Size, partition.Limit);
+  }
+}
+
+static
+BOOLEAN
+TestIsReadable(
+  PTEST_REGION region,
+  DWORD64 base,
+  DWORD32 size)
+{
+  PBYTE mapped;
+  return (base + size) <= region->Limit && TestMapSpan(region, base, size, &mapped);
+}
+
+///////////////////////////////////////////////////////////
+// Boundary tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestBoundary(
+  PTEST_REGION region,
+  PTEST_MATCHER matcher,
+  const char* name,
+  DWORD64 boundary,
+  DWORD32 before)
+{
+  // One value which starts before the boundary and ends after it
+  DWORD64 address = region->Base + boundary - before;
+  memcpy(region->Bytes + boundary - before, matcher->Value, matcher->Width);
+
+  region->HitCount = 0;
+  TestScanWork(region, matcher);
+  memset(region->Bytes + boundary - before, 0, matcher->Width);
+
+  // Aligned values are reported exactly once if every byte is readable
+  BOOLEAN expected = (address % matcher->Alignment) == 0 && TestIsReadable(region, address, matcher->Width);
+  BOOLEAN found = region->HitCount == 1 && region->Hits[0] == address;
+  TEST_CHECK(region->HitCount <= 1, "%s: boundary %llX before %u reported %u times", name, (unsigned long long)boundary, before, region->HitCount);
+  TEST_CHECK(found == expected, "%s: boundary %llX before %u %s", name, (unsigned long long)boundary, before, expected ? "missed" : "reported");
+}
+
+static
+VOID
+TestBoundaries(
+  PTEST_REGION region,
+  PTEST_MATCHER matcher,
+  const char* name)
+{
+  // Window, work item, block and bad page boundaries, plus values cut off by the region end
+  DWORD64 boundaries[] =
+  {
+    KM_SCAN_WINDOW_SIZE,
+    2 * KM_SCAN_WINDOW_SIZE,
+    KM_SCAN_WINDOW_SIZE + KM_SCAN_BLOCK_SIZE,
+    KM_SCAN_WORK_SIZE,
+    KM_SCAN_WORK_SIZE + 5 * TEST_PAGE_SIZE,
+    KM_SCAN_WORK_SIZE + 6 * TEST_PAGE_SIZE,
+    KM_SCAN_WORK_SIZE + KM_SCAN_WINDOW_SIZE,
+    TEST_REGION_SIZE,
+  };
+  for (DWORD32 i = 0; i < ARRAYSIZE(boundaries); i++)
+  {
+    for (DWORD32 before = 1; before < matcher->Width; before++)
+    {
+      TestBoundary(region, matcher, name, boundaries[i], before);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  TEST_REGION region;
+  region.Base = TEST_REGION_BASE;
+  region.Limit = TEST_REGION_BASE + TEST_REGION_SIZE;
+  region.Bytes = malloc(TEST_REGION_SIZE + KM_PATTERN_MAX_LENGTH);
+  region.BadPages = calloc(TEST_REGION_SIZE / TEST_PAGE_SIZE + 1, sizeof(BOOLEAN));
+  if (region.Bytes == NULL || region.BadPages == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // The first window of the second work item falls back to pages, one of which is unreadable
+  memset(region.Bytes, 0, TEST_REGION_SIZE + KM_PATTERN_MAX_LENGTH);
+  region.BadPages[KM_SCAN_WORK_SIZE / TEST_PAGE_SIZE + 6] = TRUE;
+
+  // Integers at byte and natural alignment, single bytes can not cross anything
+  static const char* names[] = { "byte8", "byte16", "byte32", "byte64" };
+  for (DWORD32 type = SCAN_TYPE_BYTE16; type <= SCAN_TYPE_BYTE64; type++)
+  {
+    DWORD32 alignments[] = { 1, KmGetCompareWidth(type) };
+    for (DWORD32 i = 0; i < ARRAYSIZE(alignments); i++)
+    {
+      TEST_MATCHER matcher;
+      memset(&matcher, 0, sizeof(matcher));
+      matcher.Routine = KmGetCompareKernel(type, FALSE);
+      matcher.Width = KmGetCompareWidth(type);
+      matcher.Alignment = alignments[i];
+      matcher.Reach = matcher.Width - matcher.Alignment;
+      for (DWORD32 j = 0; j < matcher.Width; j++)
+      {
+        matcher.Value[j] = (BYTE)(0x11 * (j + 1));
+      }
+
+      char name[64];
+      snprintf(name, sizeof(name), "%s alignment %u", names[type], matcher.Alignment);
+      TestBoundaries(&region, &matcher, name);
+    }
+  }
+
+  // Patterns reach their length minus one past the window
+  PATTERN pattern;
+  TEST_MATCHER matcher;
+  memset(&matcher, 0, sizeof(matcher));
+  BYTE bytes[] = { 0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0x48, 0x85, 0xC0 };
+  BYTE masks[] = { 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF };
+  KmCompilePattern(&pattern, bytes, masks, sizeof(bytes));
+  memcpy(matcher.Value, bytes, sizeof(bytes));
+  matcher.Pattern = &pattern;
+  matcher.Width = sizeof(bytes);
+  matcher.Alignment = 1;
+  matcher.Reach = matcher.Width - 1;
+  TestBoundaries(&region, &matcher, "pattern");
+
+  free(region.BadPages);
+  free(region.Bytes);
+  return TestReport("window");
+}
\ No newline at end of file
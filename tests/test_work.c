@@ -0,0 +1,160 @@
+#include <test_work.h>
+
+///////////////////////////////////////////////////////////
+// Test limits
+///////////////////////////////////////////////////////////
+
+#define TEST_SPACE_BASE 0x7FF000000000ULL
+#define TEST_SPACE_SIZE (4 * KM_SCAN_WORK_SIZE + KM_SCAN_WINDOW_SIZE + 3 * KM_SCAN_PAGE_SIZE)
+#define TEST_MAX_HITS 0x400
+
+///////////////////////////////////////////////////////////
+// Partition tests
+///////////////////////////////////////////////////////////
+
+static
+VOID
+TestPartitions(
+  DWORD64 size)
+{
+  // Items cover the region without gaps and may all read up to its end
+  DWORD32 count = KmCountPartitions(size);
+  DWORD64 next = TEST_SPACE_BASE;
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    SCAN_PARTITION partition = KmGetPartition(TEST_SPACE_BASE, size, i);
+    TEST_CHECK(partition.Base == next, "size %llX item %u starts at %llX", (unsigned long long)size, i, (unsigned long long)partition.Base);
+    TEST_CHECK(partition.Size > 0 && partition.Size <= KM_SCAN_WORK_SIZE, "size %llX item %u owns %llX", (unsigned long long)size, i, (unsigned long long)partition.Size);
+    TEST_CHECK(partition.Limit == TEST_SPACE_BASE + size, "size %llX item %u limit %llX", (unsigned long long)size, i, (unsigned long long)partition.Limit);
+    next = partition.Base + partition.Size;
+  }
+  TEST_CHECK(next == TEST_SPACE_BASE + size, "size %llX covers %llX", (unsigned long long)size, (unsigned long long)(next - TEST_SPACE_BASE));
+
+  // Claims hand out every item once in address order
+  volatile LONG claim = 0;
+  for (DWORD32 i = 0; i < count; i++)
+  {
+    TEST_CHECK(KmClaimPartition(&claim, count) == i, "size %llX claim %u out of order", (unsigned long long)size, i);
+  }
+  TEST_CHECK(KmClaimPartition(&claim, count) == count, "size %llX claims past the end", (unsigned long long)size);
+}
+
+///////////////////////////////////////////////////////////
+// Worker tests
+///////////////////////////////////////////////////////////
+
+static
+DWORD64
+TestReference(
+  PTEST_SPACE space,
+  PBYTE value,
+  DWORD32 width,
+  DWORD32 alignment,
+  PDWORD64 hits)
+{
+  DWORD64 count = 0;
+
+  // Plain byte compare over the whole space
+  for (DWORD64 offset = 0; offset + width <= space->Size; offset += alignment)
+  {
+    if (memcmp(space->Bytes + offset, value, width) == 0 && count < TEST_MAX_HITS)
+    {
+      hits[count++] = space->Base + offset;
+    }
+  }
+
+  return count;
+}
+
+static
+VOID
+TestWorkers(
+  PTEST_SPACE space,
+  DWORD32 type,
+  DWORD32 alignment)
+{
+  static DWORD64 expected[TEST_MAX_HITS];
+  static DWORD64 merged[TEST_MAX_HITS * 8];
+  TEST_WORK work;
+  if (TestInitializeWork(&work, space, type, alignment, TEST_MAX_HITS) == FALSE)
+  {
+    TEST_CHECK(FALSE, "type %u out of memory", type);
+    return;
+  }
+
+  // Plant values across item, window and block boundaries, and a few in between
+  DWORD32 width = KmGetCompareWidth(type);
+  for (DWORD32 i = 0; i < width; i++)
+  {
+    work.Value[i] = (BYTE)(0x11 * (i + 1));
+  }
+  DWORD64 plants[] =
+  {
+    KM_SCAN_WORK_SIZE - 1,
+    KM_SCAN_WORK_SIZE - width / 2,
+    2 * KM_SCAN_WORK_SIZE - alignment,
+    3 * KM_SCAN_WORK_SIZE + KM_SCAN_WINDOW_SIZE - 3,
+    4 * KM_SCAN_WORK_SIZE - width,
+    KM_SCAN_WINDOW_SIZE + KM_SCAN_BLOCK_SIZE - 1,
+    TEST_SPACE_SIZE - width,
+    TEST_SPACE_SIZE - 1,
+  };
+  memset(space->Bytes, 0, space->Size + KM_PATTERN_MAX_LENGTH);
+  for (DWORD32 i = 0; i < ARRAYSIZE(plants); i++)
+  {
+    memcpy(space->Bytes + plants[i], work.Value, width);
+  }
+  for (DWORD32 i = 0; i < 32; i++)
+  {
+    memcpy(space->Bytes + TestRandom() % (space->Size - width), work.Value, width);
+  }
+  DWORD64 expectedCount = TestReference(space, work.Value, width, alignment, expected);
+
+  // Every worker count merges to the serial result in address order
+  DWORD32 threadCounts[] = { 1, 2, 3, 8 };
+  for (DWORD32 i = 0; i < ARRAYSIZE(threadCounts); i++)
+  {
+    DWORD64 count = TestRunWork(&work, threadCounts[i], merged);
+    BOOLEAN same = count == expectedCount && memcmp(merged, expected, count * sizeof(DWORD64)) == 0;
+    TEST_CHECK(same, "type %u alignment %u threads %u: %llu hits, expected %llu", type, alignment, threadCounts[i], (unsigned long long)count, (unsigned long long)expectedCount);
+  }
+
+  TestFreeWork(&work);
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int
+main()
+{
+  // Sizes around one item and a few odd ones
+  DWORD64 sizes[] = { 1, KM_SCAN_PAGE_SIZE, KM_SCAN_WORK_SIZE - 1, KM_SCAN_WORK_SIZE, KM_SCAN_WORK_SIZE + 1, TEST_SPACE_SIZE, 0x100ULL * KM_SCAN_WORK_SIZE + 7 };
+  for (DWORD32 i = 0; i < ARRAYSIZE(sizes); i++)
+  {
+    TestPartitions(sizes[i]);
+  }
+  TEST_CHECK(KmCountPartitions(0) == 0, "empty region has items");
+
+  // The space is not repeated, the buffer still carries the reach past its end
+  TEST_SPACE space;
+  space.Base = TEST_SPACE_BASE;
+  space.Size = TEST_SPACE_SIZE;
+  space.Period = TEST_SPACE_SIZE;
+  space.Bytes = malloc(TEST_SPACE_SIZE + KM_PATTERN_MAX_LENGTH);
+  if (space.Bytes == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  // Integers at byte and natural alignment
+  for (DWORD32 type = SCAN_TYPE_BYTE16; type <= SCAN_TYPE_BYTE64; type++)
+  {
+    TestWorkers(&space, type, 1);
+    TestWorkers(&space, type, KmGetCompareWidth(type));
+  }
+
+  free(space.Bytes);
+  return TestReport("work");
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#ifndef TEST_WORK_H
+#define TEST_WORK_H
+
+#include <test_core.h>
+#include <km_partition.h>
+
+#include <pthread.h>
+
+///////////////////////////////////////////////////////////
+// Work data types
+///////////////////////////////////////////////////////////
+
+typedef struct _TEST_SPACE
+{
+  PBYTE Bytes;
+  DWORD64 Base;
+  DWORD64 Size;
+  DWORD64 Period;
+} TEST_SPACE, * PTEST_SPACE;
+
+typedef struct _TEST_ITEM
+{
+  SCAN_PARTITION Partition;
+  PDWORD64 Hits;
+  DWORD32 HitCount;
+  DWORD32 HitCapacity;
+  DWORD64 HitTotal;
+} TEST_ITEM, * PTEST_ITEM;
+
+typedef struct _TEST_WORK
+{
+  PTEST_SPACE Space;
+  SCAN_COMPARE_ROUTINE Routine;
+  BYTE Value[sizeof(INT64)];
+  DWORD32 Alignment;
+  DWORD32 Reach;
+  PTEST_ITEM Items;
+  DWORD32 Count;
+  volatile LONG Next;
+} TEST_WORK, * PTEST_WORK;
+
+typedef struct _TEST_WORK_SCAN
+{
+  PTEST_WORK Work;
+  PTEST_ITEM Item;
+} TEST_WORK_SCAN, * PTEST_WORK_SCAN;
+
+typedef struct _TEST_WORK_MERGE
+{
+  PTEST_WORK Work;
+  PDWORD64 Hits;
+  DWORD64 HitCount;
+} TEST_WORK_MERGE, * PTEST_WORK_MERGE;
+
+///////////////////////////////////////////////////////////
+// Work model
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+TestMapSpace(
+  PVOID context,
+  DWORD64 base,
+  DWORD32 size,
+  PBYTE* mapped)
+{
+  PTEST_SPACE space = (PTEST_SPACE)context;
+
+  // Large spaces repeat one period, the buffer carries a window past it so every span maps flat
+  UNREFERENCED_PARAMETER(size);
+  *mapped = space->Bytes + (base - space->Base) % space->Period;
+  return TRUE;
+}
+
+static
+VOID
+TestScanWorkSpan(
+  PVOID context,
+  DWORD64 base,
+  PBYTE bytes,
+  DWORD32 size,
+  DWORD32 owned)
+{
+  PTEST_WORK_SCAN scan = (PTEST_WORK_SCAN)context;
+  PTEST_WORK work = scan->Work;
+  PTEST_ITEM item = scan->Item;
+  DWORD32 offsets[KM_SCAN_BLOCK_SIZE + KM_PATTERN_MAX_LENGTH];
+
+  // Same block walk as the exact scan window routine
+  for (DWORD32 offset = 0; offset < owned; offset += KM_SCAN_BLOCK_SIZE)
+  {
+    DWORD32 blockSize = (KM_SCAN_BLOCK_SIZE + work->Reach < size - offset) ? (KM_SCAN_BLOCK_SIZE + work->Reach) : (size - offset);
+    DWORD32 count = work->Routine(bytes + offset, blockSize, work->Value, work->Alignment, offsets);
+    count = KmTrimOffsets(offsets, count, (KM_SCAN_BLOCK_SIZE < owned - offset) ? KM_SCAN_BLOCK_SIZE : (owned - offset));
+    for (DWORD32 i = 0; i < count && item->HitCount < item->HitCapacity; i++)
+    {
+      item->Hits[item->HitCount++] = base + offset + offsets[i];
+    }
+    item->HitTotal += count;
+  }
+}
+
+static
+PVOID
+TestWorkThread(
+  PVOID context)
+{
+  PTEST_WORK work = (PTEST_WORK)context;
+
+  SCAN_WALK walk;
+  walk.Map = TestMapSpace;
+  walk.Unmap = NULL;
+  walk.Step = NULL;
+  walk.Context = work->Space;
+
+  // Drain the shared item list like a driver worker
+  DWORD32 index;
+  while ((index = KmClaimPartition(&work->Next, work->Count)) < work->Count)
+  {
+    TEST_WORK_SCAN scan;
+    scan.Work = work;
+    scan.Item = &work->Items[index];
+    KmWalkScanWindows(&walk, scan.Item->Partition.Base, scan.Item->Partition.Size, scan.Item->Partition.Limit, work->Reach, TestScanWorkSpan, &scan);
+  }
+
+  return NULL;
+}
+
+static
+VOID
+TestSpliceWork(
+  PVOID context,
+  DWORD32 index)
+{
+  PTEST_WORK_MERGE merge = (PTEST_WORK_MERGE)context;
+  PTEST_ITEM item = &merge->Work->Items[index];
+
+  // Keep addresses if the caller collects them, totals always
+  if (merge->Hits)
+  {
+    memcpy(merge->Hits + merge->HitCount, item->Hits, item->HitCount * sizeof(DWORD64));
+  }
+  merge->HitCount += merge->Hits ? item->HitCount : item->HitTotal;
+}
+
+///////////////////////////////////////////////////////////
+// Work API
+///////////////////////////////////////////////////////////
+
+static
+BOOLEAN
+TestInitializeWork(
+  PTEST_WORK work,
+  PTEST_SPACE space,
+  DWORD32 type,
+  DWORD32 alignment,
+  DWORD32 hitCapacity)
+{
+  memset(work, 0, sizeof(TEST_WORK));
+  work->Space = space;
+  work->Routine = KmGetCompareKernel(type, TestIsAvx2Supported());
+  work->Alignment = alignment;
+  work->Reach = KmGetCompareWidth(type) - alignment;
+
+  // One item per partition of the space
+  work->Count = KmCountPartitions(space->Size);
+  work->Items = calloc(work->Count, sizeof(TEST_ITEM));
+  if (work->Items == NULL)
+  {
+    return FALSE;
+  }
+  for (DWORD32 i = 0; i < work->Count; i++)
+  {
+    work->Items[i].Partition = KmGetPartition(space->Base, space->Size, i);
+    work->Items[i].HitCapacity = hitCapacity;
+    if (hitCapacity)
+    {
+      work->Items[i].Hits = malloc(hitCapacity * sizeof(DWORD64));
+      if (work->Items[i].Hits == NULL)
+      {
+        return FALSE;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+static
+VOID
+TestFreeWork(
+  PTEST_WORK work)
+{
+  for (DWORD32 i = 0; i < work->Count; i++)
+  {
+    free(work->Items[i].Hits);
+  }
+  free(work->Items);
+}
+
+static
+DWORD64
+TestRunWork(
+  PTEST_WORK work,
+  DWORD32 threadCount,
+  PDWORD64 hits)
+{
+  pthread_t threads[KM_SCAN_MAX_WORKERS];
+
+  // Reset items and claims
+  work->Next = 0;
+  for (DWORD32 i = 0; i < work->Count; i++)
+  {
+    work->Items[i].HitCount = 0;
+    work->Items[i].HitTotal = 0;
+  }
+
+  // Start workers, the calling thread only waits like the driver does
+  DWORD32 started = 0;
+  for (; started < threadCount && started < KM_SCAN_MAX_WORKERS; started++)
+  {
+    if (pthread_create(&threads[started], NULL, TestWorkThread, work) != 0)
+    {
+      break;
+    }
+  }
+  if (started == 0)
+  {
+    TestWorkThread(work);
+  }
+  for (DWORD32 i = 0; i < started; i++)
+  {
+    pthread_join(threads[i], NULL);
+  }
+
+  // Merge item results in address order
+  TEST_WORK_MERGE merge;
+  merge.Work = work;
+  merge.Hits = hits;
+  merge.HitCount = 0;
+  KmSplicePartitions(work->Count, TestSpliceWork, &merge);
+
+  return merge.HitCount;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,107 @@
+#ifndef KM_CORE_H
+#define KM_CORE_H
+
+// Stands in for the kernel headers so pool backed driver modules build into the Linux harness
+#include <km_platform.h>
+
+#include <stdlib.h>
+#include <stddef.h>
+
+///////////////////////////////////////////////////////////
+// Kernel data types
+///////////////////////////////////////////////////////////
+
+typedef LONG NTSTATUS;
+typedef size_t SIZE_T, * PSIZE_T;
+typedef uint32_t ULONG, * PULONG;
+
+typedef struct _LIST_ENTRY
+{
+  struct _LIST_ENTRY* Flink;
+  struct _LIST_ENTRY* Blink;
+} LIST_ENTRY, * PLIST_ENTRY;
+
+typedef enum _POOL_TYPE
+{
+  NonPagedPool,
+  PagedPool,
+} POOL_TYPE;
+
+#define STATUS_SUCCESS ((NTSTATUS)0x00000000L)
+#define STATUS_UNSUCCESSFUL ((NTSTATUS)0xC0000001L)
+#define STATUS_INVALID_PARAMETER ((NTSTATUS)0xC000000DL)
+#define STATUS_INSUFFICIENT_RESOURCES ((NTSTATUS)0xC000009AL)
+
+#define NT_SUCCESS(status) (((NTSTATUS)(status)) >= 0)
+
+#define PAGE_SIZE 0x1000
+#define PAGE_SHIFT 12
+
+#define FIELD_OFFSET(type, field) ((LONG)offsetof(type, field))
+#define CONTAINING_RECORD(address, type, field) ((type*)((PBYTE)(address) - offsetof(type, field)))
+
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+///////////////////////////////////////////////////////////
+// Kernel runtime
+///////////////////////////////////////////////////////////
+
+#define RtlMoveMemory(destination, source, length) memmove((destination), (source), (length))
+
+#define ExAllocatePoolWithTag(type, size, tag) malloc(size)
+#define ExFreePoolWithTag(pointer, tag) free(pointer)
+
+static __inline
+VOID
+InitializeListHead(
+  PLIST_ENTRY head)
+{
+  head->Flink = head->Blink = head;
+}
+
+static __inline
+BOOLEAN
+IsListEmpty(
+  const LIST_ENTRY* head)
+{
+  return head->Flink == head;
+}
+
+static __inline
+VOID
+InsertTailList(
+  PLIST_ENTRY head,
+  PLIST_ENTRY entry)
+{
+  entry->Flink = head;
+  entry->Blink = head->Blink;
+  head->Blink->Flink = entry;
+  head->Blink = entry;
+}
+
+static __inline
+BOOLEAN
+RemoveEntryList(
+  PLIST_ENTRY entry)
+{
+  entry->Blink->Flink = entry->Flink;
+  entry->Flink->Blink = entry->Blink;
+  return entry->Flink == entry->Blink;
+}
+
+static __inline
+PLIST_ENTRY
+RemoveHeadList(
+  PLIST_ENTRY head)
+{
+  PLIST_ENTRY entry = head->Flink;
+  RemoveEntryList(entry);
+  return entry;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include <kc_results.h>
+#include <kc_capture.h>
+#include <kc_pattern.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+
+///////////////////////////////////////////////////////////
+// Result tool limits
+///////////////////////////////////////////////////////////
+
+#define KC_RESULTS_MAX_VALUE_SIZE 0x100
+
+///////////////////////////////////////////////////////////
+// Result file commands
+///////////////////////////////////////////////////////////
+
+// Offline counterpart of the scanner's Files section, results are exchanged as text on stdin and stdout
+namespace kdbg::results
+{
+  static int32_t Usage()
+  {
+    fprintf(stderr,
+      "usage: kcresults info <file>\n"
+      "       kcresults dump <file> [count]\n"
+      "       kcresults write <file> <type> <value size> [pid] < results\n"
+      "       kcresults diff <previous> <next> <file>\n"
+      "       kcresults scan <capture> <type> <value> <file> [alignment]\n"
+      "       kcresults next <previous> <capture> <filter> <file> [value]\n"
+      "       kcresults pointers <capture> <file> [base size]\n"
+      "results are lines of a hex address and hex value bytes in memory order\n"
+      "types and filters are numbered like the scanner's, patterns are hex bytes with ?? wildcards\n");
+    return EXIT_FAILURE;
+  }
+
+  static bool ParseValue(const char* text, uint8_t* value, uint32_t valueSize)
+  {
+    // Two hex digits per byte, exactly as many bytes as the file stores
+    for (uint32_t i = 0; i < valueSize; i++)
+    {
+      char digits[3] = { text[i * 2], text[i * 2] ? text[i * 2 + 1] : '\0', '\0' };
+      char* end = nullptr;
+      value[i] = (uint8_t)strtoul(digits, &end, 16);
+      if (digits[0] == '\0' || digits[1] == '\0' || *end != '\0')
+      {
+        return false;
+      }
+    }
+    return text[valueSize * 2] == '\0';
+  }
+
+  static bool ParseScanValue(uint32_t type, const std::string& text, std::vector<uint8_t>& value)
+  {
+    // Patterns are bytes followed by masks, text is widened to UTF-16 code units byte wise
+    value.clear();
+    if (type == SCAN_TYPE_BYTES)
+    {
+      std::vector<BYTE> masks = {};
+      bool parsed = pattern::Parse(text, value, masks);
+      value.insert(value.end(), masks.begin(), masks.end());
+      return parsed;
+    }
+    if (KmIsTextCompare(type))
+    {
+      for (char c : text)
+      {
+        value.push_back((uint8_t)c);
+        value.push_back(0);
+      }
+      return !text.empty();
+    }
+
+    // Numbers are stored at the width of their type
+    uint32_t width = KmGetCompareWidth(type);
+    char* end = nullptr;
+    value.assign(width, 0);
+    if (KmIsRealCompare(type))
+    {
+      double real = strtod(text.c_str(), &end);
+      float narrow = (float)real;
+      std::memcpy(value.data(), (width == sizeof(float)) ? (const void*)&narrow : (const void*)&real, width);
+    }
+    else
+    {
+      uint64_t integer = (text[0] == '-') ? (uint64_t)strtoll(text.c_str(), &end, 0) : strtoull(text.c_str(), &end, 0);
+      std::memcpy(value.data(), &integer, width);
+    }
+    return width > 0 && !text.empty() && *end == '\0';
+  }
+
+  static int32_t Info(const std::string& path)
+  {
+    FileView view = {};
+    if (!view.Open(path))
+    {
+      fprintf(stderr, "%s: not a result file\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+
+    const FileHeader& header = view.GetHeader();
+    printf("pid %u\ntype %u\nvalue size %u\nresults %" PRIu64 "\nblocks %" PRIu64 "\n", header.Pid, header.Type, header.ValueSize, header.Count, header.BlockCount);
+    return EXIT_SUCCESS;
+  }
+
+  static int32_t Dump(const std::string& path, uint64_t count)
+  {
+    FileView view = {};
+    if (!view.Open(path))
+    {
+      fprintf(stderr, "%s: not a result file\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+
+    // Same line format write accepts, dumps can be edited and written back
+    uint32_t valueSize = view.GetHeader().ValueSize;
+    FileCursor cursor(view);
+    for (uint64_t i = 0; i < count && cursor.IsValid(); i++, cursor.Next())
+    {
+      printf("%016" PRIX64 " ", cursor.GetBase());
+      for (uint32_t j = 0; j < valueSize; j++)
+      {
+        printf("%02X", cursor.GetValue()[j]);
+      }
+      printf("\n");
+    }
+
+    if (cursor.IsFailed())
+    {
+      fprintf(stderr, "%s: corrupt block\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  static int32_t Write(const std::string& path, uint32_t type, uint32_t valueSize, uint32_t pid)
+  {
+    // Values are at most as wide as the longest pattern the driver scans for
+    if (valueSize > KC_RESULTS_MAX_VALUE_SIZE)
+    {
+      fprintf(stderr, "value size %u exceeds %u\n", valueSize, KC_RESULTS_MAX_VALUE_SIZE);
+      return EXIT_FAILURE;
+    }
+
+    // Results are collected first, files need strictly increasing addresses
+    std::vector<std::pair<uint64_t, std::vector<uint8_t>>> results = {};
+    char line[0x400];
+    char text[0x400];
+    uint64_t number = 0;
+    while (fgets(line, sizeof(line), stdin))
+    {
+      number++;
+      uint64_t base = 0;
+      std::vector<uint8_t> value(valueSize);
+      text[0] = '\0';
+      int32_t fields = sscanf(line, "%" SCNx64 " %1023s", &base, text);
+      if (fields < 1 || (fields == 1 && valueSize) || !ParseValue(text, value.data(), valueSize))
+      {
+        fprintf(stderr, "stdin:%" PRIu64 ": expected an address and %u value bytes\n", number, valueSize);
+        return EXIT_FAILURE;
+      }
+      results.emplace_back(base, std::move(value));
+    }
+
+    // Later lines win over earlier ones for the same address
+    std::stable_sort(results.begin(), results.end(), [](const auto& left, const auto& right) { return left.first < right.first; });
+    FileWriter writer = {};
+    bool written = writer.Open(path, pid, type, valueSize);
+    for (size_t i = 0; i < results.size() && written; i++)
+    {
+      if ((i + 1) == results.size() || results[i + 1].first != results[i].first)
+      {
+        written = writer.Append(&results[i].first, results[i].second.data(), 1);
+      }
+    }
+
+    if (!writer.Close() || !written)
+    {
+      fprintf(stderr, "%s: write failed\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  static int32_t Compare(const std::string& previousPath, const std::string& nextPath, const std::string& path)
+  {
+    FileView previous = {};
+    if (!previous.Open(previousPath))
+    {
+      fprintf(stderr, "%s: not a result file\n", previousPath.c_str());
+      return EXIT_FAILURE;
+    }
+    FileView next = {};
+    if (!next.Open(nextPath))
+    {
+      fprintf(stderr, "%s: not a result file\n", nextPath.c_str());
+      return EXIT_FAILURE;
+    }
+
+    if (!Diff(previous, next, path))
+    {
+      fprintf(stderr, "%s: diff failed\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  static int32_t ScanCapture(const std::string& capturePath, uint32_t type, const std::string& text, const std::string& path, uint32_t alignment)
+  {
+    capture::CaptureView view = {};
+    if (!view.Open(capturePath))
+    {
+      fprintf(stderr, "%s: not a capture\n", capturePath.c_str());
+      return EXIT_FAILURE;
+    }
+
+    // Values are compiled once like the driver does for a first scan
+    std::vector<uint8_t> value = {};
+    capture::Compare compare = {};
+    if (!ParseScanValue(type, text, value) || !compare.Begin(type, alignment, SCAN_ROUNDING_EXACT, 0.0, SCAN_CASE_SENSITIVE, value.data(), (uint32_t)value.size()))
+    {
+      fprintf(stderr, "%s: not a value of type %u\n", text.c_str(), type);
+      return EXIT_FAILURE;
+    }
+
+    if (!capture::Scan(view, compare, type, path))
+    {
+      fprintf(stderr, "%s: scan failed\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  static int32_t NextCapture(const std::string& previousPath, const std::string& capturePath, uint32_t filter, const std::string& path, const std::string& text)
+  {
+    FileView previous = {};
+    if (!previous.Open(previousPath))
+    {
+      fprintf(stderr, "%s: not a result file\n", previousPath.c_str());
+      return EXIT_FAILURE;
+    }
+    capture::CaptureView view = {};
+    if (!view.Open(capturePath))
+    {
+      fprintf(stderr, "%s: not a capture\n", capturePath.c_str());
+      return EXIT_FAILURE;
+    }
+
+    // Operands take the type and width of the previous results
+    const FileHeader& header = previous.GetHeader();
+    std::vector<uint8_t> value = {};
+    capture::Operand operand = {};
+    if ((!text.empty() && !ParseScanValue(header.Type, text, value)) || !operand.Begin(header.Type, header.ValueSize, filter, SCAN_ROUNDING_EXACT, 0.0, value.data(), (uint32_t)value.size()))
+    {
+      fprintf(stderr, "filter %u does not apply to results of type %u\n", filter, header.Type);
+      return EXIT_FAILURE;
+    }
+
+    if (!capture::Next(previous, view, operand, path))
+    {
+      fprintf(stderr, "%s: next scan failed\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  static int32_t ScanCapturePointers(const std::string& capturePath, const std::string& path, uint64_t base, uint64_t size)
+  {
+    capture::CaptureView view = {};
+    if (!view.Open(capturePath))
+    {
+      fprintf(stderr, "%s: not a capture\n", capturePath.c_str());
+      return EXIT_FAILURE;
+    }
+
+    if (!capture::ScanPointers(view, base, size, path))
+    {
+      fprintf(stderr, "%s: pointer scan failed\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+}
+
+///////////////////////////////////////////////////////////
+// Entry point
+///////////////////////////////////////////////////////////
+
+int32_t main(int32_t argc, char** argv)
+{
+  using namespace kdbg::results;
+
+  std::string command = (argc > 1) ? argv[1] : "";
+  if (command == "info" && argc == 3)
+  {
+    return Info(argv[2]);
+  }
+  if (command == "dump" && (argc == 3 || argc == 4))
+  {
+    return Dump(argv[2], (argc == 4) ? strtoull(argv[3], nullptr, 0) : UINT64_MAX);
+  }
+  if (command == "write" && (argc == 5 || argc == 6))
+  {
+    return Write(argv[2], (uint32_t)strtoul(argv[3], nullptr, 0), (uint32_t)strtoul(argv[4], nullptr, 0), (argc == 6) ? (uint32_t)strtoul(argv[5], nullptr, 0) : 0);
+  }
+  if (command == "diff" && argc == 5)
+  {
+    return Compare(argv[2], argv[3], argv[4]);
+  }
+  if (command == "scan" && (argc == 6 || argc == 7))
+  {
+    return ScanCapture(argv[2], (uint32_t)strtoul(argv[3], nullptr, 0), argv[4], argv[5], (argc == 7) ? (uint32_t)strtoul(argv[6], nullptr, 0) : (uint32_t)SCAN_ALIGNMENT_NATURAL);
+  }
+  if (command == "next" && (argc == 6 || argc == 7))
+  {
+    return NextCapture(argv[2], argv[3], (uint32_t)strtoul(argv[4], nullptr, 0), argv[5], (argc == 7) ? argv[6] : "");
+  }
+  if (command == "pointers" && (argc == 4 || argc == 6))
+  {
+    return ScanCapturePointers(argv[2], argv[3], (argc == 6) ? strtoull(argv[4], nullptr, 16) : 0, (argc == 6) ? strtoull(argv[5], nullptr, 16) : 0);
+  }
+  return Usage();
+}
\ No newline at end of file